@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 
 #include "AlgorithmCiftiSeparate.h"
+#include "CaretSparseFile.h"
 #include "CiftiFile.h"
 #include "MetricFile.h"
 #include "VolumeFile.h"
@@ -30,10 +31,12 @@
 #include "CaretOMP.h"
 #include "FileInformation.h"
 #include "CaretPointer.h"
+#include "DotProductKernel.h"
 #include "dot_wrapper.h"
 #include <fstream>
 #include <utility>
 #include <algorithm>
+#include <stdint.h>
 
 using namespace caret;
 using namespace std;
@@ -215,74 +218,117 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
     } else {
         CaretLogInfo("computing " + AString::number(numCacheRows) + " rows at a time, reading rows as needed during processing");
     }
-    vector<CaretArray<float> > outRows;
     if (cacheFullInput)
     {
+        vector<int> rowList(numRows);
         for (int i = 0; i < numRows; ++i)
         {
-            cacheRow(i);
+            rowList[i] = i;
         }
+        correlateInMemory(myCiftiOut, rowList, rowList, numCacheRows, fisherZ);
+        return;
     }
+    vector<CaretArray<float> > outRows;
     for (int startrow = 0; startrow < numRows; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numRows) endrow = numRows;
-        outRows.resize(endrow - startrow);
+        correlateRowsStreaming(startrow, endrow, outRows, fisherZ);
         for (int i = startrow; i < endrow; ++i)
         {
-            if (!cacheFullInput)
+            myCiftiOut->setRow(outRows[i - startrow], i);
+        }
+        clearCache();//tell the cache we are going to preload a different set of rows now
+    }
+}
+
+AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, const AString& sparseOutName, const SparseSettings& sparseSettings,
+                                                     const vector<float>* weights, const bool& fisherZ, const float& memLimitGB, const bool& noDemean,
+                                                     const bool& covariance) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    if (covariance)
+    {
+        if (fisherZ) throw AlgorithmException("cannot apply fisher z transformation to covariance");
+    }
+    if (sparseSettings.m_topK < 0 && !sparseSettings.m_useThreshold) throw AlgorithmException("sparse output requires a top-k count or a threshold");
+    init(myCifti, weights, noDemean, covariance);
+    int numRows = myCifti->getNumberOfRows();
+    CiftiXML outXML = myCifti->getCiftiXML();
+    outXML.setMap(CiftiXML::ALONG_ROW, *(outXML.getMap(CiftiXML::ALONG_COLUMN)));
+    CaretSparseFileWriter myWriter(sparseOutName, outXML, CaretSparseFile::FLOAT_VALUES);
+    int numCacheRows = numRows;
+    bool cacheFullInput = true;
+    if (memLimitGB >= 0.0f)
+    {
+        numCacheRows = numRowsForMem(memLimitGB, cacheFullInput);
+    }
+    if (numCacheRows > numRows) numCacheRows = numRows;
+    vector<CaretArray<float> > outRows;
+    vector<vector<int64_t> > sparseIndices;
+    vector<vector<float> > sparseValues;
+    if (!cacheFullInput)
+    {//same row by row scan as the dense output, selecting from each chunk of output rows before the next
+        CaretLogInfo("computing " + AString::number(numCacheRows) + " rows at a time, reading rows as needed during processing");
+        for (int startrow = 0; startrow < numRows; startrow += numCacheRows)
+        {
+            int endrow = min(startrow + numCacheRows, numRows), numChunk = endrow - startrow;
+            correlateRowsStreaming(startrow, endrow, outRows, fisherZ);
+            sparseIndices.resize(numChunk);
+            sparseValues.resize(numChunk);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int i = 0; i < numChunk; ++i)
             {
-                cacheRow(i);//preload the rows in a range which we will reuse as much as possible during one row by row scan
+                sparseSettings.select(outRows[i].getArray(), numRows, sparseIndices[i], sparseValues[i]);
             }
-            if (outRows[i - startrow].size() != numRows)
+            for (int i = 0; i < numChunk; ++i)
             {
-                outRows[i - startrow] = CaretArray<float>(numRows);
+                myWriter.writeFloatRowSparse(startrow + i, sparseIndices[i], sparseValues[i]);
             }
+            clearCache();
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
+        myWriter.finish();
+        return;
+    }
+    vector<float> panelStorage;
+    int64_t rowStride;
+    const float* panel = loadPanel(panelStorage, rowStride);
+    const int64_t CHUNK_BYTES = 1<<28;//dense scratch for rows being computed, the full matrix is never held in memory
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    int chunkSize = max(getTileRows() * numThreads, 1);//enough output tiles that every thread has work
+    chunkSize = min((int64_t)chunkSize, max((int64_t)1, CHUNK_BYTES / max((int64_t)1, (int64_t)numRows * (int64_t)sizeof(float))));
+    chunkSize = min(chunkSize, numCacheRows);//-mem-limit also bounds the dense scratch
+    vector<int> chunkRows;
+    for (int startrow = 0; startrow < numRows; startrow += chunkSize)
+    {
+        int numChunk = min(chunkSize, numRows - startrow);
+        outRows.resize(numChunk);
+        chunkRows.resize(numChunk);
+        sparseIndices.resize(numChunk);
+        sparseValues.resize(numChunk);
+        for (int i = 0; i < numChunk; ++i)
         {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
+            if (outRows[i].size() != numRows)
             {
-                if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
-                {
-                    if (j >= myrow)//if so, only compute one half, and store both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(j, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(j, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
+                outRows[i] = CaretArray<float>(numRows);
             }
+            chunkRows[i] = startrow + i;
         }
-        for (int i = startrow; i < endrow; ++i)
+        correlateTiles(panel, rowStride, chunkRows.data(), numChunk, outRows, NULL, fisherZ);//no symmetry within a chunk, because the dense rows are discarded after selection
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int i = 0; i < numChunk; ++i)
         {
-            myCiftiOut->setRow(outRows[i - startrow], i);
+            sparseSettings.select(outRows[i].getArray(), numRows, sparseIndices[i], sparseValues[i]);
         }
-        if (!cacheFullInput)
+        for (int i = 0; i < numChunk; ++i)
         {
-            clearCache();//tell the cache we are going to preload a different set of rows now
+            myWriter.writeFloatRowSparse(startrow + i, sparseIndices[i], sparseValues[i]);
         }
     }
-    if (cacheFullInput)
-    {
-        clearCache();//don't currently need to do this, its just for completeness
-    }
+    myWriter.finish();
 }
 
 AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, CiftiFile* myCiftiOut,
@@ -401,14 +447,18 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
     } else {
         CaretLogInfo("computing " + AString::number(numCacheRows) + " rows at a time, reading rows as needed during processing");
     }
-    vector<CaretArray<float> > outRows;
     if (cacheFullInput)
     {
-        for (int i = 0; i < numRows; ++i)
+        vector<int> rowList(numSelected), outRowList(numSelected);
+        for (int i = 0; i < numSelected; ++i)
         {
-            cacheRow(i);
+            rowList[i] = ciftiIndexList[i].first;
+            outRowList[i] = ciftiIndexList[i].second;
         }
+        correlateInMemory(myCiftiOut, rowList, outRowList, numCacheRows, fisherZ);
+        return;
     }
+    vector<CaretArray<float> > outRows;
     CaretArray<int> indexReverse(numRows, -1);
     for (int startrow = 0; startrow < numSelected; startrow += numCacheRows)
     {
@@ -418,10 +468,7 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
         int curRow = 0;//because we can't trust the order threads hit the critical section
         for (int i = startrow; i < endrow; ++i)
         {
-            if (!cacheFullInput)
-            {
-                cacheRow(ciftiIndexList[i].first);//preload the rows in a range which we will reuse as much as possible during one row by row scan
-            }
+            cacheRow(ciftiIndexList[i].first);//preload the rows in a range which we will reuse as much as possible during one row by row scan
             if (outRows[i - startrow].size() != numRows)
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
@@ -463,14 +510,7 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             myCiftiOut->setRow(outRows[i - startrow], ciftiIndexList[i].second);
             indexReverse[ciftiIndexList[i].first] = -1;
         }
-        if (!cacheFullInput)
-        {
-            clearCache();//tell the cache we are going to preload a different set of rows now
-        }
-    }
-    if (cacheFullInput)
-    {
-        clearCache();//don't currently need to do this, its just for completeness
+        clearCache();//tell the cache we are going to preload a different set of rows now
     }
 }
 
@@ -519,15 +559,23 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
 
 float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
 {
-    double r;
     if (row1 == row2 && !m_covariance)
     {
-        r = 1.0;//short circuit for same row
+        return convertDot(0.0, rrs1, rrs2, true, fisherZ);//short circuit for same row
+    }
+    return convertDot(dsdot(row1, row2, getDotLength()), rrs1, rrs2, false, fisherZ);//these have already had the row means subtracted out, and weights applied
+}
+
+float AlgorithmCiftiCorrelation::convertDot(const double& accum, const float& rrs1, const float& rrs2, const bool& sameRow, const bool& fisherZ)
+{
+    double r;
+    if (sameRow && !m_covariance)
+    {
+        r = 1.0;
     } else {
         if (m_weightedMode)
         {
             int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-            double accum = dsdot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
             if (m_covariance)
             {
                 if (m_binaryWeights)
@@ -540,7 +588,6 @@ float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1,
                 r = accum / (rrs1 * rrs2);//as do these
             }
         } else {
-            double accum = dsdot(row1, row2, m_numCols);//these have already had the row means subtracted out
             if (m_covariance)
             {
                 r = accum / m_numCols;
@@ -617,16 +664,204 @@ void AlgorithmCiftiCorrelation::cacheRow(const int& ciftiIndex)
         m_rowCache[m_cacheUsed].m_row.resize(m_numCols);
     }
     m_rowCache[m_cacheUsed].m_ciftiIndex = ciftiIndex;
-    float* myPtr = m_rowCache[m_cacheUsed].m_row.data();
-    m_inputCifti->getRow(myPtr, ciftiIndex);
+    loadRow(ciftiIndex, m_rowCache[m_cacheUsed].m_row.data());
+    m_rowInfo[ciftiIndex].m_cacheIndex = m_cacheUsed;
+    ++m_cacheUsed;
+}
+
+void AlgorithmCiftiCorrelation::loadRow(const int& ciftiIndex, float* rowOut)
+{
+    m_inputCifti->getRow(rowOut, ciftiIndex);
     if (!m_rowInfo[ciftiIndex].m_haveCalculated)
     {
-        computeRowStats(myPtr, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
+        computeRowStats(rowOut, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
         m_rowInfo[ciftiIndex].m_haveCalculated = true;
     }
-    doSubtract(myPtr, m_rowInfo[ciftiIndex].m_mean);
-    m_rowInfo[ciftiIndex].m_cacheIndex = m_cacheUsed;
-    ++m_cacheUsed;
+    doSubtract(rowOut, m_rowInfo[ciftiIndex].m_mean);
+}
+
+const float* AlgorithmCiftiCorrelation::loadPanel(vector<float>& storage, int64_t& rowStride)
+{
+    const int64_t ALIGN_FLOATS = 16;//64 bytes, a cache line and the width of an AVX-512 register
+    int numRows = m_inputCifti->getNumberOfRows();
+    rowStride = ((m_numCols + ALIGN_FLOATS - 1) / ALIGN_FLOATS) * ALIGN_FLOATS;
+    storage.resize(rowStride * numRows + ALIGN_FLOATS);
+    float* panel = storage.data();
+    while (((uintptr_t)panel) % (ALIGN_FLOATS * sizeof(float)) != 0) ++panel;//floats are at least 4-byte aligned, so this stays inside the extra space
+    if (m_inputCifti->supportsConcurrentRead())
+    {//each row only touches its own RowInfo, so rows can be loaded in any order
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int i = 0; i < numRows; ++i)
+        {
+            loadRow(i, panel + i * rowStride);
+        }
+    } else {
+        for (int i = 0; i < numRows; ++i)
+        {
+            loadRow(i, panel + i * rowStride);
+        }
+    }
+    return panel;
+}
+
+void AlgorithmCiftiCorrelation::correlateInMemory(CiftiFile* ciftiOut, const vector<int>& rowList, const vector<int>& outRowList, const int& numCacheRows, const bool& fisherZ)
+{
+    CaretAssert(rowList.size() == outRowList.size());
+    int numRows = m_inputCifti->getNumberOfRows(), numSelected = (int)rowList.size();
+    vector<float> panelStorage;
+    int64_t rowStride;
+    const float* panel = loadPanel(panelStorage, rowStride);
+    vector<CaretArray<float> > outRows;
+    vector<int> indexReverse(numRows, -1);//position of an input row within the current chunk of output rows, to compute symmetric pairs only once
+    for (int startrow = 0; startrow < numSelected; startrow += numCacheRows)
+    {
+        int endrow = min(startrow + numCacheRows, numSelected), numChunk = endrow - startrow;
+        outRows.resize(numChunk);
+        for (int i = 0; i < numChunk; ++i)
+        {
+            if (outRows[i].size() != numRows)
+            {
+                outRows[i] = CaretArray<float>(numRows);
+            }
+            indexReverse[rowList[startrow + i]] = i;
+        }
+        correlateTiles(panel, rowStride, rowList.data() + startrow, numChunk, outRows, indexReverse.data(), fisherZ);
+        for (int i = 0; i < numChunk; ++i)
+        {
+            ciftiOut->setRow(outRows[i], outRowList[startrow + i]);
+            indexReverse[rowList[startrow + i]] = -1;
+        }
+    }
+}
+
+int AlgorithmCiftiCorrelation::getTileRows() const
+{
+    const int64_t TILE_BYTES = 1<<17;//two tiles of input rows should stay in L2 while they are multiplied against each other
+    int ret = (int)(TILE_BYTES / max((int64_t)1, (int64_t)getDotLength() * (int64_t)sizeof(float)));
+    if (ret < 4) ret = 4;
+    if (ret > 256) ret = 256;
+    return ret;
+}
+
+void AlgorithmCiftiCorrelation::correlateTiles(const float* panel, const int64_t& rowStride, const int* chunkRows, const int& numChunk,
+                                               vector<CaretArray<float> >& outRows, const int* indexReverse, const bool& fisherZ)
+{
+    int numRows = m_inputCifti->getNumberOfRows();
+    const int dotLength = getDotLength(), tileRows = getTileRows();
+    int64_t numOutTiles = (numChunk + tileRows - 1) / tileRows, numInTiles = (numRows + tileRows - 1) / tileRows;
+    const bool useBlocks = DotProductKernel::isAVX2Enabled();//otherwise dsdot one pair at a time, which picks its own SIMD version
+#pragma omp CARET_PAR
+    {
+        vector<float> packed;//one block of input rows, interleaved for DotProductKernel
+        if (useBlocks) packed.resize((int64_t)dotLength * DotProductKernel::BLOCK_COLS);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t tile = 0; tile < numOutTiles * numInTiles; ++tile)
+        {//input tiles vary fastest, so a thread keeps its output tile's rows in cache while streaming input tiles past them
+            int outStart = (int)(tile / numInTiles) * tileRows, outEnd = min(outStart + tileRows, numChunk);
+            int inStart = (int)(tile % numInTiles) * tileRows, inEnd = min(inStart + tileRows, numRows);
+            if (useBlocks)
+            {
+                correlateTileBlocks(panel, rowStride, chunkRows, outStart, outEnd, inStart, inEnd, packed.data(), outRows, indexReverse, fisherZ);
+                continue;
+            }
+            for (int i = outStart; i < outEnd; ++i)
+            {
+                int myrow = chunkRows[i];
+                const float* row1 = panel + myrow * rowStride;
+                const float rrs1 = m_rowInfo[myrow].m_rootResidSqr;
+                float* outRow = outRows[i].getArray();
+                for (int j = inStart; j < inEnd; ++j)
+                {
+                    int mirror = (indexReverse == NULL ? -1 : indexReverse[j]);
+                    if (mirror != -1 && mirror < i) continue;//both rows are in the chunk, the pair is computed once by the earlier one
+                    bool sameRow = (j == myrow);
+                    double accum = ((sameRow && !m_covariance) ? 0.0 : dsdot(row1, panel + j * rowStride, dotLength));
+                    outRow[j] = convertDot(accum, rrs1, m_rowInfo[j].m_rootResidSqr, sameRow, fisherZ);
+                    if (mirror != -1) outRows[mirror][myrow] = outRow[j];
+                }
+            }
+        }
+    }
+}
+
+void AlgorithmCiftiCorrelation::correlateTileBlocks(const float* panel, const int64_t& rowStride, const int* chunkRows, const int& outStart, const int& outEnd,
+                                                    const int& inStart, const int& inEnd, float* packed, vector<CaretArray<float> >& outRows,
+                                                    const int* indexReverse, const bool& fisherZ)
+{
+    const int BLOCK_ROWS = DotProductKernel::BLOCK_ROWS, BLOCK_COLS = DotProductKernel::BLOCK_COLS;
+    const int dotLength = getDotLength();
+    const float* inPtrs[BLOCK_COLS];
+    const float* outPtrs[BLOCK_ROWS];
+    double dots[BLOCK_ROWS * BLOCK_COLS];
+    for (int blockIn = inStart; blockIn < inEnd; blockIn += BLOCK_COLS)
+    {//pack a few input rows once, then run every output row of the tile past them
+        int numIn = min(BLOCK_COLS, inEnd - blockIn);
+        for (int c = 0; c < numIn; ++c)
+        {
+            inPtrs[c] = panel + (blockIn + c) * rowStride;
+        }
+        DotProductKernel::packRows(inPtrs, numIn, dotLength, packed);
+        for (int blockOut = outStart; blockOut < outEnd; blockOut += BLOCK_ROWS)
+        {
+            int numOut = min(BLOCK_ROWS, outEnd - blockOut);
+            bool needed = (indexReverse == NULL);
+            for (int r = 0; r < numOut && !needed; ++r)
+            {
+                for (int c = 0; c < numIn; ++c)
+                {
+                    int mirror = indexReverse[blockIn + c];
+                    if (mirror == -1 || mirror >= blockOut + r)
+                    {
+                        needed = true;
+                        break;
+                    }
+                }
+            }
+            if (!needed) continue;//every pair in the block is computed by its mirror
+            for (int r = 0; r < BLOCK_ROWS; ++r)
+            {
+                outPtrs[r] = panel + chunkRows[blockOut + min(r, numOut - 1)] * rowStride;//repeat the last row to fill a partial block
+            }
+            DotProductKernel::dotBlock(outPtrs, packed, dotLength, dots);
+            for (int r = 0; r < numOut; ++r)
+            {
+                int i = blockOut + r, myrow = chunkRows[i];
+                const float rrs1 = m_rowInfo[myrow].m_rootResidSqr;
+                float* outRow = outRows[i].getArray();
+                for (int c = 0; c < numIn; ++c)
+                {
+                    int j = blockIn + c;
+                    int mirror = (indexReverse == NULL ? -1 : indexReverse[j]);
+                    if (mirror != -1 && mirror < i) continue;//same symmetry as the pairwise loop
+                    outRow[j] = convertDot(dots[r * BLOCK_COLS + c], rrs1, m_rowInfo[j].m_rootResidSqr, (j == myrow), fisherZ);
+                    if (mirror != -1) outRows[mirror][myrow] = outRow[j];
+                }
+            }
+        }
+    }
+}
+
+void AlgorithmCiftiCorrelation::SparseSettings::select(const float* row, const int64_t& length, vector<int64_t>& indicesOut, vector<float>& valuesOut) const
+{
+    indicesOut.clear();
+    for (int64_t i = 0; i < length; ++i)
+    {
+        if (row[i] != row[i]) continue;//NaN from a constant row
+        if (m_useThreshold && !(row[i] >= m_threshold)) continue;
+        indicesOut.push_back(i);
+    }
+    if (m_topK >= 0 && (int64_t)indicesOut.size() > m_topK)
+    {
+        nth_element(indicesOut.begin(), indicesOut.begin() + m_topK, indicesOut.end(),
+                    [row](const int64_t& a, const int64_t& b) { return row[a] > row[b]; });
+        indicesOut.resize(m_topK);
+        sort(indicesOut.begin(), indicesOut.end());//sparse rows must be written in index order
+    }
+    valuesOut.resize(indicesOut.size());
+    for (size_t i = 0; i < indicesOut.size(); ++i)
+    {
+        valuesOut[i] = row[indicesOut[i]];
+    }
 }
 
 void AlgorithmCiftiCorrelation::clearCache()
@@ -652,13 +887,7 @@ const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& roo
             throw AlgorithmException("something very bad happened, notify the developers");
         }
         ret = getTempRow();
-        m_inputCifti->getRow(ret, ciftiIndex);
-        if (!m_rowInfo[ciftiIndex].m_haveCalculated)
-        {
-            computeRowStats(ret, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
-            m_rowInfo[ciftiIndex].m_haveCalculated = true;
-        }
-        doSubtract(ret, m_rowInfo[ciftiIndex].m_mean);
+        loadRow(ciftiIndex, ret);
     }
     rootResidSqr = m_rowInfo[ciftiIndex].m_rootResidSqr;
     return ret;
@@ -793,6 +1022,51 @@ float* AlgorithmCiftiCorrelation::getTempRow()
 #endif
 }
 
+void AlgorithmCiftiCorrelation::correlateRowsStreaming(const int& startrow, const int& endrow, vector<CaretArray<float> >& outRows, const bool& fisherZ)
+{
+    int numRows = m_inputCifti->getNumberOfRows();
+    outRows.resize(endrow - startrow);
+    for (int i = startrow; i < endrow; ++i)
+    {
+        cacheRow(i);//preload the rows in a range which we will reuse as much as possible during one row by row scan
+        if (outRows[i - startrow].size() != numRows)
+        {
+            outRows[i - startrow] = CaretArray<float>(numRows);
+        }
+    }
+    int curRow = 0;//because we can't trust the order threads hit the critical section
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int i = 0; i < numRows; ++i)
+    {
+        float movingRrs;
+        int myrow;
+        const float* movingRow;
+#pragma omp critical
+        {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
+            myrow = curRow;//so, manually force it to read sequentially
+            ++curRow;
+            movingRow = getRow(myrow, movingRrs);
+        }
+        for (int j = startrow; j < endrow; ++j)
+        {
+            if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
+            {
+                if (j >= myrow)//if so, only compute one half, and store both places
+                {
+                    float cacheRrs;
+                    const float* cacheRow = getRow(j, cacheRrs, true);
+                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
+                    outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
+                }
+            } else {
+                float cacheRrs;
+                const float* cacheRow = getRow(j, cacheRrs, true);
+                outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
+            }
+        }
+    }
+}
+
 int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cacheFullInput)
 {
     int numRows = m_inputCifti->getNumberOfRows();
@@ -56,18 +56,39 @@ namespace caret {
         int m_numCols;
         const CiftiFile* m_inputCifti;//so that accesses work through the cache functions
         void cacheRow(const int& ciftiIndex);
+        void loadRow(const int& ciftiIndex, float* rowOut);//reads, computes stats if needed, and demeans/compacts the row
+        const float* loadPanel(std::vector<float>& storage, int64_t& rowStride);//all rows in one aligned buffer, for correlateInMemory
+        void correlateInMemory(CiftiFile* ciftiOut, const std::vector<int>& rowList, const std::vector<int>& outRowList, const int& numCacheRows, const bool& fisherZ);
+        int getTileRows() const;
+        void correlateTiles(const float* panel, const int64_t& rowStride, const int* chunkRows, const int& numChunk,
+                            std::vector<CaretArray<float> >& outRows, const int* indexReverse, const bool& fisherZ);//indexReverse may be NULL to skip symmetry
+        void correlateTileBlocks(const float* panel, const int64_t& rowStride, const int* chunkRows, const int& outStart, const int& outEnd,
+                                 const int& inStart, const int& inEnd, float* packed, std::vector<CaretArray<float> >& outRows,
+                                 const int* indexReverse, const bool& fisherZ);//one tile through DotProductKernel, packed holds one block of input rows
+        void correlateRowsStreaming(const int& startrow, const int& endrow, std::vector<CaretArray<float> >& outRows, const bool& fisherZ);//rows startrow to endrow against all rows, reading them from the file in order
         void computeRowStats(const float* row, float& mean, float& rootResidSqr);
         void doSubtract(float* row, const float& mean);
         void clearCache();
         const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
         float* getTempRow();
         float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        float convertDot(const double& accum, const float& rrs1, const float& rrs2, const bool& sameRow, const bool& fisherZ);//normalization, clamping and fisher z
+        int getDotLength() const { return m_weightedMode ? (int)m_weightIndexes.size() : m_numCols; }//weighted rows are compacted to exclude zero weights
         void init(const CiftiFile* input, const std::vector<float>* weights, const bool& noDemean, const bool& covariance);
         int numRowsForMem(const float& memLimitGB, bool& cacheFullInput);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
+        ///which correlations to keep per row when writing sparse output
+        struct SparseSettings
+        {
+            int64_t m_topK;//negative for no limit
+            bool m_useThreshold;
+            float m_threshold;//values at or above this are kept
+            SparseSettings() { m_topK = -1; m_useThreshold = false; m_threshold = 0.0f; }
+            void select(const float* row, const int64_t& length, std::vector<int64_t>& indicesOut, std::vector<float>& valuesOut) const;
+        };
         AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, CiftiFile* myCiftiOut, const std::vector<float>* weights = NULL,
                                   const bool& fisherZ = false, const float& memLimitGB = -1.0f, const bool& noDemean = false, const bool& covariance = false);
         AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, CiftiFile* myCiftiOut,
@@ -77,6 +98,9 @@ namespace caret {
         AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, CiftiFile* myCiftiOut, const CiftiFile* ciftiRoi,
                                   const std::vector<float>* weights = NULL, const bool& fisherZ = false, const float& memLimitGB = -1.0f,
                                   const bool& noDemean = false, const bool& covariance = false);
+        AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, const AString& sparseOutName, const SparseSettings& sparseSettings,
+                                  const std::vector<float>* weights = NULL, const bool& fisherZ = false, const float& memLimitGB = -1.0f,
+                                  const bool& noDemean = false, const bool& covariance = false);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
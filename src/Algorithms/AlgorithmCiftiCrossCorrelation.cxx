@@ -24,10 +24,12 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretOMP.h"
+#include "CaretSparseFile.h"
 #include "CiftiFile.h"
 #include "dot_wrapper.h"
 #include "FileInformation.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
@@ -133,30 +135,73 @@ AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* m
     {
         int64_t chunkEnd = chunkStart + chunkSize;
         if (chunkEnd > m_numRowsA) chunkEnd = m_numRowsA;
-        cacheRowsA(chunkStart, chunkEnd);
-        int64_t counter = 0;
+        computeChunk(chunkStart, chunkEnd, outscratch, fisherZ);
+        for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
+        {
+            myCiftiOut->setRow(outscratch[indA - chunkStart].data(), indA);
+        }
+    }
+}
+
+AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, const AString& sparseOutName,
+                                                               const AlgorithmCiftiCorrelation::SparseSettings& sparseSettings, const vector<float>* weights,
+                                                               const bool& fisherZ, const float& memLimitGB) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    if (sparseSettings.m_topK < 0 && !sparseSettings.m_useThreshold) throw AlgorithmException("sparse output requires a top-k count or a threshold");
+    init(myCiftiA, myCiftiB, NULL, weights);
+    CiftiXML outXML = myCiftiA->getCiftiXML();
+    outXML.setMap(CiftiXML::ALONG_ROW, *(myCiftiB->getCiftiXML().getMap(CiftiXML::ALONG_COLUMN)));
+    CaretSparseFileWriter myWriter(sparseOutName, outXML, CaretSparseFile::FLOAT_VALUES);
+    const int64_t CHUNK_BYTES = ((int64_t)1)<<30;//only this much of the dense result exists at once, fewer chunks means fewer passes through <cifti-b>
+    int64_t chunkSize = max((int64_t)1, CHUNK_BYTES / ((int64_t)sizeof(float) * m_numRowsB));
+    if (memLimitGB >= 0.0f)
+    {
+        chunkSize = min(chunkSize, numRowsForMem(memLimitGB));
+    }
+    if (chunkSize > m_numRowsA) chunkSize = m_numRowsA;
+    vector<vector<float> > outscratch(chunkSize, vector<float>(m_numRowsB));
+    vector<vector<int64_t> > sparseIndices(chunkSize);
+    vector<vector<float> > sparseValues(chunkSize);
+    for (int64_t chunkStart = 0; chunkStart < m_numRowsA; chunkStart += chunkSize)
+    {
+        int64_t chunkEnd = chunkStart + chunkSize;
+        if (chunkEnd > m_numRowsA) chunkEnd = m_numRowsA;
+        computeChunk(chunkStart, chunkEnd, outscratch, fisherZ);
 #pragma omp CARET_PARFOR schedule(dynamic)
-        for (int64_t i = 0; i < m_numRowsB; ++i)
+        for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
         {
-            float rrsB;
-            int64_t indB;
-            const float* rowB;
-#pragma omp critical
-            {
-                indB = counter;//manually in-order rows because we need to read them from disk, and can't request more than one at a time
-                ++counter;
-                rowB = getRowB(indB, rrsB);
-            }
-            for (int indA = chunkStart; indA < chunkEnd; ++indA)
-            {
-                float rrsA;
-                const float* rowA = getCachedRowA(indA, rrsA);
-                outscratch[indA - chunkStart][indB] = correlate(rowA, rrsA, rowB, rrsB, fisherZ);
-            }
+            sparseSettings.select(outscratch[indA - chunkStart].data(), m_numRowsB, sparseIndices[indA - chunkStart], sparseValues[indA - chunkStart]);
         }
         for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
         {
-            myCiftiOut->setRow(outscratch[indA - chunkStart].data(), indA);
+            myWriter.writeFloatRowSparse(indA, sparseIndices[indA - chunkStart], sparseValues[indA - chunkStart]);
+        }
+    }
+    myWriter.finish();
+}
+
+void AlgorithmCiftiCrossCorrelation::computeChunk(const int64_t& chunkStart, const int64_t& chunkEnd, vector<vector<float> >& outscratch, const bool& fisherZ)
+{
+    cacheRowsA(chunkStart, chunkEnd);
+    int64_t counter = 0;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < m_numRowsB; ++i)
+    {
+        float rrsB;
+        int64_t indB;
+        const float* rowB;
+#pragma omp critical
+        {
+            indB = counter;//manually in-order rows because we need to read them from disk, and can't request more than one at a time
+            ++counter;
+            rowB = getRowB(indB, rrsB);
+        }
+        for (int indA = chunkStart; indA < chunkEnd; ++indA)
+        {
+            float rrsA;
+            const float* rowA = getCachedRowA(indA, rrsA);
+            outscratch[indA - chunkStart][indB] = correlate(rowA, rrsA, rowB, rrsB, fisherZ);
         }
     }
 }
@@ -209,7 +254,7 @@ void AlgorithmCiftiCrossCorrelation::init(const CiftiFile* myCiftiA, const Cifti
 int64_t AlgorithmCiftiCrossCorrelation::numRowsForMem(const float& memLimitGB)
 {
     int64_t targetBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
-    if (m_ciftiOut->isInMemory()) targetBytes -= sizeof(float) * m_numRowsA * m_numRowsB;//count only in-memory output against total, the only time inputs might be in memory is in the GUI
+    if (m_ciftiOut != NULL && m_ciftiOut->isInMemory()) targetBytes -= sizeof(float) * m_numRowsA * m_numRowsB;//count only in-memory output against total, the only time inputs might be in memory is in the GUI
     int64_t bytesPerInputRow = sizeof(float) * m_numCols;//this means we expect the user to give "current free memory" as the limit
     int64_t bytesPerOutputRow = sizeof(float) * m_numRowsB;
 #ifdef CARET_OMP
@@ -23,6 +23,7 @@
 
 #include "AbstractAlgorithm.h"
 
+#include "AlgorithmCiftiCorrelation.h"
 #include "CaretPointer.h"
 
 #include <vector>
@@ -65,12 +66,16 @@ namespace caret {
         void adjustRow(float* row, RowInfo& info);
         float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
         void cacheRowsA(const int64_t& begin, const int64_t& end);//grabs the rows and does whatever it needs to, using as much IO bandwidth and CPU resources as available/needed
+        void computeChunk(const int64_t& chunkStart, const int64_t& chunkEnd, std::vector<std::vector<float> >& outscratch, const bool& fisherZ);//dense correlations of a range of A rows with all of B
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
         AlgorithmCiftiCrossCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, CiftiFile* myCiftiOut,
                                        const std::vector<float>* weights, const bool& fisherZ, const float& memLimitGB);
+        AlgorithmCiftiCrossCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, const AString& sparseOutName,
+                                       const AlgorithmCiftiCorrelation::SparseSettings& sparseSettings, const std::vector<float>* weights = NULL,
+                                       const bool& fisherZ = false, const float& memLimitGB = -1.0f);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
 #include "CiftiFile.h"
+#include "CiftiRowPipeline.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "MetricFile.h"
@@ -326,19 +327,30 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     }
     if (direction == CiftiXML::ALONG_ROW)
     {
-        vector<float> scratchOutRow(numParcels);
-        vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
+        vector<vector<float> > parcelDataTemplate(numParcels);//float so we can use ReductionOperation
         for (int j = 0; j < numParcels; ++j)
         {
-            parcelData[j].reserve(parcelCounts[j]);
+            parcelDataTemplate[j].reserve(parcelCounts[j]);
         }
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
+        vector<vector<vector<float> > > threadParcelData(CiftiRowPipeline::getNumThreads(), parcelDataTemplate);
+        vector<int32_t> unassignedKeys;//getUnassignedLabelKey can modify the table, so look them up before going multithreaded
+        if (isLabel)
         {
+            for (int64_t i = 0; i < dims[labelDir]; ++i)
+            {
+                unassignedKeys.push_back(myOutXML.getLabelsMap(labelDir).getMapLabelTable(i)->getUnassignedLabelKey());
+            }
+        }
+        CiftiRowPipeline myPipeline(myCiftiOut);
+        myPipeline.addInput(myCiftiIn);
+        myPipeline.run([&](const vector<int64_t>& indices, const vector<const float*>& rowsIn, float* scratchOutRow, const int& thread)
+        {
+            vector<vector<float> >& parcelData = threadParcelData[thread];
             for (int j = 0; j < numParcels; ++j)
             {
                 parcelData[j].clear();//doesn't change allocation
             }
-            myCiftiIn->getRow(scratchRow.data(), *iter);
+            const float* inRow = rowsIn[0];
             for (int64_t j = 0; j < numCols; ++j)
             {
                 int parcel = indexToParcel[j];
@@ -346,9 +358,9 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                 {
                     if (isLabel)
                     {
-                        parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
+                        parcelData[parcel].push_back(floor(inRow[j] + 0.5f));//round to nearest integer to be safe
                     } else {
-                        parcelData[parcel].push_back(scratchRow[j]);
+                        parcelData[parcel].push_back(inRow[j]);
                     }
                 }
             }
@@ -371,14 +383,13 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                 } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
                     if (isLabel)
                     {
-                        scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
+                        scratchOutRow[j] = unassignedKeys[indices[labelDir - 1]];
                     } else {
                         scratchOutRow[j] = emptyFillVal;//odd corner case, but probably fine: with nonzero empty fill value and SAMPSTDEV, parcels with only one element get the fill value, but aren't technically empty
                     }
                 }
             }
-            myCiftiOut->setRow(scratchOutRow.data(), *iter);
-        }
+        });
     } else {
         vector<float> scratchOutRow(numCols);
         vector<int64_t> otherDims = dims;
@@ -525,19 +536,30 @@ namespace
         vector<float> scratchRow(numCols);
         if (direction == CiftiXML::ALONG_ROW)
         {
-            vector<float> scratchOutRow(numParcels);
-            vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
+            vector<vector<float> > parcelDataTemplate(numParcels);//float so we can use ReductionOperation
             for (int j = 0; j < numParcels; ++j)
             {
-                parcelData[j].reserve(parcelWeights[j].size());
+                parcelDataTemplate[j].reserve(parcelWeights[j].size());
             }
-            for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
+            vector<vector<vector<float> > > threadParcelData(CiftiRowPipeline::getNumThreads(), parcelDataTemplate);
+            vector<int32_t> unassignedKeys;//getUnassignedLabelKey can modify the table, so look them up before going multithreaded
+            if (isLabel)
             {
+                for (int64_t i = 0; i < dims[labelDir]; ++i)
+                {
+                    unassignedKeys.push_back(myOutXML.getLabelsMap(labelDir).getMapLabelTable(i)->getUnassignedLabelKey());
+                }
+            }
+            CiftiRowPipeline myPipeline(myCiftiOut);
+            myPipeline.addInput(myCiftiIn);
+            myPipeline.run([&](const vector<int64_t>& indices, const vector<const float*>& rowsIn, float* scratchOutRow, const int& thread)
+            {
+                vector<vector<float> >& parcelData = threadParcelData[thread];
                 for (int j = 0; j < numParcels; ++j)
                 {
                     parcelData[j].clear();//doesn't change allocation
                 }
-                myCiftiIn->getRow(scratchRow.data(), *iter);
+                const float* inRow = rowsIn[0];
                 for (int64_t j = 0; j < numCols; ++j)
                 {
                     int parcel = indexToParcel[j];
@@ -545,9 +567,9 @@ namespace
                     {
                         if (isLabel)
                         {
-                            parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
+                            parcelData[parcel].push_back(floor(inRow[j] + 0.5f));//round to nearest integer to be safe
                         } else {
-                            parcelData[parcel].push_back(scratchRow[j]);
+                            parcelData[parcel].push_back(inRow[j]);
                         }
                     }
                 }
@@ -570,14 +592,13 @@ namespace
                     } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
                         if (isLabel)
                         {
-                            scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
+                            scratchOutRow[j] = unassignedKeys[indices[labelDir - 1]];
                         } else {
                             scratchOutRow[j] = emptyFillVal;
                         }
                     }
                 }
-                myCiftiOut->setRow(scratchOutRow.data(), *iter);
-            }
+            });
         } else {
             vector<float> scratchOutRow(numCols);
             vector<int64_t> otherDims = dims;
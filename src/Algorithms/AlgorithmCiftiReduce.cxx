@@ -23,6 +23,7 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CiftiFile.h"
+#include "CiftiRowPipeline.h"
 #include "MultiDimIterator.h"
 #include "ReductionOperation.h"
 
@@ -112,19 +113,17 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
         {
             CaretLogWarning("-cifti-reduce is being used for a length=1 reduction on file '" + ciftiIn->getFileName() + "'");
         }
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = -1;
+        CiftiRowPipeline myPipeline(ciftiOut);//if reducing along row, length of output row is 1
+        myPipeline.addInput(ciftiIn);
+        myPipeline.run([&](const vector<int64_t>&, const vector<const float*>& rowsIn, float* rowOut, const int&)
+        {
             if (onlyNumeric)
             {
-                result = ReductionOperation::reduceOnlyNumeric(scratchInRow.data(), inDims[0], myReduce);
+                rowOut[0] = ReductionOperation::reduceOnlyNumeric(rowsIn[0], inDims[0], myReduce);
             } else {
-                result = ReductionOperation::reduce(scratchInRow.data(), inDims[0], myReduce);
+                rowOut[0] = ReductionOperation::reduce(rowsIn[0], inDims[0], myReduce);
             }
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
-        }
+        });
     } else {
         if (inDims[direction] == 1 && ! ReductionOperation::isLengthOneReasonable(myReduce))
         {
@@ -179,13 +178,12 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
     vector<int64_t> inDims = inputXML.getDimensions();
     if (direction == CiftiXML::ALONG_ROW)
     {
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = ReductionOperation::reduceExcludeDev(scratchInRow.data(), inDims[0], myReduce, sigmaBelow, sigmaAbove);
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
-        }
+        CiftiRowPipeline myPipeline(ciftiOut);//if reducing along row, length of output row is 1
+        myPipeline.addInput(ciftiIn);
+        myPipeline.run([&](const vector<int64_t>&, const vector<const float*>& rowsIn, float* rowOut, const int&)
+        {
+            rowOut[0] = ReductionOperation::reduceExcludeDev(rowsIn[0], inDims[0], myReduce, sigmaBelow, sigmaAbove);
+        });
     } else {
         vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
         vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
@@ -1071,6 +1071,107 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
     }
 }
 
+void AlgorithmCiftiResample::getRowResampleWeights(const CiftiFile* myCiftiIn, const CiftiFile* myTemplate, const int& templateDir,
+                                                   const SurfaceResamplingMethodEnum::Enum& mySurfMethod, const VolumeFile::InterpType& myVolMethod,
+                                                   const bool& surfLargest, const float& voldilatemm, const VolumeFile* warpfield, const FloatMatrix* affine,
+                                                   const SurfaceFile* curLeftSphere, const SurfaceFile* newLeftSphere, const MetricFile* curLeftAreas, const MetricFile* newLeftAreas,
+                                                   const SurfaceFile* curRightSphere, const SurfaceFile* newRightSphere, const MetricFile* curRightAreas, const MetricFile* newRightAreas,
+                                                   const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas,
+                                                   const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent, const bool volLegacyCutoff,
+                                                   vector<vector<ResampleWeight> >& weightsOut)
+{
+    CaretAssert((warpfield == NULL) != (affine == NULL));
+    const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
+    if (myInputXML.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS) throw AlgorithmException("resampling weights can't be used for label data");
+    CiftiXML myOutXML = myInputXML;
+    myOutXML.setMap(CiftiXML::ALONG_ROW, *(myTemplate->getCiftiXML().getMap(templateDir)));
+    CiftiFile outXMLFile;//setup only needs the output XML, setting it doesn't allocate the matrix
+    outXMLFile.setCiftiXML(myOutXML);
+    map<StructureEnum::Enum, ResampleCache> surfCache, volCache;
+    setupRowResampling(surfCache, volCache, myCiftiIn, &outXMLFile, mySurfMethod, voldilatemm, affine, warpfield,
+                       curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
+                       curRightSphere, newRightSphere, curRightAreas, newRightAreas,
+                       curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
+    const CiftiBrainModelsMap& inModels = myInputXML.getBrainModelsMap(CiftiXML::ALONG_ROW), &outModels = myOutXML.getBrainModelsMap(CiftiXML::ALONG_ROW);
+    int64_t inLength = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW), outLength = myOutXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    weightsOut.clear();
+    weightsOut.resize(outLength);
+    vector<StructureEnum::Enum> surfList = outModels.getSurfaceStructureList(), volList = outModels.getVolumeStructureList();
+    for (int i = 0; i < (int)surfList.size(); ++i)
+    {
+        map<StructureEnum::Enum, ResampleCache>::iterator iter = surfCache.find(surfList[i]);
+        CaretAssert(iter != surfCache.end());
+        const ResampleCache& myCache = iter->second;
+        vector<int64_t> nodeToInIndex(inModels.getSurfaceNumberOfNodes(surfList[i]), -1);//nodes outside the input map have data 0, so they get no weight
+        for (int j = 0; j < (int)myCache.inSurfMap.size(); ++j)
+        {
+            nodeToInIndex[myCache.inSurfMap[j].m_surfaceNode] = myCache.inSurfMap[j].m_ciftiIndex;
+        }
+        vector<pair<int, float> > nodeWeights;
+        for (int j = 0; j < (int)myCache.outSurfMap.size(); ++j)
+        {
+            vector<ResampleWeight>& outWeights = weightsOut[myCache.outSurfMap[j].m_ciftiIndex];
+            const int64_t outNode = myCache.outSurfMap[j].m_surfaceNode;
+            if (myCache.copyMode)
+            {
+                if (outNode < (int64_t)nodeToInIndex.size() && nodeToInIndex[outNode] != -1)
+                {
+                    outWeights.push_back(ResampleWeight(nodeToInIndex[outNode], 1.0f));
+                }
+                continue;
+            }
+            myCache.surfResamp.getNodeWeights(outNode, nodeWeights);
+            if (surfLargest)
+            {//same choice as resampleLargest
+                float largest = -1.0f;
+                int largestNode = -1;
+                for (int k = 0; k < (int)nodeWeights.size(); ++k)
+                {
+                    if (nodeWeights[k].second > largest)
+                    {
+                        largest = nodeWeights[k].second;
+                        largestNode = nodeWeights[k].first;
+                    }
+                }
+                if (largestNode != -1 && nodeToInIndex[largestNode] != -1)
+                {
+                    outWeights.push_back(ResampleWeight(nodeToInIndex[largestNode], 1.0f));
+                }
+            } else {
+                for (int k = 0; k < (int)nodeWeights.size(); ++k)
+                {
+                    if (nodeToInIndex[nodeWeights[k].first] != -1)
+                    {
+                        outWeights.push_back(ResampleWeight(nodeToInIndex[nodeWeights[k].first], nodeWeights[k].second));
+                    }
+                }
+            }
+        }
+    }
+    vector<float> inRow(inLength, 0.0f), outRow(outLength, 0.0f);
+    for (int i = 0; i < (int)volList.size(); ++i)
+    {//volume resampling (with padding, dilation, and cubic edge adjustment) is linear in the data, so resample one voxel at a time to find the weights
+        map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
+        CaretAssert(iter != volCache.end());
+        ResampleCache& myCache = iter->second;
+        for (int64_t j = 0; j < (int64_t)myCache.inVolMap.size(); ++j)
+        {
+            const int64_t inIndex = myCache.inVolMap[j].m_ciftiIndex;
+            inRow[inIndex] = 1.0f;
+            processRowVolume(myCache, inRow, outRow, myInputXML, voldilatemm, volDilateMethod, volDilateExponent, 0, warpfield, affine, myVolMethod, volLegacyCutoff);
+            inRow[inIndex] = 0.0f;
+            for (int64_t k = 0; k < (int64_t)myCache.outVolMap.size(); ++k)
+            {
+                const float value = outRow[myCache.outVolMap[k].m_ciftiIndex];
+                if (value != 0.0f)
+                {
+                    weightsOut[myCache.outVolMap[k].m_ciftiIndex].push_back(ResampleWeight(inIndex, value));
+                }
+            }
+        }
+    }
+}
+
 void AlgorithmCiftiResample::processSurfaceComponent(const CiftiFile* myCiftiIn, const int& direction, const StructureEnum::Enum& myStruct, const SurfaceResamplingMethodEnum::Enum& mySurfMethod,
                                                      CiftiFile* myCiftiOut, const bool& surfLargest, const float& surfdilatemm, const SurfaceFile* curSphere, const SurfaceFile* newSphere,
                                                      const MetricFile* curAreas, const MetricFile* newAreas,
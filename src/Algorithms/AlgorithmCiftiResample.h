@@ -30,6 +30,7 @@
 #include "VolumeFile.h"
 
 #include <utility> //for pair
+#include <vector>
 
 namespace caret {
     
@@ -47,6 +48,15 @@ namespace caret {
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
+        ///one input element and its weight, in a sparse resampling matrix
+        struct ResampleWeight
+        {
+            int64_t m_index;
+            float m_weight;
+            ResampleWeight() { }
+            ResampleWeight(const int64_t& index, const float& weight) : m_index(index), m_weight(weight) { }
+        };
+        
         //so that other code that uses it more than once can pre-check things - returns true for error present!
         static std::pair<bool, AString> checkForErrors(const CiftiFile* myCiftiIn, const int& direction, const CiftiFile* myTemplate, const int& templateDir,
                                                        const SurfaceResamplingMethodEnum::Enum& mySurfMethod,
@@ -76,6 +86,17 @@ namespace caret {
                                const AlgorithmMetricDilate::Method& surfDilateMethod = AlgorithmMetricDilate::WEIGHTED, const float& surfDilateExponent = 6.0f,
                                const bool volLegacyCutoff = false, const bool surfLegacyCutoff = false);
         
+        ///the resampling ALONG_ROW of non-label data (without surface dilation) as a sparse matrix, so it can be applied to rows without redoing the setup
+        ///weightsOut gets the input indices and weights for each output index, volume weights are found by resampling one voxel at a time
+        static void getRowResampleWeights(const CiftiFile* myCiftiIn, const CiftiFile* myTemplate, const int& templateDir,
+                                          const SurfaceResamplingMethodEnum::Enum& mySurfMethod, const VolumeFile::InterpType& myVolMethod,
+                                          const bool& surfLargest, const float& voldilatemm, const VolumeFile* warpfield, const FloatMatrix* affine,
+                                          const SurfaceFile* curLeftSphere, const SurfaceFile* newLeftSphere, const MetricFile* curLeftAreas, const MetricFile* newLeftAreas,
+                                          const SurfaceFile* curRightSphere, const SurfaceFile* newRightSphere, const MetricFile* curRightAreas, const MetricFile* newRightAreas,
+                                          const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas,
+                                          const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent, const bool volLegacyCutoff,
+                                          std::vector<std::vector<ResampleWeight> >& weightsOut);
+        
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
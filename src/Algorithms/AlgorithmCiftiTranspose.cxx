@@ -91,23 +91,21 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
         if (numCacheRows < 1) numCacheRows = 1;
         if (numCacheRows > colSize) numCacheRows = colSize;
     }
-    vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
-    vector<float> scratchInRow(colSize);
+    vector<float> cacheRows(int64_t(numCacheRows) * rowSize);//output rows are input columns, getColumns returns them contiguously
+    vector<int64_t> columnIndices;
     for (int i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
     {
         int end = i + numCacheRows;
         if (end > colSize) end = colSize;
-        for (int j = 0; j < rowSize; ++j)//loop through all input rows
+        columnIndices.clear();
+        for (int k = i; k < end; ++k)
         {
-            ciftiIn->getRow(scratchInRow.data(), j);
-            for (int k = i; k < end; ++k)
-            {
-                cacheRows[k - i][j] = scratchInRow[k];
-            }
+            columnIndices.push_back(k);
         }
+        ciftiIn->getColumns(cacheRows.data(), columnIndices);//reads input rows in large sequential blocks when on disk
         for (int k = i; k < end; ++k)
         {
-            ciftiOut->setRow(cacheRows[k - i].data(), k);
+            ciftiOut->setRow(cacheRows.data() + int64_t(k - i) * rowSize, k);
         }
     }
 }
@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 
 #include "CiftiFile.h"
+#include "CiftiRowPipeline.h"
 
 using namespace caret;
 using namespace std;
@@ -128,23 +129,23 @@ AlgorithmCiftiVectorOperation::AlgorithmCiftiVectorOperation(ProgressObject* myP
         outXML.setMap(CiftiXML::ALONG_ROW, outRowMap);
     }
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> outRow(numColsOut), multiRow(numOutVecs * 3);
-    int64_t numRows = xmlA.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    for (int64_t row = 0; row < numRows; ++row)
+    CiftiRowPipeline myPipeline(myCiftiOut);
+    myPipeline.addInput(multiVec);
+    myPipeline.addInput(singleVec);
+    myPipeline.run([&](const vector<int64_t>&, const vector<const float*>& rowsIn, float* outRow, const int&)
     {
-        multiVec->getRow(multiRow.data(), row);
-        Vector3D vecSingle;
-        singleVec->getRow(vecSingle, row);
+        const float* multiRow = rowsIn[0];
+        Vector3D vecSingle = rowsIn[1];
         for (int64_t v = 0; v < numOutVecs; ++v)
         {
             Vector3D vecA, vecB;
             if (swapped)
             {
-                vecA = multiRow.data() + v * 3;
+                vecA = multiRow + v * 3;
                 vecB = vecSingle;
             } else {
                 vecA = vecSingle;
-                vecB = multiRow.data() + v * 3;
+                vecB = multiRow + v * 3;
             }
             if (normA) vecA = vecA.normal();
             if (normB) vecB = vecB.normal();
@@ -164,8 +165,7 @@ AlgorithmCiftiVectorOperation::AlgorithmCiftiVectorOperation(ProgressObject* myP
                 }
             }
         }
-        myCiftiOut->setRow(outRow.data(), row);
-    }
+    });
 }
 
 float AlgorithmCiftiVectorOperation::getAlgorithmInternalWeight()
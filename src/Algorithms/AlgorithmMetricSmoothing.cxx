@@ -28,6 +28,7 @@
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -210,16 +211,25 @@ AlgorithmMetricSmoothing::AlgorithmMetricSmoothing(ProgressObject* myProgObj, co
         myMetricOut->setStructure(mySurf->getStructure());
         for (int32_t col = 0; col < numCols; ++col)
         {
-            myProgress.setTask("Smoothing Column " + AString::number(col));
             myMetricOut->setColumnName(col, myMetric->getColumnName(col) + ", smooth " + AString::number(myKernel));
             *(myMetricOut->getPaletteColorMapping(col)) = *(myMetric->getPaletteColorMapping(col));//copy the palette settings
-            if (myRoi != NULL && matchRoiColumns)
+        }
+        if (myRoi != NULL && matchRoiColumns)
+        {
+            for (int32_t col = 0; col < numCols; ++col)
             {
+                myProgress.setTask("Smoothing Column " + AString::number(col));
                 mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, col, fixZeros);
-            } else {
-                mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, 0, fixZeros);
+                myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
+            }
+        } else {
+            for (int32_t col = 0; col < numCols; col += MetricSmoothingObject::COLUMN_TILE)
+            {//smooth several columns per pass over the weights
+                int32_t numTileCols = min(MetricSmoothingObject::COLUMN_TILE, numCols - col);
+                myProgress.setTask("Smoothing Columns " + AString::number(col) + " to " + AString::number(col + numTileCols - 1));
+                mySmoothObj->smoothColumns(myMetric, col, numTileCols, myMetricOut, col, myRoi, 0, fixZeros);
+                myProgress.reportProgress(precomputeWeightWork + ((float)col + numTileCols) / numCols);
             }
-            myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
         }
     } else {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
@@ -38,6 +38,7 @@
 #include "AlgorithmSurfaceToSurface3dDistance.h"
 #include "AlgorithmCreateSignedDistanceVolume.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
@@ -92,6 +93,9 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
     ribbonWeightsOpt->addVolumeOutputParameter(2, "weights-out", "volume to write the weights to");
     OptionalParameter* ribbonWeightsTextOpt = ribbonOpt->createOptionalParameter(6, "-output-weights-text", "write the voxel weights for all vertices to a text file");
     ribbonWeightsTextOpt->addStringParameter(1, "text-out", "output - the output text filename");//fake the output formatting
+    OptionalComponent* additionalVolOpt = ribbonOpt->createRepeatableParameter(12, "-additional-volume", "also map another volume in the same space, reusing the voxel weights");
+    additionalVolOpt->addStringParameter(1, "volume-in", "the volume file to map");
+    additionalVolOpt->addStringParameter(2, "metric-out", "output - the output metric file");//fake the output formatting, these are written as each is mapped
     
     OptionalParameter* myelinStyleOpt = ret->createOptionalParameter(9, "-myelin-style", "use the method from myelin mapping");
     myelinStyleOpt->addVolumeParameter(1, "ribbon-roi", "an roi volume of the cortical ribbon for this hemisphere");
@@ -117,7 +121,9 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
         "The -gaussian option makes it act more like the myelin method, where the distance of a voxel from <surface> is used to downweight the voxel.  " +
         "The -interpolate suboption, instead of doing a weighted average of voxels, interpolates from the volume at the subdivided points inside the ribbon.  " +
         "If using both -interpolate and the -weighted suboption to -volume-roi, the roi volume weights are linearly interpolated, " +
-        "unless the -interpolate method is ENCLOSING_VOXEL, in which case ENCLOSING_VOXEL is also used for sampling the roi volume weights." +
+        "unless the -interpolate method is ENCLOSING_VOXEL, in which case ENCLOSING_VOXEL is also used for sampling the roi volume weights.  " +
+        "The voxel weights only depend on the surfaces, the roi, and the volume space, so when mapping several volumes that are in the same space, " +
+        "use -additional-volume to compute the weights only once.  The -subvol-select and -dilate-missing options also apply to the additional volumes." +
         "\n\n" +
         "The myelin style method uses part of the caret5 myelin mapping command to do the mapping: for each surface vertex, take all voxels that are in a cylinder " +
         "with radius and height equal to cortical thickness, centered on the vertex and aligned with the surface normal, and that are also within the ribbon ROI, " +
@@ -286,32 +292,58 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                 {
                     throw AlgorithmException("-output-weights options are incompatible with -interpolate");
                 }
+                if (!ribbonOpt->getRepeatableParameterInstances(12).empty())
+                {
+                    throw AlgorithmException("-additional-volume is incompatible with -interpolate");
+                }
                 AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, volInterpMethod, myRoiVol, weightedRoi, subdivisions, thinColumns,
                                                 mySubVol, gaussScale, badVertices, dilate, dilateNearest);
-            } else {
-                AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, weightedRoi, subdivisions, thinColumns,
-                                                mySubVol, gaussScale, badVertices, weightsOutVertex, weightsOut, dilate, dilateNearest);
-            }
-            if (ribbonWeightsText->m_present)
-            {//do this after the algorithm, to let it do the error condition checking
-                ofstream outFile(ribbonWeightsText->getString(1).toLocal8Bit().constData());
-                if (!outFile) throw AlgorithmException("failed to open output textfile '" + ribbonWeightsText->getString(1) + "'");
-                vector<vector<VoxelWeight> > myWeights;
-                const float* roiFrame = NULL;
-                if (myRoiVol != NULL) roiFrame = myRoiVol->getFrame();
-                AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, weightedRoi, subdivisions, thinColumns, mySurface, gaussScale);
-                for (int i = 0; i < (int)myWeights.size(); ++i)
+            } else {//compute the weights only once, and use them for all of the volumes
+                if (weightsOut != NULL && (weightsOutVertex < 0 || weightsOutVertex >= mySurface->getNumberOfNodes())) throw AlgorithmException("invalid vertex for voxel weights output");
+                CaretPointer<VoxelWeightMatrix> myWeights = createRibbonWeights(myVolume->getVolumeSpace(), mySurface, innerSurf, outerSurf, myRoiVol, weightedRoi, subdivisions, thinColumns, gaussScale);
+                if (weightsOut != NULL)
+                {
+                    outputVertexWeights(*myWeights, weightsOutVertex, myVolume, weightsOut);
+                }
+                AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, *myWeights, mySubVol, badVertices, dilate, dilateNearest);
+                const vector<ParameterComponent*>& additionalInstances = ribbonOpt->getRepeatableParameterInstances(12);
+                for (int i = 0; i < (int)additionalInstances.size(); ++i)
+                {
+                    VolumeFile addVolume;
+                    addVolume.readFile(additionalInstances[i]->getString(1));
+                    if (!myVolume->getVolumeSpace().matches(addVolume.getVolumeSpace()))
+                    {
+                        throw AlgorithmException("volume '" + addVolume.getFileName() + "' is not in the same volume space as the main input volume");
+                    }
+                    int64_t addSubVol = -1;
+                    if (subvolumeSelect->m_present)
+                    {
+                        addSubVol = addVolume.getMapIndexFromNameOrNumber(subvolumeSelect->getString(1));
+                        if (addSubVol < 0) throw AlgorithmException("invalid column specified for volume '" + addVolume.getFileName() + "'");
+                    }
+                    MetricFile addMetricOut;
+                    AlgorithmVolumeToSurfaceMapping(NULL, &addVolume, mySurface, &addMetricOut, *myWeights, addSubVol, NULL, dilate, dilateNearest);
+                    addMetricOut.writeFile(additionalInstances[i]->getString(2));
+                }
+                if (ribbonWeightsText->m_present)
                 {
-                    outFile << i << ", " << myWeights[i].size();
-                    for (int j = 0; j < (int)myWeights[i].size(); ++j)
+                    ofstream outFile(ribbonWeightsText->getString(1).toLocal8Bit().constData());
+                    if (!outFile) throw AlgorithmException("failed to open output textfile '" + ribbonWeightsText->getString(1) + "'");
+                    int64_t numNodes = myWeights->getNumberOfVertices();
+                    for (int64_t node = 0; node < numNodes; ++node)
                     {
-                        for (int v = 0; v < 3; ++v)
+                        vector<VoxelWeight> vertexWeights = myWeights->getVertexWeights(node);
+                        outFile << node << ", " << vertexWeights.size();
+                        for (int j = 0; j < (int)vertexWeights.size(); ++j)
                         {
-                            outFile << ", " << myWeights[i][j].ijk[v];
+                            for (int v = 0; v < 3; ++v)
+                            {
+                                outFile << ", " << vertexWeights[j].ijk[v];
+                            }
+                            outFile << ", " << vertexWeights[j].weight;
                         }
-                        outFile << ", " << myWeights[i][j].weight;
+                        outFile << endl;
                     }
-                    outFile << endl;
                 }
             }
             break;
@@ -437,13 +469,86 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     {
         throw AlgorithmException("invalid subvolume specified");
     }
-    int64_t numColumns;
-    if (mySubVol == -1)
+    if (weightsOut != NULL && (weightsOutVertex < 0 || weightsOutVertex >= mySurface->getNumberOfNodes())) throw AlgorithmException("invalid vertex for voxel weights output");
+    CaretPointer<VoxelWeightMatrix> myWeights = createRibbonWeights(myVolume->getVolumeSpace(), mySurface, innerSurf, outerSurf, roiVol, roiWeights, subdivisions, thinColumns, gaussScale);
+    if (weightsOut != NULL)
     {
-        numColumns = myVolDims[3] * myVolDims[4];
-    } else {
-        numColumns = myVolDims[4];
+        outputVertexWeights(*myWeights, weightsOutVertex, myVolume, weightsOut);
+    }
+    mapRibbonWeights(*myWeights, myVolume, mySurface, myMetricOut, mySubVol, badVertices, dilateDist, dilateNearest);
+}
+
+//ribbon mapping with precomputed weights
+AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
+                                                                 const VoxelWeightMatrix& myWeights, const int64_t& mySubVol, MetricFile* badVertices,
+                                                                 float dilateDist, bool dilateNearest) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    vector<int64_t> myVolDims;
+    myVolume->getDimensions(myVolDims);
+    if (mySubVol >= myVolDims[3] || mySubVol < -1)
+    {
+        throw AlgorithmException("invalid subvolume specified");
+    }
+    if (myWeights.getNumberOfVertices() != mySurface->getNumberOfNodes())
+    {
+        throw AlgorithmException("ribbon weights were computed for a different number of vertices than the surface");
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        if (myWeights.getDims()[i] != myVolDims[i]) throw AlgorithmException("volume '" + myVolume->getFileName() + "' has different dimensions than the volume the ribbon weights were computed for");
+    }
+    mapRibbonWeights(myWeights, myVolume, mySurface, myMetricOut, mySubVol, badVertices, dilateDist, dilateNearest);
+}
+
+CaretPointer<VoxelWeightMatrix> AlgorithmVolumeToSurfaceMapping::createRibbonWeights(const VolumeSpace& volSpace, const SurfaceFile* mySurface, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
+                                                                                     const VolumeFile* roiVol, const bool roiWeights, const int32_t& subdivisions, const bool& thinColumns,
+                                                                                     const float& gaussScale)
+{
+    if (!mySurface->hasNodeCorrespondence(*outerSurf) || !mySurface->hasNodeCorrespondence(*innerSurf))
+    {
+        throw AlgorithmException("all surfaces must have vertex correspondence");
     }
+    if (roiVol != NULL && !volSpace.matches(roiVol->getVolumeSpace()))
+    {
+        throw AlgorithmException("roi volume is not in the same volume space as input volume");
+    }
+    vector<vector<VoxelWeight> > myWeights;
+    const float* roiFrame = NULL;
+    if (roiVol != NULL) roiFrame = roiVol->getFrame();
+    precomputeWeightsRibbon(myWeights, volSpace, innerSurf, outerSurf, roiFrame, roiWeights, subdivisions, thinColumns, mySurface, gaussScale);
+    CaretPointer<VoxelWeightMatrix> ret(new VoxelWeightMatrix(myWeights, volSpace));
+    return ret;
+}
+
+void AlgorithmVolumeToSurfaceMapping::outputVertexWeights(const VoxelWeightMatrix& myWeights, const int& weightsOutVertex, const VolumeFile* myVolume, VolumeFile* weightsOut)
+{
+    if (weightsOutVertex < 0 || weightsOutVertex >= myWeights.getNumberOfVertices()) throw AlgorithmException("invalid vertex for voxel weights output");
+    vector<int64_t> weightDims;
+    myVolume->getDimensions(weightDims);
+    weightDims.resize(3);
+    weightsOut->reinitialize(weightDims, myVolume->getSform());
+    weightsOut->setValueAllVoxels(0.0f);
+    vector<VoxelWeight> vertexWeights = myWeights.getVertexWeights(weightsOutVertex);
+    int numWeights = (int)vertexWeights.size();
+    for (int i = 0; i < numWeights; ++i)
+    {
+        weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
+    }
+}
+
+void AlgorithmVolumeToSurfaceMapping::mapRibbonWeights(const VoxelWeightMatrix& myWeights, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
+                                                       const int64_t& mySubVol, MetricFile* badVertices, float dilateDist, bool dilateNearest)
+{
+    vector<int64_t> myVolDims;
+    myVolume->getDimensions(myVolDims);
+    int64_t startVol = 0, endVol = myVolDims[3];
+    if (mySubVol > -1)
+    {
+        startVol = mySubVol;
+        endVol = mySubVol + 1;
+    }
+    int64_t numColumns = (endVol - startVol) * myVolDims[4];
     int64_t numNodes = mySurface->getNumberOfNodes();
     MetricFile rawMappingTemp;
     MetricFile* rawMapping = myMetricOut;
@@ -458,7 +563,6 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     {
         dilMethod = AlgorithmMetricDilate::AlgorithmMetricDilate::NEAREST;
     }
-    vector<float> badVertScratch;
     MetricFile badVertTemp; //we will need a metric file if we do the dilate step, so always make a metric file
     MetricFile* badVertCompute = &badVertTemp;
     if (badVertices != NULL)
@@ -467,110 +571,39 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     }
     badVertCompute->setNumberOfNodesAndColumns(numNodes, 1);
     badVertCompute->setStructure(mySurface->getStructure());
-    badVertScratch.resize(numNodes, 0.0f);
-    if (!mySurface->hasNodeCorrespondence(*outerSurf) || !mySurface->hasNodeCorrespondence(*innerSurf))
-    {
-        throw AlgorithmException("all surfaces must have vertex correspondence");
-    }
-    if (roiVol != NULL && !roiVol->matchesVolumeSpace(myVolume))
-    {
-        throw AlgorithmException("roi volume is not in the same volume space as input volume");
-    }
-    if (weightsOut != NULL)
-    {
-        if (weightsOutVertex < 0 || weightsOutVertex >= numNodes) throw AlgorithmException("invalid vertex for voxel weights output");
-        vector<int64_t> weightDims = myVolDims;
-        weightDims.resize(3);
-        weightsOut->reinitialize(weightDims, myVolume->getSform());
-    }
-    vector<vector<VoxelWeight> > myWeights;
-    const float* roiFrame = NULL;
-    if (roiVol != NULL) roiFrame = roiVol->getFrame();
-    precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, roiWeights, subdivisions, thinColumns, mySurface, gaussScale);
-    if (weightsOut != NULL)
+    vector<float> badVertScratch(numNodes, 0.0f);
+    if (numColumns > 0)
     {
-        weightsOut->setValueAllVoxels(0.0f);
-        const vector<VoxelWeight>& vertexWeights = myWeights[weightsOutVertex];
-        int numWeights = (int)vertexWeights.size();
-        for (int i = 0; i < numWeights; ++i)
+        for (int64_t node = 0; node < numNodes; ++node)
         {
-            weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
+            if (myWeights.isVertexEmpty(node)) badVertScratch[node] = 1.0f;
         }
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
-    if (mySubVol == -1)
+    const int64_t COLUMN_BATCH = 64;//columns mapped per pass, limits the output buffer size
+    vector<float> scratchColumns(min(COLUMN_BATCH, numColumns) * numNodes);
+    for (int64_t batchStart = 0; batchStart < numColumns; batchStart += COLUMN_BATCH)
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                rawMapping->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                        if (thisCol == 0)
-                        {
-                            badVertScratch[node] = 1.0f;
-                        }
-                    }
-                }
-                rawMapping->setValuesForColumn(thisCol, myScratch);
-            }
-        }
-    } else {
-        for (int64_t j = 0; j < myVolDims[4]; ++j)
+        int64_t batchSize = min(COLUMN_BATCH, numColumns - batchStart);
+        vector<const float*> frames(batchSize);
+        vector<float*> columns(batchSize);
+        for (int64_t c = 0; c < batchSize; ++c)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
+            int64_t thisCol = batchStart + c;
+            int64_t i = startVol + thisCol / myVolDims[4], j = thisCol % myVolDims[4];
+            frames[c] = myVolume->getFrame(i, j);
+            columns[c] = scratchColumns.data() + c * numNodes;
+            AString metricLabel = myVolume->getMapName(i);
             if (myVolDims[4] != 1)
             {
                 metricLabel += " component " + AString::number(j);
             }
             metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
             rawMapping->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                        badVertScratch[node] = 1.0f;
-                    }
-            }
-            rawMapping->setValuesForColumn(thisCol, myScratch);
+        }
+        myWeights.apply(frames, columns);
+        for (int64_t c = 0; c < batchSize; ++c)
+        {
+            rawMapping->setValuesForColumn(batchStart + c, columns[c]);
         }
     }
     badVertCompute->setValuesForColumn(0, badVertScratch.data());
@@ -23,6 +23,7 @@
 
 #include "AbstractAlgorithm.h"
 
+#include "CaretPointer.h"
 #include "RibbonMappingHelper.h"
 #include "Vector3D.h"
 #include "VolumeFile.h"
@@ -38,6 +39,9 @@ namespace caret {
                                             const MetricFile* thickness, const float& sigma, const bool& oldCutoffBug);
         static void precomputeWeightsRibbon(std::vector<std::vector<VoxelWeight> >& myWeights, const VolumeSpace& volSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                             const float* roiFrame, const bool roiWeights, const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale);
+        static void outputVertexWeights(const VoxelWeightMatrix& myWeights, const int& weightsOutVertex, const VolumeFile* myVolume, VolumeFile* weightsOut);
+        static void mapRibbonWeights(const VoxelWeightMatrix& myWeights, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
+                                     const int64_t& mySubVol, MetricFile* badVertices, float dilateDist, bool dilateNearest);
         enum Method
         {
             TRILINEAR,
@@ -59,6 +63,10 @@ namespace caret {
                                         const VolumeFile* roiVol = NULL, const bool roiWeights = false, const int32_t& subdivisions = 3, const bool& thinColumns = false,
                                         const int64_t& mySubVol = -1, const float& gaussScale = -1.0f, MetricFile* badVertices = NULL,
                                         const int& weightsOutVertex = -1, VolumeFile* weightsOut = NULL, float dilateDist = -1.0f, bool dilateNearest = false);
+        //ribbon with precomputed weights, for mapping many volumes in the same space with the same surfaces
+        AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
+                                        const VoxelWeightMatrix& myWeights, const int64_t& mySubVol = -1, MetricFile* badVertices = NULL,
+                                        float dilateDist = -1.0f, bool dilateNearest = false);
         //interpolated ribbon
         AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                         const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile::InterpType interpType,
@@ -67,6 +75,10 @@ namespace caret {
         //myelin-style
         AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                         const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol = -1, const bool& oldCutoffBug = false);
+        ///computes the ribbon constrained weights once, for use with the precomputed weights constructor
+        static CaretPointer<VoxelWeightMatrix> createRibbonWeights(const VolumeSpace& volSpace, const SurfaceFile* mySurface, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
+                                                                   const VolumeFile* roiVol = NULL, const bool roiWeights = false, const int32_t& subdivisions = 3,
+                                                                   const bool& thinColumns = false, const float& gaussScale = -1.0f);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
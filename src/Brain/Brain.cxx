@@ -19,11 +19,15 @@
 /*LICENSE_END*/
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 #include <new>
 
 #include <QCollator>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
 
 #include "AnnotationFile.h"
 #include "AnnotationManager.h"
@@ -6857,6 +6861,7 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
      * Note: Need to read palette first since some of the individual file
      * reading routines update palette coloring when file is read
      */
+    std::vector<PreReadDataFile> preReadFiles;
     const int32_t numFileGroups = sf->getNumberOfDataFileTypeGroups();
     for (int32_t ig = -1; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = ((ig == -1)
@@ -6872,42 +6877,53 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* dataFileInfo = group->getFileInformation(iFile);
             if (dataFileInfo->isLoadingSelected()) {
-                const AString filename = dataFileInfo->getFileName();
-                const StructureEnum::Enum structure = dataFileInfo->getStructure();
-
-                /*
-                 * Send event indicating progress of file reading
-                 */
-                FileInformation fileInfo(dataFileInfo->getFileName());
-                progressUpdate.setProgress(fileReadCounter,
-                                           ("Reading "
-                                            + fileInfo.getFileName()));
-                EventManager::get()->sendEvent(progressUpdate.getPointer());
-                
-                /*
-                 * If user cancelled, reset brain and get out!
-                 */
-                if (progressUpdate.isCancelled()) {
-                    resetBrain();
-                    return;
-                }
-                
-                try {
-                    readDataFile(dataFileType,
-                                 structure,
-                                 filename,
-                                 false);
-                }
-                catch (const DataFileException& e) {
-                    if (errorMessage.isEmpty() == false) {
-                        errorMessage += "\n";
-                    }
-                    errorMessage += e.whatString();
-                }
-                
-                fileReadCounter++;
+                preReadFiles.push_back(PreReadDataFile(dataFileType,
+                                                       dataFileInfo->getStructure(),
+                                                       dataFileInfo->getFileName()));
+            }
+        }
+    }
+    
+    /*
+     * Files that do not depend upon other files are read by worker
+     * threads and then added, in order, with the other files
+     */
+    if ( ! preReadDataFilesInParallel(preReadFiles,
+                                      progressUpdate)) {
+        resetBrain();
+        return;
+    }
+    
+    for (PreReadDataFile& preReadFile : preReadFiles) {
+        /*
+         * Send event indicating progress of file reading
+         */
+        FileInformation fileInfo(preReadFile.m_filename);
+        progressUpdate.setProgress(fileReadCounter,
+                                   ("Reading "
+                                    + fileInfo.getFileName()));
+        EventManager::get()->sendEvent(progressUpdate.getPointer());
+        
+        /*
+         * If user cancelled, reset brain and get out!
+         */
+        if (progressUpdate.isCancelled()) {
+            deletePreReadDataFiles(preReadFiles);
+            resetBrain();
+            return;
+        }
+        
+        try {
+            addPreReadDataFile(preReadFile);
+        }
+        catch (const DataFileException& e) {
+            if (errorMessage.isEmpty() == false) {
+                errorMessage += "\n";
             }
+            errorMessage += e.whatString();
         }
+        
+        fileReadCounter++;
     }
     
     m_specFile->clearModified();
@@ -6967,6 +6983,313 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                                                      "");
 }
 
+/**
+ * @return True if files of the given type may be read by a worker thread.
+ * Reading these files does not use other files, palettes, or the GUI
+ * and they are added to the brain, on the main thread, after reading.
+ * @param dataFileType
+ *    Type of data file.
+ */
+bool
+Brain::isDataFileTypeReadInParallel(const DataFileTypeEnum::Enum dataFileType)
+{
+    bool parallelFlag(false);
+    
+    switch (dataFileType) {
+        case DataFileTypeEnum::ANNOTATION:
+            break;
+        case DataFileTypeEnum::ANNOTATION_TEXT_SUBSTITUTION:
+            break;
+        case DataFileTypeEnum::BORDER:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_ORIENTATIONS_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_MAPS:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_DYNAMIC:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::CZI_IMAGE_FILE:
+            break;
+        case DataFileTypeEnum::FOCI:
+            break;
+        case DataFileTypeEnum::HISTOLOGY_SLICES:
+            break;
+        case DataFileTypeEnum::IMAGE:
+            break;
+        case DataFileTypeEnum::LABEL:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::METRIC:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::METRIC_DYNAMIC:
+            break;
+        case DataFileTypeEnum::OME_ZARR_IMAGE_FILE:
+            break;
+        case DataFileTypeEnum::PALETTE:
+            break;
+        case DataFileTypeEnum::RGBA:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::SAMPLES:
+            break;
+        case DataFileTypeEnum::SCENE:
+            break;
+        case DataFileTypeEnum::SPECIFICATION:
+            break;
+        case DataFileTypeEnum::SURFACE:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::UNKNOWN:
+            break;
+        case DataFileTypeEnum::VOLUME:
+            parallelFlag = true;
+            break;
+        case DataFileTypeEnum::VOLUME_DYNAMIC:
+            break;
+    }
+    
+    return parallelFlag;
+}
+
+/**
+ * Read, using worker threads, the files that may be read in parallel.
+ * The files are NOT added to the brain, use addPreReadDataFile() to
+ * add each file, in order, on the main thread.  Progress is reported
+ * while the files are read.
+ *
+ * @param preReadFiles
+ *    The files selected for loading.
+ * @param progressEvent
+ *    Event for reporting progress and checking for cancellation.
+ * @return
+ *    True if reading finished, false if the user cancelled (in which
+ *    case any files that were read have been deleted).
+ */
+bool
+Brain::preReadDataFilesInParallel(std::vector<PreReadDataFile>& preReadFiles,
+                                  EventProgressUpdate& progressEvent)
+{
+    std::vector<PreReadDataFile*> filesToRead;
+    for (PreReadDataFile& preReadFile : preReadFiles) {
+        preReadFile.m_filename = convertFilePathNameToAbsolutePathName(preReadFile.m_filename);
+        if (isDataFileTypeReadInParallel(preReadFile.m_dataFileType)
+            && ( ! DataFile::isFileOnNetwork(preReadFile.m_filename))
+            && FileInformation(preReadFile.m_filename).exists()) {
+            filesToRead.push_back(&preReadFile);
+        }
+    }
+    
+    /*
+     * Nothing gained by using a thread for just one file
+     */
+    const int32_t numberOfFilesToRead(filesToRead.size());
+    if (numberOfFilesToRead < 2) {
+        return true;
+    }
+    
+    ElapsedTimer timer;
+    timer.start();
+    
+    /*
+     * Files are created on this thread, only reading is
+     * performed by the worker threads
+     */
+    for (PreReadDataFile* preReadFile : filesToRead) {
+        preReadFile->m_caretDataFile = CaretDataFileHelper::createCaretDataFileForFileType(preReadFile->m_dataFileType);
+        CaretAssert(preReadFile->m_caretDataFile);
+        preReadFile->m_preReadFlag = true;
+    }
+    
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(std::min(std::max(QThread::idealThreadCount(), 1),
+                                          numberOfFilesToRead));
+    std::atomic<bool> cancelledFlag(false);
+    std::atomic<int32_t> numberOfFilesRead(0);
+    for (PreReadDataFile* preReadFile : filesToRead) {
+        QtConcurrent::run(&threadPool,
+                          [preReadFile, &cancelledFlag, &numberOfFilesRead]() {
+                              if ( ! cancelledFlag) {
+                                  preReadDataFile(*preReadFile);
+                              }
+                              ++numberOfFilesRead;
+                          });
+    }
+    
+    while ( ! threadPool.waitForDone(100)) {
+        progressEvent.setProgressMessage("Reading files ("
+                                         + AString::number(numberOfFilesRead.load())
+                                         + " of "
+                                         + AString::number(numberOfFilesToRead)
+                                         + " finished)");
+        EventManager::get()->sendEvent(progressEvent.getPointer());
+        if (progressEvent.isCancelled()) {
+            cancelledFlag = true;
+            threadPool.waitForDone();
+            deletePreReadDataFiles(preReadFiles);
+            return false;
+        }
+    }
+    
+    CaretLogInfo("Time to read "
+                 + AString::number(numberOfFilesToRead)
+                 + " files in parallel was "
+                 + AString::number(timer.getElapsedTimeSeconds())
+                 + " seconds.");
+    
+    return true;
+}
+
+/**
+ * Read a file on a worker thread.  Errors are saved in the file
+ * so that they are reported, in order, when the file is added.
+ *
+ * @param preReadFile
+ *    The file, its data file must have been created.
+ */
+void
+Brain::preReadDataFile(PreReadDataFile& preReadFile)
+{
+    CaretAssert(preReadFile.m_caretDataFile);
+    
+    try {
+        try {
+            preReadFile.m_caretDataFile->readFile(preReadFile.m_filename);
+        }
+        catch (const std::bad_alloc&) {
+            throw DataFileException(preReadFile.m_filename,
+                                    CaretDataFileHelper::createBadAllocExceptionMessage(preReadFile.m_filename));
+        }
+    }
+    catch (const DataFileException& dfe) {
+        preReadFile.m_dataFileException = dfe;
+        preReadFile.m_dataFileExceptionValid = true;
+    }
+    catch (const std::exception& e) {
+        preReadFile.m_dataFileException = DataFileException(preReadFile.m_filename,
+                                                            e.what());
+        preReadFile.m_dataFileExceptionValid = true;
+    }
+}
+
+/**
+ * Add a file to the brain.  If the file was not read by
+ * preReadDataFilesInParallel() it is read now.
+ *
+ * @param preReadFile
+ *    The file.
+ * @return
+ *    Pointer to file that was added, may be NULL.
+ * @throws DataFileException
+ *    If there was an error reading or adding the file.
+ */
+CaretDataFile*
+Brain::addPreReadDataFile(PreReadDataFile& preReadFile)
+{
+    if ( ! preReadFile.m_preReadFlag) {
+        return readDataFile(preReadFile.m_dataFileType,
+                            preReadFile.m_structure,
+                            preReadFile.m_filename,
+                            false);
+    }
+    
+    CaretDataFile* caretDataFile = preReadFile.m_caretDataFile;
+    preReadFile.m_caretDataFile = NULL;
+    CaretAssertMessage(caretDataFile,
+                       "Pre-read file was previously added.");
+    
+    if (preReadFile.m_dataFileExceptionValid) {
+        delete caretDataFile;
+        throw preReadFile.m_dataFileException;
+    }
+    
+    try {
+        /*
+         * Validation is performed when reading but not when adding
+         * and it requires the surfaces added before this file
+         */
+        const CiftiMappableDataFile* ciftiMapFile = dynamic_cast<const CiftiMappableDataFile*>(caretDataFile);
+        if (ciftiMapFile != NULL) {
+            validateCiftiMappableDataFile(ciftiMapFile);
+        }
+        
+        return addReadOrReloadDataFile(FILE_MODE_ADD,
+                                       caretDataFile,
+                                       preReadFile.m_dataFileType,
+                                       preReadFile.m_structure,
+                                       preReadFile.m_filename,
+                                       false);
+    }
+    catch (const DataFileException&) {
+        /*
+         * When adding fails, the file is not deleted
+         * and it may or may not be in the brain
+         */
+        std::vector<CaretDataFile*> allDataFiles;
+        getAllDataFiles(allDataFiles);
+        if (std::find(allDataFiles.begin(),
+                      allDataFiles.end(),
+                      caretDataFile) == allDataFiles.end()) {
+            delete caretDataFile;
+        }
+        throw;
+    }
+}
+
+/**
+ * Delete files read by preReadDataFilesInParallel() that have not been added.
+ *
+ * @param preReadFiles
+ *    The files.
+ */
+void
+Brain::deletePreReadDataFiles(std::vector<PreReadDataFile>& preReadFiles)
+{
+    for (PreReadDataFile& preReadFile : preReadFiles) {
+        if (preReadFile.m_caretDataFile != NULL) {
+            delete preReadFile.m_caretDataFile;
+            preReadFile.m_caretDataFile = NULL;
+        }
+    }
+}
+
 /**
  * Some files are sorted by name
  */
@@ -7118,15 +7441,55 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
     m_nonModifiedFilesForRestoringScene.clear();
     
     
+    /*
+     * Find the new files to load so that those that do not depend
+     * upon other files can be read by worker threads.
+     */
+    std::vector<PreReadDataFile> preReadFiles;
+    const int32_t numFileGroups = specFileToLoad->getNumberOfDataFileTypeGroups();
+    for (int32_t ig = 0; ig < numFileGroups; ig++) {
+        const SpecFileDataFileTypeGroup* group = specFileToLoad->getDataFileTypeGroupByIndex(ig);
+        const DataFileTypeEnum::Enum dataFileType = group->getDataFileType();
+        const int32_t numFiles = group->getNumberOfFiles();
+        for (int32_t iFile = 0; iFile < numFiles; iFile++) {
+            const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
+            if (fileInfo->isLoadingSelected()) {
+                if (specFilesEntryToNonModifiedFile.find(fileInfo) == specFilesEntryToNonModifiedFile.end()) {
+                    AString filename = fileInfo->getFileName();
+                    if (sceneFileOnNetwork) {
+                        if (DataFile::isFileOnNetwork(filename) == false) {
+                            const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
+                            if (lastSlashIndex >= 0) {
+                                const AString newName = (sceneFileName.left(lastSlashIndex)
+                                                         + "/"
+                                                         + filename);
+                                filename = newName;
+                            }
+                        }
+                    }
+                    preReadFiles.push_back(PreReadDataFile(dataFileType,
+                                                           fileInfo->getStructure(),
+                                                           filename));
+                }
+            }
+        }
+    }
+    
+    if ( ! preReadDataFilesInParallel(preReadFiles,
+                                      progressEvent)) {
+        resetBrain(keepSceneFiles,
+                   keepSpecFile);
+        return;
+    }
+    
     /*
      * Load new files and add existing files that were previously loaded.
      */
     const int64_t numberOfFilesToLoad(specFileToLoad->getNumberOfFilesSelectedForLoading());
     int64_t fileLoadingCounter(1);
-    const int32_t numFileGroups = specFileToLoad->getNumberOfDataFileTypeGroups();
+    std::vector<PreReadDataFile>::iterator preReadFileIter = preReadFiles.begin();
     for (int32_t ig = 0; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = specFileToLoad->getDataFileTypeGroupByIndex(ig);
-        const DataFileTypeEnum::Enum dataFileType = group->getDataFileType();
         const int32_t numFiles = group->getNumberOfFiles();
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
@@ -7142,6 +7505,7 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                         progressEvent.setProgressMessage(msg);
                         EventManager::get()->sendEvent(progressEvent.getPointer());
                         if (progressEvent.isCancelled()) {
+                            deletePreReadDataFiles(preReadFiles);
                             resetBrain(keepSceneFiles,
                                        keepSpecFile);
                             return;
@@ -7156,7 +7520,9 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                                                 false);
                     }
                     else {
-                        const StructureEnum::Enum structure = fileInfo->getStructure();
+                        CaretAssert(preReadFileIter != preReadFiles.end());
+                        PreReadDataFile& preReadFile = *preReadFileIter;
+                        ++preReadFileIter;
                         
                         const QString msg = ("Loading ("
                                              + AString::number(fileLoadingCounter)
@@ -7169,26 +7535,13 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                         progressEvent.setProgressMessage(msg);
                         EventManager::get()->sendEvent(progressEvent.getPointer());
                         if (progressEvent.isCancelled()) {
+                            deletePreReadDataFiles(preReadFiles);
                             resetBrain(keepSceneFiles,
                                        keepSpecFile);
                             return;
                         }
                         
-                        if (sceneFileOnNetwork) {
-                            if (DataFile::isFileOnNetwork(filename) == false) {
-                                const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
-                                if (lastSlashIndex >= 0) {
-                                    const AString newName = (sceneFileName.left(lastSlashIndex)
-                                                             + "/"
-                                                             + filename);
-                                    filename = newName;
-                                }
-                            }
-                        }
-                        readDataFile(dataFileType,
-                                     structure,
-                                     filename,
-                                     false);
+                        addPreReadDataFile(preReadFile);
                     }
                 }
                 catch (const DataFileException& e) {
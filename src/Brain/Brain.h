@@ -27,6 +27,7 @@
 
 #include "CaretObject.h"
 #include "ChartOneDataTypeEnum.h"
+#include "DataFileException.h"
 #include "DataFileTypeEnum.h"
 #include "DisplayGroupEnum.h"
 #include "EventListenerInterface.h"
@@ -92,6 +93,7 @@ namespace caret {
     class EventDataFileRead;
     class EventDataFileReload;
     class EventDataFileReloadAll;
+    class EventProgressUpdate;
     class EventSpecFileReadDataFiles;
     class GapsAndMargins;
     class HistologySlicesFile;
@@ -580,6 +582,37 @@ namespace caret {
             FILE_MODE_RELOAD
         };
         
+        /**
+         * A data file selected for loading that may be read by a
+         * worker thread before it is added on the main thread
+         */
+        class PreReadDataFile {
+        public:
+            PreReadDataFile(const DataFileTypeEnum::Enum dataFileType,
+                            const StructureEnum::Enum structure,
+                            const AString& filename)
+            : m_dataFileType(dataFileType),
+            m_structure(structure),
+            m_filename(filename) { }
+            
+            DataFileTypeEnum::Enum m_dataFileType;
+            
+            StructureEnum::Enum m_structure;
+            
+            AString m_filename;
+            
+            /** File read by a worker thread, NULL if not pre-read or after it is added */
+            CaretDataFile* m_caretDataFile = NULL;
+            
+            /** Error from reading by a worker thread, valid if m_dataFileExceptionValid */
+            DataFileException m_dataFileException;
+            
+            bool m_dataFileExceptionValid = false;
+            
+            /** True if the file was read by a worker thread */
+            bool m_preReadFlag = false;
+        };
+        
         void addDataFile(CaretDataFile* caretDataFile);
         
         bool removeWithoutDeleteDataFile(const CaretDataFile* caretDataFile);
@@ -590,6 +623,17 @@ namespace caret {
         
         void loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataFilesEvent);
         
+        static bool isDataFileTypeReadInParallel(const DataFileTypeEnum::Enum dataFileType);
+        
+        bool preReadDataFilesInParallel(std::vector<PreReadDataFile>& preReadFiles,
+                                        EventProgressUpdate& progressEvent);
+        
+        static void preReadDataFile(PreReadDataFile& preReadFile);
+        
+        CaretDataFile* addPreReadDataFile(PreReadDataFile& preReadFile);
+        
+        static void deletePreReadDataFiles(std::vector<PreReadDataFile>& preReadFiles);
+        
         void loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                                    SpecFile* specFile,
                           const ResetBrainKeepSceneFiles keepSceneFile,
@@ -29,6 +29,7 @@
 #undef __BRAIN_OPENGL_FIXED_PIPELINE_DEFINE_H
 
 #include <algorithm>
+#include <array>
 #include <limits>
 #include <cmath>
 
@@ -170,6 +171,7 @@
 #include "SurfaceProjectionBarycentric.h"
 #include "SurfaceProjectionVanEssen.h"
 #include "SurfaceSelectionModel.h"
+#include "SurfaceTriangleBVH.h"
 #include "TabDrawingInfo.h"
 #include "TopologyHelper.h"
 #include "VolumeFile.h"
@@ -3206,47 +3208,60 @@ BrainOpenGLFixedPipeline::drawSurfaceTriangles(Surface* surface,
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
     
+    /*
+     * When selecting, find the triangle under the mouse with a ray
+     * instead of drawing every triangle in a unique color
+     */
+    int32_t triangleIndex = -1;
+    float depth = -1.0;
+    const bool triangleFromRayFlag = (isSelect
+                                      && this->getSurfaceTriangleWithRay(surface,
+                                                                         triangleIndex,
+                                                                         depth));
+    
     uint8_t rgba[4];
     
-    glBegin(GL_TRIANGLES);
-    for (int32_t i = 0; i < numTriangles; i++) {
-        const int32_t i3 = i * 3;
-        const int32_t n1 = triangles[i3];
-        const int32_t n2 = triangles[i3+1];
-        const int32_t n3 = triangles[i3+2];
+    if ( ! triangleFromRayFlag) {
+        glBegin(GL_TRIANGLES);
+        for (int32_t i = 0; i < numTriangles; i++) {
+            const int32_t i3 = i * 3;
+            const int32_t n1 = triangles[i3];
+            const int32_t n2 = triangles[i3+1];
+            const int32_t n3 = triangles[i3+2];
         
-        if (isSelect) {
-            this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
-            glColor3ubv(rgba);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
-        }
-        else {
-            glColor4fv(&nodeColoringRGBA[n1*4]);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glColor4fv(&nodeColoringRGBA[n2*4]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glColor4fv(&nodeColoringRGBA[n3*4]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
+            if (isSelect) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
+                glColor3ubv(rgba);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
+            else {
+                glColor4fv(&nodeColoringRGBA[n1*4]);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glColor4fv(&nodeColoringRGBA[n2*4]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glColor4fv(&nodeColoringRGBA[n3*4]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
         }
+        glEnd();
     }
-    glEnd();
     
     if (isSelect) {
-        int32_t triangleIndex = -1;
-        float depth = -1.0;
-        this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE, 
-                                         this->mouseX, 
-                                         this->mouseY,
-                                         triangleIndex,
-                                         depth);
+        if ( ! triangleFromRayFlag) {
+            this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE, 
+                                             this->mouseX, 
+                                             this->mouseY,
+                                             triangleIndex,
+                                             depth);
+        }
         
         if (triangleIndex >= 0) {
             bool isTriangleIdAccepted = false;
@@ -3467,6 +3482,131 @@ BrainOpenGLFixedPipeline::drawSurfaceTriangles(Surface* surface,
     }
 }
 
+/**
+ * Find the surface triangle under the mouse by intersecting a ray, from
+ * the mouse position through the current modelview and projection
+ * matrices, with the surface's bounding volume hierarchy.  This only
+ * uses the CPU, so it avoids an identification render pass and the
+ * read of the frame buffer.  Hits removed by enabled clipping planes
+ * are ignored, as they would not be drawn.
+ *
+ * @param surface
+ *    Surface that is searched.
+ * @param triangleIndexOut
+ *    Output with index of triangle under the mouse, or -1 if the
+ *    mouse is not over the surface.
+ * @param depthOut
+ *    Output with the window depth, in [0, 1], of the point on the triangle.
+ * @return
+ *    True if the ray could be computed.  If false, the outputs are not
+ *    valid and identification with colors must be used.
+ */
+bool
+BrainOpenGLFixedPipeline::getSurfaceTriangleWithRay(const Surface* surface,
+                                                    int32_t& triangleIndexOut,
+                                                    float& depthOut)
+{
+    triangleIndexOut = -1;
+    depthOut = -1.0;
+    if (surface->getNumberOfTriangles() <= 0) {
+        return false;
+    }
+    
+    GLdouble modelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    /*
+     * Ray from the near clipping plane to the far clipping plane
+     */
+    double nearXYZ[3];
+    double farXYZ[3];
+    if ( ! gluUnProject(this->mouseX, this->mouseY, 0.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &nearXYZ[0], &nearXYZ[1], &nearXYZ[2])) {
+        return false;
+    }
+    if ( ! gluUnProject(this->mouseX, this->mouseY, 1.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &farXYZ[0], &farXYZ[1], &farXYZ[2])) {
+        return false;
+    }
+    
+    /*
+     * Clipping planes are in eye coordinates
+     */
+    std::vector<std::array<double, 4>> clippingPlanes;
+    for (int32_t i = 0; i < 6; i++) {
+        if (glIsEnabled(GL_CLIP_PLANE0 + i)) {
+            std::array<double, 4> plane;
+            glGetClipPlane(GL_CLIP_PLANE0 + i, plane.data());
+            clippingPlanes.push_back(plane);
+        }
+    }
+    SurfaceTriangleBVH::HitFilter clippingFilter;
+    if ( ! clippingPlanes.empty()) {
+        clippingFilter = [&](const float xyz[3]) {
+            double eyeXYZW[4];
+            for (int32_t row = 0; row < 4; row++) {
+                eyeXYZW[row] = (modelviewMatrix[row]      * xyz[0]
+                                + modelviewMatrix[row + 4]  * xyz[1]
+                                + modelviewMatrix[row + 8]  * xyz[2]
+                                + modelviewMatrix[row + 12]);
+            }
+            for (const auto& plane : clippingPlanes) {
+                if ((plane[0] * eyeXYZW[0]
+                     + plane[1] * eyeXYZW[1]
+                     + plane[2] * eyeXYZW[2]
+                     + plane[3] * eyeXYZW[3]) < 0.0) {
+                    return false;
+                }
+            }
+            return true;
+        };
+    }
+    
+    const float rayOrigin[3] = {
+        (float)nearXYZ[0],
+        (float)nearXYZ[1],
+        (float)nearXYZ[2]
+    };
+    const float rayDirection[3] = {
+        (float)(farXYZ[0] - nearXYZ[0]),
+        (float)(farXYZ[1] - nearXYZ[1]),
+        (float)(farXYZ[2] - nearXYZ[2])
+    };
+    
+    int32_t triangleIndex = -1;
+    float rayDistance = 0.0;
+    float barycentricWeights[3];
+    if (surface->getTriangleBVH()->intersectRay(rayOrigin,
+                                                rayDirection,
+                                                0.0,
+                                                1.0,
+                                                triangleIndex,
+                                                rayDistance,
+                                                barycentricWeights,
+                                                clippingFilter)) {
+        const double hitXYZ[3] = {
+            nearXYZ[0] + rayDistance * (farXYZ[0] - nearXYZ[0]),
+            nearXYZ[1] + rayDistance * (farXYZ[1] - nearXYZ[1]),
+            nearXYZ[2] + rayDistance * (farXYZ[2] - nearXYZ[2])
+        };
+        double windowXYZ[3];
+        if (gluProject(hitXYZ[0], hitXYZ[1], hitXYZ[2],
+                       modelviewMatrix, projectionMatrix, viewport,
+                       &windowXYZ[0], &windowXYZ[1], &windowXYZ[2])) {
+            triangleIndexOut = triangleIndex;
+            depthOut = windowXYZ[2];
+        }
+    }
+    
+    return true;
+}
+
 /**
  * During projection mode, set the projected data.  If the 
  * projection data is already set, it will be overridden
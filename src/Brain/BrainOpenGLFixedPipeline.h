@@ -251,6 +251,10 @@ namespace caret {
         void drawSurfaceTriangles(Surface* surface,
                                   const float* nodeColoringRGBA);
         
+        bool getSurfaceTriangleWithRay(const Surface* surface,
+                                       int32_t& triangleIndexOut,
+                                       float& depthOut);
+        
         void drawSurfaceNodeAttributes(Surface* surface,
                                        const int32_t viewportHeight);
         
@@ -287,6 +287,10 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
                                            nodeIndex,
                                            rowIndex,
                                            columnIndex);
+            if (rowIndex >= 0) {
+                cmf->prefetchRowsForSurfaceNodeNeighbors(surfaceFile,
+                                                         nodeIndex);
+            }
             cmf->updateScalarColoringForMap(mapIndex);
             haveData = true;
             
@@ -401,6 +405,9 @@ CiftiConnectivityMatrixDataFileManager::loadDataForVoxelAtCoordinate(Brain* brai
                                                  xyz,
                                                  rowIndex,
                                                  columnIndex);
+            if (rowIndex >= 0) {
+                cmf->prefetchRowsForVoxelNeighbors(xyz);
+            }
             cmf->updateScalarColoringForMap(mapIndex);
             haveData = true;
             
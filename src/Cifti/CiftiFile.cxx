@@ -31,6 +31,10 @@
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <QFile>
+
+#include <cstring>
+
 using namespace std;
 using namespace caret;
 
@@ -48,15 +52,42 @@ namespace
                         const int16_t& datatype, const bool& rescale, const double& minval, const double& maxval);//make new empty file with read/write
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getColumns(float* dataOut, const std::vector<int64_t>& indices, const int64_t& colLength) const;
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
+        bool supportsConcurrentRead() const { return m_nifti.supportsConcurrentRead(); }
+        bool canMemoryMap() const;
+        static const int64_t COLUMN_TILE_BYTES = 1<<26;//64MiB of rows per sequential read when gathering columns
+        static const int64_t SEEK_EQUIVALENT_BYTES = 1<<16;//roughly what a single-element read costs, for deciding when reading whole rows is cheaper
+        bool useTiledColumnRead(const int64_t& numColumns) const;
+        int64_t getDataOffset() const { return m_nifti.getHeader().getDataOffset(); }
+        const vector<int64_t>& getMatrixDims() const { return m_matrixDims; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
         void close();
         void dropXML() { m_xml = CiftiXML(); m_nifti.dropExtensions(); }
     };
     
+    //read-only, zero-copy access to files that are already native float32 on disk, shares page cache with other processes mapping the same file
+    class CiftiMmapImpl : public CiftiFile::ReadImplInterface
+    {
+        QFile m_file;
+        const float* m_data;
+        vector<int64_t> m_matrixDims;
+        int64_t m_rowSize;
+    public:
+        CiftiMmapImpl(const QString& filename, const int64_t& dataOffset, const vector<int64_t>& matrixDims);
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
+        void getColumn(float* dataOut, const int64_t& index) const;
+        void getColumns(float* dataOut, const std::vector<int64_t>& indices, const int64_t& colLength) const;
+        bool supportsConcurrentRead() const { return true; }
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        bool isMemoryMapped() const { return true; }
+        QString getFilename() const { return m_file.fileName(); }
+        ~CiftiMmapImpl();
+    };
+    
     class CiftiMemoryImpl : public CiftiFile::WriteImplInterface
     {
         MultiDimArray<float> m_array;
@@ -64,7 +95,10 @@ namespace
         CiftiMemoryImpl(const CiftiXML& xml);
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getColumns(float* dataOut, const std::vector<int64_t>& indices, const int64_t& colLength) const;
         bool isInMemory() const { return true; }
+        bool supportsConcurrentRead() const { return true; }
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const { return m_array.get(1, indexSelect); }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
     };
@@ -100,6 +134,32 @@ namespace
         return (endian == CiftiFile::ANY);
     }
     
+    //copy the requested columns out of a row-major block of rows, into column-major output with full column length colLength
+    void gatherColumns(const float* rowBlock, const int64_t& rowSize, const int64_t& firstRow, const int64_t& numBlockRows,
+                       const vector<int64_t>& indices, float* dataOut, const int64_t& colLength)
+    {
+        int64_t numIndices = (int64_t)indices.size();
+        for (int64_t row = 0; row < numBlockRows; ++row)
+        {
+            const float* rowPtr = rowBlock + row * rowSize;
+            float* outPtr = dataOut + firstRow + row;
+            for (int64_t i = 0; i < numIndices; ++i)
+            {
+                outPtr[i * colLength] = rowPtr[indices[i]];
+            }
+        }
+    }
+    
+    //returns empty string if the implementation isn't reading from a file on disk
+    QString getOnDiskFilename(const CiftiFile::ReadImplInterface* impl)
+    {
+        const CiftiOnDiskImpl* onDiskImpl = dynamic_cast<const CiftiOnDiskImpl*>(impl);
+        if (onDiskImpl != NULL) return onDiskImpl->getFilename();
+        const CiftiMmapImpl* mmapImpl = dynamic_cast<const CiftiMmapImpl*>(impl);
+        if (mmapImpl != NULL) return mmapImpl->getFilename();
+        return "";
+    }
+    
 }
 
 CiftiFile::ReadImplInterface::~ReadImplInterface()
@@ -110,6 +170,14 @@ CiftiFile::WriteImplInterface::~WriteImplInterface()
 {
 }
 
+void CiftiFile::ReadImplInterface::getColumns(float* dataOut, const vector<int64_t>& indices, const int64_t& colLength) const
+{
+    for (int64_t i = 0; i < (int64_t)indices.size(); ++i)
+    {
+        getColumn(dataOut + i * colLength, indices[i]);
+    }
+}
+
 CiftiFile::CiftiFile(const QString& fileName)
 {
     m_endianPref = NATIVE;
@@ -124,6 +192,15 @@ void CiftiFile::openFile(const QString& fileName)
     m_readingImpl = newRead;//it should be noted that if the constructor throws (if the file isn't readable), new guarantees the memory allocated for the object will be freed
     m_xml = newRead->getCiftiXML();
     newRead->dropXML();//save some memory, we don't need 2 copies of the xml - figure out if there is a better way to prevent copies
+    if (newRead->canMemoryMap())
+    {
+        try
+        {
+            m_readingImpl.grabNew(new CiftiMmapImpl(newRead->getFilename(), newRead->getDataOffset(), newRead->getMatrixDims()));//releases the NiftiIO handle when newRead goes out of scope
+        } catch (DataFileException& e) {//mapping can fail for reasons that don't prevent normal reading (address space, filesystem support), so keep the on-disk reader
+            CaretLogFine("unable to memory map cifti file, using normal reading: " + e.whatString());
+        }
+    }
     m_xmlBroken = false;
     m_dims = m_xml.getDimensions();
     m_onDiskVersion = m_xml.getParsedVersion();
@@ -188,10 +265,12 @@ void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVe
     FileInformation myInfo(fileName);
     QString canonicalFilename = myInfo.getCanonicalFilePath();//NOTE: returns EMPTY STRING for nonexistant file
     const CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
+    QString readingFilename = getOnDiskFilename(m_readingImpl);
     bool collision = false, hadWriter = (m_writingImpl != NULL);
-    if (testImpl != NULL && canonicalFilename != "" && FileInformation(testImpl->getFilename()).getCanonicalFilePath() == canonicalFilename)
+    if (readingFilename != "" && canonicalFilename != "" && FileInformation(readingFilename).getCanonicalFilePath() == canonicalFilename)
     {//empty string test is so that we don't say collision if both are nonexistant - could happen if file is removed/unlinked while reading on some filesystems
-        if (m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == testImpl->isSwapped())) return;//don't need to copy to itself
+        bool readingSwapped = (testImpl != NULL && testImpl->isSwapped());//memory mapping is only used on native endian files
+        if (m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == readingSwapped)) return;//don't need to copy to itself
         collision = true;//we need to copy to memory temporarily
         CaretPointer<WriteImplInterface> tempMemory(new CiftiMemoryImpl(m_xml));
         copyImplData(m_readingImpl, tempMemory, m_dims);
@@ -252,6 +331,12 @@ bool CiftiFile::isInMemory() const
     }
 }
 
+bool CiftiFile::supportsConcurrentRead() const
+{
+    if (m_readingImpl == NULL) return false;
+    return m_readingImpl->supportsConcurrentRead();
+}
+
 void CiftiFile::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool& tolerateShortRead) const
 {
     if (m_dims.empty()) throw DataFileException("getRow called on uninitialized CiftiFile");
@@ -259,6 +344,40 @@ void CiftiFile::getRow(float* dataOut, const vector<int64_t>& indexSelect, const
     m_readingImpl->getRow(dataOut, indexSelect, tolerateShortRead);
 }
 
+const float* CiftiFile::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_readingImpl == NULL) return NULL;//no matrix yet, same as any other implementation that can't provide a pointer
+    return m_readingImpl->getRowPointer(indexSelect);
+}
+
+const float* CiftiFile::getRowPointer(const int64_t& index) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRowPointer with single index called on non-2D CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    return m_readingImpl->getRowPointer(vector<int64_t>(1, index));
+}
+
+void CiftiFile::getColumns(float* dataOut, const vector<int64_t>& indices) const
+{
+    if (m_dims.empty()) throw DataFileException("getColumns called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getColumns called on non-2D CiftiFile");
+    for (int64_t i = 0; i < (int64_t)indices.size(); ++i)
+    {
+        if (indices[i] < 0 || indices[i] >= m_dims[0]) throw DataFileException("getColumns called with invalid column index");
+    }
+    if (m_readingImpl == NULL) return;//NOT an error because we are pretending to have a matrix already, while we are waiting for setRow to actually start writing the file
+    if (indices.empty()) return;
+    m_readingImpl->getColumns(dataOut, indices, m_dims[1]);
+}
+
+bool CiftiFile::isMemoryMapped() const
+{
+    if (m_readingImpl == NULL) return false;
+    return m_readingImpl->isMemoryMapped();
+}
+
 void CiftiFile::getColumn(float* dataOut, const int64_t& index) const
 {
     if (m_dims.empty()) throw DataFileException("getColumn called on uninitialized CiftiFile");
@@ -400,10 +519,10 @@ void CiftiFile::verifyWriteImpl()
         if (m_xmlBroken) throw DataFileException("can't write file when XML mappings have been forgotten");
         if (m_readingImpl != NULL)
         {
-            CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
-            if (testImpl != NULL)
+            QString readingFilename = getOnDiskFilename(m_readingImpl);
+            if (readingFilename != "")
             {
-                QString canonicalCurrent = FileInformation(testImpl->getFilename()).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
+                QString canonicalCurrent = FileInformation(readingFilename).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
                 if (canonicalCurrent != "" && canonicalCurrent == FileInformation(m_writingFile).getCanonicalFilePath())//these were already absolute
                 {
                     convertToInMemory();//save existing data in memory before we clobber file
@@ -468,6 +587,13 @@ void CiftiMemoryImpl::getColumn(float* dataOut, const int64_t& index) const
     }
 }
 
+void CiftiMemoryImpl::getColumns(float* dataOut, const vector<int64_t>& indices, const int64_t& colLength) const
+{
+    CaretAssert(m_array.getDimensions().size() == 2);
+    CaretAssert(m_array.getDimensions()[1] == colLength);
+    gatherColumns(m_array.get(2, vector<int64_t>()), m_array.getDimensions()[0], 0, colLength, indices, dataOut, colLength);
+}
+
 void CiftiMemoryImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
     float* ref = m_array.get(1, indexSelect);
@@ -491,6 +617,66 @@ void CiftiMemoryImpl::setColumn(const float* dataIn, const int64_t& index)
     }
 }
 
+CiftiMmapImpl::CiftiMmapImpl(const QString& filename, const int64_t& dataOffset, const vector<int64_t>& matrixDims)
+{
+    CaretAssert(!matrixDims.empty());
+    m_data = NULL;
+    m_matrixDims = matrixDims;
+    m_rowSize = matrixDims[0];
+    int64_t numElems = 1;
+    for (int i = 0; i < (int)matrixDims.size(); ++i)
+    {
+        numElems *= matrixDims[i];
+    }
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly)) throw DataFileException("failed to open file '" + filename + "' for memory mapping");
+    if (m_file.size() < dataOffset + numElems * (int64_t)sizeof(float)) throw DataFileException("nifti file is truncated: " + filename);//mapping past the end would fault rather than throw
+    uchar* mapped = m_file.map(dataOffset, numElems * sizeof(float));
+    if (mapped == NULL) throw DataFileException("failed to memory map file '" + filename + "': " + m_file.errorString());
+    m_data = (const float*)mapped;
+}
+
+CiftiMmapImpl::~CiftiMmapImpl()
+{
+    if (m_data != NULL) m_file.unmap((uchar*)m_data);//QFile also unmaps on close, but be explicit
+}
+
+const float* CiftiMmapImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    CaretAssert(indexSelect.size() + 1 == m_matrixDims.size());
+    int64_t offset = 0, stride = m_rowSize;
+    for (int i = 0; i < (int)indexSelect.size(); ++i)
+    {
+        CaretAssert(indexSelect[i] >= 0 && indexSelect[i] < m_matrixDims[i + 1]);
+        offset += indexSelect[i] * stride;
+        stride *= m_matrixDims[i + 1];
+    }
+    return m_data + offset;
+}
+
+void CiftiMmapImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool&) const
+{
+    memcpy(dataOut, getRowPointer(indexSelect), m_rowSize * sizeof(float));
+}
+
+void CiftiMmapImpl::getColumn(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(m_matrixDims.size() == 2);//otherwise, CiftiFile shouldn't have called this
+    CaretAssert(index >= 0 && index < m_rowSize);
+    int64_t colSize = m_matrixDims[1];
+    for (int64_t i = 0; i < colSize; ++i)
+    {
+        dataOut[i] = m_data[index + m_rowSize * i];
+    }
+}
+
+void CiftiMmapImpl::getColumns(float* dataOut, const vector<int64_t>& indices, const int64_t& colLength) const
+{
+    CaretAssert(m_matrixDims.size() == 2);
+    CaretAssert(m_matrixDims[1] == colLength);
+    gatherColumns(m_data, m_rowSize, 0, colLength, indices, dataOut, colLength);//one pass over the mapping instead of one per column
+}
+
 CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
 {//opens existing file for reading
     m_nifti.openRead(filename);//read-only, so we don't need write permission to read a cifti file
@@ -704,6 +890,17 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, c
     m_xml = CiftiXML();//use an empty one instead
 }
 
+bool CiftiOnDiskImpl::canMemoryMap() const
+{//only when the bytes on disk are exactly the floats we would return, so rows can be handed out without conversion
+    if (!m_nifti.supportsConcurrentRead()) return false;//compressed, or open for writing
+    const NiftiHeader& myHeader = m_nifti.getHeader();
+    if (myHeader.getDataType() != NIFTI_TYPE_FLOAT32 || myHeader.isSwapped()) return false;
+    double mult, offset;
+    if (myHeader.getDataScaling(mult, offset)) return false;
+    if (myHeader.getDataOffset() % sizeof(float) != 0) return false;//mappings are page aligned, so this is enough for aligned float pointers
+    return true;
+}
+
 void CiftiOnDiskImpl::close()
 {
     m_nifti.close();//lets this throw when there is a writing problem
@@ -720,8 +917,10 @@ void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_matrixDims.size() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_matrixDims[0]);
-    if (m_matrixDims[0] > 1)
+    if (m_matrixDims[0] > 1 && useTiledColumnRead(1))
     {
+        getColumns(dataOut, vector<int64_t>(1, index), m_matrixDims[1]);
+    } else if (m_matrixDims[0] > 1) {
         CaretLogFine("getColumn called on CiftiOnDiskImpl with multiple columns, this will be slow");//generate logging messages at a low priority
         vector<int64_t> indexSelect(2);
         indexSelect[0] = index;
@@ -736,6 +935,35 @@ void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
     }
 }
 
+bool CiftiOnDiskImpl::useTiledColumnRead(const int64_t& numColumns) const
+{//reading one element costs a seek and at least a filesystem block, so only read whole rows when they are short compared to the number of seeks they replace
+    CaretAssert(m_matrixDims.size() == 2);
+    return m_matrixDims[0] * (int64_t)sizeof(float) <= numColumns * SEEK_EQUIVALENT_BYTES;
+}
+
+void CiftiOnDiskImpl::getColumns(float* dataOut, const vector<int64_t>& indices, const int64_t& colLength) const
+{
+    CaretAssert(m_matrixDims.size() == 2);//otherwise this shouldn't be called
+    CaretAssert(m_matrixDims[1] == colLength);
+    int64_t rowSize = m_matrixDims[0];
+    if (rowSize == 1 || !useTiledColumnRead(indices.size()))
+    {
+        ReadImplInterface::getColumns(dataOut, indices, colLength);
+        return;
+    }
+    int64_t blockRows = max(int64_t(1), COLUMN_TILE_BYTES / (rowSize * (int64_t)sizeof(float)));
+    if (blockRows > colLength) blockRows = colLength;
+    vector<float> tile(blockRows * rowSize);
+    vector<int64_t> indexSelect(1);
+    for (int64_t start = 0; start < colLength; start += blockRows)
+    {
+        int64_t numBlockRows = min(blockRows, colLength - start);
+        indexSelect[0] = start;
+        m_nifti.readDataBlocks(tile.data(), 5, indexSelect, numBlockRows);//5 means 4 reserved (space and time) plus the first cifti dimension, so full rows
+        gatherColumns(tile.data(), rowSize, start, numBlockRows, indices, dataOut, colLength);
+    }
+}
+
 void CiftiOnDiskImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
     m_nifti.writeData(dataIn, 5, indexSelect);
@@ -63,6 +63,7 @@ namespace caret
         QString getFileName() const { return m_fileName; }
         
         bool isInMemory() const;
+        bool supportsConcurrentRead() const;//whether getRow/getColumn may be called from multiple threads without the reads being serialized internally
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false) const;//tolerateShortRead is useful for on-disk writing when it is easiest to do RMW multiple times on a new file
         const std::vector<int64_t>& getDimensions() const { return m_dims; }
         MultiDimIterator<int64_t> getIteratorOverRows() const
@@ -70,6 +71,14 @@ namespace caret
             return MultiDimIterator<int64_t>(std::vector<int64_t>(m_dims.begin() + 1, m_dims.end()));
         }
         void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, will be slow if on disk!
+        ///for 2D only, output is column by column: column indices[i] goes to dataOut[i * getNumberOfRows()] onwards
+        ///when on disk, reads blocks of rows sequentially and gathers all requested columns in one pass
+        void getColumns(float* dataOut, const std::vector<int64_t>& indices) const;
+        ///direct pointer to row data when the matrix is addressable (in memory, or memory-mapped float32 file), otherwise NULL - use getRow as the fallback
+        ///the pointer is invalidated by any call that changes the file (setRow, setCiftiXML, convertToInMemory, writeFile, close, etc)
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        const float* getRowPointer(const int64_t& index) const;//2D only
+        bool isMemoryMapped() const;
         
         void setCiftiXML(const CiftiXML& xml, const bool useOldMetadata = true);
         void setCiftiXML(const CiftiXMLOld &xml, const bool useOldMetadata = true);//set xml from old implementation
@@ -94,7 +103,11 @@ namespace caret
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual void getColumns(float* dataOut, const std::vector<int64_t>& indices, const int64_t& colLength) const;//default calls getColumn for each
             virtual bool isInMemory() const { return false; }
+            virtual bool supportsConcurrentRead() const { return false; }
+            virtual const float* getRowPointer(const std::vector<int64_t>&) const { return NULL; }
+            virtual bool isMemoryMapped() const { return false; }
             virtual ~ReadImplInterface();
         };
         //assume if you can write to it, you can also read from it
@@ -0,0 +1,217 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiRowPipeline.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace caret;
+using namespace std;
+
+CiftiRowPipeline::CiftiRowPipeline(CiftiFile* output)
+{
+    CaretAssert(output != NULL);
+    m_output = output;
+    const vector<int64_t>& outDims = output->getDimensions();
+    if (outDims.size() < 1) throw DataFileException("output cifti file must have its dimensions set before rows can be processed");
+    m_outRowLength = outDims[0];
+    m_iterDims = vector<int64_t>(outDims.begin() + 1, outDims.end());
+    m_memLimit = ((int64_t)1) << 30;
+}
+
+void CiftiRowPipeline::addInput(const CiftiFile* input, const vector<int64_t>& fixedIndices)
+{
+    CaretAssert(input != NULL);
+    const vector<int64_t>& inDims = input->getDimensions();
+    InputInfo newInfo;
+    newInfo.m_file = input;
+    newInfo.m_rowLength = inDims[0];
+    newInfo.m_fixedIndices = fixedIndices;
+    if (newInfo.m_fixedIndices.empty()) newInfo.m_fixedIndices.resize(inDims.size() - 1, -1);
+    if (newInfo.m_fixedIndices.size() != inDims.size() - 1) throw DataFileException("wrong number of fixed indices for input cifti file '" + input->getFileName() + "'");
+    for (int i = 0; i < (int)newInfo.m_fixedIndices.size(); ++i)
+    {
+        if (newInfo.m_fixedIndices[i] == -1)
+        {
+            if (i >= (int)m_iterDims.size() || m_iterDims[i] != inDims[i + 1])
+            {
+                throw DataFileException("input cifti file '" + input->getFileName() + "' doesn't match the output dimensions");
+            }
+        } else {
+            if (newInfo.m_fixedIndices[i] < 0 || newInfo.m_fixedIndices[i] >= inDims[i + 1])
+            {
+                throw DataFileException("fixed index out of range for input cifti file '" + input->getFileName() + "'");
+            }
+        }
+    }
+    m_inputs.push_back(newInfo);
+}
+
+int CiftiRowPipeline::getNumThreads()
+{
+#ifdef CARET_OMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+void CiftiRowPipeline::readBatch(Batch& batch, const int64_t& firstRow, const int64_t& numRows)
+{
+    int numInputs = (int)m_inputs.size();
+    int numIterDims = (int)m_iterDims.size();
+    batch.m_numRows = numRows;
+    for (int64_t r = 0; r < numRows; ++r)
+    {//unravel the linear row number, first dimension fastest, same as MultiDimIterator
+        vector<int64_t>& indices = batch.m_indices[r];
+        int64_t remainder = firstRow + r;
+        for (int d = 0; d < numIterDims; ++d)
+        {
+            indices[d] = remainder % m_iterDims[d];
+            remainder /= m_iterDims[d];
+        }
+    }
+    vector<int64_t> inIndices, prevIndices;
+    for (int v = 0; v < numInputs; ++v)
+    {
+        const InputInfo& thisInput = m_inputs[v];
+        int numInDims = (int)thisInput.m_fixedIndices.size();
+        inIndices.resize(numInDims);
+        prevIndices.clear();//make the first row of a batch always load, simpler than tracking it across batches
+        int64_t slot = -1;
+        for (int64_t r = 0; r < numRows; ++r)
+        {
+            for (int d = 0; d < numInDims; ++d)
+            {
+                inIndices[d] = (thisInput.m_fixedIndices[d] == -1 ? batch.m_indices[r][d] : thisInput.m_fixedIndices[d]);
+            }
+            if (inIndices != prevIndices)
+            {
+                const float* direct = thisInput.m_file->getRowPointer(inIndices);
+                if (direct != NULL)
+                {//in memory or memory mapped, no copy needed
+                    batch.m_rowsIn[r][v] = direct;
+                } else {
+                    ++slot;
+                    float* rowStore = batch.m_inStore[v].data() + slot * thisInput.m_rowLength;
+                    thisInput.m_file->getRow(rowStore, inIndices);
+                    batch.m_rowsIn[r][v] = rowStore;
+                }
+                prevIndices = inIndices;
+            } else {
+                batch.m_rowsIn[r][v] = batch.m_rowsIn[r - 1][v];
+            }
+        }
+    }
+}
+
+void CiftiRowPipeline::writeBatch(const Batch& batch)
+{
+    for (int64_t r = 0; r < batch.m_numRows; ++r)
+    {
+        m_output->setRow(batch.m_outStore.data() + r * m_outRowLength, batch.m_indices[r]);
+    }
+}
+
+void CiftiRowPipeline::run(const RowFunction& rowFunction)
+{
+    int64_t numRows = 1;
+    for (int d = 0; d < (int)m_iterDims.size(); ++d)
+    {
+        numRows *= m_iterDims[d];
+    }
+    if (numRows < 1) return;
+    int numInputs = (int)m_inputs.size();
+    int64_t bytesPerRow = m_outRowLength * sizeof(float);
+    for (int v = 0; v < numInputs; ++v)
+    {
+        bytesPerRow += m_inputs[v].m_rowLength * sizeof(float);
+    }
+    const int NUM_BATCHES = 3;//one being read, one being computed, one being written
+    int64_t batchRows = 16 * getNumThreads();//enough rows that dynamic scheduling can balance uneven rows
+    if (bytesPerRow > 0) batchRows = min(batchRows, m_memLimit / (bytesPerRow * NUM_BATCHES));
+    batchRows = max((int64_t)1, min(batchRows, numRows));
+    Batch batches[NUM_BATCHES];
+    for (int b = 0; b < NUM_BATCHES; ++b)
+    {
+        Batch& thisBatch = batches[b];
+        thisBatch.m_numRows = 0;
+        thisBatch.m_indices.resize(batchRows, vector<int64_t>(m_iterDims.size()));
+        thisBatch.m_rowsIn.resize(batchRows, vector<const float*>(numInputs, NULL));
+        thisBatch.m_inStore.resize(numInputs);
+        for (int v = 0; v < numInputs; ++v)
+        {
+            thisBatch.m_inStore[v].resize(batchRows * m_inputs[v].m_rowLength);
+        }
+        thisBatch.m_outStore.resize(batchRows * m_outRowLength);
+    }
+    int64_t numBatches = (numRows - 1) / batchRows + 1;
+    readBatch(batches[0], 0, min(batchRows, numRows));
+    exception_ptr firstError;
+    for (int64_t b = 0; b < numBatches && !firstError; ++b)
+    {
+        Batch& computeBatch = batches[b % NUM_BATCHES];
+#pragma omp CARET_PAR
+        {
+            int thread = 0;
+#ifdef CARET_OMP
+            thread = omp_get_thread_num();
+#endif
+#pragma omp CARET_SINGLE nowait
+            {//this thread joins the computation when it is done with IO
+                try
+                {
+                    if (b > 0) writeBatch(batches[(b - 1) % NUM_BATCHES]);
+                    if (b + 1 < numBatches)
+                    {
+                        int64_t nextStart = (b + 1) * batchRows;
+                        readBatch(batches[(b + 1) % NUM_BATCHES], nextStart, min(batchRows, numRows - nextStart));
+                    }
+                } catch (...) {
+#pragma omp critical
+                    {
+                        if (!firstError) firstError = current_exception();
+                    }
+                }
+            }
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t r = 0; r < computeBatch.m_numRows; ++r)
+            {
+                try
+                {
+                    rowFunction(computeBatch.m_indices[r], computeBatch.m_rowsIn[r], computeBatch.m_outStore.data() + r * m_outRowLength, thread);
+                } catch (...) {
+#pragma omp critical
+                    {
+                        if (!firstError) firstError = current_exception();
+                    }
+                }
+            }
+        }
+    }
+    if (firstError) rethrow_exception(firstError);
+    writeBatch(batches[(numBatches - 1) % NUM_BATCHES]);
+}
@@ -0,0 +1,78 @@
+#ifndef __CIFTI_ROW_PIPELINE_H__
+#define __CIFTI_ROW_PIPELINE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+    class CiftiFile;
+
+    ///runs a row-at-a-time computation over every row of an output cifti file, in batches of rows:
+    ///while the worker threads compute one batch (dynamic scheduling), one thread writes the previous batch in row order and reads the next one
+    ///the row function is called concurrently from multiple threads, so it must only modify its output row and per-thread scratch (use the thread argument)
+    class CiftiRowPipeline
+    {
+    public:
+        ///indices is the output row index (excluding the row dimension), rowsIn has one row per input, in the order they were added
+        typedef std::function<void(const std::vector<int64_t>& indices, const std::vector<const float*>& rowsIn, float* rowOut, const int& thread)> RowFunction;
+
+        ///output must already have its cifti XML set, its rows define the iteration
+        explicit CiftiRowPipeline(CiftiFile* output);
+        ///fixedIndices has one entry per non-row dimension of the input, -1 means use the output's index for that dimension (the default for all)
+        ///consecutive output rows that need the same input row only read it once
+        void addInput(const CiftiFile* input, const std::vector<int64_t>& fixedIndices = std::vector<int64_t>());
+        ///approximate limit on the memory used for buffered rows (default 1GiB), at least 3 rows per input and output are always buffered
+        void setMemoryLimit(const int64_t& bytes) { m_memLimit = bytes; }
+        ///exceptions from the row function, or from reading or writing, are rethrown after the workers stop
+        void run(const RowFunction& rowFunction);
+        ///number of distinct values the thread argument can take, for sizing per-thread scratch
+        static int getNumThreads();
+    private:
+        struct InputInfo
+        {
+            const CiftiFile* m_file;
+            std::vector<int64_t> m_fixedIndices;
+            int64_t m_rowLength;
+        };
+        struct Batch
+        {
+            int64_t m_numRows;
+            std::vector<std::vector<int64_t> > m_indices;
+            std::vector<std::vector<float> > m_inStore;//per input
+            std::vector<std::vector<const float*> > m_rowsIn;//per row, then per input
+            std::vector<float> m_outStore;
+        };
+        CiftiRowPipeline(const CiftiRowPipeline&);
+        CiftiRowPipeline& operator=(const CiftiRowPipeline&);
+        CiftiFile* m_output;
+        std::vector<int64_t> m_iterDims;
+        int64_t m_outRowLength, m_memLimit;
+        std::vector<InputInfo> m_inputs;
+        void readBatch(Batch& batch, const int64_t& firstRow, const int64_t& numRows);
+        void writeBatch(const Batch& batch);
+    };
+}
+
+#endif //__CIFTI_ROW_PIPELINE_H__
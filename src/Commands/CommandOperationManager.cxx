@@ -154,6 +154,7 @@
 #include "OperationCiftiChangeTimestep.h"
 #include "OperationCiftiConvert.h"
 #include "OperationCiftiConvertToScalar.h"
+#include "OperationCiftiCorrelationSparse.h"
 #include "OperationCiftiCopyMapping.h"
 #include "OperationCiftiCreateDenseFromTemplate.h"
 #include "OperationCiftiCreateParcellatedFromTemplate.h"
@@ -253,9 +254,12 @@
 #include "CommandUnitTest.h"
 #include "ProgramParameters.h"
 
+#include "CaretBinaryFile.h"
 #include "CaretLogger.h"
 #include "dot_wrapper.h"
 #include "CaretCommandGlobalOptions.h"
+#include "MetricSmoothingObject.h"
+#include "SurfaceResamplingHelper.h"
 
 #include <iostream>
 #include <map>
@@ -421,6 +425,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiAverage()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiChangeMapping()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiConvert()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiCorrelationSparse()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiCreateDenseFromTemplate()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiCreateParcellatedFromTemplate()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationCiftiCreateScalarSeries()));
@@ -634,6 +639,22 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
     {
         caret_global_command_options.m_ciftiReadMemory = true;
     }
+    if (getGlobalOption(parameters, "-gzip-index-sidecar", 0, globalOptionArgs))
+    {
+        CaretBinaryFile::setGzipIndexSidecar(true);
+    }
+    if (getGlobalOption(parameters, "-gzip-parallel-write", 0, globalOptionArgs))
+    {
+        CaretBinaryFile::setGzipParallelWrite(true);
+    }
+    if (getGlobalOption(parameters, "-smoothing-weights-cache", 1, globalOptionArgs))
+    {
+        MetricSmoothingObject::setWeightsCacheDirectory(globalOptionArgs[0]);
+    }
+    if (getGlobalOption(parameters, "-resampling-weights-cache", 1, globalOptionArgs))
+    {
+        SurfaceResamplingHelper::setWeightsCacheDirectory(globalOptionArgs[0]);
+    }
 
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
@@ -788,7 +809,19 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         return "";
     }
     /*OptionInfo ciftiReadMemInfo = */parseGlobalOption(parameters, "-cifti-read-memory", 0, globalOptionArgs, true);
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range\\ -nifti-output-datatype\\ -nifti-output-range\\ -cifti-read-memory";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    /*OptionInfo gzipIndexInfo = */parseGlobalOption(parameters, "-gzip-index-sidecar", 0, globalOptionArgs, true);
+    /*OptionInfo gzipParallelInfo = */parseGlobalOption(parameters, "-gzip-parallel-write", 0, globalOptionArgs, true);
+    OptionInfo smoothCacheInfo = parseGlobalOption(parameters, "-smoothing-weights-cache", 1, globalOptionArgs, true);
+    if (smoothCacheInfo.specified && !smoothCacheInfo.complete)
+    {
+        return "";
+    }
+    OptionInfo resampleCacheInfo = parseGlobalOption(parameters, "-resampling-weights-cache", 1, globalOptionArgs, true);
+    if (resampleCacheInfo.specified && !resampleCacheInfo.complete)
+    {
+        return "";
+    }
+    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range\\ -nifti-output-datatype\\ -nifti-output-range\\ -cifti-read-memory\\ -gzip-index-sidecar\\ -gzip-parallel-write\\ -smoothing-weights-cache\\ -resampling-weights-cache";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -1187,6 +1220,28 @@ void CommandOperationManager::printGlobalOptions()
     cout << "                                        avoid hitting limits on number of open" << endl;
     cout << "                                        files" << endl;
     cout << endl;
+    cout << "   -gzip-index-sidecar               save the seek index built while reading" << endl;
+    cout << "                                        a .gz file as <filename>.wbgzidx, and" << endl;
+    cout << "                                        reuse it to speed up random access on" << endl;
+    cout << "                                        later reads of the same file" << endl;
+    cout << endl;
+    cout << "   -gzip-parallel-write              compress .gz outputs using multiple" << endl;
+    cout << "                                        threads, the output is a standard gzip" << endl;
+    cout << "                                        file, but will not be byte-identical to" << endl;
+    cout << "                                        single-threaded output" << endl;
+    cout << endl;
+    cout << "   -smoothing-weights-cache <dir>    save geodesic smoothing weights in <dir>," << endl;
+    cout << "                                        and reuse them when smoothing with the" << endl;
+    cout << "                                        same surface, kernel, method, roi and" << endl;
+    cout << "                                        areas (default from environment" << endl;
+    cout << "                                        variable WB_SMOOTHING_WEIGHTS_CACHE)" << endl;
+    cout << endl;
+    cout << "   -resampling-weights-cache <dir>   save surface resampling weights in <dir>," << endl;
+    cout << "                                        and reuse them when resampling with the" << endl;
+    cout << "                                        same spheres, method, areas and roi" << endl;
+    cout << "                                        (default from environment variable" << endl;
+    cout << "                                        WB_RESAMPLING_WEIGHTS_CACHE)" << endl;
+    cout << endl;
     cout << "   -cifti-output-datatype <type>     deprecated, only affects cifti outputs" << endl;
     cout << "   -cifti-output-range <min> <max>   deprecated, only affects cifti outputs" << endl;
     cout << endl;
@@ -0,0 +1,186 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Base64Decoder.h"
+
+using namespace caret;
+
+namespace
+{
+    const uint32_t INVALID_FLAG = 0x80000000u;
+
+    //the value of each character pre-shifted to its position in a group of 4, so a whole group decodes with 4 lookups and 3 ORs
+    //characters outside the alphabet (including whitespace and '=') have the invalid flag, which sends the group to the careful path
+    struct DecodeTables
+    {
+        uint8_t m_value[256];//0xFF for characters outside the alphabet
+        uint32_t m_shifted[4][256];
+        DecodeTables()
+        {
+            const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int c = 0; c < 256; ++c) m_value[c] = 0xFF;
+            for (int i = 0; i < 64; ++i) m_value[(unsigned char)alphabet[i]] = (uint8_t)i;
+            for (int c = 0; c < 256; ++c)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    if (m_value[c] == 0xFF)
+                    {
+                        m_shifted[k][c] = INVALID_FLAG;
+                    } else {
+                        m_shifted[k][c] = ((uint32_t)m_value[c]) << (18 - 6 * k);
+                    }
+                }
+            }
+        }
+    };
+
+    const DecodeTables& getTables()
+    {
+        static const DecodeTables tables;//initialization is thread safe in C++11
+        return tables;
+    }
+
+    bool isWhitespace(const unsigned char c)
+    {
+        return (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v');
+    }
+}
+
+Base64Decoder::Base64Decoder()
+{
+    m_bits = 0;
+    m_count = 0;
+    m_endReached = false;
+    m_error = false;
+}
+
+int64_t Base64Decoder::decode(const char* input, const int64_t& inputLength, unsigned char* output)
+{
+    if (m_error) return -1;
+    const DecodeTables& tables = getTables();
+    const unsigned char* in = (const unsigned char*)input;
+    const unsigned char* inEnd = in + inputLength;
+    unsigned char* out = output;
+    if (m_endReached)
+    {//only more padding or whitespace may follow the padding
+        for (; in < inEnd; ++in)
+        {
+            if (*in != '=' && !isWhitespace(*in))
+            {
+                m_error = true;
+                return -1;
+            }
+        }
+        return 0;
+    }
+    while (in < inEnd)
+    {
+        if (m_count == 0)
+        {//fast path: whole groups of 4 alphabet characters
+            while (inEnd - in >= 4)
+            {
+                uint32_t bits = tables.m_shifted[0][in[0]] | tables.m_shifted[1][in[1]] | tables.m_shifted[2][in[2]] | tables.m_shifted[3][in[3]];
+                if (bits & INVALID_FLAG) break;
+                out[0] = (unsigned char)(bits >> 16);
+                out[1] = (unsigned char)(bits >> 8);
+                out[2] = (unsigned char)bits;
+                out += 3;
+                in += 4;
+            }
+            if (in >= inEnd) break;
+        }
+        //careful path: one character, for whitespace, padding, errors, and groups split across line breaks or calls
+        const unsigned char c = *in;
+        ++in;
+        const uint8_t value = tables.m_value[c];
+        if (value != 0xFF)
+        {
+            m_bits = (m_bits << 6) | value;
+            ++m_count;
+            if (m_count == 4)
+            {
+                out[0] = (unsigned char)(m_bits >> 16);
+                out[1] = (unsigned char)(m_bits >> 8);
+                out[2] = (unsigned char)m_bits;
+                out += 3;
+                m_bits = 0;
+                m_count = 0;
+            }
+        } else if (isWhitespace(c)) {
+            continue;
+        } else if (c == '=') {
+            switch (m_count)
+            {
+                case 0://"====" is the end marker the VTK encoder can write after complete groups
+                    break;
+                case 2:
+                    out[0] = (unsigned char)(m_bits >> 4);
+                    out += 1;
+                    break;
+                case 3:
+                    out[0] = (unsigned char)(m_bits >> 10);
+                    out[1] = (unsigned char)(m_bits >> 2);
+                    out += 2;
+                    break;
+                default:
+                    m_error = true;
+                    return -1;
+            }
+            m_bits = 0;
+            m_count = 0;
+            m_endReached = true;
+            int64_t rest = decode((const char*)in, inEnd - in, out);//checks that nothing but padding follows
+            if (rest < 0) return -1;
+            break;
+        } else {
+            m_error = true;
+            return -1;
+        }
+    }
+    return out - output;
+}
+
+int64_t Base64Decoder::finish(unsigned char* output)
+{
+    if (m_error) return -1;
+    int64_t ret = 0;
+    switch (m_count)
+    {
+        case 0:
+            break;
+        case 2:
+            output[0] = (unsigned char)(m_bits >> 4);
+            ret = 1;
+            break;
+        case 3:
+            output[0] = (unsigned char)(m_bits >> 10);
+            output[1] = (unsigned char)(m_bits >> 2);
+            ret = 2;
+            break;
+        default:
+            m_error = true;
+            return -1;
+    }
+    m_bits = 0;
+    m_count = 0;
+    m_endReached = true;
+    return ret;
+}
@@ -0,0 +1,50 @@
+#ifndef __BASE64_DECODER_H__
+#define __BASE64_DECODER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+namespace caret
+{
+    ///incremental base64 decoder, the input may be split anywhere (for instance, into the chunks an XML parser gives)
+    ///whitespace is skipped, decoding ends at '=' padding, any other character outside the base64 alphabet is an error
+    class Base64Decoder
+    {
+    public:
+        Base64Decoder();
+        ///decodes the next part of the input, output must have room for getMaximumDecodedSize(inputLength) bytes
+        ///returns the number of bytes written, or -1 if the input is not valid base64
+        int64_t decode(const char* input, const int64_t& inputLength, unsigned char* output);
+        ///decodes the partial group left at the end of unpadded input, output must have room for 2 bytes
+        ///returns the number of bytes written, or -1 if the input is not valid base64
+        int64_t finish(unsigned char* output);
+        ///true after '=' padding has been seen
+        bool isEndReached() const { return m_endReached; }
+        static int64_t getMaximumDecodedSize(const int64_t& inputLength) { return (inputLength / 4 + 1) * 3; }
+    private:
+        uint32_t m_bits;//sextets of a group that was split between calls
+        int m_count;
+        bool m_endReached, m_error;
+    };
+}
+
+#endif //__BASE64_DECODER_H__
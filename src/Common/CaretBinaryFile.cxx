@@ -29,14 +29,23 @@
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
 #include "DataFileException.h"
+#include "GzipIndexedReader.h"
+#include "GzipParallelWriter.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include "zlib.h"
 
 #include <cstdio>
 #include <algorithm>
 
+#ifndef CARET_OS_WINDOWS
+#include <cerrno>
+#include <unistd.h>
+#endif
+
 using namespace caret;
 using namespace std;
 
@@ -47,9 +56,20 @@ namespace caret
     class ZFileImpl : public CaretBinaryFile::ImplInterface
     {
         gzFile m_zfile;
+        CaretPointer<GzipIndexedReader> m_indexed;//reading gzip data uses this instead of m_zfile, so that backwards seeks don't restart from the beginning
+        CaretPointer<GzipParallelWriter> m_parallelWriter;//used instead of m_zfile for writing when parallel compression is enabled
+        int64_t m_indexKey1, m_indexKey2;//file size and modification time, to validate a sidecar index
         const static int64_t CHUNK_SIZE;
+        static bool s_indexSidecar, s_parallelWrite;
+        QString getIndexSidecarName() const { return m_fileName + ".wbgzidx"; }
+        void loadIndexSidecar();
+        void saveIndexSidecar();
     public:
-        ZFileImpl() { m_zfile = NULL; }
+        ZFileImpl() { m_zfile = NULL; m_indexKey1 = -1; m_indexKey2 = -1; }
+        static void setIndexSidecar(const bool& enabled) { s_indexSidecar = enabled; }
+        static bool getIndexSidecar() { return s_indexSidecar; }
+        static void setParallelWrite(const bool& enabled) { s_parallelWrite = enabled; }
+        static bool getParallelWrite() { return s_parallelWrite; }
         void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
         void close();
         void seek(const int64_t& position);
@@ -61,6 +81,8 @@ namespace caret
     };
     
     const int64_t ZFileImpl::CHUNK_SIZE = 1<<26;//64MiB, large enough for good performance, small enough for zlib, must convert to uint32
+    bool ZFileImpl::s_indexSidecar = false;
+    bool ZFileImpl::s_parallelWrite = false;
 #endif //ZLIB_VERSION
 
     class QFileImpl : public CaretBinaryFile::ImplInterface
@@ -75,6 +97,10 @@ namespace caret
         int64_t size() { return m_file.size(); }
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
+#ifndef CARET_OS_WINDOWS
+        bool canReadAt() const { return m_file.isOpen() && m_file.handle() != -1; }
+        void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead);
+#endif
     };
     
     const int64_t QFileImpl::CHUNK_SIZE = 1<<30;//1GiB, QT4 apparently chokes at more than 2GiB via buffer.read using int32
@@ -84,6 +110,11 @@ CaretBinaryFile::ImplInterface::~ImplInterface()
 {
 }
 
+void CaretBinaryFile::ImplInterface::readAt(const int64_t&, void*, const int64_t&, int64_t*)
+{
+    throw DataFileException("positional read is not supported for file '" + m_fileName + "'");//callers should check canReadAt() first
+}
+
 CaretBinaryFile::CaretBinaryFile(const QString& filename, const OpenMode& fileMode)
 {
     open(filename, fileMode);
@@ -138,6 +169,56 @@ void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead
     m_impl->read(dataOut, count, numRead);
 }
 
+bool CaretBinaryFile::supportsConcurrentRead() const
+{
+    if (m_curMode != READ || m_impl == NULL) return false;//QFile buffers writes, so a positional read could see stale data on a file that is also being written
+    return m_impl->canReadAt();
+}
+
+void CaretBinaryFile::readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    CaretAssert(position >= 0);
+    CaretAssert(count >= 0);
+    if (!getOpenForRead()) throw DataFileException("file is not open for reading");
+    m_impl->readAt(position, dataOut, count, numRead);
+}
+
+void CaretBinaryFile::setGzipIndexSidecar(const bool& enabled)
+{
+#ifdef ZLIB_VERSION
+    ZFileImpl::setIndexSidecar(enabled);
+#else //ZLIB_VERSION
+    if (enabled) CaretLogWarning("compiled without zlib support, gzip index sidecar files will not be used");
+#endif //ZLIB_VERSION
+}
+
+bool CaretBinaryFile::getGzipIndexSidecar()
+{
+#ifdef ZLIB_VERSION
+    return ZFileImpl::getIndexSidecar();
+#else //ZLIB_VERSION
+    return false;
+#endif //ZLIB_VERSION
+}
+
+void CaretBinaryFile::setGzipParallelWrite(const bool& enabled)
+{
+#ifdef ZLIB_VERSION
+    ZFileImpl::setParallelWrite(enabled);
+#else //ZLIB_VERSION
+    if (enabled) CaretLogWarning("compiled without zlib support, parallel gzip writing will not be used");
+#endif //ZLIB_VERSION
+}
+
+bool CaretBinaryFile::getGzipParallelWrite()
+{
+#ifdef ZLIB_VERSION
+    return ZFileImpl::getParallelWrite();
+#else //ZLIB_VERSION
+    return false;
+#endif //ZLIB_VERSION
+}
+
 void CaretBinaryFile::seek(const int64_t& position)
 {
     CaretAssert(position >= 0);
@@ -183,6 +264,26 @@ void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
         default:
             throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
     }
+    if (opmode == CaretBinaryFile::READ)
+    {
+        CaretPointer<GzipIndexedReader> indexed(new GzipIndexedReader());
+        if (indexed->open(QDir::toNativeSeparators(filename).toLocal8Bit().constData()))
+        {
+            m_indexed = indexed;
+            if (s_indexSidecar) loadIndexSidecar();
+            return;
+        }//otherwise, let zlib deal with it - it transparently reads files that aren't actually compressed, and gives the usual error messages
+    }
+    if (opmode == CaretBinaryFile::WRITE_TRUNCATE && s_parallelWrite)
+    {
+        CaretPointer<GzipParallelWriter> writer(new GzipParallelWriter());
+        if (!writer->open(QDir::toNativeSeparators(filename).toLocal8Bit().constData()))
+        {
+            throw DataFileException("failed to open compressed file '" + filename + "', unable to create file");
+        }
+        m_parallelWriter = writer;
+        return;
+    }
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
     m_zfile = gzopen64(filename.toLocal8Bit().constData(), mode);
 #else
@@ -203,8 +304,43 @@ void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
     }
 }
 
+void ZFileImpl::loadIndexSidecar()
+{
+    CaretAssert(m_indexed != NULL);
+    QFileInfo fileInfo(m_fileName);
+    m_indexKey1 = fileInfo.size();
+    m_indexKey2 = fileInfo.lastModified().toMSecsSinceEpoch();
+    if (m_indexed->loadIndex(QDir::toNativeSeparators(getIndexSidecarName()).toLocal8Bit().constData(), m_indexKey1, m_indexKey2))
+    {
+        CaretLogFine("using gzip index file '" + getIndexSidecarName() + "'");
+    }
+}
+
+void ZFileImpl::saveIndexSidecar()
+{
+    CaretAssert(m_indexed != NULL);
+    if (!m_indexed->indexModified() || m_indexed->getNumberOfAccessPoints() < 2) return;//nothing new, or file is too small to benefit
+    if (!m_indexed->saveIndex(QDir::toNativeSeparators(getIndexSidecarName()).toLocal8Bit().constData(), m_indexKey1, m_indexKey2))
+    {//the index is only a cache, so don't make this an error
+        CaretLogFine("unable to write gzip index file '" + getIndexSidecarName() + "': " + QString::fromStdString(m_indexed->getErrorMessage()));
+    }
+}
+
 void ZFileImpl::close()
 {
+    if (m_indexed != NULL)
+    {
+        if (s_indexSidecar) saveIndexSidecar();
+        m_indexed.grabNew(NULL);
+        return;
+    }
+    if (m_parallelWriter != NULL)
+    {
+        CaretPointer<GzipParallelWriter> writer = m_parallelWriter;
+        m_parallelWriter.grabNew(NULL);//don't try to close it again from the destructor if this throws
+        if (!writer->close()) throw DataFileException("error closing compressed file '" + m_fileName + "': " + QString::fromStdString(writer->getErrorMessage()));
+        return;
+    }
     if (m_zfile == NULL) return;//happens when closed and then destroyed, error opening
     if (gzclose(m_zfile) != 0) throw DataFileException("error closing compressed file '" + m_fileName + "'");
     m_zfile = NULL;
@@ -212,15 +348,21 @@ void ZFileImpl::close()
 
 void ZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
-    if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
     int64_t totalRead = 0;
     int readret = 0;//to preserve the info of the read that broke early
-    while (totalRead < count)
+    if (m_indexed != NULL)
     {
-        int64_t iterSize = min(count - totalRead, CHUNK_SIZE);
-        readret = gzread(m_zfile, ((char*)dataOut) + totalRead, iterSize);
-        if (readret < 1) break;//0 or -1 indicate eof or error
-        totalRead += readret;
+        totalRead = m_indexed->read(dataOut, count);
+        if (totalRead < 0) throw DataFileException("error while reading compressed file '" + m_fileName + "': " + QString::fromStdString(m_indexed->getErrorMessage()));
+    } else {
+        if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
+        while (totalRead < count)
+        {
+            int64_t iterSize = min(count - totalRead, CHUNK_SIZE);
+            readret = gzread(m_zfile, ((char*)dataOut) + totalRead, iterSize);
+            if (readret < 1) break;//0 or -1 indicate eof or error
+            totalRead += readret;
+        }
     }
     if (numRead == NULL)
     {
@@ -236,6 +378,16 @@ void ZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
 
 void ZFileImpl::seek(const int64_t& position)
 {
+    if (m_indexed != NULL)
+    {
+        if (!m_indexed->seek(position)) throw DataFileException("seek failed in compressed file '" + m_fileName + "': " + QString::fromStdString(m_indexed->getErrorMessage()));
+        return;
+    }
+    if (m_parallelWriter != NULL)
+    {
+        if (!m_parallelWriter->seek(position)) throw DataFileException("seek failed in compressed file '" + m_fileName + "': " + QString::fromStdString(m_parallelWriter->getErrorMessage()));
+        return;
+    }
     if (m_zfile == NULL) throw DataFileException("seek called on unopened ZFileImpl");//shouldn't happen
     if (pos() == position) return;//slight hack, since gzseek is slow or nonfunctional for some cases, so don't try it unless necessary
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
@@ -248,6 +400,8 @@ void ZFileImpl::seek(const int64_t& position)
 
 int64_t ZFileImpl::pos()
 {
+    if (m_indexed != NULL) return m_indexed->pos();
+    if (m_parallelWriter != NULL) return m_parallelWriter->pos();
     if (m_zfile == NULL) throw DataFileException("pos called on unopened ZFileImpl");//shouldn't happen
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
     return gztell64(m_zfile);
@@ -258,6 +412,11 @@ int64_t ZFileImpl::pos()
 
 void ZFileImpl::write(const void* dataIn, const int64_t& count)
 {
+    if (m_parallelWriter != NULL)
+    {
+        if (!m_parallelWriter->write(dataIn, count)) throw DataFileException("failed to write to compressed file '" + m_fileName + "': " + QString::fromStdString(m_parallelWriter->getErrorMessage()));
+        return;
+    }
     if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
     int64_t totalWritten = 0;
     while (totalWritten < count)
@@ -357,6 +516,34 @@ void QFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
     }
 }
 
+#ifndef CARET_OS_WINDOWS
+void QFileImpl::readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead)
+{//pread doesn't touch the file offset, so this doesn't need a lock, and doesn't interfere with QFile's idea of the position
+    int fd = m_file.handle();
+    if (fd == -1) throw DataFileException("readAt called on unopened file '" + m_fileName + "'");//shouldn't happen
+    int64_t total = 0;
+    int64_t readret = -1;
+    while (total < count)
+    {
+        int64_t maxToRead = min(count - total, CHUNK_SIZE);
+        readret = pread(fd, ((char*)dataOut) + total, maxToRead, position + total);
+        if (readret < 0 && errno == EINTR) continue;
+        if (readret < 1) break;//0 or -1 means error or eof
+        total += readret;
+    }
+    if (numRead == NULL)
+    {
+        if (total != count)
+        {
+            if (readret < 0) throw DataFileException("error while reading file '" + m_fileName + "'");
+            throw DataFileException("premature end of file in '" + m_fileName + "'");
+        }
+    } else {
+        *numRead = total;
+    }
+}
+#endif
+
 void QFileImpl::seek(const int64_t& position)
 {
     if (m_file.pos() == position) return; //QFile::seek always does a flush in qt5, so try to avoid calling it
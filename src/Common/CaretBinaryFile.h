@@ -56,6 +56,16 @@ namespace caret {
         void read(void* dataOut, const int64_t& count, int64_t* numRead = NULL);//throw if numRead is NULL and (error or end of file reached early)
         void write(const void* dataIn, const int64_t& count);//failure to complete write is always an exception
         int64_t size();//may return -1 if size cannot be determined efficiently
+        ///whether readAt() can be called from multiple threads at once - only true for uncompressed files opened read-only
+        bool supportsConcurrentRead() const;
+        ///positional read that does not use or change the current position, same error behavior as read()
+        void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead = NULL);
+        ///when true, seek indexes built while reading .gz files are saved next to the file (as <filename>.wbgzidx) and reused on later opens
+        static void setGzipIndexSidecar(const bool& enabled);
+        static bool getGzipIndexSidecar();
+        ///when true, .gz files opened for writing are compressed in independent blocks on multiple threads
+        static void setGzipParallelWrite(const bool& enabled);
+        static bool getGzipParallelWrite();
         class ImplInterface
         {
         protected:
@@ -69,6 +79,8 @@ namespace caret {
             virtual int64_t size() = 0;
             virtual void read(void* dataOut, const int64_t& count, int64_t* numRead) = 0;
             virtual void write(const void* dataIn, const int64_t& count) = 0;
+            virtual bool canReadAt() const { return false; }
+            virtual void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead);
             virtual ~ImplInterface();
         };
     private:
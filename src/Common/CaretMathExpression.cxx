@@ -23,11 +23,86 @@
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t BATCH_CHUNK = 256;//values per instruction in evaluateBatch, small enough that the stack stays in cache
+
+    //shared by the tree and batch evaluation, so they give the same answers
+    float compareFudge(const double& a, const double& b)
+    {//because == doesn't always work as expected, include a fudge factor based on the approximate precision of float
+        return min(abs(a), abs(b)) / 1000000;
+    }
+
+    bool approxEqual(const double& a, const double& b)
+    {
+        float adjust = compareFudge(a, b);
+        return (a >= b - adjust) && (a <= b + adjust);
+    }
+
+    double asinhFunc(const double& arg)
+    {//asinh would work with c++11, but doesn't work on windows with previous standard
+        if (arg > 0)
+        {
+            return log(arg + sqrt(arg * arg + 1));
+        } else {
+            return -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
+        }
+    }
+
+    double acoshFunc(const double& arg)
+    {
+        return log(arg + sqrt(arg * arg - 1));
+    }
+
+    double atanhFunc(const double& arg)
+    {
+        return 0.5 * log((1 + arg) / (1 - arg));
+    }
+
+    double sincFunc(const double& arg)
+    {
+        if (arg == 0.0) return 1.0;//assume sin(x) behaves well for very small x
+        return sin(arg) / arg;
+    }
+
+    double roundFunc(const double& arg)
+    {//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
+        if (arg > 0.0) return floor(arg + 0.5);
+        return ceil(arg - 0.5);
+    }
+
+    double modFunc(const double& first, const double& second)
+    {
+        if (second == 0.0) return 0.0;
+        return first - second * floor(first / second);
+    }
+
+    //plain loops over a chunk, so the compiler can vectorize them when the operation allows
+    template <typename F>
+    void unaryLoop(double* data, const int64_t& count, F func)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            data[i] = func(data[i]);
+        }
+    }
+
+    template <typename F>
+    void binaryLoop(double* left, const double* right, const int64_t& count, F func)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            left[i] = func(left[i], right[i]);
+        }
+    }
+}
+
 CaretMathExpression::CaretMathExpression(const AString& expression)
 {
     m_input = expression;
@@ -38,6 +113,10 @@ CaretMathExpression::CaretMathExpression(const AString& expression)
     {
         throw CaretException("extra characters on end of expression: '" + m_input.mid(m_position) + "'");
     }
+    int depth = 0;
+    m_maxStackDepth = 0;
+    compile(m_root, depth);
+    CaretAssert(depth == 1);
     CaretLogFiner("parsed '" + expression + "' as '" + toString() + "'");
 }
 
@@ -47,6 +126,333 @@ double CaretMathExpression::evaluate(const vector<float>& variableValues) const
     return m_root->eval(variableValues);
 }
 
+void CaretMathExpression::evaluateBatch(const vector<const float*>& variableArrays, const int64_t& count, float* out) const
+{
+    CaretAssert(variableArrays.size() == m_varNames.size());
+    vector<double> stack(m_maxStackDepth * BATCH_CHUNK);
+    int numInstructions = (int)m_program.size();
+    for (int64_t start = 0; start < count; start += BATCH_CHUNK)
+    {
+        const int64_t chunkSize = min(BATCH_CHUNK, count - start);
+        int depth = 0;
+        for (int p = 0; p < numInstructions; ++p)
+        {
+            const MathInstruction& instr = m_program[p];
+            switch (instr.m_op)
+            {
+                case MathInstruction::PUSH_VAR:
+                {
+                    CaretAssertVectorIndex(variableArrays, instr.m_varIndex);
+                    CaretAssert(depth < m_maxStackDepth);
+                    double* dest = stack.data() + depth * BATCH_CHUNK;
+                    const float* source = variableArrays[instr.m_varIndex] + start;
+                    for (int64_t i = 0; i < chunkSize; ++i)
+                    {
+                        dest[i] = source[i];
+                    }
+                    ++depth;
+                    continue;
+                }
+                case MathInstruction::PUSH_CONST:
+                {
+                    CaretAssert(depth < m_maxStackDepth);
+                    double* dest = stack.data() + depth * BATCH_CHUNK;
+                    const double value = instr.m_constVal;
+                    for (int64_t i = 0; i < chunkSize; ++i)
+                    {
+                        dest[i] = value;
+                    }
+                    ++depth;
+                    continue;
+                }
+                case MathInstruction::NOT:
+                    CaretAssert(depth > 0);
+                    unaryLoop(stack.data() + (depth - 1) * BATCH_CHUNK, chunkSize, [](const double& a) { return (a > 0.0) ? 0.0 : 1.0; });
+                    continue;
+                case MathInstruction::NEGATE:
+                    CaretAssert(depth > 0);
+                    unaryLoop(stack.data() + (depth - 1) * BATCH_CHUNK, chunkSize, [](const double& a) { return -a; });
+                    continue;
+                case MathInstruction::FUNC:
+                    break;//may have any number of arguments, below
+                default://all other instructions are binary
+                {
+                    CaretAssert(depth > 1);
+                    double* left = stack.data() + (depth - 2) * BATCH_CHUNK;
+                    const double* right = left + BATCH_CHUNK;
+                    switch (instr.m_op)
+                    {
+                        case MathInstruction::OR:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a > 0.0 || b > 0.0) ? 1.0 : 0.0; });
+                            break;
+                        case MathInstruction::AND:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a > 0.0 && b > 0.0) ? 1.0 : 0.0; });
+                            break;
+                        case MathInstruction::EQUAL:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return approxEqual(a, b) ? 1.0 : 0.0; });
+                            break;
+                        case MathInstruction::NOT_EQUAL:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return approxEqual(a, b) ? 0.0 : 1.0; });
+                            break;
+                        case MathInstruction::GREATER:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a > b) ? 1.0 : 0.0; });
+                            break;
+                        case MathInstruction::GREATER_EQUAL:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a >= b - compareFudge(a, b)) ? 1.0 : 0.0; });
+                            break;
+                        case MathInstruction::LESS:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a < b) ? 1.0 : 0.0; });
+                            break;
+                        case MathInstruction::LESS_EQUAL:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a <= b + compareFudge(a, b)) ? 1.0 : 0.0; });
+                            break;
+                        case MathInstruction::ADD:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return a + b; });
+                            break;
+                        case MathInstruction::SUBTRACT:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return a - b; });
+                            break;
+                        case MathInstruction::MULTIPLY:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return a * b; });
+                            break;
+                        case MathInstruction::DIVIDE:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return a / b; });
+                            break;
+                        case MathInstruction::POW:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return pow(a, b); });
+                            break;
+                        default:
+                            CaretAssertMessage(0, "unhandled instruction in CaretMathExpression");
+                            throw CaretException("internal error in CaretMathExpression");
+                    }
+                    --depth;
+                    continue;
+                }
+            }
+            CaretAssert(instr.m_op == MathInstruction::FUNC);
+            switch (instr.m_function)
+            {
+                case MathFunctionEnum::ATAN2:
+                case MathFunctionEnum::MIN:
+                case MathFunctionEnum::MAX:
+                case MathFunctionEnum::MOD:
+                {
+                    CaretAssert(depth > 1);
+                    double* left = stack.data() + (depth - 2) * BATCH_CHUNK;
+                    const double* right = left + BATCH_CHUNK;
+                    switch (instr.m_function)
+                    {
+                        case MathFunctionEnum::ATAN2:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return atan2(a, b); });
+                            break;
+                        case MathFunctionEnum::MIN:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a > b) ? b : a; });
+                            break;
+                        case MathFunctionEnum::MAX:
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return (a < b) ? b : a; });
+                            break;
+                        default://MOD
+                            binaryLoop(left, right, chunkSize, [](const double& a, const double& b) { return modFunc(a, b); });
+                            break;
+                    }
+                    --depth;
+                    break;
+                }
+                case MathFunctionEnum::CLAMP:
+                {
+                    CaretAssert(depth > 2);
+                    double* data = stack.data() + (depth - 3) * BATCH_CHUNK;
+                    const double* low = data + BATCH_CHUNK;
+                    const double* high = low + BATCH_CHUNK;
+                    for (int64_t i = 0; i < chunkSize; ++i)
+                    {
+                        double temp = data[i];
+                        if (temp < low[i]) temp = low[i];
+                        if (temp > high[i]) temp = high[i];
+                        data[i] = temp;
+                    }
+                    depth -= 2;
+                    break;
+                }
+                default:
+                {
+                    CaretAssert(depth > 0);
+                    double* data = stack.data() + (depth - 1) * BATCH_CHUNK;
+                    switch (instr.m_function)
+                    {
+                        case MathFunctionEnum::SIN:
+                            unaryLoop(data, chunkSize, [](const double& a) { return sin(a); });
+                            break;
+                        case MathFunctionEnum::COS:
+                            unaryLoop(data, chunkSize, [](const double& a) { return cos(a); });
+                            break;
+                        case MathFunctionEnum::TAN:
+                            unaryLoop(data, chunkSize, [](const double& a) { return tan(a); });
+                            break;
+                        case MathFunctionEnum::ASIN:
+                            unaryLoop(data, chunkSize, [](const double& a) { return asin(a); });
+                            break;
+                        case MathFunctionEnum::ACOS:
+                            unaryLoop(data, chunkSize, [](const double& a) { return acos(a); });
+                            break;
+                        case MathFunctionEnum::ATAN:
+                            unaryLoop(data, chunkSize, [](const double& a) { return atan(a); });
+                            break;
+                        case MathFunctionEnum::SINH:
+                            unaryLoop(data, chunkSize, [](const double& a) { return sinh(a); });
+                            break;
+                        case MathFunctionEnum::COSH:
+                            unaryLoop(data, chunkSize, [](const double& a) { return cosh(a); });
+                            break;
+                        case MathFunctionEnum::TANH:
+                            unaryLoop(data, chunkSize, [](const double& a) { return tanh(a); });
+                            break;
+                        case MathFunctionEnum::ASINH:
+                            unaryLoop(data, chunkSize, [](const double& a) { return asinhFunc(a); });
+                            break;
+                        case MathFunctionEnum::ACOSH:
+                            unaryLoop(data, chunkSize, [](const double& a) { return acoshFunc(a); });
+                            break;
+                        case MathFunctionEnum::ATANH:
+                            unaryLoop(data, chunkSize, [](const double& a) { return atanhFunc(a); });
+                            break;
+                        case MathFunctionEnum::SINC:
+                            unaryLoop(data, chunkSize, [](const double& a) { return sincFunc(a); });
+                            break;
+                        case MathFunctionEnum::LN:
+                            unaryLoop(data, chunkSize, [](const double& a) { return log(a); });
+                            break;
+                        case MathFunctionEnum::EXP:
+                            unaryLoop(data, chunkSize, [](const double& a) { return exp(a); });
+                            break;
+                        case MathFunctionEnum::LOG:
+                            unaryLoop(data, chunkSize, [](const double& a) { return log10(a); });
+                            break;
+                        case MathFunctionEnum::LOG2:
+                            unaryLoop(data, chunkSize, [](const double& a) { return log2(a); });
+                            break;
+                        case MathFunctionEnum::SQRT:
+                            unaryLoop(data, chunkSize, [](const double& a) { return sqrt(a); });
+                            break;
+                        case MathFunctionEnum::ABS:
+                            unaryLoop(data, chunkSize, [](const double& a) { return abs(a); });
+                            break;
+                        case MathFunctionEnum::FLOOR:
+                            unaryLoop(data, chunkSize, [](const double& a) { return floor(a); });
+                            break;
+                        case MathFunctionEnum::ROUND:
+                            unaryLoop(data, chunkSize, [](const double& a) { return roundFunc(a); });
+                            break;
+                        case MathFunctionEnum::CEIL:
+                            unaryLoop(data, chunkSize, [](const double& a) { return ceil(a); });
+                            break;
+                        default:
+                            CaretAssertMessage(0, "unhandled function in CaretMathExpression");
+                            throw CaretException("internal error in CaretMathExpression");
+                    }
+                    break;
+                }
+            }
+        }
+        CaretAssert(depth == 1);
+        const double* result = stack.data();
+        float* outChunk = out + start;
+        for (int64_t i = 0; i < chunkSize; ++i)
+        {
+            outChunk[i] = (float)result[i];
+        }
+    }
+}
+
+void CaretMathExpression::compile(const MathNode* node, int& depth)
+{
+    if (!node->hasVariables())
+    {//constant folding, just use the tree to evaluate it
+        MathInstruction instr(MathInstruction::PUSH_CONST);
+        instr.m_constVal = node->eval(vector<float>());
+        m_program.push_back(instr);
+        ++depth;
+        if (depth > m_maxStackDepth) m_maxStackDepth = depth;
+        return;
+    }
+    int numArgs = (int)node->m_arguments.size();
+    for (int i = 0; i < numArgs; ++i)
+    {
+        compile(node->m_arguments[i], depth);
+        if (i == 0) continue;
+        switch (node->m_type)//chained binary operators evaluate left to right, so emit the operator after each argument past the first
+        {
+            case MathNode::OR:
+                m_program.push_back(MathInstruction(MathInstruction::OR));
+                --depth;
+                break;
+            case MathNode::AND:
+                m_program.push_back(MathInstruction(MathInstruction::AND));
+                --depth;
+                break;
+            case MathNode::EQUAL:
+                m_program.push_back(MathInstruction(node->m_invert[i] ? MathInstruction::NOT_EQUAL : MathInstruction::EQUAL));
+                --depth;
+                break;
+            case MathNode::GREATERLESS:
+                if (node->m_inclusive[i])
+                {
+                    m_program.push_back(MathInstruction(node->m_invert[i] ? MathInstruction::LESS_EQUAL : MathInstruction::GREATER_EQUAL));
+                } else {
+                    m_program.push_back(MathInstruction(node->m_invert[i] ? MathInstruction::LESS : MathInstruction::GREATER));
+                }
+                --depth;
+                break;
+            case MathNode::ADDSUB:
+                m_program.push_back(MathInstruction(node->m_invert[i] ? MathInstruction::SUBTRACT : MathInstruction::ADD));
+                --depth;
+                break;
+            case MathNode::MULTDIV:
+                m_program.push_back(MathInstruction(node->m_invert[i] ? MathInstruction::DIVIDE : MathInstruction::MULTIPLY));
+                --depth;
+                break;
+            default:
+                break;
+        }
+    }
+    switch (node->m_type)
+    {
+        case MathNode::NOT:
+            m_program.push_back(MathInstruction(MathInstruction::NOT));
+            break;
+        case MathNode::NEGATE:
+            m_program.push_back(MathInstruction(MathInstruction::NEGATE));
+            break;
+        case MathNode::POW:
+            CaretAssert(numArgs == 2);
+            m_program.push_back(MathInstruction(MathInstruction::POW));
+            --depth;
+            break;
+        case MathNode::FUNC:
+        {
+            MathInstruction instr(MathInstruction::FUNC);
+            instr.m_function = node->m_function;
+            m_program.push_back(instr);
+            depth -= numArgs - 1;
+            break;
+        }
+        case MathNode::VAR:
+        {
+            MathInstruction instr(MathInstruction::PUSH_VAR);
+            instr.m_varIndex = node->m_varIndex;
+            m_program.push_back(instr);
+            ++depth;
+            if (depth > m_maxStackDepth) m_maxStackDepth = depth;
+            break;
+        }
+        case MathNode::INVALID:
+            CaretAssertMessage(0, "parsing left INVALID MathNode");
+            throw CaretException("parsing problem in CaretMathExpression");
+        default:
+            break;
+    }
+}
+
 vector<AString> CaretMathExpression::getVarNames() const
 {
     vector<AString> ret(m_varNames.size());
@@ -124,9 +530,7 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
             ret = m_arguments[0]->eval(values);
             for (int i = 1; i < end; ++i)
             {
-                double temp = m_arguments[i]->eval(values);
-                float adjust = min(abs(ret), abs(temp)) / 1000000;//because == doesn't always work as expected, include a fudge factor based on the approximate precision of float
-                bool equal = (ret >= m_arguments[i]->eval(values) - adjust) && (ret <= m_arguments[i]->eval(values) + adjust);
+                bool equal = approxEqual(ret, m_arguments[i]->eval(values));
                 if (m_invert[i])
                 {
                     ret = equal ? 0.0 : 1.0;
@@ -148,7 +552,7 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
                 double temp = m_arguments[i]->eval(values);
                 if (m_inclusive[i])
                 {
-                    float adjust = min(abs(ret), abs(temp)) / 1000000;//because == doesn't always work as expected, include a fudge factor based on the approximate precision of float
+                    float adjust = compareFudge(ret, temp);
                     if (m_invert[i])
                     {
                         ret = (ret <= temp + adjust ? 1.0 : 0.0);//don't trust booleans to cast to 0 and 1, just because
@@ -255,46 +659,21 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
                     ret = tanh(m_arguments[0]->eval(values));
                     break;
                 case MathFunctionEnum::ASINH:
-                {
                     CaretAssert(m_arguments.size() == 1);
-                    //ret = asinh(m_arguments[0].eval(values));//will work, and be preferred, when we use c++11, but doesn't work on windows with previous standard
-                    double arg = m_arguments[0]->eval(values);
-                    if (arg > 0)
-                    {
-                        ret = log(arg + sqrt(arg * arg + 1));
-                    } else {
-                        ret = -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
-                    }
+                    ret = asinhFunc(m_arguments[0]->eval(values));
                     break;
-                }
                 case MathFunctionEnum::ACOSH:
-                {
                     CaretAssert(m_arguments.size() == 1);
-                    //ret = acosh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = log(arg + sqrt(arg * arg - 1));
+                    ret = acoshFunc(m_arguments[0]->eval(values));
                     break;
-                }
                 case MathFunctionEnum::ATANH:
-                {
                     CaretAssert(m_arguments.size() == 1);
-                    //ret = atanh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = 0.5 * log((1 + arg) / (1 - arg));
+                    ret = atanhFunc(m_arguments[0]->eval(values));
                     break;
-                }
                 case MathFunctionEnum::SINC:
-                {
                     CaretAssert(m_arguments.size() == 1);
-                    double arg = m_arguments[0]->eval(values);
-                    if (arg == 0.0)//assume sin(x) behaves well for very small x
-                    {
-                        ret = 1.0;
-                    } else {
-                        ret = sin(arg) / arg;
-                    }
+                    ret = sincFunc(m_arguments[0]->eval(values));
                     break;
-                }
                 case MathFunctionEnum::LN:
                     CaretAssert(m_arguments.size() == 1);
                     ret = log(m_arguments[0]->eval(values));
@@ -324,17 +703,9 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
                     ret = floor(m_arguments[0]->eval(values));
                     break;
                 case MathFunctionEnum::ROUND:
-                {
                     CaretAssert(m_arguments.size() == 1);
-                    double temp = m_arguments[0]->eval(values);//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
-                    if (temp > 0.0)
-                    {
-                        ret = floor(temp + 0.5);
-                    } else {
-                        ret = ceil(temp - 0.5);
-                    }
+                    ret = roundFunc(m_arguments[0]->eval(values));
                     break;
-                }
                 case MathFunctionEnum::CEIL:
                     CaretAssert(m_arguments.size() == 1);
                     ret = ceil(m_arguments[0]->eval(values));
@@ -360,18 +731,9 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
                     break;
                 }
                 case MathFunctionEnum::MOD:
-                {
                     CaretAssert(m_arguments.size() == 2);
-                    double second = m_arguments[1]->eval(values);
-                    if (second == 0.0)
-                    {
-                        ret = 0.0;
-                    } else {
-                        double first = m_arguments[0]->eval(values);
-                        ret = first - second * floor(first / second);
-                    }
+                    ret = modFunc(m_arguments[0]->eval(values), m_arguments[1]->eval(values));
                     break;
-                }
                 case MathFunctionEnum::CLAMP:
                 {
                     CaretAssert(m_arguments.size() == 3);
@@ -408,6 +770,16 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
     return ret;
 }
 
+bool CaretMathExpression::MathNode::hasVariables() const
+{
+    if (m_type == VAR) return true;
+    for (int i = 0; i < (int)m_arguments.size(); ++i)
+    {
+        if (m_arguments[i]->hasVariables()) return true;
+    }
+    return false;
+}
+
 AString CaretMathExpression::MathNode::toString(const std::vector<AString>& varNames, bool addParens) const
 {
     AString ret = "";
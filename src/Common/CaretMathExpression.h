@@ -26,6 +26,7 @@
 #include "MathFunctionEnum.h"
 
 #include <map>
+#include <stdint.h>
 #include <vector>
 
 namespace caret {
@@ -62,11 +63,44 @@ class CaretMathExpression
         MathNode(const ExprType& type) { m_type = type; m_function = MathFunctionEnum::INVALID; }
         double eval(const std::vector<float>& values) const;
         AString toString(const std::vector<AString>& varNames, bool addParens = true) const;
+        bool hasVariables() const;
+    };
+    struct MathInstruction
+    {//stack machine instruction, operates on a chunk of values at a time
+        enum OpCode
+        {
+            PUSH_VAR,
+            PUSH_CONST,
+            OR,
+            AND,
+            EQUAL,
+            NOT_EQUAL,
+            GREATER,
+            GREATER_EQUAL,
+            LESS,
+            LESS_EQUAL,
+            ADD,
+            SUBTRACT,
+            MULTIPLY,
+            DIVIDE,
+            NOT,
+            NEGATE,
+            POW,
+            FUNC
+        };
+        OpCode m_op;
+        MathFunctionEnum::Enum m_function;
+        double m_constVal;
+        int m_varIndex;
+        MathInstruction(const OpCode& op) { m_op = op; m_function = MathFunctionEnum::INVALID; m_constVal = 0.0; m_varIndex = -1; }
     };
     std::map<AString, int> m_varNames;
     AString m_input;
     int m_position, m_end;
     CaretPointer<MathNode> m_root;
+    std::vector<MathInstruction> m_program;//postfix form of m_root, with constant subexpressions folded
+    int m_maxStackDepth;
+    void compile(const MathNode* node, int& depth);
     bool skipWhitespace();
     bool accept(const char& c);
     void expect(const char& c, const int& exprStart);
@@ -87,6 +121,9 @@ public:
     static bool getNamedConstant(const AString& name, double& valueOut);
     CaretMathExpression(const AString& expression);
     double evaluate(const std::vector<float>& variableValues) const;
+    ///evaluates count elements at once, variableArrays has one array of count values per variable, in the order of getVarNames()
+    ///gives the same results as evaluate(), and is safe to call from multiple threads, so callers can split their data across threads
+    void evaluateBatch(const std::vector<const float*>& variableArrays, const int64_t& count, float* out) const;
     std::vector<AString> getVarNames() const;
     AString toString() const;//the expression, with a lot of parentheses added
 };
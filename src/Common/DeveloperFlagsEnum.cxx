@@ -142,7 +142,7 @@ DeveloperFlagsEnum::initialize()
                                                 "DEVELOPER_FLAG_SURFACE_BUFFER",
                                                 "Drawing: Draw Surfaces Using Buffers",
                                                 CheckableEnum::YES,
-                                                false));
+                                                true));
     
     checkableItems.push_back(DeveloperFlagsEnum(DEVELOPER_FLAG_VOXEL_CUBES_TEST,
                                                 "DEVELOPER_FLAG_VOXEL_CUBES_TEST",
@@ -284,7 +284,8 @@ DeveloperFlagsEnum::toToolTip(Enum enumValue)
             toolTip = ("Smooth MPR volume functional volume drawing voxels");
             break;
         case DEVELOPER_FLAG_SURFACE_BUFFER:
-            toolTip = ("Draw surface using buffers (improved performance)");
+            toolTip = ("Draw surface using buffers (improved performance), "
+                       "when off surfaces are drawn using vertex arrays");
             break;
         case DEVELOPER_FLAG_BLENDING:
             toolTip = ("Separately blend RGB and Alpha components so Alpha is always 1.0 in frame buffer"
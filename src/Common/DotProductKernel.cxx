@@ -0,0 +1,104 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "DotProductKernel.h"
+
+#include "CaretAssert.h"
+
+#ifdef CARET_DOTPRODUCT_AVX2
+extern "C"
+{
+#include "cpuinfo.h"
+}
+#endif
+
+using namespace caret;
+
+namespace
+{
+    bool cpuHasAVX2()
+    {
+#ifdef CARET_DOTPRODUCT_AVX2
+        static const bool ret = (hasAVX() != 0 && hasAVX2() != 0);//hasAVX also checks that the OS saves the registers
+        return ret;
+#else
+        return false;
+#endif
+    }
+
+    bool s_avx2Enabled = true;
+}
+
+bool DotProductKernel::setAVX2Enabled(const bool& enabled)
+{
+    s_avx2Enabled = enabled;
+    return isAVX2Enabled();
+}
+
+bool DotProductKernel::isAVX2Enabled()
+{
+    return s_avx2Enabled && cpuHasAVX2();
+}
+
+void DotProductKernel::packRows(const float* const* rows, const int& numRows, const int64_t& length, float* packedOut)
+{
+    CaretAssert(numRows >= 0 && numRows <= BLOCK_COLS);
+    for (int64_t k = 0; k < length; ++k)
+    {
+        float* packedElem = packedOut + k * BLOCK_COLS;
+        int j = 0;
+        for (; j < numRows; ++j)
+        {
+            packedElem[j] = rows[j][k];
+        }
+        for (; j < BLOCK_COLS; ++j)
+        {
+            packedElem[j] = 0.0f;
+        }
+    }
+}
+
+void DotProductKernel::dotBlock(const float* const* rows, const float* packed, const int64_t& length, double* dotsOut)
+{
+#ifdef CARET_DOTPRODUCT_AVX2
+    if (isAVX2Enabled())
+    {
+        dotBlockAVX2(rows, packed, length, dotsOut);
+        return;
+    }
+#endif
+    for (int i = 0; i < BLOCK_ROWS * BLOCK_COLS; ++i)
+    {
+        dotsOut[i] = 0.0;
+    }
+    for (int64_t k = 0; k < length; ++k)
+    {
+        const float* packedElem = packed + k * BLOCK_COLS;
+        for (int i = 0; i < BLOCK_ROWS; ++i)
+        {
+            const float value = rows[i][k];
+            double* dotRow = dotsOut + i * BLOCK_COLS;
+            for (int j = 0; j < BLOCK_COLS; ++j)
+            {
+                dotRow[j] += value * packedElem[j];//float product, like dsdot
+            }
+        }
+    }
+}
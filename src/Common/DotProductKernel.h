@@ -0,0 +1,54 @@
+#ifndef __DOT_PRODUCT_KERNEL_H__
+#define __DOT_PRODUCT_KERNEL_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+
+namespace caret
+{
+    ///register blocked dot products of several rows against several others, with an AVX2 version used when the build and cpu support it
+    ///each dot product is summed in double in element order from float products, exactly like the naive dsdot, so results don't depend on the blocking
+    class DotProductKernel
+    {
+    public:
+        ///number of rows in the first operand of a block, and number of packed rows in the second
+        static const int BLOCK_ROWS = 4, BLOCK_COLS = 8;
+
+        ///interleave up to BLOCK_COLS rows so that packedOut[k * BLOCK_COLS + j] = rows[j][k], missing rows are filled with zeros
+        ///packedOut must hold length * BLOCK_COLS floats
+        static void packRows(const float* const* rows, const int& numRows, const int64_t& length, float* packedOut);
+
+        ///dotsOut[i * BLOCK_COLS + j] = dot product of rows[i] with packed row j, for BLOCK_ROWS rows
+        static void dotBlock(const float* const* rows, const float* packed, const int64_t& length, double* dotsOut);
+
+        ///enable or disable the AVX2 version, returns whether it will be used (false if the build or cpu lacks it)
+        static bool setAVX2Enabled(const bool& enabled);
+
+        static bool isAVX2Enabled();
+
+    private:
+        ///compiled with -mavx2 in a separate file, only called when the cpu has been checked
+        static void dotBlockAVX2(const float* const* rows, const float* packed, const int64_t& length, double* dotsOut);
+    };
+}
+
+#endif //__DOT_PRODUCT_KERNEL_H__
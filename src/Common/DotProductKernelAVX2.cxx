@@ -0,0 +1,67 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//this file is compiled with -mavx2 when CARET_DOTPRODUCT_AVX2 is enabled, and is empty otherwise
+//do NOT include headers with inline functions or templates here, see StatisticsKernelAVX2.cxx
+#ifdef __AVX2__
+
+#include "DotProductKernel.h"
+
+#include <immintrin.h>
+
+using namespace caret;
+
+namespace
+{
+    //add the float products of one row element with 8 packed elements to two vectors of double sums
+    void addProducts(const float* rowElem, const __m256 packedElems, __m256d& sumLow, __m256d& sumHigh)
+    {
+        const __m256 products = _mm256_mul_ps(_mm256_broadcast_ss(rowElem), packedElems);//rounded to float, so the sums match dsdot
+        sumLow = _mm256_add_pd(sumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(products)));
+        sumHigh = _mm256_add_pd(sumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(products, 1)));
+    }
+}
+
+void DotProductKernel::dotBlockAVX2(const float* const* rows, const float* packed, const int64_t& length, double* dotsOut)
+{//each lane is one pair of rows summed in element order, the vectors only go across the block
+    const float* row0 = rows[0], *row1 = rows[1], *row2 = rows[2], *row3 = rows[3];
+    __m256d sum0Low = _mm256_setzero_pd(), sum0High = _mm256_setzero_pd();
+    __m256d sum1Low = _mm256_setzero_pd(), sum1High = _mm256_setzero_pd();
+    __m256d sum2Low = _mm256_setzero_pd(), sum2High = _mm256_setzero_pd();
+    __m256d sum3Low = _mm256_setzero_pd(), sum3High = _mm256_setzero_pd();
+    for (int64_t k = 0; k < length; ++k)
+    {
+        const __m256 packedElems = _mm256_loadu_ps(packed + k * BLOCK_COLS);
+        addProducts(row0 + k, packedElems, sum0Low, sum0High);
+        addProducts(row1 + k, packedElems, sum1Low, sum1High);
+        addProducts(row2 + k, packedElems, sum2Low, sum2High);
+        addProducts(row3 + k, packedElems, sum3Low, sum3High);
+    }
+    _mm256_storeu_pd(dotsOut, sum0Low);
+    _mm256_storeu_pd(dotsOut + 4, sum0High);
+    _mm256_storeu_pd(dotsOut + BLOCK_COLS, sum1Low);
+    _mm256_storeu_pd(dotsOut + BLOCK_COLS + 4, sum1High);
+    _mm256_storeu_pd(dotsOut + 2 * BLOCK_COLS, sum2Low);
+    _mm256_storeu_pd(dotsOut + 2 * BLOCK_COLS + 4, sum2High);
+    _mm256_storeu_pd(dotsOut + 3 * BLOCK_COLS, sum3Low);
+    _mm256_storeu_pd(dotsOut + 3 * BLOCK_COLS + 4, sum3High);
+}
+
+#endif //__AVX2__
@@ -18,6 +18,7 @@
  */
 /*LICENSE_END*/
 
+#include <QMutexLocker>
 #include <QThread>
 
 #include <algorithm>
@@ -167,6 +168,7 @@ void
 EventManager::addEventListener(EventListenerInterface* eventListener,
                                const EventTypeEnum::Enum listenForEventType)
 {
+    QMutexLocker locker(&m_listenersMutex);
 #ifdef CONTAINER_VECTOR
     m_eventListeners[listenForEventType].push_back(eventListener);
 #elif CONTAINER_HASH_SET
@@ -191,6 +193,7 @@ void
 EventManager::addProcessedEventListener(EventListenerInterface* eventListener,
                                const EventTypeEnum::Enum listenForEventType)
 {
+    QMutexLocker locker(&m_listenersMutex);
 #ifdef CONTAINER_VECTOR
     m_eventProcessedListeners[listenForEventType].push_back(eventListener);
 #elif CONTAINER_HASH_SET
@@ -214,6 +217,7 @@ void
 EventManager::removeEventFromListener(EventListenerInterface* eventListener,
                                   const EventTypeEnum::Enum listenForEventType)
 {
+    QMutexLocker locker(&m_listenersMutex);
 #ifdef CONTAINER_VECTOR
     /*
      * Remove from NORMAL listeners
@@ -306,7 +310,11 @@ EventManager::sendEvent(Event* event)
         /*
          * Get listeners for event.
          */
-        EVENT_LISTENER_CONTAINER listeners = m_eventListeners[eventType];
+        EVENT_LISTENER_CONTAINER listeners;
+        {
+            QMutexLocker locker(&m_listenersMutex);
+            listeners = m_eventListeners[eventType];
+        }
         
         const AString eventNumberString = AString::number(m_eventIssuedCounter);
         
@@ -333,7 +341,11 @@ EventManager::sendEvent(Event* event)
             /*
              * Send event to each of the PROCESSED listeners.
              */
-            EVENT_LISTENER_CONTAINER processedListeners = m_eventProcessedListeners[eventType];
+            EVENT_LISTENER_CONTAINER processedListeners;
+            {
+                QMutexLocker locker(&m_listenersMutex);
+                processedListeners = m_eventProcessedListeners[eventType];
+            }
             for (EVENT_LISTENER_CONTAINER_ITERATOR iter = processedListeners.begin();
                  iter != processedListeners.end();
                  iter++) {
@@ -595,12 +607,15 @@ EventManager::verifyAllListenersRemoved(EventListenerInterface* eventListener)
 {
     AString eventNames;
     
-    for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
-        const EventTypeEnum::Enum eventType = static_cast<EventTypeEnum::Enum>(i);
-        if ((m_eventListeners[eventType].find(eventListener) != m_eventListeners[eventType].end())
-            || (m_eventProcessedListeners[eventType].find(eventListener) != m_eventProcessedListeners[eventType].end())) {
-            eventNames.appendWithNewLine("    "
-                                  + EventTypeEnum::toName(eventType));
+    {
+        QMutexLocker locker(&m_listenersMutex);
+        for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
+            const EventTypeEnum::Enum eventType = static_cast<EventTypeEnum::Enum>(i);
+            if ((m_eventListeners[eventType].find(eventListener) != m_eventListeners[eventType].end())
+                || (m_eventProcessedListeners[eventType].find(eventListener) != m_eventProcessedListeners[eventType].end())) {
+                eventNames.appendWithNewLine("    "
+                                      + EventTypeEnum::toName(eventType));
+            }
         }
     }
     
@@ -23,6 +23,8 @@
 
 #include <stdint.h>
 
+#include <QMutex>
+
 #include "CaretObject.h"
 
 #include "EventTypeEnum.h"
@@ -131,6 +133,13 @@ namespace caret {
          */
         EVENT_LISTENER_CONTAINER m_eventProcessedListeners[EventTypeEnum::EVENT_COUNT];
         
+        /**
+         * Protects the listener containers since files read by
+         * worker threads (parallel spec file loading) may add and
+         * remove listeners.  Never held while an event is delivered.
+         */
+        mutable QMutex m_listenersMutex;
+        
         /** Counter that is incremented each time an event is issued */
         int64_t m_eventIssuedCounter;
         
@@ -21,9 +21,11 @@
 
 #include "FastStatistics.h"
 #include "CaretPointer.h"
+#include "StatisticsKernel.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <limits>
 
 using namespace caret;
@@ -65,103 +67,84 @@ void FastStatistics::reset()
 
 void FastStatistics::update(const float* data, const int64_t& dataCount)
 {
-    reset();
-    CaretArray<float> positives(dataCount), negatives(dataCount), absolutes(dataCount);
-    double sum = 0.0;//for numerical stability
-    bool first = true;//so min can be positive and max can be negative
-    for (int64_t i = 0; i < dataCount; ++i)
-    {
-        if (data[i] != data[i])
-        {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
-        {
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
-            {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_negInfCount;
-                    continue;//skip neg infs
-                } else {
-                    negatives[m_negCount] = data[i];
-                    ++m_negCount;
-                    if (data[i] > m_leastNeg) m_leastNeg = data[i];
-                    if (data[i] < m_mostNeg) m_mostNeg = data[i];
-                    
-                    absolutes[m_absCount] = -data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
-                }
-            } else {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_infCount;
-                    continue;//skip infs
-                } else {
-                    positives[m_posCount] = data[i];
-                    ++m_posCount;
-                    if (data[i] > m_mostPos) m_mostPos = data[i];
-                    if (data[i] < m_leastPos) m_leastPos = data[i];
-                    
-                    absolutes[m_absCount] = data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
-                }
-            }
-        }
-        if (data[i] > m_max || first) m_max = data[i];
-        if (data[i] < m_min || first) m_min = data[i];
-        sum += data[i];//use a two-pass method for stability, only do mean this pass
-        first = false;
-    }
-    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
-    m_mean = sum / totalGood;
-    float tempf;
+    const StatisticsKernel::Summary summary = StatisticsKernel::summarize(data, dataCount);
     double sum2 = 0.0;
-    for (int64_t i = 0; i < dataCount; ++i)
+    if (summary.m_posCount + summary.m_zeroCount + summary.m_negCount > 0)
     {
-        if (data[i] != data[i]) continue;//skip NaNs
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        tempf = data[i] - m_mean;
-        sum2 += tempf * tempf;
+        sum2 = StatisticsKernel::sumSquaredDeviations(data, dataCount, getMean(summary));//second pass for stability
     }
+    //the percentile histograms select their values from the data, instead of copying the positives, negatives and absolute values
+    int usebuckets = getPercentileBucketCount(dataCount);
+    Histogram negHist, posHist, absHist;
+    negHist.update(usebuckets, data, dataCount, summary, StatisticsKernel::NEGATIVE);
+    posHist.update(usebuckets, data, dataCount, summary, StatisticsKernel::POSITIVE);
+    absHist.update(usebuckets, data, dataCount, summary, StatisticsKernel::ABSOLUTE);
+    update(summary, sum2, negHist, posHist, absHist);
+}
+
+void FastStatistics::update(const StatisticsKernel::Summary& summary, const double& sumSquaredDeviations,
+                            const Histogram& negPercentHist, const Histogram& posPercentHist, const Histogram& absPercentHist)
+{
+    reset();
+    m_posCount = summary.m_posCount;
+    m_zeroCount = summary.m_zeroCount;
+    m_negCount = summary.m_negCount;
+    m_infCount = summary.m_infCount;
+    m_negInfCount = summary.m_negInfCount;
+    m_nanCount = summary.m_nanCount;
+    m_absCount = m_posCount + m_negCount;
+    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
+    m_mean = getMean(summary);
     if (totalGood > 0)
     {
-        m_stdDevPop = sqrt(sum2 / totalGood);
+        m_min = summary.m_min;
+        m_max = summary.m_max;
+        m_stdDevPop = sqrt(sumSquaredDeviations / totalGood);
         if (totalGood > 1)
         {
-            m_stdDevSample = sqrt(sum2 / (totalGood - 1));
+            m_stdDevSample = sqrt(sumSquaredDeviations / (totalGood - 1));
         }
     }
-    int usebuckets = min(NUM_BUCKETS_PERCENTILE_HIST, dataCount);
-    m_negPercentHist.update(usebuckets, negatives, m_negCount);
-    m_posPercentHist.update(usebuckets, positives, m_posCount);
-    m_absPercentHist.update(usebuckets, absolutes, m_absCount);
+    m_negPercentHist = negPercentHist;
+    m_posPercentHist = posPercentHist;
+    m_absPercentHist = absPercentHist;
     
-    if (m_negCount <= 0)
+    if (m_negCount > 0)
     {
+        m_leastNeg = summary.m_leastNeg;
+        m_mostNeg = summary.m_mostNeg;
+    } else {
         m_leastNeg = 0.0;
         m_mostNeg  = 0.0;
     }
-    if (m_posCount <= 0)
+    if (m_posCount > 0)
     {
+        m_leastPos = summary.m_leastPos;
+        m_mostPos = summary.m_mostPos;
+    } else {
         m_leastPos = 0.0;
         m_mostPos  = 0.0;
     }
-    if (m_absCount <= 0)
+    if (m_absCount > 0)
     {
+        m_leastAbs = min(summary.m_leastPos, -summary.m_leastNeg);
+        m_mostAbs = max(summary.m_mostPos, -summary.m_mostNeg);
+    } else {
         m_leastAbs = 0.0;
         m_mostAbs  = 0.0;
     }
 }
 
+float FastStatistics::getMean(const StatisticsKernel::Summary& summary)
+{
+    return summary.m_sum / (summary.m_negCount + summary.m_zeroCount + summary.m_posCount);
+}
+
+int FastStatistics::getPercentileBucketCount(const int64_t& dataCount)
+{
+    return (int)min(NUM_BUCKETS_PERCENTILE_HIST, dataCount);
+}
+
 void FastStatistics::update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive)
 {
     reset();
@@ -570,4 +553,74 @@ FastStatistics::getPositiveValuePercentile(const float value) const
 //    return percentile;
 }
 
+namespace
+{
+    struct FastStatisticsBinaryHeader
+    {//followed by the positive, negative, and absolute percentile histograms
+        float m_min, m_max, m_mean, m_stdDevPop, m_stdDevSample;
+        float m_mostPos, m_leastPos, m_leastNeg, m_mostNeg, m_leastAbs, m_mostAbs;
+        int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount, m_absCount;
+    };
+}
+
+void FastStatistics::appendBinary(vector<char>& bufferOut) const
+{
+    FastStatisticsBinaryHeader header;
+    memset(&header, 0, sizeof(FastStatisticsBinaryHeader));//no uninitialized padding in the output
+    header.m_min = m_min;
+    header.m_max = m_max;
+    header.m_mean = m_mean;
+    header.m_stdDevPop = m_stdDevPop;
+    header.m_stdDevSample = m_stdDevSample;
+    header.m_mostPos = m_mostPos;
+    header.m_leastPos = m_leastPos;
+    header.m_leastNeg = m_leastNeg;
+    header.m_mostNeg = m_mostNeg;
+    header.m_leastAbs = m_leastAbs;
+    header.m_mostAbs = m_mostAbs;
+    header.m_posCount = m_posCount;
+    header.m_zeroCount = m_zeroCount;
+    header.m_negCount = m_negCount;
+    header.m_infCount = m_infCount;
+    header.m_negInfCount = m_negInfCount;
+    header.m_nanCount = m_nanCount;
+    header.m_absCount = m_absCount;
+    const char* headerBytes = (const char*)&header;
+    bufferOut.insert(bufferOut.end(), headerBytes, headerBytes + sizeof(FastStatisticsBinaryHeader));
+    m_posPercentHist.appendBinary(bufferOut);
+    m_negPercentHist.appendBinary(bufferOut);
+    m_absPercentHist.appendBinary(bufferOut);
+}
 
+bool FastStatistics::readBinary(const char*& position, const char* end)
+{
+    FastStatisticsBinaryHeader header;
+    if (end - position < (int64_t)sizeof(FastStatisticsBinaryHeader)) return false;
+    memcpy(&header, position, sizeof(FastStatisticsBinaryHeader));
+    const char* histPosition = position + sizeof(FastStatisticsBinaryHeader);
+    Histogram posHist, negHist, absHist;//don't modify this until everything has been read
+    if (!posHist.readBinary(histPosition, end) || !negHist.readBinary(histPosition, end) || !absHist.readBinary(histPosition, end)) return false;
+    m_posPercentHist = posHist;
+    m_negPercentHist = negHist;
+    m_absPercentHist = absHist;
+    m_min = header.m_min;
+    m_max = header.m_max;
+    m_mean = header.m_mean;
+    m_stdDevPop = header.m_stdDevPop;
+    m_stdDevSample = header.m_stdDevSample;
+    m_mostPos = header.m_mostPos;
+    m_leastPos = header.m_leastPos;
+    m_leastNeg = header.m_leastNeg;
+    m_mostNeg = header.m_mostNeg;
+    m_leastAbs = header.m_leastAbs;
+    m_mostAbs = header.m_mostAbs;
+    m_posCount = header.m_posCount;
+    m_zeroCount = header.m_zeroCount;
+    m_negCount = header.m_negCount;
+    m_infCount = header.m_infCount;
+    m_negInfCount = header.m_negInfCount;
+    m_nanCount = header.m_nanCount;
+    m_absCount = header.m_absCount;
+    position = histPosition;
+    return true;
+}
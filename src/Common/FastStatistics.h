@@ -46,6 +46,17 @@ namespace caret
         
         void update(const float* data, const int64_t& dataCount);
         
+        ///statistics of data that is read in parts, summary is merged from every part, sumSquaredDeviations is summed from StatisticsKernel::sumSquaredDeviations
+        ///on every part with getMean(summary), and the percentile histograms have getPercentileBucketCount() buckets
+        void update(const StatisticsKernel::Summary& summary, const double& sumSquaredDeviations,
+                    const Histogram& negPercentHist, const Histogram& posPercentHist, const Histogram& absPercentHist);
+        
+        ///the mean that update() computes from a summary
+        static float getMean(const StatisticsKernel::Summary& summary);
+        
+        ///number of buckets in the percentile histograms for dataCount values
+        static int getPercentileBucketCount(const int64_t& dataCount);
+        
         ///statistics and display are really not that related, so for now, only include a continuous clipping range, excluding the middle from data will do weird things to standard deviation
         void update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive);
         
@@ -101,6 +112,12 @@ namespace caret
         
         float getAbsoluteValuePercentile(const float value) const;
         
+        ///append the complete state to a buffer in native byte order, for saving computed statistics
+        void appendBinary(std::vector<char>& bufferOut) const;
+        
+        ///restore a state written by appendBinary and advance position past it, returns false and leaves this unchanged if it is truncated or inconsistent
+        bool readBinary(const char*& position, const char* end);
+        
     };
     
 }
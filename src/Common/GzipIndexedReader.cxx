@@ -0,0 +1,441 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//same large file support defines as CaretBinaryFile.cxx, for fseeko
+#ifndef CARET_OS_MACOSX
+#define _LARGEFILE64_SOURCE
+#define _LFS64_LARGEFILE 1
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "GzipIndexedReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t WINDOW_SIZE = 32768;//deflate's maximum back-reference distance
+    const int64_t INPUT_BUFFER_SIZE = 1<<18;
+    const int64_t DISCARD_BUFFER_SIZE = 1<<16;
+    const int64_t MAX_INFLATE_CHUNK = 1<<30;//avail_out is a uInt
+    const char INDEX_MAGIC[8] = { 'W', 'B', 'G', 'Z', 'I', 'D', 'X', '\0' };
+    const uint32_t INDEX_VERSION = 1;//also serves as an endianness check
+
+    bool writeInt64(FILE* file, const int64_t& value)
+    {
+        return fwrite(&value, sizeof(value), 1, file) == 1;
+    }
+
+    bool readInt64(FILE* file, int64_t& value)
+    {
+        return fread(&value, sizeof(value), 1, file) == 1;
+    }
+}
+
+const int64_t GzipIndexedReader::DEFAULT_SPAN = 1<<24;//16MiB, a seek decompresses at most this much extra, each point costs up to 32KiB of memory
+
+GzipIndexedReader::GzipIndexedReader(const int64_t& span)
+{
+    m_file = NULL;
+    memset(&m_strm, 0, sizeof(m_strm));
+    m_strmInit = false;
+    m_rawMode = false;
+    m_atEnd = false;
+    m_indexModified = false;
+    m_outPos = 0;
+    m_fileInPos = 0;
+    m_span = max(span, WINDOW_SIZE);
+}
+
+GzipIndexedReader::~GzipIndexedReader()
+{
+    close();
+}
+
+bool GzipIndexedReader::open(const char* filename)
+{
+    close();
+    m_error = "";
+    m_file = fopen(filename, "rb");
+    if (m_file == NULL)
+    {
+        m_error = "unable to open file";
+        return false;
+    }
+    unsigned char magic[2];
+    if (fread(magic, 1, 2, m_file) != 2 || magic[0] != 0x1f || magic[1] != 0x8b)
+    {
+        m_error = "file does not start with a gzip header";
+        close();
+        return false;
+    }
+    if (inflateInit2(&m_strm, 47) != Z_OK)//15 bits window, +32 for gzip/zlib header detection
+    {
+        m_error = "failed to initialize zlib";
+        close();
+        return false;
+    }
+    m_strmInit = true;
+    m_inBuf.resize(INPUT_BUFFER_SIZE);
+    AccessPoint start;
+    start.m_memberStart = true;
+    m_points.push_back(start);
+    if (!restart(start))
+    {
+        close();
+        return false;
+    }
+    m_indexModified = false;
+    return true;
+}
+
+void GzipIndexedReader::close()
+{
+    if (m_strmInit)
+    {
+        inflateEnd(&m_strm);
+        m_strmInit = false;
+    }
+    memset(&m_strm, 0, sizeof(m_strm));
+    if (m_file != NULL)
+    {
+        fclose(m_file);
+        m_file = NULL;
+    }
+    m_points.clear();
+    m_inBuf.clear();
+    m_discard.clear();
+    m_outPos = 0;
+    m_fileInPos = 0;
+    m_atEnd = false;
+    m_rawMode = false;
+    m_indexModified = false;
+}
+
+bool GzipIndexedReader::seekFile(const int64_t& position)
+{
+#ifdef CARET_OS_WINDOWS_MSVC
+    int ret = _fseeki64(m_file, position, SEEK_SET);
+#else
+    int ret = fseeko(m_file, position, SEEK_SET);
+#endif
+    if (ret != 0)
+    {
+        m_error = "failed to seek in compressed file";
+        return false;
+    }
+    m_fileInPos = position;
+    m_strm.next_in = m_inBuf.data();
+    m_strm.avail_in = 0;
+    return true;
+}
+
+bool GzipIndexedReader::fillInput()
+{
+    if (m_strm.avail_in != 0 && m_strm.next_in != m_inBuf.data())
+    {//keep unconsumed input, nextMember needs to look at bytes that may straddle a buffer boundary
+        memmove(m_inBuf.data(), m_strm.next_in, m_strm.avail_in);
+    }
+    size_t numRead = fread(m_inBuf.data() + m_strm.avail_in, 1, m_inBuf.size() - m_strm.avail_in, m_file);
+    if (numRead == 0 && ferror(m_file))
+    {
+        m_error = "error reading compressed file";
+        return false;
+    }
+    m_fileInPos += numRead;
+    m_strm.next_in = m_inBuf.data();
+    m_strm.avail_in += (uInt)numRead;
+    return true;
+}
+
+bool GzipIndexedReader::restart(const AccessPoint& point)
+{
+    if (!seekFile(point.m_inPos - (point.m_bits ? 1 : 0))) return false;
+    if (point.m_memberStart)
+    {
+        if (inflateReset2(&m_strm, 47) != Z_OK)
+        {
+            m_error = "failed to reset zlib";
+            return false;
+        }
+        m_rawMode = false;
+    } else {//the header was already read when this point was recorded, so restart inside the deflate stream
+        if (inflateReset2(&m_strm, -15) != Z_OK)
+        {
+            m_error = "failed to reset zlib";
+            return false;
+        }
+        m_rawMode = true;
+        if (point.m_bits != 0)
+        {
+            if (!fillInput()) return false;
+            if (m_strm.avail_in == 0)
+            {
+                m_error = "compressed file is shorter than its index";
+                return false;
+            }
+            int partial = m_strm.next_in[0];
+            ++m_strm.next_in;
+            --m_strm.avail_in;
+            inflatePrime(&m_strm, point.m_bits, partial >> (8 - point.m_bits));
+        }
+        if (!point.m_window.empty())
+        {
+            inflateSetDictionary(&m_strm, point.m_window.data(), (uInt)point.m_window.size());
+        }
+    }
+    m_outPos = point.m_outPos;
+    m_atEnd = false;
+    return true;
+}
+
+bool GzipIndexedReader::nextMember()
+{
+    if (m_rawMode)
+    {//raw inflate stops at the end of the deflate data, the gzip trailer (crc32 and length) is left to us
+        int64_t toSkip = 8;
+        while (toSkip > 0)
+        {
+            if (m_strm.avail_in == 0)
+            {
+                if (!fillInput()) return false;
+                if (m_strm.avail_in == 0)
+                {
+                    m_atEnd = true;
+                    return true;
+                }
+            }
+            uInt skip = (uInt)min(toSkip, (int64_t)m_strm.avail_in);
+            m_strm.next_in += skip;
+            m_strm.avail_in -= skip;
+            toSkip -= skip;
+        }
+    }
+    if (m_strm.avail_in < 2)
+    {
+        if (!fillInput()) return false;
+    }
+    if (m_strm.avail_in < 2 || m_strm.next_in[0] != 0x1f || m_strm.next_in[1] != 0x8b)
+    {//like gzread, ignore anything after a member that isn't another gzip member
+        m_atEnd = true;
+        return true;
+    }
+    if (inflateReset2(&m_strm, 47) != Z_OK)
+    {
+        m_error = "failed to reset zlib";
+        return false;
+    }
+    m_rawMode = false;
+    if (m_outPos >= m_points.back().m_outPos + m_span)
+    {
+        addPoint(true);
+    }
+    return true;
+}
+
+void GzipIndexedReader::addPoint(const bool& memberStart)
+{
+    AccessPoint newPoint;
+    newPoint.m_outPos = m_outPos;
+    newPoint.m_inPos = currentInPos();
+    newPoint.m_memberStart = memberStart;
+    if (!memberStart)
+    {
+        newPoint.m_bits = m_strm.data_type & 7;
+        newPoint.m_window.resize(WINDOW_SIZE);
+        uInt windowLength = (uInt)WINDOW_SIZE;
+        if (inflateGetDictionary(&m_strm, newPoint.m_window.data(), &windowLength) != Z_OK) return;//an access point is only an optimization
+        newPoint.m_window.resize(windowLength);
+    }
+    m_points.push_back(newPoint);
+    m_indexModified = true;
+}
+
+int64_t GzipIndexedReader::read(void* dataOut, const int64_t& count)
+{
+    if (m_file == NULL)
+    {
+        m_error = "read called on unopened file";
+        return -1;
+    }
+    int64_t total = 0;
+    while (total < count && !m_atEnd)
+    {
+        if (m_strm.avail_in == 0)
+        {
+            if (!fillInput()) return -1;
+            if (m_strm.avail_in == 0)
+            {
+                m_error = "unexpected end of compressed data";
+                m_atEnd = true;//truncated file, return what we have
+                break;
+            }
+        }
+        uInt chunk = (uInt)min(count - total, MAX_INFLATE_CHUNK);
+        m_strm.next_out = ((Bytef*)dataOut) + total;
+        m_strm.avail_out = chunk;
+        int ret = inflate(&m_strm, Z_BLOCK);//stop at deflate block boundaries, so we can record access points
+        int64_t produced = chunk - m_strm.avail_out;
+        total += produced;
+        m_outPos += produced;
+        switch (ret)
+        {
+            case Z_NEED_DICT:
+            case Z_DATA_ERROR:
+                m_error = "compressed data is corrupt";
+                return -1;
+            case Z_MEM_ERROR:
+                m_error = "out of memory while decompressing";
+                return -1;
+            case Z_STREAM_ERROR:
+                m_error = "internal zlib error";
+                return -1;
+            case Z_STREAM_END:
+                if (!nextMember()) return -1;
+                continue;
+            default://Z_OK or Z_BUF_ERROR (needs more input), both handled by the loop
+                break;
+        }
+        if ((m_strm.data_type & 128) && !(m_strm.data_type & 64) && m_outPos >= m_points.back().m_outPos + m_span)
+        {//at a block boundary that isn't the end of the member, and far enough from the last point
+            addPoint(false);
+        }
+    }
+    return total;
+}
+
+bool GzipIndexedReader::skipForward(const int64_t& position)
+{
+    if (m_discard.empty()) m_discard.resize(DISCARD_BUFFER_SIZE);
+    while (m_outPos < position)
+    {
+        int64_t toRead = min(position - m_outPos, (int64_t)m_discard.size());
+        int64_t ret = read(m_discard.data(), toRead);
+        if (ret < 0) return false;
+        if (ret < toRead)
+        {
+            m_error = "seek beyond end of compressed file";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GzipIndexedReader::seek(const int64_t& position)
+{
+    if (m_file == NULL)
+    {
+        m_error = "seek called on unopened file";
+        return false;
+    }
+    if (position < 0)
+    {
+        m_error = "seek to negative position";
+        return false;
+    }
+    if (position == m_outPos) return true;
+    AccessPoint searchPoint;
+    searchPoint.m_outPos = position;
+    vector<AccessPoint>::const_iterator iter = upper_bound(m_points.begin(), m_points.end(), searchPoint,
+                                                           [](const AccessPoint& a, const AccessPoint& b) { return a.m_outPos < b.m_outPos; });
+    --iter;//the first point is always at 0, so there is always one at or before a nonnegative position
+    if (position < m_outPos || iter->m_outPos > m_outPos)
+    {//going backwards, or there is a point closer than where we are
+        if (!restart(*iter)) return false;
+    }
+    return skipForward(position);
+}
+
+bool GzipIndexedReader::saveIndex(const char* filename, const int64_t& key1, const int64_t& key2)
+{
+    FILE* indexFile = fopen(filename, "wb");
+    if (indexFile == NULL)
+    {
+        m_error = "unable to open index file for writing";
+        return false;
+    }
+    bool good = fwrite(INDEX_MAGIC, sizeof(INDEX_MAGIC), 1, indexFile) == 1;
+    good = good && fwrite(&INDEX_VERSION, sizeof(INDEX_VERSION), 1, indexFile) == 1;
+    good = good && writeInt64(indexFile, key1) && writeInt64(indexFile, key2) && writeInt64(indexFile, m_span);
+    good = good && writeInt64(indexFile, (int64_t)m_points.size());
+    for (size_t i = 0; good && i < m_points.size(); ++i)
+    {
+        const AccessPoint& point = m_points[i];
+        good = writeInt64(indexFile, point.m_outPos) && writeInt64(indexFile, point.m_inPos) &&
+               writeInt64(indexFile, point.m_bits) && writeInt64(indexFile, point.m_memberStart ? 1 : 0) &&
+               writeInt64(indexFile, (int64_t)point.m_window.size());
+        if (good && !point.m_window.empty())
+        {
+            good = fwrite(point.m_window.data(), point.m_window.size(), 1, indexFile) == 1;
+        }
+    }
+    if (fclose(indexFile) != 0) good = false;
+    if (!good)
+    {
+        m_error = "error writing index file";
+        remove(filename);//don't leave a truncated index around
+        return false;
+    }
+    m_indexModified = false;
+    return true;
+}
+
+bool GzipIndexedReader::loadIndex(const char* filename, const int64_t& key1, const int64_t& key2)
+{
+    FILE* indexFile = fopen(filename, "rb");
+    if (indexFile == NULL) return false;//not an error, there just isn't one yet
+    char magic[sizeof(INDEX_MAGIC)];
+    uint32_t version = 0;
+    int64_t fileKey1 = 0, fileKey2 = 0, span = 0, numPoints = 0;
+    bool good = fread(magic, sizeof(magic), 1, indexFile) == 1 && memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0;
+    good = good && fread(&version, sizeof(version), 1, indexFile) == 1 && version == INDEX_VERSION;
+    good = good && readInt64(indexFile, fileKey1) && readInt64(indexFile, fileKey2) && readInt64(indexFile, span) && readInt64(indexFile, numPoints);
+    good = good && fileKey1 == key1 && fileKey2 == key2 && span >= WINDOW_SIZE && numPoints > 0;
+    vector<AccessPoint> newPoints;
+    for (int64_t i = 0; good && i < numPoints; ++i)
+    {
+        AccessPoint point;
+        int64_t bits = 0, memberStart = 0, windowSize = 0;
+        good = readInt64(indexFile, point.m_outPos) && readInt64(indexFile, point.m_inPos) &&
+               readInt64(indexFile, bits) && readInt64(indexFile, memberStart) && readInt64(indexFile, windowSize);
+        good = good && bits >= 0 && bits < 8 && windowSize >= 0 && windowSize <= WINDOW_SIZE && point.m_inPos >= 0;
+        good = good && (newPoints.empty() ? point.m_outPos == 0 : point.m_outPos > newPoints.back().m_outPos);
+        if (!good) break;
+        point.m_bits = (int)bits;
+        point.m_memberStart = (memberStart != 0);
+        point.m_window.resize(windowSize);
+        if (windowSize > 0)
+        {
+            good = fread(point.m_window.data(), windowSize, 1, indexFile) == 1;
+        }
+        newPoints.push_back(point);
+    }
+    fclose(indexFile);
+    if (!good) return false;
+    if (newPoints.size() < m_points.size()) return false;//we already know more than the saved index
+    m_points = newPoints;
+    m_span = span;
+    m_indexModified = false;
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef __GZIP_INDEXED_READER_H__
+#define __GZIP_INDEXED_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "zlib.h"
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace caret {
+
+    ///read-only gzip access with fast random seeks, by recording decompressor checkpoints (access points) while reading
+    ///same idea as zlib's examples/zran.c: an access point stores the compressed offset, bit offset and 32KiB window at a deflate block
+    ///boundary, so a seek only has to decompress from the nearest point before it instead of from the start of the file
+    ///does not depend on Qt, reports errors through return values and getErrorMessage(), so CaretBinaryFile can wrap them in its own exceptions
+    class GzipIndexedReader
+    {
+    public:
+        GzipIndexedReader(const int64_t& span = DEFAULT_SPAN);
+        ~GzipIndexedReader();
+        ///returns false if the file can't be opened, or doesn't start with a gzip header (caller should use another method)
+        bool open(const char* filename);
+        void close();
+        bool isOpen() const { return m_file != NULL; }
+        ///returns number of bytes read, which is less than count at end of file, or -1 on error
+        int64_t read(void* dataOut, const int64_t& count);
+        ///position in the uncompressed stream, returns false if it fails or is beyond the end of the data
+        bool seek(const int64_t& position);
+        int64_t pos() const { return m_outPos; }
+        const std::string& getErrorMessage() const { return m_error; }
+        int64_t getNumberOfAccessPoints() const { return (int64_t)m_points.size(); }
+        ///whether any access points were added since open or loadIndex, for deciding whether to rewrite a saved index
+        bool indexModified() const { return m_indexModified; }
+        ///the keys should identify the compressed file's contents (size, modification time), loadIndex returns false without changes if they don't match
+        bool saveIndex(const char* filename, const int64_t& key1, const int64_t& key2);
+        bool loadIndex(const char* filename, const int64_t& key1, const int64_t& key2);
+        static const int64_t DEFAULT_SPAN;//uncompressed distance between access points
+    private:
+        struct AccessPoint
+        {
+            int64_t m_outPos;//uncompressed position
+            int64_t m_inPos;//compressed position of the first byte that is not fully consumed
+            int m_bits;//number of bits of the previous byte that are still unused, 0-7
+            bool m_memberStart;//at the start of a gzip member, header not yet read, no window needed
+            std::vector<unsigned char> m_window;
+            AccessPoint() { m_outPos = 0; m_inPos = 0; m_bits = 0; m_memberStart = false; }
+        };
+        GzipIndexedReader(const GzipIndexedReader&);
+        GzipIndexedReader& operator=(const GzipIndexedReader&);
+        FILE* m_file;
+        z_stream m_strm;
+        bool m_strmInit, m_rawMode, m_atEnd, m_indexModified;
+        int64_t m_outPos, m_fileInPos;//m_fileInPos is the file position of the end of the data in m_inBuf
+        int64_t m_span;
+        std::vector<unsigned char> m_inBuf, m_discard;
+        std::vector<AccessPoint> m_points;
+        std::string m_error;
+        bool seekFile(const int64_t& position);
+        bool fillInput();//returns false on read error, sets m_error
+        bool restart(const AccessPoint& point);
+        bool nextMember();//after a member ends, skip raw-mode trailer and start the next member if present
+        void addPoint(const bool& memberStart);
+        bool skipForward(const int64_t& position);
+        int64_t currentInPos() const { return m_fileInPos - m_strm.avail_in; }
+    };
+
+}
+
+#endif //__GZIP_INDEXED_READER_H__
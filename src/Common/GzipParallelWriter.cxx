@@ -0,0 +1,264 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//same large file support defines as CaretBinaryFile.cxx
+#ifndef CARET_OS_MACOSX
+#define _LARGEFILE64_SOURCE
+#define _LFS64_LARGEFILE 1
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "GzipParallelWriter.h"
+
+#include "CaretOMP.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t WINDOW_SIZE = 32768;//deflate's maximum back-reference distance
+    const int64_t MAX_DEFLATE_CHUNK = 1<<30;//avail_in/avail_out are uInt
+}
+
+const int64_t GzipParallelWriter::DEFAULT_BLOCK_SIZE = 1<<20;//1MiB, the dictionary priming keeps the compression ratio close to single-threaded
+
+GzipParallelWriter::GzipParallelWriter(const int& level, const int64_t& blockSize)
+{
+    m_file = NULL;
+    m_level = level;
+    m_blockSize = max(blockSize, WINDOW_SIZE);
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    m_batchBlocks = 2 * numThreads;//some slack, so a thread with a slow block doesn't leave the others idle for long
+    m_totalIn = 0;
+    m_crc = crc32(0L, Z_NULL, 0);
+}
+
+GzipParallelWriter::~GzipParallelWriter()
+{
+    if (m_file != NULL)
+    {
+        fclose(m_file);//close() wasn't called or failed, there is nothing useful left to do with the stream
+    }
+}
+
+bool GzipParallelWriter::open(const char* filename)
+{
+    m_error = "";
+    m_file = fopen(filename, "wb");
+    if (m_file == NULL)
+    {
+        m_error = "unable to create file";
+        return false;
+    }
+    m_totalIn = 0;
+    m_crc = crc32(0L, Z_NULL, 0);
+    m_pending.clear();
+    m_pending.reserve(m_blockSize * m_batchBlocks);
+    m_dictTail.clear();
+    const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255 };//deflate, no flags, no mtime, no extra flags, unknown OS
+    return writeBytes(header, sizeof(header));
+}
+
+bool GzipParallelWriter::writeBytes(const void* data, const int64_t& count)
+{
+    if (count == 0) return true;
+    if (fwrite(data, 1, count, m_file) != (size_t)count)
+    {
+        m_error = "failed to write to file";
+        return false;
+    }
+    return true;
+}
+
+bool GzipParallelWriter::write(const void* dataIn, const int64_t& count)
+{
+    if (m_file == NULL)
+    {
+        m_error = "write called on unopened file";
+        return false;
+    }
+    const unsigned char* inPtr = (const unsigned char*)dataIn;
+    int64_t remaining = count;
+    const int64_t batchBytes = m_blockSize * m_batchBlocks;
+    while (remaining > 0)
+    {
+        int64_t toCopy = min(remaining, batchBytes - (int64_t)m_pending.size());
+        m_pending.insert(m_pending.end(), inPtr, inPtr + toCopy);
+        inPtr += toCopy;
+        remaining -= toCopy;
+        m_totalIn += toCopy;
+        if ((int64_t)m_pending.size() == batchBytes)
+        {
+            if (!compressPending(false)) return false;
+        }
+    }
+    return true;
+}
+
+bool GzipParallelWriter::seek(const int64_t& position)
+{
+    if (position == m_totalIn) return true;
+    if (position < m_totalIn)
+    {
+        m_error = "can't seek backwards while writing compressed file";
+        return false;
+    }
+    vector<unsigned char> zeros(min(position - m_totalIn, m_blockSize), 0);
+    while (m_totalIn < position)
+    {
+        if (!write(zeros.data(), min(position - m_totalIn, (int64_t)zeros.size()))) return false;
+    }
+    return true;
+}
+
+void GzipParallelWriter::compressBlock(Block& block, const int& level, const bool& last)
+{
+    block.m_ok = false;
+    block.m_crc = crc32(0L, Z_NULL, 0);
+    const unsigned char* crcPtr = block.m_in;
+    for (int64_t crcLeft = block.m_inSize; crcLeft > 0; )
+    {
+        uInt chunk = (uInt)min(crcLeft, MAX_DEFLATE_CHUNK);
+        block.m_crc = crc32(block.m_crc, crcPtr, chunk);
+        crcPtr += chunk;
+        crcLeft -= chunk;
+    }
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return;//raw deflate, we write the gzip wrapper ourselves
+    if (block.m_dict != NULL && block.m_dictSize > 0)
+    {
+        if (deflateSetDictionary(&strm, block.m_dict, (uInt)block.m_dictSize) != Z_OK)
+        {
+            deflateEnd(&strm);
+            return;
+        }
+    }
+    block.m_out.resize(deflateBound(&strm, (uLong)block.m_inSize) + 16);//a sync flush can add a few bytes beyond the bound
+    strm.next_in = (Bytef*)block.m_in;
+    strm.avail_in = (uInt)block.m_inSize;
+    int64_t outUsed = 0;
+    int ret;
+    do
+    {
+        if (outUsed == (int64_t)block.m_out.size()) block.m_out.resize(block.m_out.size() * 2);
+        strm.next_out = block.m_out.data() + outUsed;
+        strm.avail_out = (uInt)min((int64_t)block.m_out.size() - outUsed, MAX_DEFLATE_CHUNK);
+        uInt availBefore = strm.avail_out;
+        ret = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);//sync flush ends on a byte boundary without setting the final-block bit, so the next block can follow directly
+        outUsed += availBefore - strm.avail_out;
+        if (ret == Z_STREAM_ERROR)
+        {
+            deflateEnd(&strm);
+            return;
+        }
+    } while (last ? ret != Z_STREAM_END : (strm.avail_out == 0 || strm.avail_in != 0));
+    deflateEnd(&strm);
+    block.m_out.resize(outUsed);
+    block.m_ok = true;
+}
+
+bool GzipParallelWriter::compressPending(const bool& finish)
+{
+    int64_t pendingSize = (int64_t)m_pending.size();
+    int64_t numBlocks = pendingSize / m_blockSize;
+    if (finish && (numBlocks * m_blockSize != pendingSize || numBlocks == 0)) ++numBlocks;//partial last block, or an empty one to end the stream
+    m_blocks.resize(numBlocks);
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        Block& block = m_blocks[i];
+        block.m_in = m_pending.data() + i * m_blockSize;
+        block.m_inSize = min(m_blockSize, pendingSize - i * m_blockSize);
+        if (i == 0)
+        {
+            block.m_dict = m_dictTail.empty() ? NULL : m_dictTail.data();
+            block.m_dictSize = (int64_t)m_dictTail.size();
+        } else {//blocks are at least WINDOW_SIZE, so the dictionary is entirely within the previous block
+            block.m_dict = block.m_in - WINDOW_SIZE;
+            block.m_dictSize = WINDOW_SIZE;
+        }
+    }
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        compressBlock(m_blocks[i], m_level, finish && i == numBlocks - 1);
+    }
+    int64_t consumed = 0;
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        Block& block = m_blocks[i];
+        if (!block.m_ok)
+        {
+            m_error = "zlib failed to compress data";
+            return false;
+        }
+        if (!writeBytes(block.m_out.data(), (int64_t)block.m_out.size())) return false;
+        m_crc = crc32_combine(m_crc, block.m_crc, (z_off_t)block.m_inSize);
+        consumed += block.m_inSize;
+        vector<unsigned char>().swap(block.m_out);
+    }
+    if (consumed > 0)
+    {
+        int64_t tailSize = min(WINDOW_SIZE, consumed);
+        if (tailSize < WINDOW_SIZE && !m_dictTail.empty())
+        {//very small last batch, keep the end of the old dictionary too
+            m_dictTail.insert(m_dictTail.end(), m_pending.begin(), m_pending.begin() + consumed);
+            if ((int64_t)m_dictTail.size() > WINDOW_SIZE) m_dictTail.erase(m_dictTail.begin(), m_dictTail.end() - WINDOW_SIZE);
+        } else {
+            m_dictTail.assign(m_pending.begin() + consumed - tailSize, m_pending.begin() + consumed);
+        }
+        m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+    }
+    return true;
+}
+
+bool GzipParallelWriter::close()
+{
+    if (m_file == NULL) return true;
+    bool good = compressPending(true);
+    if (good)
+    {
+        unsigned char trailer[8];
+        uLong size32 = (uLong)(m_totalIn & 0xffffffff);//gzip stores the length modulo 2^32
+        for (int i = 0; i < 4; ++i)
+        {
+            trailer[i] = (unsigned char)((m_crc >> (8 * i)) & 0xff);
+            trailer[i + 4] = (unsigned char)((size32 >> (8 * i)) & 0xff);
+        }
+        good = writeBytes(trailer, sizeof(trailer));
+    }
+    if (fclose(m_file) != 0 && good)
+    {
+        m_error = "failed to close file";
+        good = false;
+    }
+    m_file = NULL;
+    vector<unsigned char>().swap(m_pending);
+    m_dictTail.clear();
+    m_blocks.clear();
+    return good;
+}
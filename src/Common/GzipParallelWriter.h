@@ -0,0 +1,80 @@
+#ifndef __GZIP_PARALLEL_WRITER_H__
+#define __GZIP_PARALLEL_WRITER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "zlib.h"
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace caret {
+
+    ///writes a single-member gzip file, compressing independent blocks on multiple threads (same approach as pigz)
+    ///each block is raw deflate primed with the previous 32KiB of input as a dictionary and ended with a sync flush,
+    ///so the concatenation is one ordinary deflate stream that any gzip reader can decompress
+    ///does not depend on Qt, reports errors through return values and getErrorMessage(), so CaretBinaryFile can wrap them in its own exceptions
+    class GzipParallelWriter
+    {
+    public:
+        GzipParallelWriter(const int& level = Z_DEFAULT_COMPRESSION, const int64_t& blockSize = DEFAULT_BLOCK_SIZE);
+        ~GzipParallelWriter();
+        bool open(const char* filename);
+        bool write(const void* dataIn, const int64_t& count);
+        ///only forward seeks are possible, which write zeros (same as gzseek when writing)
+        bool seek(const int64_t& position);
+        int64_t pos() const { return m_totalIn; }
+        ///finishes the gzip stream, returns false if anything failed to be written
+        bool close();
+        bool isOpen() const { return m_file != NULL; }
+        const std::string& getErrorMessage() const { return m_error; }
+        static const int64_t DEFAULT_BLOCK_SIZE;
+    private:
+        struct Block
+        {
+            const unsigned char* m_in;
+            int64_t m_inSize;
+            const unsigned char* m_dict;//NULL for the first block of the file
+            int64_t m_dictSize;
+            std::vector<unsigned char> m_out;
+            uLong m_crc;
+            bool m_ok;
+        };
+        GzipParallelWriter(const GzipParallelWriter&);
+        GzipParallelWriter& operator=(const GzipParallelWriter&);
+        FILE* m_file;
+        int m_level;
+        int64_t m_blockSize, m_batchBlocks, m_totalIn;
+        uLong m_crc;
+        std::vector<unsigned char> m_pending;//uncompressed data not yet compressed, up to m_batchBlocks blocks
+        std::vector<unsigned char> m_dictTail;//last 32KiB of input before m_pending
+        std::vector<Block> m_blocks;
+        std::string m_error;
+        bool compressPending(const bool& finish);//if not finishing, only full blocks are compressed
+        bool writeBytes(const void* data, const int64_t& count);
+        static void compressBlock(Block& block, const int& level, const bool& last);
+    };
+
+}
+
+#endif //__GZIP_PARALLEL_WRITER_H__
@@ -21,7 +21,9 @@
 
 #include "Histogram.h"
 #include "CaretAssert.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 using namespace caret;
 using namespace std;
@@ -86,61 +88,103 @@ void Histogram::update(const int& numBuckets, const float* data, const int64_t&
 
 void Histogram::update(const float* data, const int64_t& dataCount)
 {
-    int numBuckets = (int)m_buckets.size();
+    const StatisticsKernel::Summary summary = StatisticsKernel::summarize(data, dataCount);
+    update((int)m_buckets.size(), data, dataCount, summary, StatisticsKernel::ALL_FINITE);
+}
+
+void Histogram::getFilterRange(const StatisticsKernel::Summary& summary, const StatisticsKernel::ValueFilter& filter,
+                               int64_t& countOut, float& rangeMinOut, float& rangeMaxOut)
+{
+    countOut = 0;
+    rangeMinOut = 0.0f;
+    rangeMaxOut = 0.0f;
+    switch (filter)
+    {
+        case StatisticsKernel::ALL_FINITE:
+            countOut = summary.m_posCount + summary.m_zeroCount + summary.m_negCount;
+            rangeMinOut = summary.m_min;
+            rangeMaxOut = summary.m_max;
+            break;
+        case StatisticsKernel::POSITIVE:
+            countOut = summary.m_posCount;
+            rangeMinOut = summary.m_leastPos;
+            rangeMaxOut = summary.m_mostPos;
+            break;
+        case StatisticsKernel::NEGATIVE:
+            countOut = summary.m_negCount;
+            rangeMinOut = summary.m_mostNeg;
+            rangeMaxOut = summary.m_leastNeg;
+            break;
+        case StatisticsKernel::ABSOLUTE://absolute values are all positive
+            countOut = summary.m_posCount + summary.m_negCount;
+            rangeMinOut = min(summary.m_leastPos, -summary.m_leastNeg);
+            rangeMaxOut = max(summary.m_mostPos, -summary.m_mostNeg);
+            break;
+    }
+    if (countOut == 0)
+    {
+        rangeMinOut = 0.0f;
+        rangeMaxOut = 0.0f;
+    }
+}
+
+bool Histogram::getBucketRange(const int& numBuckets, const StatisticsKernel::Summary& summary, const StatisticsKernel::ValueFilter& filter,
+                               float& bucketMinOut, float& bucketSizeOut)
+{
+    CaretAssert(numBuckets > 0);
+    int64_t count;
+    float rangeMax;
+    getFilterRange(summary, filter, count, bucketMinOut, rangeMax);
+    bucketSizeOut = (rangeMax - bucketMinOut) / numBuckets;
+    return (count > 0 && bucketMinOut != rangeMax);//otherwise, update() doesn't use bucket counts
+}
+
+void Histogram::update(const int& numBuckets, const float* data, const int64_t& dataCount,
+                       const StatisticsKernel::Summary& summary, const StatisticsKernel::ValueFilter& filter)
+{
+    float bucketMin, bucketSize;
+    vector<int64_t> bucketCounts(numBuckets, 0);
+    if (getBucketRange(numBuckets, summary, filter, bucketMin, bucketSize))
+    {
+        StatisticsKernel::addToBuckets(data, dataCount, filter, bucketMin, bucketSize, bucketCounts.data(), numBuckets);
+    }
+    update(numBuckets, summary, filter, bucketCounts.data());
+}
+
+void Histogram::update(const int& numBuckets, const StatisticsKernel::Summary& summary, const StatisticsKernel::ValueFilter& filter,
+                       const int64_t* bucketCounts)
+{
+    resize(numBuckets);
     reset();
-    bool first = true;
-    for (int64_t i = 0; i < dataCount; ++i)
-    {//count value classes
-        if (data[i] != data[i])
-        {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
-        {
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
-            {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_negInfCount;
-                    continue;//skip neg infs
-                } else {
-                    ++m_negCount;
-                }
-            } else {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_infCount;
-                    continue;//skip infs
-                } else {
-                    ++m_posCount;
-                }
-            }
-        }
-        if (first)
-        {
-            first = false;
-            m_bucketMin = data[i];
-            m_bucketMax = data[i];
-        } else {
-            if (data[i] > m_bucketMax)
-            {
-                m_bucketMax = data[i];
-            } else if (data[i] < m_bucketMin) {//skip testing for new minimum if we found a new maximum
-                m_bucketMin = data[i];
-            }
-        }
+    switch (filter)
+    {
+        case StatisticsKernel::ALL_FINITE:
+            m_posCount = summary.m_posCount;
+            m_zeroCount = summary.m_zeroCount;
+            m_negCount = summary.m_negCount;
+            m_infCount = summary.m_infCount;
+            m_negInfCount = summary.m_negInfCount;
+            m_nanCount = summary.m_nanCount;
+            break;
+        case StatisticsKernel::POSITIVE:
+            m_posCount = summary.m_posCount;
+            break;
+        case StatisticsKernel::NEGATIVE:
+            m_negCount = summary.m_negCount;
+            break;
+        case StatisticsKernel::ABSOLUTE://absolute values are all positive
+            m_posCount = summary.m_posCount + summary.m_negCount;
+            break;
     }
-    if (first)
+    const int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
+    if (totalValid == 0)
     {
-        m_bucketMin = m_bucketMax = 0.0f;
-        return;//our arrays are already zeroed, so just return if no valid data
+        return;//our arrays are already zeroed, and the range is 0 to 0
     }
+    int64_t rangeCount;
+    getFilterRange(summary, filter, rangeCount, m_bucketMin, m_bucketMax);
     if (m_bucketMin == m_bucketMax)
     {
-        int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
         for (int i = 0; i < numBuckets - 1; ++i)
         {
             m_cumulative[i] = (i + 1) * totalValid / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
@@ -160,17 +204,10 @@ void Histogram::update(const float* data, const int64_t& dataCount)
         }
         return;
     }
-    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
-    for (int64_t i = 0; i < dataCount; ++i)
-    {//determine histogram
-        if (data[i] != data[i]) continue;//exclude NaN
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        int bucket = (int)((data[i] - m_bucketMin) / bucketsize);//doesn't really matter whether small negative floats truncate to a 0 integer
-        if (bucket < 0) bucket = 0;//because of this
-        if (bucket >= numBuckets) bucket = numBuckets - 1;
-        CaretAssertVectorIndex(m_buckets, bucket);
-        ++m_buckets[bucket];
+    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;//same as getBucketRange
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        m_buckets[i] = bucketCounts[i];
     }
     computeCumulative();
     m_displayHeightMax = 0.0;
@@ -326,6 +363,64 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
     }
 }
 
+namespace
+{
+    struct HistogramBinaryHeader
+    {//followed by buckets (int64) and display values (float), cumulative counts are recomputed
+        int32_t m_numBuckets;
+        float m_bucketMin, m_bucketMax, m_displayHeightMax;
+        int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
+    };
+}
+
+void Histogram::appendBinary(vector<char>& bufferOut) const
+{
+    HistogramBinaryHeader header;
+    memset(&header, 0, sizeof(HistogramBinaryHeader));//no uninitialized padding in the output
+    header.m_numBuckets = (int32_t)m_buckets.size();
+    header.m_bucketMin = m_bucketMin;
+    header.m_bucketMax = m_bucketMax;
+    header.m_displayHeightMax = m_displayHeightMax;
+    header.m_posCount = m_posCount;
+    header.m_zeroCount = m_zeroCount;
+    header.m_negCount = m_negCount;
+    header.m_infCount = m_infCount;
+    header.m_negInfCount = m_negInfCount;
+    header.m_nanCount = m_nanCount;
+    const char* headerBytes = (const char*)&header;
+    bufferOut.insert(bufferOut.end(), headerBytes, headerBytes + sizeof(HistogramBinaryHeader));
+    const char* bucketBytes = (const char*)m_buckets.data();
+    bufferOut.insert(bufferOut.end(), bucketBytes, bucketBytes + m_buckets.size() * sizeof(int64_t));
+    const char* displayBytes = (const char*)m_display.data();
+    bufferOut.insert(bufferOut.end(), displayBytes, displayBytes + m_display.size() * sizeof(float));
+}
+
+bool Histogram::readBinary(const char*& position, const char* end)
+{
+    HistogramBinaryHeader header;
+    if (end - position < (int64_t)sizeof(HistogramBinaryHeader)) return false;
+    memcpy(&header, position, sizeof(HistogramBinaryHeader));
+    if (header.m_numBuckets <= 0) return false;
+    const int64_t dataBytes = header.m_numBuckets * (int64_t)(sizeof(int64_t) + sizeof(float));
+    if (end - position - (int64_t)sizeof(HistogramBinaryHeader) < dataBytes) return false;
+    const char* data = position + sizeof(HistogramBinaryHeader);
+    resize(header.m_numBuckets);
+    memcpy(m_buckets.data(), data, header.m_numBuckets * sizeof(int64_t));
+    memcpy(m_display.data(), data + header.m_numBuckets * sizeof(int64_t), header.m_numBuckets * sizeof(float));
+    computeCumulative();
+    m_bucketMin = header.m_bucketMin;
+    m_bucketMax = header.m_bucketMax;
+    m_displayHeightMax = header.m_displayHeightMax;
+    m_posCount = header.m_posCount;
+    m_zeroCount = header.m_zeroCount;
+    m_negCount = header.m_negCount;
+    m_infCount = header.m_infCount;
+    m_negInfCount = header.m_negInfCount;
+    m_nanCount = header.m_nanCount;
+    position = data + dataBytes;
+    return true;
+}
+
 void Histogram::computeCumulative()
 {
     int numBuckets = (int)m_buckets.size();
@@ -24,6 +24,8 @@
 #include <vector>
 #include "stdint.h"
 
+#include "StatisticsKernel.h"
+
 namespace caret
 {
     
@@ -43,6 +45,9 @@ namespace caret
         
         void computeCumulative();
         
+        static void getFilterRange(const StatisticsKernel::Summary& summary, const StatisticsKernel::ValueFilter& filter,
+                                   int64_t& countOut, float& rangeMinOut, float& rangeMaxOut);
+        
         void update(const float* data,
                     const int64_t& dataCount,
                     float mostPositiveValueInclusive,
@@ -71,6 +76,26 @@ namespace caret
                     float mostNegativeValueInclusive,
                     const bool& includeZeroValues);
         
+        ///histogram of the values selected by filter, using the counts and ranges that StatisticsKernel::summarize already found in the same data
+        void update(const int& numBuckets,
+                    const float* data,
+                    const int64_t& dataCount,
+                    const StatisticsKernel::Summary& summary,
+                    const StatisticsKernel::ValueFilter& filter);
+        
+        ///histogram of data that is read in parts, summary is merged from every part, bucketCounts is summed from StatisticsKernel::addToBuckets on every part with the range from getBucketRange
+        void update(const int& numBuckets,
+                    const StatisticsKernel::Summary& summary,
+                    const StatisticsKernel::ValueFilter& filter,
+                    const int64_t* bucketCounts);
+        
+        ///the bucket range update() uses for the values summary describes, returns false when there are no values to put in buckets, or they are all the same
+        static bool getBucketRange(const int& numBuckets,
+                                   const StatisticsKernel::Summary& summary,
+                                   const StatisticsKernel::ValueFilter& filter,
+                                   float& bucketMinOut,
+                                   float& bucketSizeOut);
+        
         ///get raw counts (useful mathematically)
         const std::vector<int64_t>& getHistogramCounts() const { return m_buckets; }
         
@@ -112,6 +137,12 @@ namespace caret
             histMin = m_bucketMin;
             histMax = m_bucketMax;
         }
+        
+        ///append the complete state to a buffer in native byte order, for saving computed histograms
+        void appendBinary(std::vector<char>& bufferOut) const;
+        
+        ///restore a state written by appendBinary and advance position past it, returns false and leaves this unchanged if it is truncated or inconsistent
+        bool readBinary(const char*& position, const char* end);
     };
 
 }
@@ -0,0 +1,166 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PartitionedStatistics.h"
+
+#include "CaretOMP.h"
+#include "FastStatistics.h"
+#include "Histogram.h"
+#include "StatisticsKernel.h"
+
+#include <cstddef>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+PartitionedStatistics::PartReader::~PartReader()
+{
+}
+
+PartitionedStatistics::PartSummary::PartSummary()
+{
+    m_min = numeric_limits<float>::infinity();
+    m_max = -numeric_limits<float>::infinity();
+    m_mean = 0.0f;
+}
+
+bool PartitionedStatistics::compute(const PartReader& reader, const int& numHistogramBuckets, FastStatistics* statisticsOut,
+                                    Histogram* histogramOut, vector<PartSummary>* partSummariesOut)
+{
+    const int64_t numParts = reader.getNumberOfParts();
+    const bool parallelRead = reader.supportsConcurrentRead();
+    vector<StatisticsKernel::Summary> summaries(numParts);
+    int64_t totalCount = 0;
+#pragma omp CARET_PAR if (parallelRead)
+    {
+        vector<float> storage;
+#pragma omp CARET_FOR schedule(dynamic) reduction(+:totalCount)
+        for (int64_t part = 0; part < numParts; ++part)
+        {
+            int64_t count = 0;
+            const float* data = reader.readPart(part, storage, count);
+            summaries[part] = StatisticsKernel::summarize(data, count);
+            totalCount += count;
+        }
+    }
+    StatisticsKernel::Summary total;
+    for (int64_t part = 0; part < numParts; ++part)
+    {//in order, so the sum is the same every time
+        total.merge(summaries[part]);
+    }
+    if (partSummariesOut != NULL)
+    {
+        partSummariesOut->resize(numParts);
+        for (int64_t part = 0; part < numParts; ++part)
+        {
+            const StatisticsKernel::Summary& summary = summaries[part];
+            PartSummary& partSummary = (*partSummariesOut)[part];
+            partSummary.m_min = (summary.m_negInfCount > 0 ? -numeric_limits<float>::infinity() : summary.m_min);
+            partSummary.m_max = (summary.m_infCount > 0 ? numeric_limits<float>::infinity() : summary.m_max);
+            if (summary.m_posCount + summary.m_zeroCount + summary.m_negCount > 0)
+            {
+                partSummary.m_mean = FastStatistics::getMean(summary);
+            } else {
+                partSummary.m_mean = 0.0f;
+            }
+        }
+    }
+    if (totalCount == 0) return false;
+    if (statisticsOut == NULL && histogramOut == NULL) return true;
+    //the file histogram, then the negative, positive and absolute percentile histograms of the statistics
+    const int NUM_HISTOGRAMS = 4;
+    const StatisticsKernel::ValueFilter filters[NUM_HISTOGRAMS] = { StatisticsKernel::ALL_FINITE, StatisticsKernel::NEGATIVE,
+                                                                    StatisticsKernel::POSITIVE, StatisticsKernel::ABSOLUTE };
+    const int percentileBuckets = FastStatistics::getPercentileBucketCount(totalCount);
+    const int numBuckets[NUM_HISTOGRAMS] = { numHistogramBuckets, percentileBuckets, percentileBuckets, percentileBuckets };
+    const bool wanted[NUM_HISTOGRAMS] = { histogramOut != NULL, statisticsOut != NULL, statisticsOut != NULL, statisticsOut != NULL };
+    float bucketMin[NUM_HISTOGRAMS], bucketSize[NUM_HISTOGRAMS];
+    bool useBuckets[NUM_HISTOGRAMS];
+    vector<int64_t> bucketCounts[NUM_HISTOGRAMS];
+    bool anyBuckets = false;
+    for (int h = 0; h < NUM_HISTOGRAMS; ++h)
+    {
+        useBuckets[h] = wanted[h] && Histogram::getBucketRange(numBuckets[h], total, filters[h], bucketMin[h], bucketSize[h]);
+        if (wanted[h]) bucketCounts[h].assign(numBuckets[h], 0);
+        anyBuckets = anyBuckets || useBuckets[h];
+    }
+    const bool useDeviations = (statisticsOut != NULL && total.m_posCount + total.m_zeroCount + total.m_negCount > 0);
+    const float mean = FastStatistics::getMean(total);
+    vector<double> deviations(numParts, 0.0);
+    if (useDeviations || anyBuckets)
+    {
+#pragma omp CARET_PAR if (parallelRead)
+        {
+            vector<float> storage;
+            vector<int64_t> threadCounts[NUM_HISTOGRAMS];//counts add up the same in any order, so per-thread buckets are enough
+            for (int h = 0; h < NUM_HISTOGRAMS; ++h)
+            {
+                if (useBuckets[h]) threadCounts[h].assign(numBuckets[h], 0);
+            }
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t part = 0; part < numParts; ++part)
+            {
+                int64_t count = 0;
+                const float* data = reader.readPart(part, storage, count);
+                if (useDeviations)
+                {
+                    deviations[part] = StatisticsKernel::sumSquaredDeviations(data, count, mean);
+                }
+                for (int h = 0; h < NUM_HISTOGRAMS; ++h)
+                {
+                    if (useBuckets[h])
+                    {
+                        StatisticsKernel::addToBuckets(data, count, filters[h], bucketMin[h], bucketSize[h], threadCounts[h].data(), numBuckets[h]);
+                    }
+                }
+            }
+#pragma omp critical
+            {
+                for (int h = 0; h < NUM_HISTOGRAMS; ++h)
+                {
+                    if (!useBuckets[h]) continue;
+                    for (int i = 0; i < numBuckets[h]; ++i)
+                    {
+                        bucketCounts[h][i] += threadCounts[h][i];
+                    }
+                }
+            }
+        }
+    }
+    if (histogramOut != NULL)
+    {
+        histogramOut->update(numBuckets[0], total, filters[0], bucketCounts[0].data());
+    }
+    if (statisticsOut != NULL)
+    {
+        double sumSquaredDeviations = 0.0;
+        for (int64_t part = 0; part < numParts; ++part)
+        {//also in order
+            sumSquaredDeviations += deviations[part];
+        }
+        Histogram negHist, posHist, absHist;
+        negHist.update(numBuckets[1], total, filters[1], bucketCounts[1].data());
+        posHist.update(numBuckets[2], total, filters[2], bucketCounts[2].data());
+        absHist.update(numBuckets[3], total, filters[3], bucketCounts[3].data());
+        statisticsOut->update(total, sumSquaredDeviations, negHist, posHist, absHist);
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef __PARTITIONED_STATISTICS_H__
+#define __PARTITIONED_STATISTICS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+
+#include <vector>
+
+namespace caret
+{
+    class FastStatistics;
+    class Histogram;
+    
+    ///FastStatistics and Histogram of data that is read in parts (like the maps of a file), so the whole of it is never in memory at once
+    ///each part is read twice, first for the counts and ranges, then for the deviations from the mean and the histogram buckets
+    ///parts are processed in parallel, and their results are merged in order so they don't depend on the number of threads
+    class PartitionedStatistics
+    {
+    public:
+        ///reads the parts of the data
+        class PartReader
+        {
+        public:
+            virtual ~PartReader();
+            
+            virtual int64_t getNumberOfParts() const = 0;
+            
+            ///whether readPart may be called from multiple threads at once
+            virtual bool supportsConcurrentRead() const = 0;
+            
+            ///returns the data of one part, which may be put in storage or may point to memory the reader already has
+            virtual const float* readPart(const int64_t& index, std::vector<float>& storage, int64_t& countOut) const = 0;
+        };
+        
+        ///range and mean of one part, for saving along with the statistics of all of the data
+        struct PartSummary
+        {
+            ///range of the values that aren't NaN, including infinities, a part with no such values has +inf as its min and -inf as its max
+            float m_min, m_max;
+            ///mean of the finite values, 0 if there are none
+            float m_mean;
+            
+            PartSummary();
+        };
+        
+        ///any of the outputs may be NULL, returns false and leaves statisticsOut and histogramOut unchanged if the parts have no data
+        static bool compute(const PartReader& reader, const int& numHistogramBuckets, FastStatistics* statisticsOut,
+                            Histogram* histogramOut, std::vector<PartSummary>* partSummariesOut);
+    };
+}
+
+#endif //__PARTITIONED_STATISTICS_H__
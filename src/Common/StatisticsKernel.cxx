@@ -0,0 +1,277 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "StatisticsKernel.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+
+#ifdef CARET_STATISTICS_AVX2
+extern "C"
+{
+#include "cpuinfo.h"
+}
+#endif
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    bool cpuHasAVX2()
+    {
+#ifdef CARET_STATISTICS_AVX2
+        static const bool ret = (hasAVX() != 0 && hasAVX2() != 0);//hasAVX also checks that the OS saves the registers
+        return ret;
+#else
+        return false;
+#endif
+    }
+
+    bool s_avx2Enabled = true;
+}
+
+const int64_t StatisticsKernel::BLOCK_SIZE;//std::min takes a reference
+
+StatisticsKernel::Summary::Summary()
+{
+    m_posCount = 0;
+    m_zeroCount = 0;
+    m_negCount = 0;
+    m_infCount = 0;
+    m_negInfCount = 0;
+    m_nanCount = 0;
+    m_min = numeric_limits<float>::infinity();
+    m_max = -numeric_limits<float>::infinity();
+    m_leastPos = numeric_limits<float>::infinity();
+    m_mostPos = -numeric_limits<float>::infinity();
+    m_leastNeg = -numeric_limits<float>::infinity();
+    m_mostNeg = numeric_limits<float>::infinity();
+    m_sum = 0.0;
+}
+
+void StatisticsKernel::Summary::merge(const Summary& other)
+{
+    m_posCount += other.m_posCount;
+    m_zeroCount += other.m_zeroCount;
+    m_negCount += other.m_negCount;
+    m_infCount += other.m_infCount;
+    m_negInfCount += other.m_negInfCount;
+    m_nanCount += other.m_nanCount;
+    m_min = min(m_min, other.m_min);
+    m_max = max(m_max, other.m_max);
+    m_leastPos = min(m_leastPos, other.m_leastPos);
+    m_mostPos = max(m_mostPos, other.m_mostPos);
+    m_leastNeg = max(m_leastNeg, other.m_leastNeg);
+    m_mostNeg = min(m_mostNeg, other.m_mostNeg);
+    m_sum += other.m_sum;
+}
+
+bool StatisticsKernel::setAVX2Enabled(const bool& enabled)
+{
+    s_avx2Enabled = enabled;
+    return isAVX2Enabled();
+}
+
+bool StatisticsKernel::isAVX2Enabled()
+{
+    return s_avx2Enabled && cpuHasAVX2();
+}
+
+StatisticsKernel::Summary StatisticsKernel::summarize(const float* data, const int64_t& dataCount)
+{
+    const int64_t numBlocks = (dataCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (numBlocks <= 1)
+    {//don't start threads for a single map
+        Summary ret;
+        summarizeBlock(data, dataCount, ret);
+        return ret;
+    }
+    vector<Summary> blockSummaries(numBlocks);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t block = 0; block < numBlocks; ++block)
+    {
+        const int64_t start = block * BLOCK_SIZE;
+        summarizeBlock(data + start, min(BLOCK_SIZE, dataCount - start), blockSummaries[block]);
+    }
+    Summary ret;
+    for (int64_t block = 0; block < numBlocks; ++block)
+    {//in order, so the sum is the same every time
+        ret.merge(blockSummaries[block]);
+    }
+    return ret;
+}
+
+double StatisticsKernel::sumSquaredDeviations(const float* data, const int64_t& dataCount, const float& mean)
+{
+    const int64_t numBlocks = (dataCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (numBlocks <= 1)
+    {
+        return sumSquaredDeviationsBlock(data, dataCount, mean);
+    }
+    vector<double> blockSums(numBlocks);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t block = 0; block < numBlocks; ++block)
+    {
+        const int64_t start = block * BLOCK_SIZE;
+        blockSums[block] = sumSquaredDeviationsBlock(data + start, min(BLOCK_SIZE, dataCount - start), mean);
+    }
+    double ret = 0.0;
+    for (int64_t block = 0; block < numBlocks; ++block)
+    {
+        ret += blockSums[block];
+    }
+    return ret;
+}
+
+void StatisticsKernel::addToBuckets(const float* data, const int64_t& dataCount, const ValueFilter& filter,
+                                    const float& bucketMin, const float& bucketSize, int64_t* buckets, const int& numBuckets)
+{
+    CaretAssert(numBuckets > 0);
+    const int64_t numBlocks = (dataCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (numBlocks <= 1)
+    {
+        addToBucketsBlock(data, dataCount, filter, bucketMin, bucketSize, buckets, numBuckets);
+        return;
+    }
+#pragma omp CARET_PAR
+    {
+        vector<int64_t> threadBuckets(numBuckets, 0);//counts add up the same in any order, so per-thread buckets are enough
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t block = 0; block < numBlocks; ++block)
+        {
+            const int64_t start = block * BLOCK_SIZE;
+            addToBucketsBlock(data + start, min(BLOCK_SIZE, dataCount - start), filter, bucketMin, bucketSize, threadBuckets.data(), numBuckets);
+        }
+#pragma omp critical
+        {
+            for (int i = 0; i < numBuckets; ++i)
+            {
+                buckets[i] += threadBuckets[i];
+            }
+        }
+    }
+}
+
+void StatisticsKernel::summarizeBlock(const float* data, const int64_t& dataCount, Summary& summaryOut)
+{
+#ifdef CARET_STATISTICS_AVX2
+    if (isAVX2Enabled())
+    {
+        summarizeBlockAVX2(data, dataCount, summaryOut);
+        return;
+    }
+#endif
+    Summary& s = summaryOut;
+    for (int64_t i = 0; i < dataCount; ++i)
+    {
+        const float value = data[i];
+        if (value != value)
+        {
+            ++s.m_nanCount;
+            continue;
+        }
+        if (value == 0.0f)
+        {
+            ++s.m_zeroCount;
+        } else if (value < 0.0f) {
+            if (value * 2.0f == value)
+            {
+                ++s.m_negInfCount;
+                continue;
+            }
+            ++s.m_negCount;
+            if (value > s.m_leastNeg) s.m_leastNeg = value;
+            if (value < s.m_mostNeg) s.m_mostNeg = value;
+        } else {
+            if (value * 2.0f == value)
+            {
+                ++s.m_infCount;
+                continue;
+            }
+            ++s.m_posCount;
+            if (value < s.m_leastPos) s.m_leastPos = value;
+            if (value > s.m_mostPos) s.m_mostPos = value;
+        }
+        if (value < s.m_min) s.m_min = value;
+        if (value > s.m_max) s.m_max = value;
+        s.m_sum += value;
+    }
+}
+
+double StatisticsKernel::sumSquaredDeviationsBlock(const float* data, const int64_t& dataCount, const float& mean)
+{
+#ifdef CARET_STATISTICS_AVX2
+    if (isAVX2Enabled())
+    {
+        return sumSquaredDeviationsBlockAVX2(data, dataCount, mean);
+    }
+#endif
+    double ret = 0.0;
+    for (int64_t i = 0; i < dataCount; ++i)
+    {
+        if (data[i] != data[i]) continue;//skip NaNs
+        if (data[i] != 0.0f && data[i] * 2.0f == data[i]) continue;//skip infs
+        const float diff = data[i] - mean;
+        ret += (double)diff * diff;
+    }
+    return ret;
+}
+
+void StatisticsKernel::addToBucketsBlock(const float* data, const int64_t& dataCount, const ValueFilter& filter,
+                                         const float& bucketMin, const float& bucketSize, int64_t* buckets, const int& numBuckets)
+{
+#ifdef CARET_STATISTICS_AVX2
+    if (isAVX2Enabled())
+    {
+        addToBucketsBlockAVX2(data, dataCount, filter, bucketMin, bucketSize, buckets, numBuckets);
+        return;
+    }
+#endif
+    for (int64_t i = 0; i < dataCount; ++i)
+    {
+        float value = data[i];
+        if (value != value) continue;//exclude NaN
+        if (value != 0.0f && value * 2.0f == value) continue;//exclude infs
+        switch (filter)
+        {
+            case ALL_FINITE:
+                break;
+            case POSITIVE:
+                if (!(value > 0.0f)) continue;
+                break;
+            case NEGATIVE:
+                if (!(value < 0.0f)) continue;
+                break;
+            case ABSOLUTE:
+                if (value == 0.0f) continue;
+                if (value < 0.0f) value = -value;
+                break;
+        }
+        int bucket = (int)((value - bucketMin) / bucketSize);//doesn't really matter whether small negative floats truncate to a 0 integer
+        if (bucket < 0) bucket = 0;//because of this
+        if (bucket >= numBuckets) bucket = numBuckets - 1;
+        ++buckets[bucket];
+    }
+}
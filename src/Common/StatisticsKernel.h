@@ -0,0 +1,89 @@
+#ifndef __STATISTICS_KERNEL_H__
+#define __STATISTICS_KERNEL_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+
+namespace caret
+{
+    ///the linear passes over data that FastStatistics and Histogram are built from, with AVX2 versions used when the build and cpu support them
+    ///large arrays are split into fixed size blocks that are processed in parallel, block results are merged in order so the result doesn't depend on the number of threads
+    class StatisticsKernel
+    {
+    public:
+        ///which values go into a histogram, ABSOLUTE uses the absolute value of nonzero values
+        enum ValueFilter
+        {
+            ALL_FINITE,
+            POSITIVE,
+            NEGATIVE,
+            ABSOLUTE
+        };
+
+        ///counts, ranges and sum of part of an array, merge() combines the results of separate parts
+        struct Summary
+        {
+            ///counts of each class of number, zero includes negative zero
+            int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
+            ///ranges exclude infs and NaNs, a range with no values has +inf as its min and -inf as its max
+            float m_min, m_max;
+            float m_leastPos, m_mostPos;//min and max of positive values
+            float m_leastNeg, m_mostNeg;//max and min of negative values
+            ///sum of finite values
+            double m_sum;
+
+            Summary();
+
+            void merge(const Summary& other);
+        };
+
+        static Summary summarize(const float* data, const int64_t& dataCount);
+
+        ///sum of (value - mean)^2 over finite values, the subtraction is done in float like the scalar code always has
+        static double sumSquaredDeviations(const float* data, const int64_t& dataCount, const float& mean);
+
+        ///add the values selected by filter to buckets of size bucketSize starting at bucketMin, values outside the buckets are clamped into the end buckets
+        static void addToBuckets(const float* data, const int64_t& dataCount, const ValueFilter& filter,
+                                 const float& bucketMin, const float& bucketSize, int64_t* buckets, const int& numBuckets);
+
+        ///enable or disable the AVX2 versions, returns whether they will be used (false if the build or cpu lacks them)
+        static bool setAVX2Enabled(const bool& enabled);
+
+        static bool isAVX2Enabled();
+
+    private:
+        static const int64_t BLOCK_SIZE = 1 << 18;//also keeps the AVX2 per-lane 32 bit counts from overflowing
+
+        static void summarizeBlock(const float* data, const int64_t& dataCount, Summary& summaryOut);
+        static double sumSquaredDeviationsBlock(const float* data, const int64_t& dataCount, const float& mean);
+        static void addToBucketsBlock(const float* data, const int64_t& dataCount, const ValueFilter& filter,
+                                      const float& bucketMin, const float& bucketSize, int64_t* buckets, const int& numBuckets);
+
+        ///compiled with -mavx2 in a separate file, only called when the cpu has been checked
+        static void summarizeBlockAVX2(const float* data, const int64_t& dataCount, Summary& summaryOut);
+        static double sumSquaredDeviationsBlockAVX2(const float* data, const int64_t& dataCount, const float& mean);
+        static void addToBucketsBlockAVX2(const float* data, const int64_t& dataCount, const ValueFilter& filter,
+                                          const float& bucketMin, const float& bucketSize, int64_t* buckets, const int& numBuckets);
+    };
+}
+
+#endif //__STATISTICS_KERNEL_H__
@@ -0,0 +1,248 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//this file is compiled with -mavx2 when CARET_STATISTICS_AVX2 is enabled, and is empty otherwise
+//do NOT include headers with inline functions or templates (std containers, std::min, etc) here, the linker
+//could pick the AVX2 copy of such a function for the whole program, which would crash on older cpus
+#ifdef __AVX2__
+
+#include "StatisticsKernel.h"
+
+#include <immintrin.h>
+
+using namespace caret;
+
+namespace
+{
+    __m256 bitsToFloats(const int32_t bits)
+    {
+        return _mm256_castsi256_ps(_mm256_set1_epi32(bits));
+    }
+
+    //lanes 0 to count - 1 set, for loading the partial vector at the end of the data
+    __m256i tailMask(const int64_t count)
+    {
+        return _mm256_cmpgt_epi32(_mm256_set1_epi32((int32_t)count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+
+    __m256i addMaskCount(const __m256i counts, const __m256 mask)
+    {//mask lanes are -1 when set
+        return _mm256_sub_epi32(counts, _mm256_castps_si256(mask));
+    }
+
+    int64_t sumLanes(const __m256i counts)
+    {
+        alignas(32) int32_t lanes[8];
+        _mm256_store_si256((__m256i*)lanes, counts);
+        int64_t ret = 0;
+        for (int i = 0; i < 8; ++i) ret += lanes[i];
+        return ret;
+    }
+
+    float minLanes(const __m256 values)
+    {
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, values);
+        float ret = lanes[0];
+        for (int i = 1; i < 8; ++i) if (lanes[i] < ret) ret = lanes[i];
+        return ret;
+    }
+
+    float maxLanes(const __m256 values)
+    {
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, values);
+        float ret = lanes[0];
+        for (int i = 1; i < 8; ++i) if (lanes[i] > ret) ret = lanes[i];
+        return ret;
+    }
+
+    double sumLanes(const __m256d values)
+    {
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, values);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    __m256d finiteSum(const __m256d sum, const __m256 values)
+    {//values must already be zeroed where they aren't finite
+        return _mm256_add_pd(_mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_castps256_ps128(values))),
+                             _mm256_cvtps_pd(_mm256_extractf128_ps(values, 1)));
+    }
+
+    struct SummaryLanes
+    {
+        __m256i m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
+        __m256 m_min, m_max, m_leastPos, m_mostPos, m_leastNeg, m_mostNeg;
+        __m256d m_sum;
+        __m256 m_posInf, m_negInf, m_absMask;
+
+        SummaryLanes()
+        {
+            m_posCount = m_zeroCount = m_negCount = m_infCount = m_negInfCount = m_nanCount = _mm256_setzero_si256();
+            m_posInf = bitsToFloats(0x7f800000);
+            m_negInf = bitsToFloats((int32_t)0xff800000);
+            m_absMask = bitsToFloats(0x7fffffff);
+            m_min = m_leastPos = m_mostNeg = m_posInf;
+            m_max = m_mostPos = m_leastNeg = m_negInf;
+            m_sum = _mm256_setzero_pd();
+        }
+
+        void add(const __m256 value, const __m256 valid)
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 absValue = _mm256_and_ps(value, m_absMask);
+            const __m256 nan = _mm256_and_ps(_mm256_cmp_ps(value, value, _CMP_UNORD_Q), valid);
+            const __m256 finite = _mm256_and_ps(_mm256_cmp_ps(absValue, m_posInf, _CMP_LT_OQ), valid);//false for NaN
+            const __m256 inf = _mm256_and_ps(_mm256_cmp_ps(absValue, m_posInf, _CMP_EQ_OQ), valid);
+            const __m256 positive = _mm256_cmp_ps(value, zero, _CMP_GT_OQ);
+            const __m256 negative = _mm256_cmp_ps(value, zero, _CMP_LT_OQ);
+            const __m256 finitePos = _mm256_and_ps(positive, finite);
+            const __m256 finiteNeg = _mm256_and_ps(negative, finite);
+            m_nanCount = addMaskCount(m_nanCount, nan);
+            m_zeroCount = addMaskCount(m_zeroCount, _mm256_and_ps(_mm256_cmp_ps(value, zero, _CMP_EQ_OQ), valid));
+            m_posCount = addMaskCount(m_posCount, finitePos);
+            m_negCount = addMaskCount(m_negCount, finiteNeg);
+            m_infCount = addMaskCount(m_infCount, _mm256_and_ps(inf, positive));
+            m_negInfCount = addMaskCount(m_negInfCount, _mm256_and_ps(inf, negative));
+            m_min = _mm256_min_ps(m_min, _mm256_blendv_ps(m_posInf, value, finite));
+            m_max = _mm256_max_ps(m_max, _mm256_blendv_ps(m_negInf, value, finite));
+            m_leastPos = _mm256_min_ps(m_leastPos, _mm256_blendv_ps(m_posInf, value, finitePos));
+            m_mostPos = _mm256_max_ps(m_mostPos, _mm256_blendv_ps(m_negInf, value, finitePos));
+            m_leastNeg = _mm256_max_ps(m_leastNeg, _mm256_blendv_ps(m_negInf, value, finiteNeg));
+            m_mostNeg = _mm256_min_ps(m_mostNeg, _mm256_blendv_ps(m_posInf, value, finiteNeg));
+            m_sum = finiteSum(m_sum, _mm256_and_ps(value, finite));
+        }
+    };
+}
+
+void StatisticsKernel::summarizeBlockAVX2(const float* data, const int64_t& dataCount, Summary& summaryOut)
+{
+    SummaryLanes lanes;
+    const __m256 allLanes = bitsToFloats(-1);
+    int64_t i = 0;
+    for (; i + 8 <= dataCount; i += 8)
+    {
+        lanes.add(_mm256_loadu_ps(data + i), allLanes);
+    }
+    if (i < dataCount)
+    {
+        const __m256i mask = tailMask(dataCount - i);
+        lanes.add(_mm256_maskload_ps(data + i, mask), _mm256_castsi256_ps(mask));
+    }
+    Summary blockSummary;
+    blockSummary.m_posCount = sumLanes(lanes.m_posCount);
+    blockSummary.m_zeroCount = sumLanes(lanes.m_zeroCount);
+    blockSummary.m_negCount = sumLanes(lanes.m_negCount);
+    blockSummary.m_infCount = sumLanes(lanes.m_infCount);
+    blockSummary.m_negInfCount = sumLanes(lanes.m_negInfCount);
+    blockSummary.m_nanCount = sumLanes(lanes.m_nanCount);
+    blockSummary.m_min = minLanes(lanes.m_min);
+    blockSummary.m_max = maxLanes(lanes.m_max);
+    blockSummary.m_leastPos = minLanes(lanes.m_leastPos);
+    blockSummary.m_mostPos = maxLanes(lanes.m_mostPos);
+    blockSummary.m_leastNeg = maxLanes(lanes.m_leastNeg);
+    blockSummary.m_mostNeg = minLanes(lanes.m_mostNeg);
+    blockSummary.m_sum = sumLanes(lanes.m_sum);
+    summaryOut.merge(blockSummary);
+}
+
+double StatisticsKernel::sumSquaredDeviationsBlockAVX2(const float* data, const int64_t& dataCount, const float& mean)
+{
+    const __m256 posInf = bitsToFloats(0x7f800000);
+    const __m256 absMask = bitsToFloats(0x7fffffff);
+    const __m256 meanLanes = _mm256_set1_ps(mean);
+    __m256d sum = _mm256_setzero_pd();
+    int64_t i = 0;
+    for (; i < dataCount; i += 8)
+    {
+        __m256 value, valid;
+        if (i + 8 <= dataCount)
+        {
+            value = _mm256_loadu_ps(data + i);
+            valid = bitsToFloats(-1);
+        } else {
+            const __m256i mask = tailMask(dataCount - i);
+            value = _mm256_maskload_ps(data + i, mask);
+            valid = _mm256_castsi256_ps(mask);
+        }
+        const __m256 finite = _mm256_and_ps(_mm256_cmp_ps(_mm256_and_ps(value, absMask), posInf, _CMP_LT_OQ), valid);
+        const __m256 diff = _mm256_and_ps(_mm256_sub_ps(value, meanLanes), finite);
+        const __m256d diffLow = _mm256_cvtps_pd(_mm256_castps256_ps128(diff));
+        const __m256d diffHigh = _mm256_cvtps_pd(_mm256_extractf128_ps(diff, 1));
+        sum = _mm256_add_pd(sum, _mm256_add_pd(_mm256_mul_pd(diffLow, diffLow), _mm256_mul_pd(diffHigh, diffHigh)));
+    }
+    return sumLanes(sum);
+}
+
+void StatisticsKernel::addToBucketsBlockAVX2(const float* data, const int64_t& dataCount, const ValueFilter& filter,
+                                             const float& bucketMin, const float& bucketSize, int64_t* buckets, const int& numBuckets)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 posInf = bitsToFloats(0x7f800000);
+    const __m256 absMask = bitsToFloats(0x7fffffff);
+    const __m256 minLanes = _mm256_set1_ps(bucketMin);
+    const __m256 sizeLanes = _mm256_set1_ps(bucketSize);
+    const __m256i lastBucket = _mm256_set1_epi32(numBuckets - 1);
+    alignas(32) int32_t bucketLanes[8];
+    for (int64_t i = 0; i < dataCount; i += 8)
+    {
+        __m256 value, valid;
+        if (i + 8 <= dataCount)
+        {
+            value = _mm256_loadu_ps(data + i);
+            valid = bitsToFloats(-1);
+        } else {
+            const __m256i mask = tailMask(dataCount - i);
+            value = _mm256_maskload_ps(data + i, mask);
+            valid = _mm256_castsi256_ps(mask);
+        }
+        const __m256 absValue = _mm256_and_ps(value, absMask);
+        __m256 selected = _mm256_and_ps(_mm256_cmp_ps(absValue, posInf, _CMP_LT_OQ), valid);
+        switch (filter)
+        {
+            case ALL_FINITE:
+                break;
+            case POSITIVE:
+                selected = _mm256_and_ps(selected, _mm256_cmp_ps(value, zero, _CMP_GT_OQ));
+                break;
+            case NEGATIVE:
+                selected = _mm256_and_ps(selected, _mm256_cmp_ps(value, zero, _CMP_LT_OQ));
+                break;
+            case ABSOLUTE:
+                selected = _mm256_and_ps(selected, _mm256_cmp_ps(value, zero, _CMP_NEQ_OQ));
+                value = absValue;
+                break;
+        }
+        int selectedBits = _mm256_movemask_ps(selected);
+        if (selectedBits == 0) continue;
+        //same float operations as the scalar code, so values on bucket edges go to the same bucket
+        __m256i bucket = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_sub_ps(value, minLanes), sizeLanes));
+        bucket = _mm256_min_epi32(_mm256_max_epi32(bucket, _mm256_setzero_si256()), lastBucket);
+        _mm256_store_si256((__m256i*)bucketLanes, bucket);
+        while (selectedBits != 0)
+        {
+            ++buckets[bucketLanes[__builtin_ctz(selectedBits)]];
+            selectedBits &= selectedBits - 1;
+        }
+    }
+}
+
+#endif //__AVX2__
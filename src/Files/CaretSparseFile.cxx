@@ -28,10 +28,15 @@
 
 #include <QByteArray>
 
+#include <cstring>
+
 using namespace caret;
 using namespace std;
 
 const char magic[] = "\0\0\0\0cst\0";
+const char floatMagic[] = "\0\0\0\0csf\0";//same layout, but the values are float bits, so older readers reject it
+
+const char* CaretSparseFile::FLOAT_CORRELATION_EXTENSION = ".corr.wbsparse";
 
 CaretSparseFile::CaretSparseFile(const AString& fileName)
 {
@@ -49,9 +54,13 @@ void CaretSparseFile::readFile(const AString& filename)
     FileInformation fileInfo(filename);//useful later for file size, but create it now to reduce the amount of time between file open and size check
     char buf[8];
     m_file.read(buf, 8);
-    for (int i = 0; i < 8; ++i)
+    if (memcmp(buf, magic, 8) == 0)
     {
-        if (buf[i] != magic[i]) throw DataFileException("file has the wrong magic string");
+        m_valueType = INTEGER_VALUES;
+    } else if (memcmp(buf, floatMagic, 8) == 0) {
+        m_valueType = FLOAT_VALUES;
+    } else {
+        throw DataFileException("file has the wrong magic string");
     }
     m_file.read(m_dims, 2 * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
@@ -100,8 +109,22 @@ CaretSparseFile::~CaretSparseFile()
 {
 }
 
+void CaretSparseFile::checkValueType(const ValueType& type) const
+{
+    if (m_valueType != type)
+    {
+        if (m_valueType == FLOAT_VALUES)
+        {
+            throw DataFileException("sparse file contains float values, it cannot be read as integer or fiber trajectory data");
+        } else {
+            throw DataFileException("sparse file contains integer or fiber trajectory values, it cannot be read as float data");
+        }
+    }
+}
+
 void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 {
+    checkValueType(INTEGER_VALUES);
     CaretAssert(index >= 0 && index < m_dims[1]);
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
     int64_t numToRead = (end - start) * 2;
@@ -133,6 +156,12 @@ void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 }
 
 void CaretSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
+{
+    checkValueType(INTEGER_VALUES);
+    readRowSparse(index, indicesOut, valuesOut);
+}
+
+void CaretSparseFile::readRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
@@ -182,6 +211,21 @@ void CaretSparseFile::getFibersRowSparse(const int64_t& index, vector<int64_t>&
     }
 }
 
+void CaretSparseFile::getFloatRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<float>& valuesOut)
+{
+    checkValueType(FLOAT_VALUES);
+    readRowSparse(index, indicesOut, m_scratchSparseRow);
+    size_t numNonzero = m_scratchSparseRow.size();
+    valuesOut.resize(numNonzero);
+    for (size_t i = 0; i < numNonzero; ++i)
+    {
+        uint64_t coded = ((uint64_t*)m_scratchSparseRow.data())[i];
+        if (coded > 0xFFFFFFFFULL) throw DataFileException("error decoding value '" + AString::number(coded) + "' from workbench sparse float file");
+        uint32_t bits = (uint32_t)coded;
+        memcpy(&(valuesOut[i]), &bits, sizeof(float));
+    }
+}
+
 void CaretSparseFile::decodeFibers(const uint64_t& coded, FiberFractions& decoded)
 {
     decoded.fiberFractions.resize(3);
@@ -206,11 +250,20 @@ void FiberFractions::zero()
     distance = 0.0f;
 }
 
-CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml)
+CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const CaretSparseFile::ValueType& valueType)
 {
-    if (!fileName.endsWith(".trajTEMP.wbsparse"))
-    {//for now (and maybe forever), this format is single-purpose
-        CaretLogWarning("sparse trajectory file '" + fileName + "' should be saved ending in .trajTEMP.wbsparse");
+    m_valueType = valueType;
+    if (valueType == CaretSparseFile::FLOAT_VALUES)
+    {
+        if (!fileName.endsWith(CaretSparseFile::FLOAT_CORRELATION_EXTENSION))
+        {
+            CaretLogWarning("sparse float file '" + fileName + "' should be saved ending in " + CaretSparseFile::FLOAT_CORRELATION_EXTENSION);
+        }
+    } else {
+        if (!fileName.endsWith(".trajTEMP.wbsparse"))
+        {//for now (and maybe forever), integer sparse files are only trajectories
+            CaretLogWarning("sparse trajectory file '" + fileName + "' should be saved ending in .trajTEMP.wbsparse");
+        }
     }
     m_finished = false;
     int64_t dimensions[2] = { xml.getDimensionLength(CiftiXML::ALONG_ROW), xml.getDimensionLength(CiftiXML::ALONG_COLUMN) };
@@ -223,7 +276,7 @@ CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const Cift
         throw DataFileException("wbsparse files cannot be written compressed");
     }//because after we finish writing the data, we have to come back and write the lengths array
     m_file.open(fileName, CaretBinaryFile::WRITE_TRUNCATE);
-    m_file.write(magic, 8);
+    m_file.write((valueType == CaretSparseFile::FLOAT_VALUES) ? floatMagic : magic, 8);
     int64_t tempdims[2] = { m_dims[0], m_dims[1] };
     if (ByteOrderEnum::isSystemBigEndian())
     {
@@ -236,8 +289,17 @@ CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const Cift
     m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
 }
 
+void CaretSparseFileWriter::checkValueType(const CaretSparseFile::ValueType& type) const
+{
+    if (m_valueType != type)
+    {
+        throw DataFileException("sparse file writer was not opened for this type of values");
+    }
+}
+
 void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
 {
+    checkValueType(CaretSparseFile::INTEGER_VALUES);
     CaretAssert(index < m_dims[1]);
     CaretAssert(index >= m_nextRowIndex);
     while (m_nextRowIndex < index)
@@ -267,6 +329,12 @@ void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
 }
 
 void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
+{
+    checkValueType(CaretSparseFile::INTEGER_VALUES);
+    writeRowSparseValues(index, indices, values);
+}
+
+void CaretSparseFileWriter::writeRowSparseValues(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
 {
     CaretAssert(index < m_dims[1]);
     CaretAssert(index >= m_nextRowIndex);
@@ -322,6 +390,20 @@ void CaretSparseFileWriter::writeFibersRowSparse(const int64_t& index, const vec
     writeRowSparse(index, indices, m_scratchSparseRow);
 }
 
+void CaretSparseFileWriter::writeFloatRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<float>& values)
+{
+    checkValueType(CaretSparseFile::FLOAT_VALUES);
+    size_t numNonzero = values.size();
+    m_scratchSparseRow.resize(numNonzero);
+    for (size_t i = 0; i < numNonzero; ++i)
+    {
+        uint32_t bits;
+        memcpy(&bits, &(values[i]), sizeof(float));
+        m_scratchSparseRow[i] = bits;//zero-extended, so the value field is never negative
+    }
+    writeRowSparseValues(index, indices, m_scratchSparseRow);
+}
+
 void CaretSparseFileWriter::finish()
 {
     if (m_finished) return;
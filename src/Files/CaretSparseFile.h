@@ -42,8 +42,22 @@ namespace caret {
     
     class CaretSparseFile /* : public DataFile */
     {
+    public:
+        ///what the 64 bit value fields hold, recorded by the magic string, so a file is only read with the functions for its type
+        enum ValueType
+        {
+            INTEGER_VALUES,//fiber trajectories and other integer encodings, use getRow, getRowSparse, getFibersRow, getFibersRowSparse
+            FLOAT_VALUES//bits of a float, use getFloatRowSparse
+        };
+        
+        ///secondary extension for files of FLOAT_VALUES written by -cifti-correlation-sparse
+        static const char* FLOAT_CORRELATION_EXTENSION;
+    private:
         static void decodeFibers(const uint64_t& coded, FiberFractions& decoded);//takes a uint because right shift on signed is implementation dependent
+        void readRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<int64_t>& valuesOut);
+        void checkValueType(const ValueType& type) const;
         CaretBinaryFile m_file;
+        ValueType m_valueType;
         int64_t m_dims[2], m_valuesOffset;
         std::vector<uint64_t> m_indexArray, m_scratchRow;
         std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
@@ -51,6 +65,8 @@ namespace caret {
         CiftiXML m_xml;
     public:
         const int64_t* getDimensions() { return m_dims; }
+        
+        ValueType getValueType() const { return m_valueType; }
 
         CaretSparseFile() {};
         
@@ -70,6 +86,9 @@ namespace caret {
         void getFibersRow(const int64_t& index, FiberFractions* rowOut);
         
         void getFibersRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<FiberFractions>& valuesOut);
+        
+        ///only for files of FLOAT_VALUES, the other row functions throw for them
+        void getFloatRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<float>& valuesOut);
 
         virtual ~CaretSparseFile();
     };
@@ -78,7 +97,10 @@ namespace caret {
     {
         static void encodeFibers(const FiberFractions& orig, uint64_t& coded);
         static uint32_t myclamp(const int& x);
+        void writeRowSparseValues(const int64_t& index, const std::vector<int64_t>& indices, const std::vector<int64_t>& values);
+        void checkValueType(const CaretSparseFile::ValueType& type) const;
         CaretBinaryFile m_file;
+        CaretSparseFile::ValueType m_valueType;
         int64_t m_dims[2], m_valuesOffset, m_nextRowIndex;
         bool m_finished;
         std::vector<uint64_t> m_lengthArray, m_scratchRow;
@@ -86,7 +108,8 @@ namespace caret {
         CaretSparseFileWriter(const CaretSparseFileWriter& rhs);
         CiftiXML m_xml;
     public:
-        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml);
+        ///valueType is recorded in the file, and only the write functions for that type may be used
+        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const CaretSparseFile::ValueType& valueType = CaretSparseFile::INTEGER_VALUES);
         
         ~CaretSparseFileWriter();
         
@@ -102,6 +125,9 @@ namespace caret {
         ///you must write the rows in order, though you can skip empty rows
         void writeFibersRowSparse(const int64_t& index, const std::vector<int64_t>& indices, const std::vector<FiberFractions>& values);
         
+        ///only for FLOAT_VALUES files, stores the bits of each float in the value field, you must write the rows in order, though you can skip empty rows
+        void writeFloatRowSparse(const int64_t& index, const std::vector<int64_t>& indices, const std::vector<float>& values);
+        
         ///call this if no rows remain to be written
         void finish();
     };
@@ -275,6 +275,39 @@ CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataForRow(std::vector<floa
                                                dataOut);
 }
 
+/**
+ * Compute the average of the PROCESSED data for the given rows, the
+ * correlation computes all of the rows together.
+ *
+ * @param dataOut
+ *     Output with average data.
+ * @param indices
+ *     Indices of the rows.
+ * @return
+ *     True if the average was computed.
+ */
+bool
+CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataAverageForRows(std::vector<float>& dataOut,
+                                                                        const std::vector<int64_t>& indices) const
+{
+    if ((m_numberOfBrainordinates <= 0)
+        || (m_numberOfTimePoints <= 0)
+        || indices.empty()) {
+        return false;
+    }
+    
+    CaretAssert(static_cast<int64_t>(dataOut.size()) == m_numberOfBrainordinates);
+    
+    ConnectivityCorrelationTwo* connCorrelationTwo(getConnectivityCorrelationTwo());
+    if (connCorrelationTwo == NULL) {
+        return false;
+    }
+    
+    connCorrelationTwo->computeAverageForDataSetIndices(indices,
+                                                        dataOut);
+    return true;
+}
+
 /**
  * Save subclass data to the scene.
  *
@@ -69,6 +69,8 @@ namespace caret {
         
         virtual void getProcessedDataForRow(std::vector<float>& dataOut, const int64_t& index) const override;
         
+        virtual bool getProcessedDataAverageForRows(std::vector<float>& dataOut, const std::vector<int64_t>& indices) const override;
+        
         virtual void saveSubClassDataToScene(const SceneAttributes* sceneAttributes,
                                              SceneClass* sceneClass);
         
@@ -789,6 +789,10 @@ CiftiFiberTrajectoryFile::readFile(const AString& filename)
     try {
         m_sparseFile = new CaretSparseFile();
         m_sparseFile->readFile(filename);
+        if (m_sparseFile->getValueType() != CaretSparseFile::INTEGER_VALUES) {
+            throw DataFileException("File contains float values, not fiber trajectories: "
+                                    + filename);
+        }
         setFileName(filename);
         
         m_fiberTrajectoryFileType = FIBER_TRAJECTORY_LOAD_BY_BRAINORDINATE;
@@ -806,6 +806,10 @@ CiftiFiberTrajectoryMapFile::readFile(const AString& filename)
     try {
         m_sparseFile = new CaretSparseFile();
         m_sparseFile->readFile(filename);
+        if (m_sparseFile->getValueType() != CaretSparseFile::INTEGER_VALUES) {
+            throw DataFileException("File contains float values, not fiber trajectories: "
+                                    + filename);
+        }
         setFileName(filename);
         
         AString errorMessage;
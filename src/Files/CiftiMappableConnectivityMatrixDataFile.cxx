@@ -23,8 +23,11 @@
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #undef __CIFTI_MAPPABLE_CONNECTIVITY_MATRIX_DATA_FILE_DECLARE__
 
+#include <cstdlib>
+
 #include "CaretAssert.h"
 #include "CiftiFile.h"
+#include "CiftiRowCache.h"
 #include "CaretLogger.h"
 #include "ChartableMatrixParcelInterface.h"
 #include "ConnectivityDataLoaded.h"
@@ -34,6 +37,8 @@
 #include "EventProgressUpdate.h"
 #include "SceneClass.h"
 #include "SceneClassAssistant.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
 
 using namespace caret;
 
@@ -371,7 +376,12 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
     bool dataWasLoadedFlag(false);
     
     const int64_t numIndices = static_cast<int64_t>(indices.size());
-    if (numIndices > 0) {
+    if (doRowsFlag
+        && getProcessedDataAverageForRows(dataAverageOut,
+                                          indices)) {
+        dataWasLoadedFlag = true;
+    }
+    else if (numIndices > 0) {
         std::vector<double> sum(dataLength, 0.0);
         std::vector<float>  data(dataLength);
         
@@ -598,8 +608,9 @@ CiftiMappableConnectivityMatrixDataFile::getDataForColumn(float* dataOut, const
 void
 CiftiMappableConnectivityMatrixDataFile::getDataForRow(float* dataOut, const int64_t& index) const
 {
-    m_ciftiFile->getRow(dataOut,
-                        index);
+    CiftiRowCache::get()->getRow(m_ciftiFile,
+                                 index,
+                                 dataOut);
 }
 
 /**
@@ -632,8 +643,30 @@ CiftiMappableConnectivityMatrixDataFile::getProcessedDataForColumn(float* dataOu
 void
 CiftiMappableConnectivityMatrixDataFile::getProcessedDataForRow(std::vector<float>& dataOut, const int64_t& index) const
 {
-    m_ciftiFile->getRow(&dataOut[0],
-                        index);
+    CiftiRowCache::get()->getRow(m_ciftiFile,
+                                 index,
+                                 &dataOut[0]);
+}
+
+/**
+ * Compute the average of the PROCESSED data for the given rows in one step.
+ *
+ * Some file types can compute the average much faster than loading each
+ * row, and override this method.
+ *
+ * @param dataOut
+ *     Output with average data.
+ * @param indices
+ *     Indices of the rows.
+ * @return
+ *     True if the average was computed, false if each row must be loaded and averaged.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::getProcessedDataAverageForRows(std::vector<float>& /*dataOut*/,
+                                                                        const std::vector<int64_t>& /*indices*/) const
+{
+    /* This method may be overridden by subclasses */
+    return false;
 }
 
 /**
@@ -650,6 +683,138 @@ CiftiMappableConnectivityMatrixDataFile::processRowAverageData(std::vector<float
 }
 
 
+/**
+ * Request background reading of the rows for the neighbors of a surface node, so that
+ * selecting a nearby node does not wait for the file.  The first ring of neighbors is
+ * requested before the second ring.  Pending requests for other nodes are cancelled.
+ *
+ * @param surfaceFile
+ *    Surface containing the node.
+ * @param nodeIndex
+ *    Index of the node whose data was loaded.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::prefetchRowsForSurfaceNodeNeighbors(const SurfaceFile* surfaceFile,
+                                                                             const int32_t nodeIndex)
+{
+    if ( ! isRowPrefetchEnabled()) {
+        return;
+    }
+    CaretAssert(surfaceFile);
+    const int32_t numberOfNodes = surfaceFile->getNumberOfNodes();
+    if ((nodeIndex < 0)
+        || (nodeIndex >= numberOfNodes)) {
+        return;
+    }
+    
+    CaretPointer<TopologyHelper> topologyHelper = surfaceFile->getTopologyHelper();
+    std::vector<int32_t> prefetchNodes;
+    std::set<int32_t> usedNodes;
+    usedNodes.insert(nodeIndex);
+    const std::vector<int32_t>& firstRing = topologyHelper->getNodeNeighbors(nodeIndex);
+    for (const int32_t neighbor : firstRing) {
+        if (usedNodes.insert(neighbor).second) {
+            prefetchNodes.push_back(neighbor);
+        }
+    }
+    for (const int32_t firstRingNode : firstRing) {
+        const std::vector<int32_t>& secondRing = topologyHelper->getNodeNeighbors(firstRingNode);
+        for (const int32_t neighbor : secondRing) {
+            if (usedNodes.insert(neighbor).second) {
+                prefetchNodes.push_back(neighbor);
+            }
+        }
+    }
+    
+    std::vector<int64_t> rowIndices;
+    for (const int32_t node : prefetchNodes) {
+        int64_t rowIndex = -1;
+        int64_t columnIndex = -1;
+        getRowColumnIndexForNodeWhenLoading(surfaceFile->getStructure(),
+                                            numberOfNodes,
+                                            node,
+                                            rowIndex,
+                                            columnIndex);
+        if (rowIndex >= 0) {
+            rowIndices.push_back(rowIndex);
+        }
+    }
+    CiftiRowCache::get()->prefetchRows(m_ciftiFile,
+                                       rowIndices);
+}
+
+/**
+ * Request background reading of the rows for the voxels adjacent to the voxel
+ * at the given coordinate (faces first, then edges and corners).  Pending
+ * requests for other voxels are cancelled.
+ *
+ * @param xyz
+ *    Coordinate of the voxel whose data was loaded.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::prefetchRowsForVoxelNeighbors(const float xyz[3])
+{
+    if ( ! isRowPrefetchEnabled()) {
+        return;
+    }
+    
+    int64_t ijk[3];
+    enclosingVoxelForDataLoading(xyz[0], xyz[1], xyz[2], ijk[0], ijk[1], ijk[2]);
+    
+    std::vector<int64_t> rowIndices;
+    for (int32_t numberOfOffsets = 1; numberOfOffsets <= 3; numberOfOffsets++) {
+        for (int32_t k = -1; k <= 1; k++) {
+            for (int32_t j = -1; j <= 1; j++) {
+                for (int32_t i = -1; i <= 1; i++) {
+                    if ((std::abs(i) + std::abs(j) + std::abs(k)) != numberOfOffsets) {
+                        continue;
+                    }
+                    const int64_t neighborIJK[3] = { ijk[0] + i, ijk[1] + j, ijk[2] + k };
+                    if ( ! indexValidForDataLoading(neighborIJK[0], neighborIJK[1], neighborIJK[2])) {
+                        continue;
+                    }
+                    int64_t rowIndex = -1;
+                    int64_t columnIndex = -1;
+                    getRowColumnIndexForVoxelIndexWhenLoading(neighborIJK,
+                                                              rowIndex,
+                                                              columnIndex);
+                    if (rowIndex >= 0) {
+                        rowIndices.push_back(rowIndex);
+                    }
+                }
+            }
+        }
+    }
+    CiftiRowCache::get()->prefetchRows(m_ciftiFile,
+                                       rowIndices);
+}
+
+/**
+ * @return True if rows are read from disk when loading data, so that prefetching
+ * rows is useful.  Dynamic files compute their rows and are not prefetched.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::isRowPrefetchEnabled()
+{
+    if (m_ciftiFile == NULL) {
+        return false;
+    }
+    if ( ! isEnabledAsLayer()) {
+        return false;
+    }
+    if ( ! m_dataLoadingEnabled) {
+        return false;
+    }
+    if ((getDataFileType() == DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC)
+        || (getDataFileType() == DataFileTypeEnum::CONNECTIVITY_PARCEL_DYNAMIC)) {
+        return false;
+    }
+    if (getCifitDirectionForLoadingRowOrColumn() != CiftiXML::ALONG_COLUMN) {
+        return false;
+    }
+    return CiftiRowCache::isCacheable(m_ciftiFile);
+}
+
 /**
  * Load the given row from the file even if the file is disabled.
  *
@@ -32,6 +32,7 @@ namespace caret {
 
     class ConnectivityDataLoaded;
     class SceneClassAssistant;
+    class SurfaceFile;
     
     class CiftiMappableConnectivityMatrixDataFile :
     public CiftiMappableDataFile
@@ -68,6 +69,11 @@ namespace caret {
                                                        const int64_t volumeDimensionIJK[3],
                                                        const std::vector<VoxelIJK>& voxelIndices);
         
+        void prefetchRowsForSurfaceNodeNeighbors(const SurfaceFile* surfaceFile,
+                                                 const int32_t nodeIndex);
+        
+        void prefetchRowsForVoxelNeighbors(const float xyz[3]);
+        
         void loadDataForRowIndex(const int64_t rowIndex);
         
         void loadDataForColumnIndex(const int64_t rowIndex);
@@ -128,6 +134,8 @@ namespace caret {
         
         virtual void getProcessedDataForRow(std::vector<float>& dataOut, const int64_t& index) const;
         
+        virtual bool getProcessedDataAverageForRows(std::vector<float>& dataOut, const std::vector<int64_t>& indices) const;
+        
         virtual void getDataForColumn(float* dataOut, const int64_t& index) const;
         
         virtual void getDataForRow(float* dataOut, const int64_t& index) const;
@@ -171,6 +179,8 @@ namespace caret {
         
         int32_t getCifitDirectionForLoadingRowOrColumn();
         
+        bool isRowPrefetchEnabled();
+        
         // ADD_NEW_MEMBERS_HERE
         
         SceneClassAssistant* m_sceneAssistant;
@@ -42,6 +42,7 @@
 #include "CiftiParcelReordering.h"
 #include "CiftiParcelScalarFile.h"
 #include "CiftiParcelSeriesFile.h"
+#include "CiftiRowCache.h"
 #include "CiftiScalarDataSeriesFile.h"
 #include "CaretTemporaryFile.h"
 #include "CiftiXML.h"
@@ -49,6 +50,7 @@
 #include "ConnectivityDataLoaded.h"
 #include "DataFileContentInformation.h"
 #include "DataFileException.h"
+#include "DataFileStatisticsSidecar.h"
 #include "EventManager.h"
 #include "EventCaretPreferencesGet.h"
 #include "EventSurfaceColoringInvalidate.h"
@@ -67,6 +69,7 @@
 #include "MapFileDataSelector.h"
 #include "NodeAndVoxelColoring.h"
 #include "PaletteColorMapping.h"
+#include "PartitionedStatistics.h"
 #include "SparseVolumeIndexer.h"
 #include "VolumeGraphicsPrimitiveManager.h"
 
@@ -125,6 +128,7 @@ VolumeMappableInterface()
     m_fileFastStatistics.grabNew(NULL);
     m_fileHistogram.grabNew(NULL);
     m_fileHistorgramLimitedValues.grabNew(NULL);
+    m_fileStatisticsSidecarChecked = false;
     
     /*
      * Note: The first palette normalization mode is assumed to
@@ -493,6 +497,8 @@ CiftiMappableDataFile::clearPrivate()
      * m_fileMapDataType
      */
     
+    /* must be done before the CIFTI file is deleted */
+    CiftiRowCache::get()->removeFile(m_ciftiFile);
     m_ciftiFile.grabNew(NULL);
     
     resetDataLoadingMembers();
@@ -1280,6 +1286,7 @@ CiftiMappableDataFile::initializeAfterReading(const AString& filename)
     m_fileFastStatistics.grabNew(NULL);
     m_fileHistogram.grabNew(NULL);
     m_fileHistorgramLimitedValues.grabNew(NULL);
+    m_fileStatisticsSidecarChecked = false;
     
     CaretLogFiner("CLASS/NAME Table for : "
                   + this->getFileNameNoPath()
@@ -1323,6 +1330,8 @@ CiftiMappableDataFile::writeFile(const AString& ciftiMapFileName)
                                 + " dense connectivity files cannot be written to files due to their large sizes.");
     }
     
+    /* writing may replace the CIFTI file's reading implementation */
+    CiftiRowCache::get()->removeFile(m_ciftiFile);
     m_ciftiFile->writeFile(ciftiMapFileName);
     setFileName(ciftiMapFileName);
     clearModified();
@@ -1582,6 +1591,9 @@ CiftiMappableDataFile::setMapData(const int32_t mapIndex,
     CaretAssert(m_ciftiFile);
     CaretAssert(mapIndex >= 0);
     
+    /* cached rows become stale, and the first write may replace the reading implementation */
+    CiftiRowCache::get()->removeFile(m_ciftiFile);
+    
     switch (m_dataReadingAccessMethod) {
         case DATA_ACCESS_METHOD_INVALID:
             CaretAssert(0);
@@ -2765,13 +2777,7 @@ const FastStatistics*
 CiftiMappableDataFile::getFileFastStatistics()
 {
     if (m_fileFastStatistics == NULL) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
-            m_fileFastStatistics.grabNew(new FastStatistics());
-            m_fileFastStatistics->update(&fileData[0],
-                                         fileData.size());
-        }
+        updateFileStatisticsAndHistogram();
     }
     
     return m_fileFastStatistics;
@@ -2789,31 +2795,135 @@ CiftiMappableDataFile::getFileFastStatistics()
 const Histogram*
 CiftiMappableDataFile::getFileHistogram()
 {
-    bool updateHistogramFlag = false;
     const int32_t numberOfBuckets = getFileHistogramNumberOfBuckets();
-    if (m_fileHistogram != NULL) {
-        if (numberOfBuckets != m_fileHistogramNumberOfBuckets) {
-            updateHistogramFlag = true;
-        }
+    if ((m_fileHistogram == NULL)
+        || (numberOfBuckets != m_fileHistogramNumberOfBuckets)) {
+        updateFileStatisticsAndHistogram();
     }
-    else {
-        updateHistogramFlag = true;
-    }
-    if (updateHistogramFlag) {
-        std::vector<float> fileData;
-        getFileData(fileData);
+    return m_fileHistogram;
+}
+
+namespace {
+    /**
+     * Reads the maps of a CIFTI file one at a time for the statistics
+     * of all data in the file.
+     */
+    class CiftiMapPartReader : public PartitionedStatistics::PartReader {
+    public:
+        CiftiMapPartReader(const CiftiMappableDataFile* ciftiMapFile,
+                           const bool concurrentReadFlag)
+        : m_ciftiMapFile(ciftiMapFile),
+          m_concurrentReadFlag(concurrentReadFlag) { }
         
-        if ( ! fileData.empty()) {
-            if (m_fileHistogram == NULL) {
-                m_fileHistogram.grabNew(new Histogram(numberOfBuckets));
+        int64_t getNumberOfParts() const {
+            return m_ciftiMapFile->getNumberOfMaps();
+        }
+        
+        bool supportsConcurrentRead() const {
+            return m_concurrentReadFlag;
+        }
+        
+        const float* readPart(const int64_t& index,
+                              std::vector<float>& storage,
+                              int64_t& countOut) const {
+            storage.clear();
+            m_ciftiMapFile->getMapData(index,
+                                       storage);
+            countOut = storage.size();
+            return (storage.empty() ? NULL : &storage[0]);
+        }
+        
+    private:
+        const CiftiMappableDataFile* m_ciftiMapFile;
+        
+        const bool m_concurrentReadFlag;
+    };
+}
+
+/**
+ * Update the statistics and histogram of all data in the file that are
+ * missing or out of date.  They are read from the statistics sidecar
+ * when it matches the file on disk, otherwise both are computed from
+ * the file's maps, which are read one at a time (in parallel when the
+ * CIFTI file allows it), and the sidecar is written.
+ */
+void
+CiftiMappableDataFile::updateFileStatisticsAndHistogram()
+{
+    const int32_t numberOfBuckets = getFileHistogramNumberOfBuckets();
+    
+    /*
+     * Sidecar describes the data on disk, not data changed in memory
+     */
+    const bool useSidecarFlag = ((m_ciftiFile != NULL)
+                                 && ( ! isModifiedExcludingPaletteColorMapping()));
+    if (useSidecarFlag
+        && ( ! m_fileStatisticsSidecarChecked)) {
+        m_fileStatisticsSidecarChecked = true;
+        CaretPointer<FastStatistics> sidecarStatistics;
+        CaretPointer<Histogram> sidecarHistogram;
+        std::vector<PartitionedStatistics::PartSummary> sidecarMapSummaries;
+        if (DataFileStatisticsSidecar::read(getFileName(),
+                                            sidecarStatistics,
+                                            sidecarHistogram,
+                                            sidecarMapSummaries)) {
+            if ((m_fileFastStatistics == NULL)
+                && (sidecarStatistics != NULL)) {
+                m_fileFastStatistics = sidecarStatistics;
+            }
+            if ((sidecarHistogram != NULL)
+                && (sidecarHistogram->getNumberOfBuckets() == numberOfBuckets)) {
+                m_fileHistogram = sidecarHistogram;
+                m_fileHistogramNumberOfBuckets = numberOfBuckets;
             }
-            m_fileHistogram->update(numberOfBuckets,
-                                    &fileData[0],
-                                    fileData.size());
-            m_fileHistogramNumberOfBuckets = numberOfBuckets;
         }
     }
-    return m_fileHistogram;
+    
+    const bool updateStatisticsFlag = (m_fileFastStatistics == NULL);
+    const bool updateHistogramFlag  = ((m_fileHistogram == NULL)
+                                       || (numberOfBuckets != m_fileHistogramNumberOfBuckets));
+    if (( ! updateStatisticsFlag)
+        && ( ! updateHistogramFlag)) {
+        return;
+    }
+    
+    if (m_ciftiFile == NULL) {
+        return;
+    }
+    
+    CaretPointer<FastStatistics> fastStatistics;
+    if (updateStatisticsFlag) {
+        fastStatistics.grabNew(new FastStatistics());
+    }
+    CaretPointer<Histogram> histogram;
+    if (updateHistogramFlag) {
+        histogram.grabNew(new Histogram(numberOfBuckets));
+    }
+    const CiftiMapPartReader mapReader(this,
+                                       m_ciftiFile->supportsConcurrentRead());
+    std::vector<PartitionedStatistics::PartSummary> mapSummaries;
+    if ( ! PartitionedStatistics::compute(mapReader,
+                                          numberOfBuckets,
+                                          fastStatistics,
+                                          histogram,
+                                          &mapSummaries)) {
+        return;
+    }
+    
+    if (updateStatisticsFlag) {
+        m_fileFastStatistics = fastStatistics;
+    }
+    if (updateHistogramFlag) {
+        m_fileHistogram = histogram;
+        m_fileHistogramNumberOfBuckets = numberOfBuckets;
+    }
+    
+    if (useSidecarFlag) {
+        DataFileStatisticsSidecar::write(getFileName(),
+                                         m_fileFastStatistics,
+                                         m_fileHistogram,
+                                         mapSummaries);
+    }
 }
 
 /**
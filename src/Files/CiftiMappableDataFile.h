@@ -774,6 +774,8 @@ namespace caret {
         
         void clearPrivate();
         
+        void updateFileStatisticsAndHistogram();
+        
     protected:
         void initializeAfterReading(const AString& filename);
         
@@ -895,6 +897,9 @@ namespace caret {
         
         int32_t m_fileHistogramNumberOfBuckets = 100;
         
+        /** Statistics sidecar has been checked since the file was read */
+        bool m_fileStatisticsSidecarChecked = false;
+        
         /** Histogram with limited values used when statistics computed on all data in file */
         CaretPointer<Histogram> m_fileHistorgramLimitedValues;
         
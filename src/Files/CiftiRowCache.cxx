@@ -0,0 +1,409 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __CIFTI_ROW_CACHE_DECLARE__
+#include "CiftiRowCache.h"
+#undef __CIFTI_ROW_CACHE_DECLARE__
+
+#include <algorithm>
+#include <limits>
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CiftiFile.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::CiftiRowCache
+ * \brief Cache of recently read rows from CIFTI files that are read from disk
+ * \ingroup Files
+ *
+ * Rows are kept in a least recently used cache, keyed by the file and row.
+ * Rows near the one the user selected can be requested for prefetch, they
+ * are read by a task in Qt's global thread pool so that a later selection
+ * of one of them does not wait for the disk.  A new prefetch request for
+ * a file cancels that file's prefetch requests that have not started.
+ *
+ * Only files that are neither in memory nor compressed use the cache, as
+ * the prefetch reads must not interfere with reads by the GUI thread
+ * (see CiftiFile::supportsConcurrentRead()).
+ *
+ * Owners of a CiftiFile must call removeFile() before the CiftiFile is
+ * destroyed or its content is changed.
+ */
+
+/**
+ * Task that reads the pending prefetch rows and exits when there are none.
+ */
+class CiftiRowCache::PrefetchTask : public QRunnable {
+public:
+    PrefetchTask(CiftiRowCache* cache) : m_cache(cache) { }
+
+    void run() override {
+        m_cache->runPrefetchTask();
+    }
+
+    CiftiRowCache* m_cache;
+};
+
+/**
+ * @return The row cache.
+ */
+CiftiRowCache*
+CiftiRowCache::get()
+{
+    /*
+     * Never deleted since a prefetch task may
+     * still be running when the application exits
+     */
+    static CiftiRowCache* s_instance = new CiftiRowCache();
+    return s_instance;
+}
+
+/**
+ * Constructor.
+ */
+CiftiRowCache::CiftiRowCache()
+: CaretObject(),
+m_prefetchReadKey(NULL, -1),
+m_prefetchReadActive(false),
+m_prefetchTaskActive(false),
+m_numberOfBytes(0),
+m_maximumBytes(((int64_t)256) << 20)
+{
+
+}
+
+/**
+ * Destructor.
+ */
+CiftiRowCache::~CiftiRowCache()
+{
+}
+
+/**
+ * @return True if rows from the given file are cached and prefetched.
+ * @param ciftiFile
+ *    The CIFTI file.
+ */
+bool
+CiftiRowCache::isCacheable(const CiftiFile* ciftiFile)
+{
+    if (ciftiFile == NULL) {
+        return false;
+    }
+    return (( ! ciftiFile->isInMemory())
+            && ciftiFile->supportsConcurrentRead());
+}
+
+/**
+ * Get a row, from the cache if it is present, otherwise it is read from the file
+ * and added to the cache.  If the prefetch task is reading the row, wait for it.
+ * @param ciftiFile
+ *    The CIFTI file.
+ * @param rowIndex
+ *    Index of the row.
+ * @param dataOut
+ *    Output with the row, must have room for the number of columns in the file.
+ * @throw DataFileException
+ *    If an error occurs reading the file.
+ */
+void
+CiftiRowCache::getRow(const CiftiFile* ciftiFile,
+                      const int64_t rowIndex,
+                      float* dataOut)
+{
+    CaretAssert(ciftiFile);
+    if ( ! isCacheable(ciftiFile)) {
+        ciftiFile->getRow(dataOut,
+                          rowIndex);
+        return;
+    }
+
+    const Key key(ciftiFile,
+                  rowIndex);
+    {
+        QMutexLocker locker(&m_mutex);
+        while (true) {
+            std::map<Key, Entry>::iterator iter = m_entries.find(key);
+            if (iter != m_entries.end()) {
+                Entry& entry = iter->second;
+                std::copy(entry.m_data.begin(),
+                          entry.m_data.end(),
+                          dataOut);
+                m_leastRecentlyUsed.splice(m_leastRecentlyUsed.begin(),
+                                           m_leastRecentlyUsed,
+                                           entry.m_lruIterator);
+                return;
+            }
+            if (m_prefetchReadActive
+                && (m_prefetchReadKey == key)) {
+                m_readFinishedCondition.wait(&m_mutex);
+            }
+            else {
+                break;
+            }
+        }
+
+        /* Reading it now, prefetching it would be wasted */
+        std::deque<Key>::iterator pendingIter = std::find(m_pendingPrefetch.begin(),
+                                                          m_pendingPrefetch.end(),
+                                                          key);
+        if (pendingIter != m_pendingPrefetch.end()) {
+            m_pendingPrefetch.erase(pendingIter);
+        }
+    }
+
+    ciftiFile->getRow(dataOut,
+                      rowIndex);
+
+    std::vector<float> data(dataOut,
+                            dataOut + ciftiFile->getNumberOfColumns());
+    QMutexLocker locker(&m_mutex);
+    addEntry(key,
+             data);
+}
+
+/**
+ * Request that rows are read into the cache in the background.  Any
+ * requests for the file that have not started are discarded.
+ * @param ciftiFile
+ *    The CIFTI file.
+ * @param rowIndices
+ *    Indices of the rows, the first ones are read first.
+ */
+void
+CiftiRowCache::prefetchRows(const CiftiFile* ciftiFile,
+                            const std::vector<int64_t>& rowIndices)
+{
+    if ( ! isCacheable(ciftiFile)) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    m_pendingPrefetch.erase(std::remove_if(m_pendingPrefetch.begin(),
+                                           m_pendingPrefetch.end(),
+                                           [ciftiFile](const Key& k) { return (k.m_ciftiFile == ciftiFile); }),
+                            m_pendingPrefetch.end());
+
+    const int64_t numberOfRows(ciftiFile->getNumberOfRows());
+    const int64_t rowBytes(ciftiFile->getNumberOfColumns() * sizeof(float));
+    int64_t bytesRequested(0);
+    for (const int64_t rowIndex : rowIndices) {
+        if ((rowIndex < 0)
+            || (rowIndex >= numberOfRows)) {
+            continue;
+        }
+        /*
+         * Requesting more than half of the cache would evict
+         * the rows just prefetched and the rows recently used
+         */
+        bytesRequested += rowBytes;
+        if (bytesRequested > (m_maximumBytes / 2)) {
+            break;
+        }
+        const Key key(ciftiFile,
+                      rowIndex);
+        if (m_entries.find(key) != m_entries.end()) {
+            continue;
+        }
+        if (m_prefetchReadActive
+            && (m_prefetchReadKey == key)) {
+            continue;
+        }
+        if (std::find(m_pendingPrefetch.begin(),
+                      m_pendingPrefetch.end(),
+                      key) != m_pendingPrefetch.end()) {
+            continue;
+        }
+        m_pendingPrefetch.push_back(key);
+    }
+
+    if (( ! m_prefetchTaskActive)
+        && ( ! m_pendingPrefetch.empty())) {
+        m_prefetchTaskActive = true;
+        PrefetchTask* task = new PrefetchTask(this);
+        task->setAutoDelete(true);
+        QThreadPool::globalInstance()->start(task);
+    }
+}
+
+/**
+ * Read pending prefetch rows until there are none.  Runs in a thread pool thread.
+ */
+void
+CiftiRowCache::runPrefetchTask()
+{
+    QMutexLocker locker(&m_mutex);
+    while ( ! m_pendingPrefetch.empty()) {
+        const Key key = m_pendingPrefetch.front();
+        m_pendingPrefetch.pop_front();
+        m_prefetchReadKey    = key;
+        m_prefetchReadActive = true;
+
+        /*
+         * The file cannot be removed while it is being read
+         * since removeFile() waits for the read to finish
+         */
+        locker.unlock();
+        std::vector<float> data;
+        bool validFlag(false);
+        try {
+            data.resize(key.m_ciftiFile->getNumberOfColumns());
+            key.m_ciftiFile->getRow(data.data(),
+                                    key.m_rowIndex);
+            validFlag = true;
+        }
+        catch (const std::exception& e) {
+            /* the read will be tried again if the row is selected, and the error reported then */
+            CaretLogFine("Prefetch of CIFTI row failed: "
+                         + AString(e.what()));
+        }
+        locker.relock();
+
+        m_prefetchReadActive = false;
+        if (validFlag) {
+            addEntry(key,
+                     data);
+        }
+        m_readFinishedCondition.wakeAll();
+    }
+    m_prefetchTaskActive = false;
+}
+
+/**
+ * Remove all rows for the given file, and cancel its prefetch requests.
+ * Waits if the prefetch task is reading from the file.
+ * @param ciftiFile
+ *    The CIFTI file.
+ */
+void
+CiftiRowCache::removeFile(const CiftiFile* ciftiFile)
+{
+    if (ciftiFile == NULL) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_pendingPrefetch.erase(std::remove_if(m_pendingPrefetch.begin(),
+                                           m_pendingPrefetch.end(),
+                                           [ciftiFile](const Key& k) { return (k.m_ciftiFile == ciftiFile); }),
+                            m_pendingPrefetch.end());
+    while (m_prefetchReadActive
+           && (m_prefetchReadKey.m_ciftiFile == ciftiFile)) {
+        m_readFinishedCondition.wait(&m_mutex);
+    }
+
+    std::map<Key, Entry>::iterator iter = m_entries.lower_bound(Key(ciftiFile,
+                                                                    std::numeric_limits<int64_t>::min()));
+    while ((iter != m_entries.end())
+           && (iter->first.m_ciftiFile == ciftiFile)) {
+        std::map<Key, Entry>::iterator removeIter = iter;
+        ++iter;
+        removeEntry(removeIter);
+    }
+}
+
+/**
+ * @return Maximum size of the cached rows, in bytes.
+ */
+int64_t
+CiftiRowCache::getMaximumBytes() const
+{
+    return m_maximumBytes;
+}
+
+/**
+ * Set the maximum size of the cached rows, in bytes.
+ * @param maximumBytes
+ *    New maximum size.
+ */
+void
+CiftiRowCache::setMaximumBytes(const int64_t maximumBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumBytes = std::max(maximumBytes,
+                              (int64_t)0);
+    removeExcessEntries();
+}
+
+/**
+ * Add a row to the cache as the most recently used.  Mutex must be locked.
+ * @param key
+ *    Key of the row.
+ * @param data
+ *    Data of the row, contents are taken.
+ */
+void
+CiftiRowCache::addEntry(const Key& key,
+                        std::vector<float>& data)
+{
+    const int64_t entryBytes(data.size() * sizeof(float));
+    if (entryBytes > m_maximumBytes) {
+        return;
+    }
+    std::map<Key, Entry>::iterator iter = m_entries.find(key);
+    if (iter != m_entries.end()) {
+        removeEntry(iter);
+    }
+    m_leastRecentlyUsed.push_front(key);
+    Entry& entry = m_entries[key];
+    entry.m_data.swap(data);
+    entry.m_lruIterator = m_leastRecentlyUsed.begin();
+    m_numberOfBytes += entryBytes;
+    removeExcessEntries();
+}
+
+/**
+ * Remove a row from the cache.  Mutex must be locked.
+ * @param iter
+ *    Iterator to the row.
+ */
+void
+CiftiRowCache::removeEntry(std::map<Key, Entry>::iterator iter)
+{
+    m_numberOfBytes -= (iter->second.m_data.size() * sizeof(float));
+    m_leastRecentlyUsed.erase(iter->second.m_lruIterator);
+    m_entries.erase(iter);
+}
+
+/**
+ * Remove least recently used rows until the cache is within its size.  Mutex must be locked.
+ */
+void
+CiftiRowCache::removeExcessEntries()
+{
+    while ((m_numberOfBytes > m_maximumBytes)
+           && ( ! m_leastRecentlyUsed.empty())) {
+        std::map<Key, Entry>::iterator iter = m_entries.find(m_leastRecentlyUsed.back());
+        CaretAssert(iter != m_entries.end());
+        removeEntry(iter);
+    }
+}
+
@@ -0,0 +1,146 @@
+#ifndef __CIFTI_ROW_CACHE_H__
+#define __CIFTI_ROW_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "CaretObject.h"
+
+namespace caret {
+
+    class CiftiFile;
+
+    class CiftiRowCache : public CaretObject {
+
+    public:
+        static CiftiRowCache* get();
+
+        static bool isCacheable(const CiftiFile* ciftiFile);
+
+        void getRow(const CiftiFile* ciftiFile,
+                    const int64_t rowIndex,
+                    float* dataOut);
+
+        void prefetchRows(const CiftiFile* ciftiFile,
+                          const std::vector<int64_t>& rowIndices);
+
+        void removeFile(const CiftiFile* ciftiFile);
+
+        int64_t getMaximumBytes() const;
+
+        void setMaximumBytes(const int64_t maximumBytes);
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        class Key {
+        public:
+            Key(const CiftiFile* ciftiFile,
+                const int64_t rowIndex)
+            : m_ciftiFile(ciftiFile),
+            m_rowIndex(rowIndex) { }
+
+            bool operator<(const Key& rhs) const {
+                if (m_ciftiFile != rhs.m_ciftiFile) {
+                    return (m_ciftiFile < rhs.m_ciftiFile);
+                }
+                return (m_rowIndex < rhs.m_rowIndex);
+            }
+
+            bool operator==(const Key& rhs) const {
+                return ((m_ciftiFile == rhs.m_ciftiFile)
+                        && (m_rowIndex == rhs.m_rowIndex));
+            }
+
+            const CiftiFile* m_ciftiFile;
+
+            int64_t m_rowIndex;
+        };
+
+        class Entry {
+        public:
+            std::vector<float> m_data;
+
+            /** Position in the least recently used list */
+            std::list<Key>::iterator m_lruIterator;
+        };
+
+        class PrefetchTask;
+
+        CiftiRowCache();
+
+        virtual ~CiftiRowCache();
+
+        CiftiRowCache(const CiftiRowCache&);
+
+        CiftiRowCache& operator=(const CiftiRowCache&);
+
+        void runPrefetchTask();
+
+        void addEntry(const Key& key,
+                      std::vector<float>& data);
+
+        void removeEntry(std::map<Key, Entry>::iterator iter);
+
+        void removeExcessEntries();
+
+        /** Protects all members, never held while reading from a file */
+        QMutex m_mutex;
+
+        /** Signaled when the prefetch task finishes reading a row */
+        QWaitCondition m_readFinishedCondition;
+
+        std::map<Key, Entry> m_entries;
+
+        /** Most recently used at front */
+        std::list<Key> m_leastRecentlyUsed;
+
+        /** Rows waiting to be read by the prefetch task */
+        std::deque<Key> m_pendingPrefetch;
+
+        /** Row being read by the prefetch task, valid when m_prefetchReadActive is true */
+        Key m_prefetchReadKey;
+
+        bool m_prefetchReadActive;
+
+        bool m_prefetchTaskActive;
+
+        int64_t m_numberOfBytes;
+
+        int64_t m_maximumBytes;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __CIFTI_ROW_CACHE_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __CIFTI_ROW_CACHE_DECLARE__
+
+} // namespace
+#endif  //__CIFTI_ROW_CACHE_H__
@@ -53,6 +53,7 @@ ConnectivityCorrelationSettings::ConnectivityCorrelationSettings()
     m_mode = ConnectivityCorrelationModeEnum::CORRELATION;
     m_correlationFisherZEnabled  = false;
     m_correlationNoDemeanEnabled = false;
+    m_reducedMemoryAveragingEnabled = false;
     m_sceneAssistant = std::unique_ptr<SceneClassAssistant>(new SceneClassAssistant());
     m_sceneAssistant->add<ConnectivityCorrelationModeEnum, ConnectivityCorrelationModeEnum::Enum>("m_mode",
                                                                                                   &m_mode);
@@ -60,6 +61,8 @@ ConnectivityCorrelationSettings::ConnectivityCorrelationSettings()
                           &m_correlationFisherZEnabled);
     m_sceneAssistant->add("m_correlationNoDemeanEnabled",
                           &m_correlationNoDemeanEnabled);
+    m_sceneAssistant->add("m_reducedMemoryAveragingEnabled",
+                          &m_reducedMemoryAveragingEnabled);
 }
 
 /**
@@ -108,6 +111,7 @@ ConnectivityCorrelationSettings::copyHelperConnectivityCorrelationSettings(const
     m_mode                       = obj.m_mode;
     m_correlationFisherZEnabled  = obj.m_correlationFisherZEnabled;
     m_correlationNoDemeanEnabled = obj.m_correlationNoDemeanEnabled;
+    m_reducedMemoryAveragingEnabled = obj.m_reducedMemoryAveragingEnabled;
 }
 
 /**
@@ -127,6 +131,7 @@ ConnectivityCorrelationSettings::operator==(const ConnectivityCorrelationSetting
     if (m_mode                       != obj.m_mode) return false;
     if (m_correlationFisherZEnabled  != obj.m_correlationFisherZEnabled) return false;
     if (m_correlationNoDemeanEnabled != obj.m_correlationNoDemeanEnabled) return false;
+    if (m_reducedMemoryAveragingEnabled != obj.m_reducedMemoryAveragingEnabled) return false;
 
     return true;
 }
@@ -204,6 +209,28 @@ ConnectivityCorrelationSettings::setCorrelationNoDemeanEnabled(const bool enable
     m_correlationNoDemeanEnabled = enabled;
 }
 
+/**
+ * @return Is reduced memory averaging enabled.  When enabled and the data is
+ * very large, averages over several data sets use a copy of the data with 8-bit
+ * values, which uses less memory but is less accurate.
+ */
+bool
+ConnectivityCorrelationSettings::isReducedMemoryAveragingEnabled() const
+{
+    return m_reducedMemoryAveragingEnabled;
+}
+
+/**
+ * Set reduced memory averaging enabled
+ * @param enabled
+ *    New status
+ */
+void
+ConnectivityCorrelationSettings::setReducedMemoryAveragingEnabled(const bool enabled)
+{
+    m_reducedMemoryAveragingEnabled = enabled;
+}
+
 /**
  * Get a description of this object's content.
  * @return String describing this object's content.
@@ -65,6 +65,10 @@ namespace caret {
         
         void setCorrelationNoDemeanEnabled(const bool enabled);
         
+        bool isReducedMemoryAveragingEnabled() const;
+        
+        void setReducedMemoryAveragingEnabled(const bool enabled);
+        
         // ADD_NEW_METHODS_HERE
 
         virtual AString toString() const;
@@ -101,6 +105,8 @@ namespace caret {
         
         bool m_correlationNoDemeanEnabled = false;
         
+        bool m_reducedMemoryAveragingEnabled = false;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
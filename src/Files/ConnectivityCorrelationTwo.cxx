@@ -240,6 +240,22 @@ ConnectivityCorrelationTwo::computeAverageForDataSetIndices(const std::vector<in
         return;
     }
 
+    if (dataSetIndices.size() > 1) {
+        /*
+         * Normalizing all of the data takes about as long as one
+         * correlation map, so it is only worth it for several indices.
+         * There is no normalized data when it is too large for a float
+         * copy and reduced memory averaging is not enabled.
+         */
+        const NormalizedData* normalizedData(getNormalizedData());
+        if (normalizedData != NULL) {
+            computeAverageWithNormalizedData(*normalizedData,
+                                             dataSetIndices,
+                                             dataOut);
+            return;
+        }
+    }
+    
     /*
      * Note: OpenMP is not used here.
      * OpenMP is used in 'computeForDataSet()'
@@ -416,6 +432,275 @@ ConnectivityCorrelationTwo::computeForDataSets(const DataSet& a,
     return value;
 }
 
+/**
+ * @return The normalized copy of the data sets, created if it does not yet exist.
+ * NULL if a float copy is too large and reduced memory averaging is not enabled.
+ */
+const ConnectivityCorrelationTwo::NormalizedData*
+ConnectivityCorrelationTwo::getNormalizedData() const
+{
+    std::lock_guard<std::mutex> locker(m_normalizedDataMutex);
+    if (m_normalizedData) {
+        return m_normalizedData.get();
+    }
+    
+    std::unique_ptr<NormalizedData> normalizedData(new NormalizedData());
+    const int64_t rowStride(((m_numberOfDataElements + NormalizedData::PAD_ELEMENTS - 1)
+                             / NormalizedData::PAD_ELEMENTS) * NormalizedData::PAD_ELEMENTS);
+    normalizedData->m_rowStride = rowStride;
+    const bool quantizeFlag((m_numberOfDataSets * rowStride * static_cast<int64_t>(sizeof(float)))
+                            > s_maximumNormalizedDataBytes);
+    if (quantizeFlag) {
+        if ( ! m_settings.isReducedMemoryAveragingEnabled()) {
+            return NULL;
+        }
+        normalizedData->m_quantizedValues.resize(m_numberOfDataSets * rowStride, 0);
+        normalizedData->m_quantizedScales.resize(m_numberOfDataSets, 0.0);
+        CaretLogInfo("Reduced memory averaging is enabled, using 8-bit normalized data "
+                     "(less accurate) for averaging connectivity of "
+                     + m_ownerName);
+    }
+    else {
+        normalizedData->m_values.resize(m_numberOfDataSets * rowStride, 0.0);
+    }
+    
+    bool correlationModeFlag(false);
+    switch (m_settings.getMode()) {
+        case ConnectivityCorrelationModeEnum::CORRELATION:
+            correlationModeFlag = true;
+            break;
+        case ConnectivityCorrelationModeEnum::COVARIANCE:
+            break;
+    }
+    /* covariance always removes the mean */
+    const bool demeanFlag( ! (correlationModeFlag
+                              && m_settings.isCorrelationNoDemeanEnabled()));
+    
+#pragma omp CARET_PAR
+    {
+        std::vector<float> row(rowStride, 0.0);
+#pragma omp CARET_FOR schedule(dynamic, 64)
+        for (int64_t i = 0; i < m_numberOfDataSets; i++) {
+            const DataSet* dataSet(m_dataSets[i]);
+            CaretAssert(dataSet);
+            double mean(0.0);
+            if (demeanFlag) {
+                for (int64_t j = 0; j < m_numberOfDataElements; j++) {
+                    mean += dataSet->get(j);
+                }
+                mean /= m_numberOfDataElements;
+            }
+            double sumSQ(0.0);
+            for (int64_t j = 0; j < m_numberOfDataElements; j++) {
+                const double d(dataSet->get(j) - mean);
+                sumSQ += (d * d);
+            }
+            double scale(1.0 / std::sqrt(static_cast<double>(m_numberOfDataElements)));
+            if (correlationModeFlag) {
+                /* rows without variance correlate as zero, same as computeForDataSets() */
+                scale = ((sumSQ > 0.0)
+                         ? (1.0 / std::sqrt(sumSQ))
+                         : 0.0);
+            }
+            float maxAbs(0.0);
+            for (int64_t j = 0; j < m_numberOfDataElements; j++) {
+                row[j] = (dataSet->get(j) - mean) * scale;
+                maxAbs = std::max(maxAbs, std::fabs(row[j]));
+            }
+            if (quantizeFlag) {
+                int8_t* quantizedRow(normalizedData->m_quantizedValues.data() + i * rowStride);
+                if (maxAbs > 0.0) {
+                    const float quantizeScale(maxAbs / 127.0f);
+                    for (int64_t j = 0; j < m_numberOfDataElements; j++) {
+                        quantizedRow[j] = static_cast<int8_t>(std::lround(row[j] / quantizeScale));
+                    }
+                    normalizedData->m_quantizedScales[i] = quantizeScale;
+                }
+            }
+            else {
+                std::copy(row.begin(),
+                          row.begin() + m_numberOfDataElements,
+                          normalizedData->m_values.begin() + i * rowStride);
+            }
+        }
+    }
+    
+    if (quantizeFlag) {
+        /*
+         * Each row was normalized in a per-thread buffer, so only the
+         * quantized rows are kept, make sure no float copy remains
+         */
+        std::vector<float>().swap(normalizedData->m_values);
+    }
+    
+    m_normalizedData = std::move(normalizedData);
+    return m_normalizedData.get();
+}
+
+/**
+ * Get a row of normalized data as floats
+ * @param rowIndex
+ *    Index of the row
+ * @param rowOut
+ *    Output with the row, must have room for m_rowStride elements (padding is zero)
+ */
+void
+ConnectivityCorrelationTwo::NormalizedData::getRow(const int64_t rowIndex,
+                                                   float* rowOut) const
+{
+    if (isQuantized()) {
+        const int8_t* quantizedRow(m_quantizedValues.data() + rowIndex * m_rowStride);
+        const float scale(m_quantizedScales[rowIndex]);
+        for (int64_t j = 0; j < m_rowStride; j++) {
+            rowOut[j] = quantizedRow[j] * scale;
+        }
+    }
+    else {
+        const float* row(m_values.data() + rowIndex * m_rowStride);
+        std::copy(row,
+                  row + m_rowStride,
+                  rowOut);
+    }
+}
+
+/**
+ * Dot product of a row of normalized data with a vector
+ * @param rowIndex
+ *    Index of the row
+ * @param vec
+ *    The vector, must have m_rowStride elements
+ * @return
+ *    The dot product
+ */
+float
+ConnectivityCorrelationTwo::NormalizedData::dotRow(const int64_t rowIndex,
+                                                   const float* vec) const
+{
+    /*
+     * Separate sums for each of 8 lanes, since the padded rows have a multiple of 8
+     * elements, this lets the compiler vectorize without reordering a single sum
+     */
+    float lanes[8] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    if (isQuantized()) {
+        const int8_t* quantizedRow(m_quantizedValues.data() + rowIndex * m_rowStride);
+        for (int64_t j = 0; j < m_rowStride; j += 8) {
+            for (int32_t k = 0; k < 8; k++) {
+                lanes[k] += quantizedRow[j + k] * vec[j + k];
+            }
+        }
+    }
+    else {
+        const float* row(m_values.data() + rowIndex * m_rowStride);
+        for (int64_t j = 0; j < m_rowStride; j += 8) {
+            for (int32_t k = 0; k < 8; k++) {
+                lanes[k] += row[j + k] * vec[j + k];
+            }
+        }
+    }
+    const float sum((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])
+                    + (lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    return (isQuantized()
+            ? sum * m_quantizedScales[rowIndex]
+            : sum);
+}
+
+/**
+ * Compute the average correlation/covariance for the given data set indices using the
+ * normalized data.  For correlation, each value is clamped (or transformed by Fisher-Z)
+ * before it is added to the average, same as computeForDataSet(), so the selected rows
+ * are processed in batches, with each row of the normalized data read once per batch.
+ * Covariance is linear and not clamped, so the average of the dot products is the dot
+ * product with the average of the selected rows, a single matrix-vector product.
+ * @param normalizedData
+ *    The normalized data
+ * @param dataSetIndices
+ *    Indices of the data sets
+ * @param dataOut
+ *    Output with computed data, already sized to the number of data sets.
+ */
+void
+ConnectivityCorrelationTwo::computeAverageWithNormalizedData(const NormalizedData& normalizedData,
+                                                             const std::vector<int64_t>& dataSetIndices,
+                                                             std::vector<float>& dataOut) const
+{
+    const int64_t rowStride(normalizedData.m_rowStride);
+    const int64_t numIndices(dataSetIndices.size());
+    const double numIndicesFloat(numIndices);
+    
+    bool correlationModeFlag(false);
+    switch (m_settings.getMode()) {
+        case ConnectivityCorrelationModeEnum::CORRELATION:
+            correlationModeFlag = true;
+            break;
+        case ConnectivityCorrelationModeEnum::COVARIANCE:
+            break;
+    }
+    
+    if (correlationModeFlag) {
+        const bool fisherZFlag(m_settings.isCorrelationFisherZEnabled());
+        const int64_t BATCH_SIZE(16);
+        std::vector<float> batchRows(BATCH_SIZE * rowStride);
+        std::vector<double> sum(m_numberOfDataSets, 0.0);
+        for (int64_t batchStart = 0; batchStart < numIndices; batchStart += BATCH_SIZE) {
+            const int64_t batchCount(std::min(BATCH_SIZE, numIndices - batchStart));
+            for (int64_t b = 0; b < batchCount; b++) {
+                CaretAssertVectorIndex(m_dataSets,
+                                       dataSetIndices[batchStart + b]);
+                normalizedData.getRow(dataSetIndices[batchStart + b],
+                                      batchRows.data() + b * rowStride);
+            }
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+            for (int64_t i = 0; i < m_numberOfDataSets; i++) {
+                for (int64_t b = 0; b < batchCount; b++) {
+                    if (i == dataSetIndices[batchStart + b]) {
+                        /* same as computeForDataSet(), 'self' is exactly 1.0 and not transformed */
+                        sum[i] += 1.0;
+                        continue;
+                    }
+                    float value(normalizedData.dotRow(i,
+                                                      batchRows.data() + b * rowStride));
+                    if (fisherZFlag) {
+                        if (value > 0.999999) value = 0.999999;   /*prevent inf */
+                        if (value < -0.999999) value = -0.999999; /*prevent -inf*/
+                        value = 0.5 * std::log((1 + value) / (1 - value));
+                    }
+                    else {
+                        if (value > 1.0) value = 1.0; /*don't output anything silly*/
+                        if (value < -1.0) value = -1.0;
+                    }
+                    sum[i] += value;
+                }
+            }
+        }
+        for (int64_t i = 0; i < m_numberOfDataSets; i++) {
+            dataOut[i] = sum[i] / numIndicesFloat;
+        }
+        return;
+    }
+    
+    std::vector<float> row(rowStride);
+    std::vector<double> rowSum(rowStride, 0.0);
+    for (int64_t index : dataSetIndices) {
+        CaretAssertVectorIndex(m_dataSets,
+                               index);
+        normalizedData.getRow(index,
+                              row.data());
+        for (int64_t j = 0; j < rowStride; j++) {
+            rowSum[j] += row[j];
+        }
+    }
+    std::vector<float> meanRow(rowStride);
+    for (int64_t j = 0; j < rowStride; j++) {
+        meanRow[j] = rowSum[j] / numIndicesFloat;
+    }
+    
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < m_numberOfDataSets; i++) {
+        dataOut[i] = normalizedData.dotRow(i,
+                                           meanRow.data());
+    }
+}
+
 void
 ConnectivityCorrelationTwo::printDebugData()
 {
@@ -21,6 +21,8 @@
  */
 /*LICENSE_END*/
 
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "CaretAssert.h"
@@ -87,6 +89,34 @@ namespace caret {
             const float   m_sqrtSumSquared;
         };
         
+        /**
+         * Copy of all data sets, each "row" transformed so that the dot product of two rows is their
+         * correlation (demeaned, unit length) or covariance (demeaned, scaled by 1/sqrt(N)).
+         * Rows are padded with zeros to a multiple of PAD_ELEMENTS.  When the float copy
+         * would be too large and reduced memory averaging is enabled in the settings,
+         * the rows are stored quantized to 8-bit integers with a scale per row.
+         */
+        class NormalizedData {
+        public:
+            static const int64_t PAD_ELEMENTS = 16;
+            
+            bool isQuantized() const { return ! m_quantizedValues.empty(); }
+            
+            void getRow(const int64_t rowIndex,
+                        float* rowOut) const;
+            
+            float dotRow(const int64_t rowIndex,
+                         const float* vec) const;
+            
+            int64_t m_rowStride = 0;
+            
+            std::vector<float> m_values;
+            
+            std::vector<int8_t> m_quantizedValues;
+            
+            std::vector<float> m_quantizedScales;
+        };
+        
         ConnectivityCorrelationTwo(const AString& ownerName,
                                    const ConnectivityCorrelationSettings& settings,
                                    const std::vector<const float*>& dataSetPointers,
@@ -99,6 +129,12 @@ namespace caret {
         float computeForDataSets(const DataSet& a,
                                  const DataSet& b) const;
         
+        const NormalizedData* getNormalizedData() const;
+        
+        void computeAverageWithNormalizedData(const NormalizedData& normalizedData,
+                                              const std::vector<int64_t>& dataSetIndices,
+                                              std::vector<float>& dataOut) const;
+        
         void computeMeanAndSumSquared(const float* dataPtr,
                                       const int64_t numberOfDataElements,
                                       const int64_t dataStride,
@@ -121,12 +157,20 @@ namespace caret {
         
         bool m_debugFlag = false;
         
+        /** Created the first time an average over several data sets is requested */
+        mutable std::unique_ptr<NormalizedData> m_normalizedData;
+        
+        mutable std::mutex m_normalizedDataMutex;
+        
+        /** Above this size, the normalized data is stored quantized (if enabled) or not created */
+        static const int64_t s_maximumNormalizedDataBytes;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
     
 #ifdef __CONNECTIVITY_CORRELATION_TWO_DECLARE__
-    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    const int64_t ConnectivityCorrelationTwo::s_maximumNormalizedDataBytes = ((int64_t)4) << 30;
 #endif // __CONNECTIVITY_CORRELATION_TWO_DECLARE__
 
 } // namespace
@@ -29,6 +29,7 @@
 
 #include <QImage>
 #include <QImageWriter>
+#include <QMutexLocker>
 
 #include "BackgroundAndForegroundColors.h"
 #include "BoundingBox.h"
@@ -37,6 +38,7 @@
 #include "CaretPreferences.h"
 #include "CziImage.h"
 #include "CziImageLoaderMultiResolution.h"
+#include "CziImageTileCache.h"
 #include "CziUtilities.h"
 #include "DataFileContentInformation.h"
 #include "DataFileException.h"
@@ -100,6 +102,11 @@ CziImageFile::CziImageFile()
 CziImageFile::~CziImageFile()
 {
     EventManager::get()->removeAllEventsFromListener(this);
+    
+    if (m_reader) {
+        /* Waits if a tile is being read from this file */
+        CziImageTileCache::get()->removeFile(this);
+    }
 }
 
 /**
@@ -122,6 +129,11 @@ CziImageFile::resetPrivate()
         m_maximumImageDimension = 2048;
     }
 
+    if (m_reader) {
+        /* Waits if a tile is being read from this file */
+        CziImageTileCache::get()->removeFile(this);
+    }
+    
     m_allFramesPyramidInfo = CziSceneInfo();
     m_cziScenePyramidInfos.clear();
     m_scalingTileAccessor.reset();
@@ -873,16 +885,6 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
         return NULL;
     }
     
-    libCZI::CDimCoordinate coordinate;
-    coordinate.Set(libCZI::DimensionIndex::C, 0);
-    
-    const std::array<float, 3> prefBackRGB = getPreferencesImageBackgroundFloatRGB();
-    libCZI::ISingleChannelScalingTileAccessor::Options scstaOptions;
-    scstaOptions.Clear();
-    scstaOptions.backGroundColor.r = prefBackRGB[0];
-    scstaOptions.backGroundColor.g = prefBackRGB[1];
-    scstaOptions.backGroundColor.b = prefBackRGB[2];
-    
     float zoomToRead(1.0);
     QRectF regionOfInterest(regionOfInterestIn);
     
@@ -908,15 +910,100 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
         zoomToRead = newZoom;
     }
     
-    /*
-     * Read into 24 bit RGB to avoid conversion from other pixel formats
-     */
     if (cziDebugFlag) {
         std::cout << "----------------------" << std::endl;
         std::cout << "READING IMAGE with ROI: " << CziUtilities::qRectToString(regionOfInterest) << std::endl;
     }
-    const libCZI::PixelType pixelType(libCZI::PixelType::Bgr24);
     const libCZI::IntRect intRectROI = CziUtilities::qRectToIntRect(regionOfInterest);
+    std::shared_ptr<libCZI::IBitmapData> bitmapDataRead(readBitmapDataFromCziImageFile(channelIndex,
+                                                                                       intRectROI,
+                                                                                       zoomToRead,
+                                                                                       getPreferencesImageBackgroundFloatRGB(),
+                                                                                       errorMessageOut));
+    if ( ! bitmapDataRead) {
+        return NULL;
+    }
+    
+    const bool removeGrayFlag(false);
+    if (removeGrayFlag) {
+        uint8_t backRGB[3] = { 0, 0, 0 };
+        makeWhiteGrayBackgroundColor(bitmapDataRead,
+                                     backRGB);
+    }
+    
+    CziImage* cziImageOut(NULL);
+    
+    switch (imageDataFormat) {
+        case ImageDataFormat::CZI_BITMAP:
+            cziImageOut = new CziImage(this,
+                                       imageName,
+                                       bitmapDataRead,
+                                       frameRegionOfInterest,
+                                       CziUtilities::intRectToQRect(intRectROI));
+            break;
+        case ImageDataFormat::Q_IMAGE:
+        {
+            QImage* qImage = createQImageFromBitmapData(QImagePixelFormat::RGBA,
+                                                        bitmapDataRead.get(),
+                                                        errorMessageOut);
+            if (qImage == NULL) {
+                return NULL;
+            }
+            
+            cziImageOut = new CziImage(this,
+                                       imageName,
+                                       qImage,
+                                       frameRegionOfInterest,
+                                       CziUtilities::intRectToQRect(intRectROI));
+        }
+            break;
+    }
+    return cziImageOut;
+}
+
+/**
+ * Read the specified region from the CZI file at the given zoom.  May be called from
+ * any thread, reading is serialized with other reads from this file.
+ * @param channelIndex
+ *    Index of channel.  Use Zero for all channels.  This parameter is ignored if there
+ *    is only one channel in the file.
+ * @param regionOfInterest
+ *    Region of interest to read from file.  Origin is in top left.
+ * @param zoom
+ *    Zoom for reading, the output image is the region's size multiplied by the zoom
+ * @param backgroundRGB
+ *    Color for regions without image data, passed in since preferences are only
+ *    accessed from the GUI thread
+ * @param errorMessageOut
+ *    Contains information about any errors
+ * @return
+ *    Bitmap data in Bgr24 format or invalid pointer if there is an error.
+ */
+std::shared_ptr<libCZI::IBitmapData>
+CziImageFile::readBitmapDataFromCziImageFile(const int32_t channelIndex,
+                                             const libCZI::IntRect& regionOfInterest,
+                                             const float zoom,
+                                             const std::array<float, 3>& backgroundRGB,
+                                             AString& errorMessageOut)
+{
+    errorMessageOut.clear();
+    
+    QMutexLocker locker(&m_readMutex);
+    
+    libCZI::CDimCoordinate coordinate;
+    coordinate.Set(libCZI::DimensionIndex::C, 0);
+    
+    libCZI::ISingleChannelScalingTileAccessor::Options scstaOptions;
+    scstaOptions.Clear();
+    scstaOptions.backGroundColor.r = backgroundRGB[0];
+    scstaOptions.backGroundColor.g = backgroundRGB[1];
+    scstaOptions.backGroundColor.b = backgroundRGB[2];
+    
+    /*
+     * Read into 24 bit RGB to avoid conversion from other pixel formats
+     */
+    const libCZI::PixelType pixelType(libCZI::PixelType::Bgr24);
+    const libCZI::IntRect& intRectROI(regionOfInterest);
     CaretAssert(m_scalingTileAccessor);
     
     std::shared_ptr<libCZI::IBitmapData> bitmapDataRead;
@@ -957,7 +1044,7 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
             libCZI::CDimCoordinate planeCoord{ { libCZI::DimensionIndex::C, chIdx } };
             actvChBms.emplace_back(m_scalingTileAccessor->Get(intRectROI,
                                                               &planeCoord,
-                                                              zoomToRead,
+                                                              zoom,
                                                               nullptr));
             activeChNoToChIdx[chIdx] = index++;
             return true;
@@ -1000,7 +1087,7 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
                                    + AString::number(channelIndex)
                                    + ", Valid range is 0 to "
                                    + AString::number(numberOfChannels - 1));
-                return NULL;
+                return bitmapDataRead;
             }
         }
     }
@@ -1008,51 +1095,16 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
         bitmapDataRead = m_scalingTileAccessor->Get(pixelType,
                                                     intRectROI,
                                                     &coordinate,
-                                                    zoomToRead,
+                                                    zoom,
                                                     &scstaOptions);
     }
 
     if ( ! bitmapDataRead) {
         errorMessageOut = ("Failed to read data for region "
                            + CziUtilities::intRectToString(intRectROI));
-        return NULL;
     }
     
-    const bool removeGrayFlag(false);
-    if (removeGrayFlag) {
-        uint8_t backRGB[3] = { 0, 0, 0 };
-        makeWhiteGrayBackgroundColor(bitmapDataRead,
-                                     backRGB);
-    }
-    
-    CziImage* cziImageOut(NULL);
-    
-    switch (imageDataFormat) {
-        case ImageDataFormat::CZI_BITMAP:
-            cziImageOut = new CziImage(this,
-                                       imageName,
-                                       bitmapDataRead,
-                                       frameRegionOfInterest,
-                                       CziUtilities::intRectToQRect(intRectROI));
-            break;
-        case ImageDataFormat::Q_IMAGE:
-        {
-            QImage* qImage = createQImageFromBitmapData(QImagePixelFormat::RGBA,
-                                                        bitmapDataRead.get(),
-                                                        errorMessageOut);
-            if (qImage == NULL) {
-                return NULL;
-            }
-            
-            cziImageOut = new CziImage(this,
-                                       imageName,
-                                       qImage,
-                                       frameRegionOfInterest,
-                                       CziUtilities::intRectToQRect(intRectROI));
-        }
-            break;
-    }
-    return cziImageOut;
+    return bitmapDataRead;
 }
 
 void
@@ -1224,6 +1276,7 @@ CziImageFile::readFramePyramidLayerFromCziImageFile(const AString& imageName,
     const libCZI::IntRect rectToReadROI = CziUtilities::qRectToIntRect(rectangleForReadingRect);
     std::shared_ptr<libCZI::IBitmapData> bitmapData;
     try {
+        QMutexLocker locker(&m_readMutex);
         bitmapData = m_pyramidLayerTileAccessor->Get(pixelType,
                                                      rectToReadROI,
                                                      iDimCoord,
@@ -2172,6 +2225,7 @@ CziImageFile::getPixelRGBA(const int32_t tabIndex,
 
     const bool readFromFileFlag(true);
     if (readFromFileFlag) {
+        QMutexLocker locker(&m_readMutex);
         bool useScalingTileAccessorFlag(true);
         bool useSingleChannelAccessorFlag(false); /* fails if type is Gray16 */
         if (useScalingTileAccessorFlag) {
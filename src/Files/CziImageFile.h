@@ -25,6 +25,7 @@
 #include <array>
 #include <memory>
 
+#include <QMutex>
 #include <QRectF>
 
 #include "BrainConstants.h"
@@ -383,6 +384,12 @@ namespace caret {
                                        const int64_t outputImageWidthHeightMaximum,
                                        AString& errorMessageOut);
         
+        std::shared_ptr<libCZI::IBitmapData> readBitmapDataFromCziImageFile(const int32_t channelIndex,
+                                                                            const libCZI::IntRect& regionOfInterest,
+                                                                            const float zoom,
+                                                                            const std::array<float, 3>& backgroundRGB,
+                                                                            AString& errorMessageOut);
+        
         enum class QImagePixelFormat {
             RGB,
             RGBA
@@ -441,6 +448,12 @@ namespace caret {
         
         std::shared_ptr<libCZI::IDisplaySettings> m_displaySettings;
         
+        /**
+         * The stream seeks and reads, so reading image data from the GUI thread and
+         * from CziImageTileCache's background task must not overlap
+         */
+        mutable QMutex m_readMutex;
+        
         CziSceneInfo m_allFramesPyramidInfo;
         
         std::vector<CziSceneInfo> m_cziScenePyramidInfos;
@@ -473,6 +486,7 @@ namespace caret {
 
         friend class CziImage;
         friend class CziImageLoaderMultiResolution;
+        friend class CziImageTileCache;
         
     };
     
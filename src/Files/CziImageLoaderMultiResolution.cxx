@@ -29,6 +29,7 @@
 #include "CaretLogger.h"
 #include "CziImage.h"
 #include "CziImageFile.h"
+#include "CziImageTileCache.h"
 #include "CziUtilities.h"
 #include "ElapsedTimer.h"
 #include "GraphicsObjectToWindowTransform.h"
@@ -164,6 +165,16 @@ CziImageLoaderMultiResolution::updateImage(const CziImage* cziImage,
         m_reloadImageFlag = true;
     }
     
+    if (isTileImageUpdateNeeded()) {
+        /*
+         * Tiles have loaded since the image was created so create the image
+         * again even though the region is unchanged
+         */
+        m_forceImageReloadFlag = true;
+        m_reloadImageFlag = true;
+        if (cziDebugFlag) std::cout << "Reload image due to tiles loaded" << std::endl;
+    }
+    
     const CziImageFile::CziSceneInfo& cziSceneInfo = (allFramesFlag
                                                    ? m_cziImageFile->m_allFramesPyramidInfo
                                                    : m_cziImageFile->m_cziScenePyramidInfos[frameIndex]);
@@ -927,13 +938,25 @@ CziImageLoaderMultiResolution::loadImageForPyrmaidLayerForPixelCoords(const CziI
                           + AString::number(pyramidLayerIndex));
     if (cziDebugFlag) std::cout << "Loading pyramid index=" << pyramidLayerIndex << ", rect=" << CziUtilities::qRectToString(rectToLoad) << std::endl;
     AString errorMessage;
-    CziImage* cziImageOut = m_cziImageFile->readFromCziImageFile(s_imageDataFormatForReading,
-                                                                 cziName,
-                                                                 channelIndex,
-                                                                 rectToLoad,
-                                                                 cziSceneInfo.m_logicalRectangle,
-                                                                 m_cziImageFile->getPreferencesImageDimension(),
-                                                                 errorMessage);
+    CziImage* cziImageOut(NULL);
+    if (CziImageTileCache::isEnabled()) {
+        cziImageOut = loadImageFromTiles(cziSceneInfo,
+                                         channelIndex,
+                                         pyramidLayerIndex,
+                                         rectToLoad,
+                                         cziName,
+                                         errorMessage);
+    }
+    else {
+        m_tileImageIncompleteFlag = false;
+        cziImageOut = m_cziImageFile->readFromCziImageFile(s_imageDataFormatForReading,
+                                                           cziName,
+                                                           channelIndex,
+                                                           rectToLoad,
+                                                           cziSceneInfo.m_logicalRectangle,
+                                                           m_cziImageFile->getPreferencesImageDimension(),
+                                                           errorMessage);
+    }
     
     if (cziDebugFlag) std::cout << "Time to load CZI Image: (ms): " << timer.getElapsedTimeMilliseconds() << std::endl;
     
@@ -1106,13 +1129,25 @@ CziImageLoaderMultiResolution::loadImageForPyrmaidLayerForPlaneCoords(const CziI
                           + AString::number(pyramidLayerIndex));
     if (cziDebugFlag) std::cout << "Loading pyramid index=" << pyramidLayerIndex << ", rect=" << CziUtilities::qRectToString(logicalRectToLoad) << std::endl;
     AString errorMessage;
-    CziImage* cziImageOut = m_cziImageFile->readFromCziImageFile(s_imageDataFormatForReading,
-                                                                 cziName,
-                                                                 channelIndex,
-                                                                 logicalRectToLoad,
-                                                                 cziSceneInfo.m_logicalRectangle,
-                                                                 m_cziImageFile->getPreferencesImageDimension(),
-                                                                 errorMessage);
+    CziImage* cziImageOut(NULL);
+    if (CziImageTileCache::isEnabled()) {
+        cziImageOut = loadImageFromTiles(cziSceneInfo,
+                                         channelIndex,
+                                         pyramidLayerIndex,
+                                         logicalRectToLoad,
+                                         cziName,
+                                         errorMessage);
+    }
+    else {
+        m_tileImageIncompleteFlag = false;
+        cziImageOut = m_cziImageFile->readFromCziImageFile(s_imageDataFormatForReading,
+                                                           cziName,
+                                                           channelIndex,
+                                                           logicalRectToLoad,
+                                                           cziSceneInfo.m_logicalRectangle,
+                                                           m_cziImageFile->getPreferencesImageDimension(),
+                                                           errorMessage);
+    }
     
     if (cziDebugFlag) std::cout << "Time to load CZI Image: (ms): " << timer.getElapsedTimeMilliseconds() << std::endl;
     
@@ -1135,6 +1170,117 @@ CziImageLoaderMultiResolution::loadImageForPyrmaidLayerForPlaneCoords(const CziI
     return cziImageOut;
 }
 
+/**
+ * Create an image from tiles in the tile cache.  Tiles of the pyramid layer that are
+ * not in the cache are loaded in the background and, until they are loaded, their
+ * region is filled from lower resolution layers.
+ * @param cziSceneInfo
+ *    CZI scene info (pyramid layers) for image selection
+ * @param channelIndex
+ *    Index of channel.
+ * @param pyramidLayerIndex
+ *    Index of the pyramid layer
+ * @param logicalRectToLoad
+ *    Logical rectangle of the image
+ * @param cziName
+ *    Name for the image
+ * @param errorMessageOut
+ *    Output with error message if image is not created
+ * @return
+ *    Pointer to CziImage or NULL if there is an error.
+ */
+CziImage*
+CziImageLoaderMultiResolution::loadImageFromTiles(const CziImageFile::CziSceneInfo& cziSceneInfo,
+                                                  const int32_t channelIndex,
+                                                  const int32_t pyramidLayerIndex,
+                                                  const QRectF& logicalRectToLoad,
+                                                  const AString& cziName,
+                                                  AString& errorMessageOut)
+{
+    errorMessageOut.clear();
+    m_tileImageIncompleteFlag = false;
+
+    /*
+     * Same integer region that is read when tiles are not used
+     */
+    const QRectF imageLogicalRect(CziUtilities::intRectToQRect(CziUtilities::qRectToIntRect(logicalRectToLoad))
+                                  .intersected(cziSceneInfo.m_logicalRectangle));
+    if (imageLogicalRect.isEmpty()) {
+        errorMessageOut = "Region of interest for reading from file is invalid";
+        return NULL;
+    }
+
+    /*
+     * A layer reads a region of its logical size at no more than the preferred
+     * image dimension so that gives the layer's pixels per logical unit
+     */
+    const float maximumDimension(m_cziImageFile->getPreferencesImageDimension());
+    const std::array<int32_t, 2> pyramidIndexRange(cziSceneInfo.getPyramidLayerIndexRange());
+    const int32_t firstIndex(std::min(pyramidIndexRange[0], pyramidLayerIndex));
+    std::vector<CziImageTileCache::TileGrid> tileGrids;
+    for (int32_t i = firstIndex; i <= pyramidLayerIndex; i++) {
+        CaretAssertVectorIndex(cziSceneInfo.m_pyramidLayers, i);
+        const auto& pyramidLayer(cziSceneInfo.m_pyramidLayers[i]);
+        const float logicalSize(std::max(pyramidLayer.m_logicalWidthForImageReading,
+                                         pyramidLayer.m_logicalHeightForImageReading));
+        const float zoom((logicalSize > maximumDimension)
+                         ? (maximumDimension / logicalSize)
+                         : 1.0f);
+        if (zoom <= 0.0f) {
+            continue;
+        }
+        tileGrids.push_back(CziImageTileCache::TileGrid(cziSceneInfo.m_sceneIndex,
+                                                        channelIndex,
+                                                        i,
+                                                        cziSceneInfo.m_logicalRectangle,
+                                                        zoom));
+    }
+    
+    CziImageTileCache* tileCache(CziImageTileCache::get());
+    
+    /*
+     * Counter is obtained before creating the image so that a tile
+     * loaded while the image is created causes another update
+     */
+    const int64_t tileLoadedCounter(tileCache->getTileLoadedCounter());
+    bool completeFlag(false);
+    std::shared_ptr<libCZI::IBitmapData> bitmapData(tileCache->createImageData(m_cziImageFile,
+                                                                               tileGrids,
+                                                                               imageLogicalRect,
+                                                                               this,
+                                                                               completeFlag));
+    if ( ! bitmapData) {
+        errorMessageOut = ("Failed to create image from tiles for region "
+                           + CziUtilities::qRectToString(imageLogicalRect));
+        return NULL;
+    }
+    
+    m_tileImageIncompleteFlag = ( ! completeFlag);
+    m_tileLoadedCounter       = tileLoadedCounter;
+    
+    CziImage* cziImageOut = new CziImage(m_cziImageFile,
+                                         cziName,
+                                         bitmapData,
+                                         cziSceneInfo.m_logicalRectangle,
+                                         imageLogicalRect);
+    return cziImageOut;
+}
+
+/**
+ * @return True if the image was created while some of its tiles were loading
+ * and tiles have been loaded since the image was created.
+ */
+bool
+CziImageLoaderMultiResolution::isTileImageUpdateNeeded() const
+{
+    if (m_tileImageIncompleteFlag) {
+        if (CziImageTileCache::get()->getTileLoadedCounter() != m_tileLoadedCounter) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * Load a image from the given pyramid layer for the center of the tab region defined by the transform
  * @param oldCziImage
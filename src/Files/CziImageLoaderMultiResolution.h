@@ -103,6 +103,15 @@ namespace caret {
                                                                const int32_t channelIndex,
                                                                const int32_t pyramidLayerIndex);
 
+        CziImage* loadImageFromTiles(const CziImageFile::CziSceneInfo& cziSceneInfo,
+                                     const int32_t channelIndex,
+                                     const int32_t pyramidLayerIndex,
+                                     const QRectF& logicalRectToLoad,
+                                     const AString& cziName,
+                                     AString& errorMessageOut);
+
+        bool isTileImageUpdateNeeded() const;
+        
         QRectF getViewportLogicalCoordinates(const GraphicsObjectToWindowTransform* transform,
                                              const MediaDisplayCoordinateModeEnum::Enum coordinateMode) const;
         
@@ -144,6 +153,12 @@ namespace caret {
         
         bool m_frameChangedFlag = false;
         
+        /** Image was created from tiles while some of its highest resolution tiles were still loading */
+        bool m_tileImageIncompleteFlag = false;
+        
+        /** Tile cache's loaded counter when the incomplete image was created */
+        int64_t m_tileLoadedCounter = 0;
+        
         /*
          * Note CZI_BITMAP does not support alpha channel that is needed for distance/masking file alpha values.
          * If QImage is used, gluBuild2DMipmaps() will crash when the Mesa3D library is used.  This may be due to
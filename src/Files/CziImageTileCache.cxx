@@ -0,0 +1,905 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2021 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __CZI_IMAGE_TILE_CACHE_DECLARE__
+#include "CziImageTileCache.h"
+#undef __CZI_IMAGE_TILE_CACHE_DECLARE__
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CziImageFile.h"
+#include "CziUtilities.h"
+#include "libCZI.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::CziImageTileCache
+ * \brief Cache of image tiles read from CZI files, tiles are loaded in the background
+ * \ingroup Files
+ *
+ * Each pyramid layer of a frame is divided into square tiles of
+ * TILE_PIXEL_SIZE pixels.  An image for a region is created from the
+ * tiles that are in the cache and the missing tiles are read by a task
+ * in Qt's global thread pool (JPEG-XR compressed data is decoded as
+ * part of the read).  Until a missing tile is loaded, the part of the
+ * image that it covers is copied from tiles of lower resolution layers.
+ * When tiles have been loaded tilesLoaded() is emitted so that the
+ * graphics are updated and the loaders create their incomplete images
+ * again.
+ *
+ * Tiles are kept in a least recently used cache with a maximum size so
+ * that panning back to a region or zooming out and in again does not
+ * read the file again.
+ *
+ * Owners of a CziImageFile must call removeFile() before the file is
+ * closed or destroyed.
+ */
+
+/**
+ * Task that reads the pending tiles and exits when there are none.
+ */
+class CziImageTileCache::LoadTask : public QRunnable {
+public:
+    LoadTask(CziImageTileCache* cache) : m_cache(cache) { }
+
+    void run() override {
+        m_cache->runLoadTask();
+    }
+
+    CziImageTileCache* m_cache;
+};
+
+/**
+ * Constructor.
+ * @param sceneIndex
+ *    Index of scene (frame), negative for all scenes
+ * @param channelIndex
+ *    Index of channel
+ * @param pyramidLayerIndex
+ *    Index of the pyramid layer
+ * @param frameLogicalRect
+ *    Logical rectangle of the frame
+ * @param zoom
+ *    Pixels per logical unit for the pyramid layer
+ */
+CziImageTileCache::TileGrid::TileGrid(const int32_t sceneIndex,
+                                      const int32_t channelIndex,
+                                      const int32_t pyramidLayerIndex,
+                                      const QRectF& frameLogicalRect,
+                                      const float zoom)
+: m_sceneIndex(sceneIndex),
+m_channelIndex(channelIndex),
+m_pyramidLayerIndex(pyramidLayerIndex),
+m_frameLogicalRect(frameLogicalRect),
+m_zoom(zoom)
+{
+    CaretAssert(zoom > 0.0f);
+    m_tileLogicalSize = std::max(static_cast<int64_t>(1),
+                                 static_cast<int64_t>(std::ceil(TILE_PIXEL_SIZE / zoom)));
+}
+
+/**
+ * @return Number of tile columns in the frame
+ */
+int64_t
+CziImageTileCache::TileGrid::getNumberOfColumns() const
+{
+    return static_cast<int64_t>(std::ceil(m_frameLogicalRect.width() / m_tileLogicalSize));
+}
+
+/**
+ * @return Number of tile rows in the frame
+ */
+int64_t
+CziImageTileCache::TileGrid::getNumberOfRows() const
+{
+    return static_cast<int64_t>(std::ceil(m_frameLogicalRect.height() / m_tileLogicalSize));
+}
+
+/**
+ * @return Logical rectangle of a tile
+ * @param column
+ *    Column of the tile
+ * @param row
+ *    Row of the tile
+ */
+QRectF
+CziImageTileCache::TileGrid::getTileLogicalRect(const int64_t column,
+                                                const int64_t row) const
+{
+    const QRectF rect(m_frameLogicalRect.x() + (column * m_tileLogicalSize),
+                      m_frameLogicalRect.y() + (row * m_tileLogicalSize),
+                      m_tileLogicalSize,
+                      m_tileLogicalSize);
+    return rect.intersected(m_frameLogicalRect);
+}
+
+/**
+ * Get the range of the tiles that overlap a logical rectangle
+ * @param logicalRect
+ *    The logical rectangle
+ * @param firstColumnOut
+ *    Output with first column
+ * @param lastColumnOut
+ *    Output with last column (inclusive)
+ * @param firstRowOut
+ *    Output with first row
+ * @param lastRowOut
+ *    Output with last row (inclusive)
+ * @return
+ *    True if any tiles overlap the rectangle
+ */
+bool
+CziImageTileCache::TileGrid::getTileRange(const QRectF& logicalRect,
+                                          int64_t& firstColumnOut,
+                                          int64_t& lastColumnOut,
+                                          int64_t& firstRowOut,
+                                          int64_t& lastRowOut) const
+{
+    const QRectF rect(logicalRect.intersected(m_frameLogicalRect));
+    if (rect.isEmpty()) {
+        return false;
+    }
+
+    const double tileSize(m_tileLogicalSize);
+    const int64_t lastFrameColumn(getNumberOfColumns() - 1);
+    const int64_t lastFrameRow(getNumberOfRows() - 1);
+    firstColumnOut = static_cast<int64_t>(std::floor((rect.left() - m_frameLogicalRect.left()) / tileSize));
+    lastColumnOut  = static_cast<int64_t>(std::ceil((rect.right() - m_frameLogicalRect.left()) / tileSize)) - 1;
+    firstRowOut    = static_cast<int64_t>(std::floor((rect.top() - m_frameLogicalRect.top()) / tileSize));
+    lastRowOut     = static_cast<int64_t>(std::ceil((rect.bottom() - m_frameLogicalRect.top()) / tileSize)) - 1;
+    firstColumnOut = std::min(std::max(firstColumnOut, static_cast<int64_t>(0)), lastFrameColumn);
+    lastColumnOut  = std::min(std::max(lastColumnOut, firstColumnOut), lastFrameColumn);
+    firstRowOut    = std::min(std::max(firstRowOut, static_cast<int64_t>(0)), lastFrameRow);
+    lastRowOut     = std::min(std::max(lastRowOut, firstRowOut), lastFrameRow);
+
+    return ((lastFrameColumn >= 0)
+            && (lastFrameRow >= 0));
+}
+
+/**
+ * @return The tile cache.
+ */
+CziImageTileCache*
+CziImageTileCache::get()
+{
+    /*
+     * Never deleted since a load task may
+     * still be running when the application exits
+     */
+    static CziImageTileCache* s_instance = new CziImageTileCache();
+    return s_instance;
+}
+
+/**
+ * @return True if CZI images are created from tiles loaded in the background.
+ * If false, images are read from the file when they are needed.
+ */
+bool
+CziImageTileCache::isEnabled()
+{
+    return s_enabled;
+}
+
+/**
+ * Set creation of CZI images from tiles loaded in the background.
+ * @param enabled
+ *    New status.
+ */
+void
+CziImageTileCache::setEnabled(const bool enabled)
+{
+    s_enabled = enabled;
+}
+
+/**
+ * Constructor.
+ */
+CziImageTileCache::CziImageTileCache()
+: QObject(),
+m_loadTaskReadFile(NULL),
+m_loadTaskActive(false),
+m_tileLoadedCounter(0),
+m_numberOfBytes(0),
+m_maximumBytes(((int64_t)512) << 20)
+{
+    m_tilesLoadedSignalTimer.start();
+}
+
+/**
+ * Destructor.
+ */
+CziImageTileCache::~CziImageTileCache()
+{
+}
+
+/**
+ * Create image data for a region from the tiles in the cache.  Missing tiles
+ * of the highest resolution layer are requested and the part of the image
+ * they cover is copied from the lower resolution layers.  If no tiles are
+ * available for the region, the tiles of the lowest resolution layer are
+ * read before returning.
+ *
+ * @param cziImageFile
+ *    The CZI file.
+ * @param tileGrids
+ *    Grids for pyramid layers from lowest to highest resolution.  The image is
+ *    created at the resolution of the last grid, the others are used for
+ *    placeholders.
+ * @param logicalRect
+ *    Logical rectangle of the image.
+ * @param requester
+ *    The image loader, its tile requests that have not started are discarded.
+ * @param completeOut
+ *    Output, true if the image contains only tiles from the highest resolution layer.
+ * @return
+ *    Bitmap data in Bgr24 format or invalid pointer if the rectangle does not overlap the frame.
+ */
+std::shared_ptr<libCZI::IBitmapData>
+CziImageTileCache::createImageData(CziImageFile* cziImageFile,
+                                   const std::vector<TileGrid>& tileGrids,
+                                   const QRectF& logicalRect,
+                                   const void* requester,
+                                   bool& completeOut)
+{
+    CaretAssert(cziImageFile);
+    completeOut = false;
+
+    std::shared_ptr<libCZI::IBitmapData> bitmapData;
+    if (tileGrids.empty()) {
+        return bitmapData;
+    }
+
+    const TileGrid& sharpGrid(tileGrids.back());
+    const QRectF imageLogicalRect(logicalRect.intersected(sharpGrid.m_frameLogicalRect));
+    if (imageLogicalRect.isEmpty()) {
+        return bitmapData;
+    }
+    const int32_t imageWidth(std::max(1, static_cast<int32_t>(std::round(imageLogicalRect.width() * sharpGrid.m_zoom))));
+    const int32_t imageHeight(std::max(1, static_cast<int32_t>(std::round(imageLogicalRect.height() * sharpGrid.m_zoom))));
+    bitmapData = libCZI::GetDefaultSiteObject(libCZI::SiteObjectType::Default)->CreateBitmap(libCZI::PixelType::Bgr24,
+                                                                                              imageWidth,
+                                                                                              imageHeight);
+    if ( ! bitmapData) {
+        return bitmapData;
+    }
+
+    const std::array<uint8_t, 3> backgroundRGB(cziImageFile->getPreferencesImageBackgroundByteRGB());
+    const std::array<float, 3> backgroundFloatRGB(cziImageFile->getPreferencesImageBackgroundFloatRGB());
+
+    libCZI::ScopedBitmapLockerSP imageLock(bitmapData);
+    std::vector<TileRequest> placeholderRequests;
+    std::vector<TileRequest> sharpRequests;
+
+    QMutexLocker locker(&m_mutex);
+    const bool anyTilesFlag(composeImage(cziImageFile,
+                                         tileGrids,
+                                         imageLogicalRect,
+                                         backgroundRGB,
+                                         backgroundFloatRGB,
+                                         requester,
+                                         imageLock,
+                                         imageWidth,
+                                         imageHeight,
+                                         placeholderRequests,
+                                         sharpRequests));
+    if ( ! anyTilesFlag) {
+        /*
+         * Nothing to show for the region, which happens when a frame is
+         * first displayed.  Wait for the lowest resolution tiles, there
+         * are few of them, rather than drawing an empty image.
+         */
+        const std::vector<TileRequest> loadNowRequests((tileGrids.size() == 1)
+                                                       ? sharpRequests
+                                                       : placeholderRequests);
+        locker.unlock();
+        loadTilesNow(loadNowRequests);
+        locker.relock();
+
+        placeholderRequests.clear();
+        sharpRequests.clear();
+        composeImage(cziImageFile,
+                     tileGrids,
+                     imageLogicalRect,
+                     backgroundRGB,
+                     backgroundFloatRGB,
+                     requester,
+                     imageLock,
+                     imageWidth,
+                     imageHeight,
+                     placeholderRequests,
+                     sharpRequests);
+    }
+
+    completeOut = sharpRequests.empty();
+
+    /* Placeholders are cheap to read and cover the most area, so they are loaded first */
+    std::vector<TileRequest> tileRequests(placeholderRequests);
+    tileRequests.insert(tileRequests.end(),
+                        sharpRequests.begin(),
+                        sharpRequests.end());
+    requestTiles(requester,
+                 tileRequests);
+
+    return bitmapData;
+}
+
+/**
+ * Copy the tiles in the cache into an image.  Mutex must be locked.
+ * @param cziImageFile
+ *    The CZI file.
+ * @param tileGrids
+ *    Grids for pyramid layers from lowest to highest resolution.
+ * @param imageLogicalRect
+ *    Logical rectangle of the image.
+ * @param backgroundRGB
+ *    Color for the image where there are no tiles.
+ * @param backgroundFloatRGB
+ *    Color for reading tiles.
+ * @param requester
+ *    The image loader.
+ * @param imageLockInfo
+ *    Lock info of the image.
+ * @param imageWidth
+ *    Width of the image.
+ * @param imageHeight
+ *    Height of the image.
+ * @param placeholderRequestsOut
+ *    Output with tiles of the lowest resolution layer that are missing and needed for placeholders.
+ * @param sharpRequestsOut
+ *    Output with tiles of the highest resolution layer that are missing, nearest to the center first.
+ * @return
+ *    True if any tiles were copied into the image.
+ */
+bool
+CziImageTileCache::composeImage(CziImageFile* cziImageFile,
+                                const std::vector<TileGrid>& tileGrids,
+                                const QRectF& imageLogicalRect,
+                                const std::array<uint8_t, 3>& backgroundRGB,
+                                const std::array<float, 3>& backgroundFloatRGB,
+                                const void* requester,
+                                const libCZI::BitmapLockInfo& imageLockInfo,
+                                const int32_t imageWidth,
+                                const int32_t imageHeight,
+                                std::vector<TileRequest>& placeholderRequestsOut,
+                                std::vector<TileRequest>& sharpRequestsOut)
+{
+    CaretAssert( ! tileGrids.empty());
+
+    /*
+     * Bgr24 pixels
+     */
+    for (int32_t y = 0; y < imageHeight; y++) {
+        uint8_t* row(static_cast<uint8_t*>(imageLockInfo.ptrDataRoi) + (y * imageLockInfo.stride));
+        for (int32_t x = 0; x < imageWidth; x++) {
+            row[x * 3]     = backgroundRGB[2];
+            row[x * 3 + 1] = backgroundRGB[1];
+            row[x * 3 + 2] = backgroundRGB[0];
+        }
+    }
+
+    bool anyTilesFlag(false);
+    const TileGrid& sharpGrid(tileGrids.back());
+    std::vector<QRectF> missingRects;
+    int64_t firstColumn(0), lastColumn(0), firstRow(0), lastRow(0);
+    if (sharpGrid.getTileRange(imageLogicalRect, firstColumn, lastColumn, firstRow, lastRow)) {
+        for (int64_t row = firstRow; row <= lastRow; row++) {
+            for (int64_t column = firstColumn; column <= lastColumn; column++) {
+                const Key key(cziImageFile,
+                              sharpGrid,
+                              column,
+                              row);
+                const QRectF tileRect(sharpGrid.getTileLogicalRect(column, row));
+                std::map<Key, Tile>::iterator iter = m_tiles.find(key);
+                if (iter != m_tiles.end()) {
+                    copyTileToImage(iter->second,
+                                    tileRect,
+                                    imageLogicalRect,
+                                    sharpGrid.m_zoom,
+                                    imageLockInfo,
+                                    imageWidth,
+                                    imageHeight);
+                    m_leastRecentlyUsed.splice(m_leastRecentlyUsed.begin(),
+                                               m_leastRecentlyUsed,
+                                               iter->second.m_lruIterator);
+                    anyTilesFlag = true;
+                }
+                else {
+                    missingRects.push_back(tileRect.intersected(imageLogicalRect));
+                    sharpRequestsOut.push_back(TileRequest(key,
+                                                           cziImageFile,
+                                                           tileRect,
+                                                           sharpGrid.m_zoom,
+                                                           backgroundFloatRGB,
+                                                           requester));
+                }
+            }
+        }
+    }
+
+    if (missingRects.empty()) {
+        return anyTilesFlag;
+    }
+
+    /*
+     * Fill the missing tiles from lower resolution layers, lowest first
+     * so that the best available resolution is on top
+     */
+    const int32_t numPlaceholderGrids(static_cast<int32_t>(tileGrids.size()) - 1);
+    for (int32_t iGrid = 0; iGrid < numPlaceholderGrids; iGrid++) {
+        const TileGrid& grid(tileGrids[iGrid]);
+        if ( ! grid.getTileRange(imageLogicalRect, firstColumn, lastColumn, firstRow, lastRow)) {
+            continue;
+        }
+        for (int64_t row = firstRow; row <= lastRow; row++) {
+            for (int64_t column = firstColumn; column <= lastColumn; column++) {
+                const QRectF tileRect(grid.getTileLogicalRect(column, row));
+                const Key key(cziImageFile,
+                              grid,
+                              column,
+                              row);
+                std::map<Key, Tile>::iterator iter = m_tiles.find(key);
+                bool tileUsedFlag(false);
+                for (const QRectF& missingRect : missingRects) {
+                    if ( ! tileRect.intersects(missingRect)) {
+                        continue;
+                    }
+                    if (iter != m_tiles.end()) {
+                        copyTileToImage(iter->second,
+                                        missingRect,
+                                        imageLogicalRect,
+                                        sharpGrid.m_zoom,
+                                        imageLockInfo,
+                                        imageWidth,
+                                        imageHeight);
+                        tileUsedFlag = true;
+                    }
+                    else {
+                        if (iGrid == 0) {
+                            placeholderRequestsOut.push_back(TileRequest(key,
+                                                                         cziImageFile,
+                                                                         tileRect,
+                                                                         grid.m_zoom,
+                                                                         backgroundFloatRGB,
+                                                                         requester));
+                        }
+                        break;
+                    }
+                }
+                if (tileUsedFlag) {
+                    m_leastRecentlyUsed.splice(m_leastRecentlyUsed.begin(),
+                                               m_leastRecentlyUsed,
+                                               iter->second.m_lruIterator);
+                    anyTilesFlag = true;
+                }
+            }
+        }
+    }
+
+    /*
+     * Load the tiles nearest the center of the image first
+     */
+    const QPointF imageCenter(imageLogicalRect.center());
+    std::stable_sort(sharpRequestsOut.begin(),
+                     sharpRequestsOut.end(),
+                     [imageCenter](const TileRequest& a, const TileRequest& b) {
+        const QPointF da(a.m_logicalRect.center() - imageCenter);
+        const QPointF db(b.m_logicalRect.center() - imageCenter);
+        return (QPointF::dotProduct(da, da) < QPointF::dotProduct(db, db));
+    });
+
+    return anyTilesFlag;
+}
+
+/**
+ * Copy the part of a tile inside a clipping rectangle into an image.  Image pixels
+ * are assigned to the tile containing the pixel's center so adjacent tiles neither
+ * overlap nor leave gaps.
+ * @param tile
+ *    The tile.
+ * @param clipLogicalRect
+ *    Only the part of the tile in this logical rectangle is copied.
+ * @param imageLogicalRect
+ *    Logical rectangle of the image.
+ * @param imageZoom
+ *    Pixels per logical unit of the image.
+ * @param imageLockInfo
+ *    Lock info of the image.
+ * @param imageWidth
+ *    Width of the image.
+ * @param imageHeight
+ *    Height of the image.
+ */
+void
+CziImageTileCache::copyTileToImage(const Tile& tile,
+                                   const QRectF& clipLogicalRect,
+                                   const QRectF& imageLogicalRect,
+                                   const float imageZoom,
+                                   const libCZI::BitmapLockInfo& imageLockInfo,
+                                   const int32_t imageWidth,
+                                   const int32_t imageHeight)
+{
+    const QRectF region(tile.m_logicalRect.intersected(clipLogicalRect).intersected(imageLogicalRect));
+    if (region.isEmpty()) {
+        return;
+    }
+    const int32_t tileWidth(tile.m_bitmapData->GetWidth());
+    const int32_t tileHeight(tile.m_bitmapData->GetHeight());
+    if ((tileWidth <= 0)
+        || (tileHeight <= 0)) {
+        return;
+    }
+    const double tileScaleX(tileWidth / tile.m_logicalRect.width());
+    const double tileScaleY(tileHeight / tile.m_logicalRect.height());
+
+    /*
+     * Rounding may make the image slightly larger than its logical rectangle,
+     * the last pixels belong to the tiles at the right and bottom
+     */
+    const bool lastColumnFlag(region.right() >= imageLogicalRect.right());
+    const bool lastRowFlag(region.bottom() >= imageLogicalRect.bottom());
+
+    const int32_t firstX(std::max(0, static_cast<int32_t>(std::floor((region.left() - imageLogicalRect.left()) * imageZoom))));
+    const int32_t lastX(lastColumnFlag
+                        ? (imageWidth - 1)
+                        : std::min(imageWidth - 1, static_cast<int32_t>(std::ceil((region.right() - imageLogicalRect.left()) * imageZoom))));
+    std::vector<int32_t> tileXs;
+    tileXs.reserve(std::max(0, lastX - firstX + 1));
+    for (int32_t x = firstX; x <= lastX; x++) {
+        const double logicalX(imageLogicalRect.left() + ((x + 0.5) / imageZoom));
+        if ((logicalX < region.left())
+            || ((logicalX >= region.right())
+                && ( ! lastColumnFlag))) {
+            tileXs.push_back(-1);
+            continue;
+        }
+        const int32_t tileX(static_cast<int32_t>((logicalX - tile.m_logicalRect.left()) * tileScaleX));
+        tileXs.push_back(std::min(std::max(tileX, 0), tileWidth - 1));
+    }
+
+    const int32_t firstY(std::max(0, static_cast<int32_t>(std::floor((region.top() - imageLogicalRect.top()) * imageZoom))));
+    const int32_t lastY(lastRowFlag
+                        ? (imageHeight - 1)
+                        : std::min(imageHeight - 1, static_cast<int32_t>(std::ceil((region.bottom() - imageLogicalRect.top()) * imageZoom))));
+
+    libCZI::ScopedBitmapLockerSP tileLock(tile.m_bitmapData);
+    for (int32_t y = firstY; y <= lastY; y++) {
+        const double logicalY(imageLogicalRect.top() + ((y + 0.5) / imageZoom));
+        if ((logicalY < region.top())
+            || ((logicalY >= region.bottom())
+                && ( ! lastRowFlag))) {
+            continue;
+        }
+        const int32_t tileY(std::min(std::max(static_cast<int32_t>((logicalY - tile.m_logicalRect.top()) * tileScaleY), 0),
+                                     tileHeight - 1));
+        const uint8_t* tileRow(static_cast<const uint8_t*>(tileLock.ptrDataRoi) + (tileY * tileLock.stride));
+        uint8_t* imageRow(static_cast<uint8_t*>(imageLockInfo.ptrDataRoi) + (y * imageLockInfo.stride));
+        const int32_t numX(static_cast<int32_t>(tileXs.size()));
+        for (int32_t i = 0; i < numX; i++) {
+            if (tileXs[i] >= 0) {
+                std::memcpy(imageRow + ((firstX + i) * 3),
+                            tileRow + (tileXs[i] * 3),
+                            3);
+            }
+        }
+    }
+}
+
+/**
+ * Request that tiles are loaded in the background.  Any requests from the
+ * requester that have not started are discarded.  Mutex must be locked.
+ * @param requester
+ *    The image loader.
+ * @param tileRequests
+ *    The tiles, the first ones are loaded first.
+ */
+void
+CziImageTileCache::requestTiles(const void* requester,
+                                const std::vector<TileRequest>& tileRequests)
+{
+    m_pendingRequests.erase(std::remove_if(m_pendingRequests.begin(),
+                                           m_pendingRequests.end(),
+                                           [requester](const TileRequest& r) { return (r.m_requester == requester); }),
+                            m_pendingRequests.end());
+
+    const int64_t tileBytes(static_cast<int64_t>(TILE_PIXEL_SIZE) * TILE_PIXEL_SIZE * 3);
+    int64_t bytesRequested(0);
+    for (const TileRequest& tileRequest : tileRequests) {
+        /*
+         * Requesting more than half of the cache would evict
+         * the tiles just loaded and the tiles recently used
+         */
+        bytesRequested += tileBytes;
+        if (bytesRequested > (m_maximumBytes / 2)) {
+            break;
+        }
+        if (m_tiles.find(tileRequest.m_key) != m_tiles.end()) {
+            continue;
+        }
+        const Key& key(tileRequest.m_key);
+        if (std::find_if(m_pendingRequests.begin(),
+                         m_pendingRequests.end(),
+                         [key](const TileRequest& r) { return (r.m_key == key); }) != m_pendingRequests.end()) {
+            continue;
+        }
+        m_pendingRequests.push_back(tileRequest);
+    }
+
+    if (( ! m_loadTaskActive)
+        && ( ! m_pendingRequests.empty())) {
+        m_loadTaskActive = true;
+        LoadTask* task = new LoadTask(this);
+        task->setAutoDelete(true);
+        QThreadPool::globalInstance()->start(task);
+    }
+}
+
+/**
+ * Read pending tiles until there are none.  Runs in a thread pool thread.
+ */
+void
+CziImageTileCache::runLoadTask()
+{
+    bool tilesNotSignaledFlag(false);
+    QMutexLocker locker(&m_mutex);
+    while ( ! m_pendingRequests.empty()) {
+        const TileRequest tileRequest = m_pendingRequests.front();
+        m_pendingRequests.pop_front();
+        if (m_tiles.find(tileRequest.m_key) != m_tiles.end()) {
+            continue;
+        }
+        m_loadTaskReadFile = tileRequest.m_cziImageFile;
+
+        /*
+         * The file cannot be removed while it is being read
+         * since removeFile() waits for the read to finish
+         */
+        locker.unlock();
+        std::shared_ptr<libCZI::IBitmapData> bitmapData;
+        const bool validFlag(readTile(tileRequest,
+                                      bitmapData));
+        locker.relock();
+
+        m_loadTaskReadFile = NULL;
+        if (validFlag) {
+            addTile(tileRequest.m_key,
+                    tileRequest.m_logicalRect,
+                    bitmapData);
+            tilesNotSignaledFlag = true;
+        }
+        m_readFinishedCondition.wakeAll();
+
+        /*
+         * Each signal causes the images to be created again, so
+         * limit how often it is emitted while tiles are loading
+         */
+        if (tilesNotSignaledFlag
+            && (m_pendingRequests.empty()
+                || (m_tilesLoadedSignalTimer.elapsed() >= 100))) {
+            emit tilesLoaded();
+            m_tilesLoadedSignalTimer.restart();
+            tilesNotSignaledFlag = false;
+        }
+    }
+    m_loadTaskActive = false;
+}
+
+/**
+ * Read tiles and add them to the cache.  Mutex must NOT be locked.
+ * @param tileRequests
+ *    The tiles.
+ */
+void
+CziImageTileCache::loadTilesNow(const std::vector<TileRequest>& tileRequests)
+{
+    for (const TileRequest& tileRequest : tileRequests) {
+        std::shared_ptr<libCZI::IBitmapData> bitmapData;
+        if (readTile(tileRequest,
+                     bitmapData)) {
+            QMutexLocker locker(&m_mutex);
+            addTile(tileRequest.m_key,
+                    tileRequest.m_logicalRect,
+                    bitmapData);
+        }
+    }
+}
+
+/**
+ * Read a tile from its file.
+ * @param tileRequest
+ *    The tile.
+ * @param bitmapDataOut
+ *    Output with the tile's image data.
+ * @return
+ *    True if the tile was read.
+ */
+bool
+CziImageTileCache::readTile(const TileRequest& tileRequest,
+                            std::shared_ptr<libCZI::IBitmapData>& bitmapDataOut)
+{
+    AString errorMessage;
+    try {
+        bitmapDataOut = tileRequest.m_cziImageFile->readBitmapDataFromCziImageFile(tileRequest.m_key.m_channelIndex,
+                                                                                   CziUtilities::qRectToIntRect(tileRequest.m_logicalRect),
+                                                                                   tileRequest.m_zoom,
+                                                                                   tileRequest.m_backgroundRGB,
+                                                                                   errorMessage);
+    }
+    catch (const std::exception& e) {
+        bitmapDataOut.reset();
+        errorMessage = e.what();
+    }
+
+    if ( ! bitmapDataOut) {
+        /* the tile is requested again when it is needed, the placeholder is drawn until then */
+        CaretLogFine("Reading CZI image tile "
+                     + CziUtilities::qRectToString(tileRequest.m_logicalRect)
+                     + " failed: "
+                     + errorMessage);
+        return false;
+    }
+    if (bitmapDataOut->GetPixelType() != libCZI::PixelType::Bgr24) {
+        CaretLogSevere("CZI image tile pixel type is not libCZI::PixelType::Bgr24");
+        bitmapDataOut.reset();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Remove all tiles for the given file, and cancel its tile requests.
+ * Waits if the load task is reading from the file.
+ * @param cziImageFile
+ *    The CZI file.
+ */
+void
+CziImageTileCache::removeFile(const CziImageFile* cziImageFile)
+{
+    if (cziImageFile == NULL) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_pendingRequests.erase(std::remove_if(m_pendingRequests.begin(),
+                                           m_pendingRequests.end(),
+                                           [cziImageFile](const TileRequest& r) { return (r.m_key.m_cziImageFile == cziImageFile); }),
+                            m_pendingRequests.end());
+    while (m_loadTaskReadFile == cziImageFile) {
+        m_readFinishedCondition.wait(&m_mutex);
+    }
+
+    std::map<Key, Tile>::iterator iter = m_tiles.begin();
+    while (iter != m_tiles.end()) {
+        std::map<Key, Tile>::iterator removeIter = iter;
+        ++iter;
+        if (removeIter->first.m_cziImageFile == cziImageFile) {
+            removeTile(removeIter);
+        }
+    }
+}
+
+/**
+ * @return A counter that is incremented each time a tile is loaded.  A
+ * loader with an incomplete image creates the image again when it changes.
+ */
+int64_t
+CziImageTileCache::getTileLoadedCounter() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_tileLoadedCounter;
+}
+
+/**
+ * @return Maximum size of the cached tiles, in bytes.
+ */
+int64_t
+CziImageTileCache::getMaximumBytes() const
+{
+    return m_maximumBytes;
+}
+
+/**
+ * Set the maximum size of the cached tiles, in bytes.
+ * @param maximumBytes
+ *    New maximum size.
+ */
+void
+CziImageTileCache::setMaximumBytes(const int64_t maximumBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumBytes = std::max(maximumBytes,
+                              (int64_t)0);
+    removeExcessTiles();
+}
+
+/**
+ * Add a tile to the cache as the most recently used.  Mutex must be locked.
+ * @param key
+ *    Key of the tile.
+ * @param logicalRect
+ *    Logical rectangle of the tile.
+ * @param bitmapData
+ *    Image data of the tile.
+ */
+void
+CziImageTileCache::addTile(const Key& key,
+                           const QRectF& logicalRect,
+                           std::shared_ptr<libCZI::IBitmapData>& bitmapData)
+{
+    const int64_t tileBytes(static_cast<int64_t>(bitmapData->GetWidth())
+                            * bitmapData->GetHeight()
+                            * 3);
+    if (tileBytes > m_maximumBytes) {
+        return;
+    }
+    std::map<Key, Tile>::iterator iter = m_tiles.find(key);
+    if (iter != m_tiles.end()) {
+        removeTile(iter);
+    }
+    m_leastRecentlyUsed.push_front(key);
+    Tile& tile = m_tiles[key];
+    tile.m_bitmapData    = bitmapData;
+    tile.m_logicalRect   = logicalRect;
+    tile.m_numberOfBytes = tileBytes;
+    tile.m_lruIterator   = m_leastRecentlyUsed.begin();
+    m_numberOfBytes += tileBytes;
+    ++m_tileLoadedCounter;
+    removeExcessTiles();
+}
+
+/**
+ * Remove a tile from the cache.  Mutex must be locked.
+ * @param iter
+ *    Iterator to the tile.
+ */
+void
+CziImageTileCache::removeTile(std::map<Key, Tile>::iterator iter)
+{
+    m_numberOfBytes -= iter->second.m_numberOfBytes;
+    m_leastRecentlyUsed.erase(iter->second.m_lruIterator);
+    m_tiles.erase(iter);
+}
+
+/**
+ * Remove least recently used tiles until the cache is within its size.  Mutex must be locked.
+ */
+void
+CziImageTileCache::removeExcessTiles()
+{
+    while ((m_numberOfBytes > m_maximumBytes)
+           && ( ! m_leastRecentlyUsed.empty())) {
+        std::map<Key, Tile>::iterator iter = m_tiles.find(m_leastRecentlyUsed.back());
+        CaretAssert(iter != m_tiles.end());
+        removeTile(iter);
+    }
+}
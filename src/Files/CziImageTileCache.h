@@ -0,0 +1,298 @@
+#ifndef __CZI_IMAGE_TILE_CACHE_H__
+#define __CZI_IMAGE_TILE_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2021 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <array>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QRectF>
+#include <QWaitCondition>
+
+#include "libCZI_Pixels.h"
+
+namespace caret {
+
+    class CziImageFile;
+
+    class CziImageTileCache : public QObject {
+
+        Q_OBJECT
+
+    public:
+        /**
+         * Divides one pyramid layer of a frame into square tiles
+         */
+        class TileGrid {
+        public:
+            TileGrid(const int32_t sceneIndex,
+                     const int32_t channelIndex,
+                     const int32_t pyramidLayerIndex,
+                     const QRectF& frameLogicalRect,
+                     const float zoom);
+
+            int64_t getNumberOfColumns() const;
+
+            int64_t getNumberOfRows() const;
+
+            QRectF getTileLogicalRect(const int64_t column,
+                                      const int64_t row) const;
+
+            bool getTileRange(const QRectF& logicalRect,
+                              int64_t& firstColumnOut,
+                              int64_t& lastColumnOut,
+                              int64_t& firstRowOut,
+                              int64_t& lastRowOut) const;
+
+            /** Index of scene (frame), negative for all scenes */
+            int32_t m_sceneIndex;
+
+            int32_t m_channelIndex;
+
+            int32_t m_pyramidLayerIndex;
+
+            /** Logical rectangle of the frame, tiles start at its top left */
+            QRectF m_frameLogicalRect;
+
+            /** Pixels per logical unit of the tiles */
+            float m_zoom;
+
+            /** Logical width and height of a tile, tiles at right and bottom are clipped to the frame */
+            int64_t m_tileLogicalSize;
+        };
+
+        static CziImageTileCache* get();
+
+        static bool isEnabled();
+
+        static void setEnabled(const bool enabled);
+
+        std::shared_ptr<libCZI::IBitmapData> createImageData(CziImageFile* cziImageFile,
+                                                             const std::vector<TileGrid>& tileGrids,
+                                                             const QRectF& logicalRect,
+                                                             const void* requester,
+                                                             bool& completeOut);
+
+        void removeFile(const CziImageFile* cziImageFile);
+
+        int64_t getTileLoadedCounter() const;
+
+        int64_t getMaximumBytes() const;
+
+        void setMaximumBytes(const int64_t maximumBytes);
+
+        /** Width and height of a tile in pixels */
+        static const int32_t TILE_PIXEL_SIZE;
+
+        // ADD_NEW_METHODS_HERE
+
+    signals:
+        /**
+         * Emitted from the background task when tiles have been loaded,
+         * connections must be queued since it is not the GUI thread
+         */
+        void tilesLoaded();
+
+    private:
+        class Key {
+        public:
+            Key(const CziImageFile* cziImageFile,
+                const TileGrid& tileGrid,
+                const int64_t column,
+                const int64_t row)
+            : m_cziImageFile(cziImageFile),
+            m_sceneIndex(tileGrid.m_sceneIndex),
+            m_channelIndex(tileGrid.m_channelIndex),
+            m_pyramidLayerIndex(tileGrid.m_pyramidLayerIndex),
+            m_tileLogicalSize(tileGrid.m_tileLogicalSize),
+            m_column(column),
+            m_row(row) { }
+
+            bool operator<(const Key& rhs) const {
+                if (m_cziImageFile != rhs.m_cziImageFile) return (m_cziImageFile < rhs.m_cziImageFile);
+                if (m_sceneIndex != rhs.m_sceneIndex) return (m_sceneIndex < rhs.m_sceneIndex);
+                if (m_channelIndex != rhs.m_channelIndex) return (m_channelIndex < rhs.m_channelIndex);
+                if (m_pyramidLayerIndex != rhs.m_pyramidLayerIndex) return (m_pyramidLayerIndex < rhs.m_pyramidLayerIndex);
+                if (m_tileLogicalSize != rhs.m_tileLogicalSize) return (m_tileLogicalSize < rhs.m_tileLogicalSize);
+                if (m_row != rhs.m_row) return (m_row < rhs.m_row);
+                return (m_column < rhs.m_column);
+            }
+
+            bool operator==(const Key& rhs) const {
+                return (( ! (*this < rhs))
+                        && ( ! (rhs < *this)));
+            }
+
+            const CziImageFile* m_cziImageFile;
+
+            int32_t m_sceneIndex;
+
+            int32_t m_channelIndex;
+
+            int32_t m_pyramidLayerIndex;
+
+            /** Tiles of a layer are a different size if the image dimension preference changes */
+            int64_t m_tileLogicalSize;
+
+            int64_t m_column;
+
+            int64_t m_row;
+        };
+
+        class Tile {
+        public:
+            std::shared_ptr<libCZI::IBitmapData> m_bitmapData;
+
+            QRectF m_logicalRect;
+
+            int64_t m_numberOfBytes = 0;
+
+            /** Position in the least recently used list */
+            std::list<Key>::iterator m_lruIterator;
+        };
+
+        class TileRequest {
+        public:
+            TileRequest(const Key& key,
+                        CziImageFile* cziImageFile,
+                        const QRectF& logicalRect,
+                        const float zoom,
+                        const std::array<float, 3>& backgroundRGB,
+                        const void* requester)
+            : m_key(key),
+            m_cziImageFile(cziImageFile),
+            m_logicalRect(logicalRect),
+            m_zoom(zoom),
+            m_backgroundRGB(backgroundRGB),
+            m_requester(requester) { }
+
+            Key m_key;
+
+            CziImageFile* m_cziImageFile;
+
+            QRectF m_logicalRect;
+
+            float m_zoom;
+
+            /** Background color from preferences, which are not accessed from the load task */
+            std::array<float, 3> m_backgroundRGB;
+
+            /** Loader that requested the tile, a new request from it discards its requests that have not started */
+            const void* m_requester;
+        };
+
+        class LoadTask;
+
+        CziImageTileCache();
+
+        virtual ~CziImageTileCache();
+
+        CziImageTileCache(const CziImageTileCache&);
+
+        CziImageTileCache& operator=(const CziImageTileCache&);
+
+        void runLoadTask();
+
+        bool composeImage(CziImageFile* cziImageFile,
+                          const std::vector<TileGrid>& tileGrids,
+                          const QRectF& imageLogicalRect,
+                          const std::array<uint8_t, 3>& backgroundRGB,
+                          const std::array<float, 3>& backgroundFloatRGB,
+                          const void* requester,
+                          const libCZI::BitmapLockInfo& imageLockInfo,
+                          const int32_t imageWidth,
+                          const int32_t imageHeight,
+                          std::vector<TileRequest>& placeholderRequestsOut,
+                          std::vector<TileRequest>& sharpRequestsOut);
+
+        void requestTiles(const void* requester,
+                          const std::vector<TileRequest>& tileRequests);
+
+        void loadTilesNow(const std::vector<TileRequest>& tileRequests);
+
+        static bool readTile(const TileRequest& tileRequest,
+                             std::shared_ptr<libCZI::IBitmapData>& bitmapDataOut);
+
+        void addTile(const Key& key,
+                     const QRectF& logicalRect,
+                     std::shared_ptr<libCZI::IBitmapData>& bitmapData);
+
+        void removeTile(std::map<Key, Tile>::iterator iter);
+
+        void removeExcessTiles();
+
+        static void copyTileToImage(const Tile& tile,
+                                    const QRectF& clipLogicalRect,
+                                    const QRectF& imageLogicalRect,
+                                    const float imageZoom,
+                                    const libCZI::BitmapLockInfo& imageLockInfo,
+                                    const int32_t imageWidth,
+                                    const int32_t imageHeight);
+
+        /** Protects all members, never held while reading from a file */
+        mutable QMutex m_mutex;
+
+        /** Signaled when the load task finishes reading a tile */
+        QWaitCondition m_readFinishedCondition;
+
+        std::map<Key, Tile> m_tiles;
+
+        /** Most recently used at front */
+        std::list<Key> m_leastRecentlyUsed;
+
+        /** Tiles waiting to be read by the load task, first is read first */
+        std::deque<TileRequest> m_pendingRequests;
+
+        /** File being read by the load task, NULL when not reading */
+        const CziImageFile* m_loadTaskReadFile;
+
+        bool m_loadTaskActive;
+
+        /** Incremented when a tile is added, a loader whose image was incomplete rebuilds it after a change */
+        int64_t m_tileLoadedCounter;
+
+        int64_t m_numberOfBytes;
+
+        int64_t m_maximumBytes;
+
+        /** Limits how often tilesLoaded() is emitted while many tiles are loading */
+        QElapsedTimer m_tilesLoadedSignalTimer;
+
+        static bool s_enabled;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __CZI_IMAGE_TILE_CACHE_DECLARE__
+    const int32_t CziImageTileCache::TILE_PIXEL_SIZE = 512;
+    bool CziImageTileCache::s_enabled = true;
+#endif // __CZI_IMAGE_TILE_CACHE_DECLARE__
+
+} // namespace
+#endif  //__CZI_IMAGE_TILE_CACHE_H__
@@ -0,0 +1,317 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __DATA_FILE_STATISTICS_SIDECAR_DECLARE__
+#include "DataFileStatisticsSidecar.h"
+#undef __DATA_FILE_STATISTICS_SIDECAR_DECLARE__
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+
+#include "CaretLogger.h"
+#include "DataFile.h"
+#include "FastStatistics.h"
+#include "Histogram.h"
+
+using namespace caret;
+
+/**
+ * \class caret::DataFileStatisticsSidecar
+ * \brief Saves the file-wide statistics and histogram of a data file next to it
+ * \ingroup Files
+ *
+ * Computing the statistics and histogram of all data in a file requires
+ * reading the entire file, which takes a long time for large series files.
+ * They are saved in a sidecar file ("<data file name>.wbstats"), along with
+ * the range and mean of each map, and reused when the file is opened again,
+ * as long as the data file's size and modification time have not changed.
+ *
+ * The sidecar is in native byte order, one written on a machine with a
+ * different byte order is ignored.  Sidecars are not used for files on
+ * the network.  A sidecar is written to a temporary file that is renamed,
+ * so a partially written sidecar is never read.  Failure to read or write
+ * a sidecar is never an error, the statistics are computed from the data
+ * instead.
+ *
+ * Enabled by default, disabled by setEnabled() or by setting the
+ * environment variable WB_STATISTICS_SIDECAR to "0" (for example, when
+ * data directories are shared and should not get extra files).
+ */
+
+namespace
+{
+    const char SIDECAR_MAGIC[8] = { 'W', 'B', 'S', 'T', 'A', 'T', '0', '2' };
+
+    struct SidecarHeader
+    {//followed by the statistics and then the histogram, as written by their appendBinary(), and then the map summaries
+        char m_magic[8];
+        int32_t m_endianCheck;
+        int32_t m_hasStatistics, m_hasHistogram;
+        int32_t m_numberOfMaps;
+        int64_t m_dataFileSize, m_dataFileTime;
+    };
+}
+
+/**
+ * Constructor.
+ */
+DataFileStatisticsSidecar::DataFileStatisticsSidecar()
+{
+}
+
+/**
+ * @return True if sidecars are read and written.
+ */
+bool
+DataFileStatisticsSidecar::isEnabled()
+{
+    if ( ! s_enabledSet) {
+        const char* envValue = getenv("WB_STATISTICS_SIDECAR");
+        s_enabled = ((envValue == NULL)
+                     || (strcmp(envValue, "0") != 0));
+        s_enabledSet = true;
+    }
+    return s_enabled;
+}
+
+/**
+ * Set reading and writing of sidecars, overrides the environment variable.
+ * @param enabled
+ *    New status.
+ */
+void
+DataFileStatisticsSidecar::setEnabled(const bool enabled)
+{
+    s_enabled = enabled;
+    s_enabledSet = true;
+}
+
+/**
+ * @return Name of the sidecar file for a data file.
+ * @param dataFileName
+ *    Name of the data file.
+ */
+AString
+DataFileStatisticsSidecar::getSidecarFileName(const AString& dataFileName)
+{
+    return (dataFileName + ".wbstats");
+}
+
+/**
+ * Get the size and modification time of a data file.
+ * @param dataFileName
+ *    Name of the data file.
+ * @param sizeOut
+ *    Output with size in bytes.
+ * @param timeOut
+ *    Output with modification time in milliseconds since the epoch.
+ * @return
+ *    True if the data file is a local file that exists.
+ */
+bool
+DataFileStatisticsSidecar::getDataFileSizeAndTime(const AString& dataFileName,
+                                                  int64_t& sizeOut,
+                                                  int64_t& timeOut)
+{
+    if (dataFileName.isEmpty()
+        || DataFile::isFileOnNetwork(dataFileName)) {
+        return false;
+    }
+    QFileInfo fileInfo(dataFileName);
+    if ( ! fileInfo.isFile()) {
+        return false;
+    }
+    sizeOut = fileInfo.size();
+    timeOut = fileInfo.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+/**
+ * Read the statistics and histogram saved for a data file.
+ * @param dataFileName
+ *    Name of the data file.
+ * @param statisticsOut
+ *    Output with the statistics, NULL if they were not saved.
+ * @param histogramOut
+ *    Output with the histogram, NULL if it was not saved.
+ * @param mapSummariesOut
+ *    Output with the range and mean of each map, empty if they were not saved.
+ * @return
+ *    True if a valid sidecar matching the data file was read.
+ */
+bool
+DataFileStatisticsSidecar::read(const AString& dataFileName,
+                                CaretPointer<FastStatistics>& statisticsOut,
+                                CaretPointer<Histogram>& histogramOut,
+                                std::vector<PartitionedStatistics::PartSummary>& mapSummariesOut)
+{
+    statisticsOut.grabNew(NULL);
+    histogramOut.grabNew(NULL);
+    mapSummariesOut.clear();
+    if ( ! isEnabled()) {
+        return false;
+    }
+    int64_t dataFileSize(0), dataFileTime(0);
+    if ( ! getDataFileSizeAndTime(dataFileName,
+                                  dataFileSize,
+                                  dataFileTime)) {
+        return false;
+    }
+    const AString sidecarFileName(getSidecarFileName(dataFileName));
+    QFile sidecarFile(sidecarFileName);
+    if ( ! sidecarFile.exists()) {
+        return false;
+    }
+    if ( ! sidecarFile.open(QIODevice::ReadOnly)) {
+        CaretLogFine("Unable to open statistics sidecar " + sidecarFileName);
+        return false;
+    }
+    const QByteArray contents(sidecarFile.readAll());
+    SidecarHeader header;
+    if (contents.size() < (int)sizeof(SidecarHeader)) {
+        CaretLogFine("Statistics sidecar " + sidecarFileName + " is truncated");
+        return false;
+    }
+    memcpy(&header, contents.constData(), sizeof(SidecarHeader));
+    if ((memcmp(header.m_magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC)) != 0)
+        || (header.m_endianCheck != 1)) {
+        CaretLogFine("Statistics sidecar " + sidecarFileName + " has the wrong format or byte order");
+        return false;
+    }
+    if ((header.m_dataFileSize != dataFileSize)
+        || (header.m_dataFileTime != dataFileTime)) {
+        /* data file has changed, a new sidecar is written after the statistics are computed */
+        return false;
+    }
+
+    const char* position = contents.constData() + sizeof(SidecarHeader);
+    const char* end = contents.constData() + contents.size();
+    CaretPointer<FastStatistics> statistics;
+    if (header.m_hasStatistics != 0) {
+        statistics.grabNew(new FastStatistics());
+        if ( ! statistics->readBinary(position, end)) {
+            CaretLogFine("Statistics sidecar " + sidecarFileName + " has invalid statistics");
+            return false;
+        }
+    }
+    CaretPointer<Histogram> histogram;
+    if (header.m_hasHistogram != 0) {
+        histogram.grabNew(new Histogram());
+        if ( ! histogram->readBinary(position, end)) {
+            CaretLogFine("Statistics sidecar " + sidecarFileName + " has an invalid histogram");
+            return false;
+        }
+    }
+    std::vector<PartitionedStatistics::PartSummary> mapSummaries;
+    if (header.m_numberOfMaps > 0) {
+        const int64_t summaryBytes = header.m_numberOfMaps * (int64_t)sizeof(PartitionedStatistics::PartSummary);
+        if ((end - position) < summaryBytes) {
+            CaretLogFine("Statistics sidecar " + sidecarFileName + " has truncated map summaries");
+            return false;
+        }
+        mapSummaries.resize(header.m_numberOfMaps);
+        memcpy(mapSummaries.data(), position, summaryBytes);
+    }
+    statisticsOut = statistics;
+    histogramOut  = histogram;
+    mapSummariesOut.swap(mapSummaries);
+    return true;
+}
+
+/**
+ * Save the statistics and histogram of a data file, replacing any existing sidecar.
+ * @param dataFileName
+ *    Name of the data file.
+ * @param statistics
+ *    Statistics of all data in the file, may be NULL.
+ * @param histogram
+ *    Histogram of all data in the file, may be NULL.
+ * @param mapSummaries
+ *    Range and mean of each map, may be empty.
+ */
+void
+DataFileStatisticsSidecar::write(const AString& dataFileName,
+                                 const FastStatistics* statistics,
+                                 const Histogram* histogram,
+                                 const std::vector<PartitionedStatistics::PartSummary>& mapSummaries)
+{
+    if ( ! isEnabled()) {
+        return;
+    }
+    if ((statistics == NULL)
+        && (histogram == NULL)) {
+        return;
+    }
+    SidecarHeader header;
+    memset(&header, 0, sizeof(SidecarHeader));
+    if ( ! getDataFileSizeAndTime(dataFileName,
+                                  header.m_dataFileSize,
+                                  header.m_dataFileTime)) {
+        return;
+    }
+    memcpy(header.m_magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+    header.m_endianCheck   = 1;
+    header.m_hasStatistics = ((statistics != NULL) ? 1 : 0);
+    header.m_hasHistogram  = ((histogram != NULL) ? 1 : 0);
+    header.m_numberOfMaps  = (int32_t)mapSummaries.size();
+
+    std::vector<char> buffer(sizeof(SidecarHeader));
+    memcpy(buffer.data(), &header, sizeof(SidecarHeader));
+    if (statistics != NULL) {
+        statistics->appendBinary(buffer);
+    }
+    if (histogram != NULL) {
+        histogram->appendBinary(buffer);
+    }
+    if ( ! mapSummaries.empty()) {
+        const char* summaryBytes = (const char*)mapSummaries.data();
+        buffer.insert(buffer.end(), summaryBytes, summaryBytes + mapSummaries.size() * sizeof(PartitionedStatistics::PartSummary));
+    }
+
+    /*
+     * Write to a temporary file and rename it so that a
+     * partially written sidecar is never read
+     */
+    const AString sidecarFileName(getSidecarFileName(dataFileName));
+    QTemporaryFile tempFile(sidecarFileName + ".XXXXXX");
+    if ( ! tempFile.open()) {
+        CaretLogFine("Unable to create statistics sidecar " + sidecarFileName);
+        return;
+    }
+    if (tempFile.write(buffer.data(), buffer.size()) != (qint64)buffer.size()) {
+        CaretLogFine("Unable to write statistics sidecar " + sidecarFileName);
+        return;
+    }
+    tempFile.close();
+    QFile::remove(sidecarFileName);
+    if (tempFile.rename(sidecarFileName)) {
+        tempFile.setAutoRemove(false);
+    }
+    else {
+        CaretLogFine("Unable to rename temporary file to statistics sidecar " + sidecarFileName);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef __DATA_FILE_STATISTICS_SIDECAR_H__
+#define __DATA_FILE_STATISTICS_SIDECAR_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretPointer.h"
+#include "PartitionedStatistics.h"
+
+namespace caret {
+
+    class FastStatistics;
+    class Histogram;
+
+    class DataFileStatisticsSidecar {
+
+    public:
+        static bool isEnabled();
+
+        static void setEnabled(const bool enabled);
+
+        static AString getSidecarFileName(const AString& dataFileName);
+
+        static bool read(const AString& dataFileName,
+                         CaretPointer<FastStatistics>& statisticsOut,
+                         CaretPointer<Histogram>& histogramOut,
+                         std::vector<PartitionedStatistics::PartSummary>& mapSummariesOut);
+
+        static void write(const AString& dataFileName,
+                          const FastStatistics* statistics,
+                          const Histogram* histogram,
+                          const std::vector<PartitionedStatistics::PartSummary>& mapSummaries);
+
+    private:
+        DataFileStatisticsSidecar();
+
+        static bool getDataFileSizeAndTime(const AString& dataFileName,
+                                           int64_t& sizeOut,
+                                           int64_t& timeOut);
+
+        static bool s_enabled;
+
+        static bool s_enabledSet;
+    };
+
+#ifdef __DATA_FILE_STATISTICS_SIDECAR_DECLARE__
+    bool DataFileStatisticsSidecar::s_enabled = true;
+    bool DataFileStatisticsSidecar::s_enabledSet = false;
+#endif // __DATA_FILE_STATISTICS_SIDECAR_DECLARE__
+
+} // namespace
+
+#endif  //__DATA_FILE_STATISTICS_SIDECAR_H__
@@ -27,7 +27,9 @@
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <stdint.h>
 
 using namespace caret;
@@ -39,8 +41,9 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
     TopologyHelper topoHelpIn(topoBase);//leave this building one privately, to not introduce even worse dependencies regarding SurfaceFile
     m_corrAreaSmallestFactor = 1.0f;
     numNodes = surfaceIn->getNumberOfNodes();
-    nodeNeighbors.resize(numNodes);
-    distances.resize(numNodes);
+    vector<vector<float> > tempDists(numNodes), tempDists2(numNodes);//built per node, then flattened into CSR arrays at the end
+    vector<vector<int32_t> > tempNeighbors(numNodes), tempNeighbors2(numNodes);
+    vector<vector<CrawlInfo> > tempPathInfo(numNodes);
     nodeCoords.resize(numNodes);
     vector<float> sqrtCorrAreas;//each edge has 2 vertices that influence it - assume that each influences a piece of the edge with a ratio depending on the square roots of the vertex areas
     vector<float> sqrtVertAreas;//we also assume isometric expansion at each vertex
@@ -61,17 +64,17 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
     bool firstCorrArea = true;//if all corrected vertex areas are significantly larger than 1, we can make A* faster by multiplying all euclidean distances by it, so find the actual smallest
     for (int32_t i = 0; i < numNodes; ++i)
     {//get neighbors
-        vector<int32_t>& neighbors = nodeNeighbors[i];
+        vector<int32_t>& neighbors = tempNeighbors[i];
         neighbors = topoHelpIn.getNodeNeighbors(i);
         nodeCoords[i] = surfaceIn->getCoordinate(i);
         const Vector3D baseCoord = nodeCoords[i];
         int numNeigh = (int)neighbors.size();
-        distances[i].resize(numNeigh);
+        tempDists[i].resize(numNeigh);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
             Vector3D neighCoord = surfaceIn->getCoordinate(neighbors[j]);
             tempvec = baseCoord - neighCoord;
-            distances[i][j] = tempvec.length();//precompute for speed in other calls
+            tempDists[i][j] = tempvec.length();//precompute for speed in other calls
             if (correctedAreas != NULL)
             {
                 float correctionFactor = (sqrtCorrAreas[i] + sqrtCorrAreas[neighbors[j]]) / (sqrtVertAreas[i] + sqrtVertAreas[neighbors[j]]);
@@ -80,21 +83,16 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
                     m_corrAreaSmallestFactor = correctionFactor;//if this is zero anywhere, it just means that the euclidean part of the heuristic must be ignored (worst case, it does dijkstra)
                     firstCorrArea = false;
                 }
-                distances[i][j] *= correctionFactor;
+                tempDists[i][j] *= correctionFactor;
             }
             if (i < neighbors[j])
             {
-                nodeSpacingAccum += distances[i][j];
+                nodeSpacingAccum += tempDists[i][j];
                 ++numEdges;
             }
         }//so few floating point operations, this should turn out symmetric
     }
     m_avgNodeSpacing = nodeSpacingAccum / numEdges;
-    std::vector<int32_t> tempneigh2;
-    std::vector<float> tempdist2;
-    nodeNeighbors2.resize(numNodes);
-    distances2.resize(numNodes);
-    neighbors2PathInfo.resize(numNodes);
     const vector<TopologyEdgeInfo>& myEdgeInfo = topoHelpIn.getEdgeInfo();
     CaretAssert(numEdges == (int32_t)myEdgeInfo.size());//SurfaceFile checks for triangles with duplicated nodes
     for (int i = 0; i < numEdges; ++i)
@@ -116,12 +114,12 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
         tempInfo.edgeNodes[0] = neigh1Node;
         tempInfo.edgeNodes[1] = neigh2Node;
         const int32_t num_reserve = 8;//uses 8 in case it is used on a mesh with haphazard topology
-        nodeNeighbors2[baseNode].reserve(num_reserve);//reserve should be fast if capacity is already num_reserve, and better than reallocating at 2 and 4, if vector allocation is naive doubling
-        nodeNeighbors2[farNode].reserve(num_reserve);//in the extremely rare case of a node with more than num_reserve neighbors, a second allocation plus copy isn't much of a cost
-        distances2[baseNode].reserve(num_reserve);
-        distances2[farNode].reserve(num_reserve);
-        neighbors2PathInfo[baseNode].reserve(num_reserve);
-        neighbors2PathInfo[farNode].reserve(num_reserve);
+        tempNeighbors2[baseNode].reserve(num_reserve);//reserve should be fast if capacity is already num_reserve, and better than reallocating at 2 and 4, if vector allocation is naive doubling
+        tempNeighbors2[farNode].reserve(num_reserve);//in the extremely rare case of a node with more than num_reserve neighbors, a second allocation plus copy isn't much of a cost
+        tempDists2[baseNode].reserve(num_reserve);
+        tempDists2[farNode].reserve(num_reserve);
+        tempPathInfo[baseNode].reserve(num_reserve);
+        tempPathInfo[farNode].reserve(num_reserve);
         Vector3D abhat = (neigh2Coord - neigh1Coord).normal(&abmag);//a is neigh1, b is neigh2, b - a = (vector)ab
         Vector3D ac = farCoord - neigh1Coord;//c is farnode, c - a = (vector)ac
         Vector3D ad = abhat * abhat.dot(ac);//d is the point on the shared edge that farnode (c) is closest to
@@ -151,16 +149,45 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
             tempInfo.pieceDists[1] *= correctionFactor;
         }//for now, assume it only depends on the expansion of the endpoints, and affects each part equally
         tempInfo.pieceDists[0] = tempf - tempInfo.pieceDists[1];
-        nodeNeighbors2[farNode].push_back(baseNode);//record it at both ends, because we are looping through edges
-        distances2[farNode].push_back(tempf);
-        neighbors2PathInfo[farNode].push_back(tempInfo);
+        tempNeighbors2[farNode].push_back(baseNode);//record it at both ends, because we are looping through edges
+        tempDists2[farNode].push_back(tempf);
+        tempPathInfo[farNode].push_back(tempInfo);
         
         float tempf2 = tempInfo.pieceDists[0];//swap the piece distances around for the baseNode info
         tempInfo.pieceDists[0] = tempInfo.pieceDists[1];
         tempInfo.pieceDists[1] = tempf2;
-        nodeNeighbors2[baseNode].push_back(farNode);
-        distances2[baseNode].push_back(tempf);
-        neighbors2PathInfo[baseNode].push_back(tempInfo);
+        tempNeighbors2[baseNode].push_back(farNode);
+        tempDists2[baseNode].push_back(tempf);
+        tempPathInfo[baseNode].push_back(tempInfo);
+    }
+    flattenLists(tempNeighbors, tempDists, NULL, m_neighOffsets, nodeNeighbors, distances, NULL, m_maxEdgeLength);
+    flattenLists(tempNeighbors2, tempDists2, &tempPathInfo, m_neigh2Offsets, nodeNeighbors2, distances2, &neighbors2PathInfo, m_maxEdge2Length);
+}
+
+void GeodesicHelperBase::flattenLists(const vector<vector<int32_t> >& neighLists, const vector<vector<float> >& distLists, const vector<vector<CrawlInfo> >* infoLists,
+                                      vector<int64_t>& offsetsOut, vector<int32_t>& neighOut, vector<float>& distOut, vector<CrawlInfo>* infoOut, float& maxDistOut)
+{
+    int32_t numLists = (int32_t)neighLists.size();
+    offsetsOut.resize(numLists + 1);
+    offsetsOut[0] = 0;
+    for (int32_t i = 0; i < numLists; ++i)
+    {
+        offsetsOut[i + 1] = offsetsOut[i] + (int64_t)neighLists[i].size();
+    }
+    neighOut.resize(offsetsOut[numLists]);
+    distOut.resize(offsetsOut[numLists]);
+    if (infoOut != NULL) infoOut->resize(offsetsOut[numLists]);
+    maxDistOut = 0.0f;
+    for (int32_t i = 0; i < numLists; ++i)
+    {
+        int64_t base = offsetsOut[i];
+        for (int64_t j = 0; j < (int64_t)neighLists[i].size(); ++j)
+        {
+            neighOut[base + j] = neighLists[i][j];
+            distOut[base + j] = distLists[i][j];
+            if (distLists[i][j] > maxDistOut) maxDistOut = distLists[i][j];
+            if (infoOut != NULL) (*infoOut)[base + j] = (*infoLists)[i][j];
+        }
     }
 }
 
@@ -175,8 +202,14 @@ GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& bas
     distances2 = m_myBase->distances2.data();
     nodeNeighbors = m_myBase->nodeNeighbors.data();
     nodeNeighbors2 = m_myBase->nodeNeighbors2.data();
+    neighOffsets = m_myBase->m_neighOffsets.data();
+    neigh2Offsets = m_myBase->m_neigh2Offsets.data();
     nodeCoords = m_myBase->nodeCoords.data();
     neighbors2PathInfo = m_myBase->neighbors2PathInfo.data();
+    m_maxEdgeLength = m_myBase->m_maxEdgeLength;
+    m_maxEdge2Length = m_myBase->m_maxEdge2Length;
+    m_bucketWidth = m_avgNodeSpacing / 2.0f;//narrower buckets mean fewer relabels inside a bucket, but more empty buckets to step over
+    if (!(m_bucketWidth > 0.0f)) m_bucketWidth = 1.0f;
     //allocate private scratch space
     marked.resize(numNodes, 0);//initialize once, each internal function (dijkstra methods) tracks elements changed, and resets only those (except in the case of whole surface)
     m_heapIdent.resize(numNodes);//the idea is to make it faster for the more likely case of small areas of the surface for functions that have limits, by removing the runtime term based solely on surface size
@@ -232,14 +265,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
         nodes.push_back(whichnode);
         dists.push_back(output[whichnode]);
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4)
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j];//isn't precomputation wonderful
                 if (tempf <= maxdist)
                 {//keep it off the heap if it is too far
                     if (!(marked[whichneigh] & 4))
@@ -259,14 +292,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j];
                     if (tempf <= maxdist)
                     {//keep it off the heap if it is too far
                         if (!(marked[whichneigh] & 4))
@@ -305,14 +338,14 @@ void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
     {
         whichnode = m_active.pop();
         marked[whichnode] |= 1;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j];
                 if (!(marked[whichneigh] & 4))
                 {
                     marked[whichneigh] |= 4;
@@ -328,14 +361,14 @@ void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
         }
         if (smooth)
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j];
                     if (!(marked[whichneigh] & 4))
                     {
                         marked[whichneigh] |= 4;
@@ -423,6 +456,116 @@ void GeodesicHelper::getGeoFromNode(const int32_t node, std::vector<float>& valu
     parent = tempi;
 }
 
+void GeodesicHelper::getNodesToGeoDist(const vector<int32_t>& roots, const float maxdist, vector<vector<int32_t> >& nodesOut, vector<vector<float> >& distsOut, const bool smoothflag)
+{
+    int32_t numRoots = (int32_t)roots.size();
+    nodesOut.resize(numRoots);
+    distsOut.resize(numRoots);
+    CaretMutexLocker locked(&inUse);
+    for (int32_t r = 0; r < numRoots; ++r)
+    {
+        nodesOut[r].clear();
+        distsOut[r].clear();
+        CaretAssert(roots[r] >= 0 && roots[r] < numNodes);
+        if (roots[r] < 0 || roots[r] >= numNodes || maxdist < 0.0f) continue;
+        int32_t numChanged = bucketSearch(roots[r], maxdist, smoothflag);
+        sort(changed.begin(), changed.begin() + numChanged);//output by node index, not bucket discovery order, so the lists don't depend on how the search went
+        nodesOut[r].resize(numChanged);
+        distsOut[r].resize(numChanged);
+        for (int32_t i = 0; i < numChanged; ++i)
+        {
+            int32_t node = changed[i];
+            nodesOut[r][i] = node;
+            distsOut[r][i] = output[node];
+            marked[node] = 0;
+        }
+    }
+}
+
+void GeodesicHelper::getGeoFromNodes(const vector<int32_t>& roots, float* valuesOut, const bool smoothflag)
+{
+    CaretAssert(valuesOut != NULL);
+    if (valuesOut == NULL) return;
+    int32_t numRoots = (int32_t)roots.size();
+    CaretMutexLocker locked(&inUse);
+    for (int32_t r = 0; r < numRoots; ++r)
+    {
+        float* rowOut = valuesOut + ((int64_t)r) * numNodes;
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            rowOut[i] = -1.0f;
+        }
+        CaretAssert(roots[r] >= 0 && roots[r] < numNodes);
+        if (roots[r] < 0 || roots[r] >= numNodes) continue;
+        int32_t numChanged = bucketSearch(roots[r], numeric_limits<float>::infinity(), smoothflag);
+        for (int32_t i = 0; i < numChanged; ++i)
+        {
+            int32_t node = changed[i];
+            rowOut[node] = output[node];
+            marked[node] = 0;
+        }
+    }
+}
+
+int32_t GeodesicHelper::bucketSearch(const int32_t root, const float maxdist, bool smooth)
+{//bucket queue, label correcting within a bucket, so the result is exact even though buckets are wider than some edges
+    //a bucket can only be finished by the nodes inside it, so once we move past a bucket, everything in it is final
+    float maxEdge = m_maxEdgeLength;
+    if (smooth && m_maxEdge2Length > maxEdge) maxEdge = m_maxEdge2Length;
+    int64_t numBuckets = (int64_t)(maxEdge / m_bucketWidth) + 3;//an edge can reach at most this many buckets ahead (plus one for rounding), so a circular array never overwrites an unfinished bucket
+    if ((int64_t)m_buckets.size() < numBuckets) m_buckets.resize(numBuckets);
+    int32_t j, numNeigh, numChanged = 0;
+    int64_t pending = 1;
+    output[root] = 0.0f;
+    marked[root] = 4;
+    changed[numChanged++] = root;
+    m_buckets[0].push_back(pair<int32_t, float>(root, 0.0f));
+    for (int64_t curBucket = 0; pending > 0; ++curBucket)
+    {
+        vector<pair<int32_t, float> >& bucket = m_buckets[curBucket % numBuckets];
+        for (size_t entry = 0; entry < bucket.size(); ++entry)//bucket can grow while we go, so index rather than iterate
+        {
+            --pending;
+            int32_t whichnode = bucket[entry].first;
+            float nodeDist = bucket[entry].second;
+            if (nodeDist != output[whichnode]) continue;//stale, node was improved after this entry was added
+            for (int pass = 0; pass < (smooth ? 2 : 1); ++pass)
+            {
+                const int32_t* neighbors;
+                const float* neighDists;
+                if (pass == 0)
+                {
+                    neighbors = nodeNeighbors + neighOffsets[whichnode];
+                    neighDists = distances + neighOffsets[whichnode];
+                    numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
+                } else {
+                    neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+                    neighDists = distances2 + neigh2Offsets[whichnode];
+                    numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
+                }
+                for (j = 0; j < numNeigh; ++j)
+                {
+                    int32_t whichneigh = neighbors[j];
+                    float tempf = nodeDist + neighDists[j];
+                    if (tempf > maxdist) continue;
+                    if (!(marked[whichneigh] & 4))
+                    {
+                        marked[whichneigh] = 4;
+                        changed[numChanged++] = whichneigh;
+                    } else if (!(tempf < output[whichneigh])) {
+                        continue;
+                    }
+                    output[whichneigh] = tempf;
+                    m_buckets[((int64_t)(tempf / m_bucketWidth)) % numBuckets].push_back(pair<int32_t, float>(whichneigh, tempf));
+                    ++pending;
+                }
+            }
+        }
+        bucket.clear();
+    }
+    return numChanged;
+}
+
 void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& interested, bool smooth)
 {
     int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0, remain = 0;
@@ -456,14 +599,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& in
             --remain;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j];//isn't precomputation wonderful
                 if (!(marked[whichneigh] & 4))
                 {
                     if (!marked[whichneigh])
@@ -483,14 +626,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& in
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j];
                     if (!(marked[whichneigh] & 4))
                     {
                         if (!marked[whichneigh])
@@ -552,14 +695,14 @@ int32_t GeodesicHelper::dijkstra(const vector<int32_t>& startList, const vector<
             break;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j];
                 if (tempf <= maxDist)
                 {
                     if (!(marked[whichneigh] & 4))
@@ -582,14 +725,14 @@ int32_t GeodesicHelper::dijkstra(const vector<int32_t>& startList, const vector<
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j];
                     if (tempf <= maxDist)
                     {
                         if (!(marked[whichneigh] & 4))
@@ -640,14 +783,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, const floa
             break;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j];//isn't precomputation wonderful
                 if (tempf <= maxdist)
                 {
                     if (!(marked[whichneigh] & 4))
@@ -670,14 +813,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, const floa
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];//isn't precomputation wonderful
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j];//isn't precomputation wonderful
                     if (tempf <= maxdist)
                     {
                         if (!(marked[whichneigh] & 4))
@@ -727,14 +870,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, bool smoot
             break;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j];//isn't precomputation wonderful
                 if (!(marked[whichneigh] & 4))
                 {
                     parent[whichneigh] = whichnode;
@@ -754,14 +897,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, bool smoot
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];//isn't precomputation wonderful
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j];//isn't precomputation wonderful
                     if (!(marked[whichneigh] & 4))
                     {
                         parent[whichneigh] = whichnode;
@@ -806,14 +949,14 @@ void GeodesicHelper::aStar(const int32_t root, const int32_t endpoint, bool smoo
         whichnode = m_active.pop();//we use a modifiable heap, so we don't need to check for duplicates
         marked[whichnode] |= 1;//frozen - will already be in changed list, due to being in heap
         if (whichnode == endpoint) break;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j];
                 if (!(marked[whichneigh] & 4))
                 {
                     heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -831,14 +974,14 @@ void GeodesicHelper::aStar(const int32_t root, const int32_t endpoint, bool smoo
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j];
                     if (!(marked[whichneigh] & 4))
                     {
                         heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -908,14 +1051,14 @@ void GeodesicHelper::aStarLine(const int32_t& root, const int32_t& endpoint, con
         whichnode = m_active.pop();//we use a modifiable heap, so we don't need to check for duplicates
         marked[whichnode] |= 1;//frozen - will already be in changed list, due to being in heap
         if (whichnode == endpoint) break;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j] + penaltyScale * distances[whichnode][j] * (linePenalty(nodeCoords[whichnode], linep1, linep2, segment) + linePenalty(nodeCoords[whichneigh], linep1, linep2, segment));
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j] + penaltyScale * distances[neighOffsets[whichnode] + j] * (linePenalty(nodeCoords[whichnode], linep1, linep2, segment) + linePenalty(nodeCoords[whichneigh], linep1, linep2, segment));
                 if (!(marked[whichneigh] & 4))
                 {
                     remainEucl = (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -956,14 +1099,14 @@ void GeodesicHelper::aStarData(const int32_t& root, const int32_t& endpoint, con
         whichnode = m_active.pop();//we use a modifiable heap, so we don't need to check for duplicates
         marked[whichnode] |= 1;//frozen - will already be in changed list, due to being in heap
         if (whichnode == endpoint) break;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighOffsets[whichnode];
+        numNeigh = (int32_t)(neighOffsets[whichnode + 1] - neighOffsets[whichnode]);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if ((roiData == NULL || roiData[whichneigh] > 0.0f) && !(marked[whichneigh] & 1))
             {//skip floating point math if frozen or outside roi
-                tempf = output[whichnode] + distances[whichnode][j] * (1.0f + followStrength * (data[whichnode] + data[whichneigh]));//integrate 1 + strength * value to get distance plus path-integrated data
+                tempf = output[whichnode] + distances[neighOffsets[whichnode] + j] * (1.0f + followStrength * (data[whichnode] + data[whichneigh]));//integrate 1 + strength * value to get distance plus path-integrated data
                 if (!(marked[whichneigh] & 4))
                 {
                     heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -981,16 +1124,16 @@ void GeodesicHelper::aStarData(const int32_t& root, const int32_t& endpoint, con
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
-            const GeodesicHelperBase::CrawlInfo* pathInfo = neighbors2PathInfo[whichnode].data();
+            neighbors = nodeNeighbors2 + neigh2Offsets[whichnode];
+            numNeigh = (int32_t)(neigh2Offsets[whichnode + 1] - neigh2Offsets[whichnode]);
+            const GeodesicHelperBase::CrawlInfo* pathInfo = neighbors2PathInfo + neigh2Offsets[whichnode];
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if ((roiData == NULL || roiData[whichneigh] > 0.0f) && !(marked[whichneigh] & 1))
                 {//skip floating point math if frozen or outside roi
-                    tempf = output[whichnode] + distances2[whichnode][j] + followStrength * (data[whichnode] * pathInfo[j].pieceDists[0] + data[whichneigh] * pathInfo[j].pieceDists[1]
-                                + distances2[whichnode][j] * (data[pathInfo[j].edgeNodes[0]] * pathInfo[j].edgeWeight + data[pathInfo[j].edgeNodes[1]] * (1.0f - pathInfo[j].edgeWeight)));
+                    tempf = output[whichnode] + distances2[neigh2Offsets[whichnode] + j] + followStrength * (data[whichnode] * pathInfo[j].pieceDists[0] + data[whichneigh] * pathInfo[j].pieceDists[1]
+                                + distances2[neigh2Offsets[whichnode] + j] * (data[pathInfo[j].edgeNodes[0]] * pathInfo[j].edgeWeight + data[pathInfo[j].edgeNodes[1]] * (1.0f - pathInfo[j].edgeWeight)));
                     if (!(marked[whichneigh] & 4))
                     {
                         heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
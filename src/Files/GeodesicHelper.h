@@ -22,6 +22,7 @@
  */
 /*LICENSE_END*/
 
+#include <utility>
 #include <vector>
 #include <stdint.h>
 
@@ -49,13 +50,18 @@ namespace caret {
         GeodesicHelperBase();//can't construct without arguments
         GeodesicHelperBase& operator=(const GeodesicHelperBase& right);//can't assign
         GeodesicHelperBase(const GeodesicHelperBase& right);//can't use copy constructor
-        std::vector<std::vector<float> > distances, distances2;
-        std::vector<std::vector<int32_t> > nodeNeighbors, nodeNeighbors2;
-        std::vector<std::vector<CrawlInfo> > neighbors2PathInfo;
+        //compressed sparse row layout: the neighbors of node i are at [m_neighOffsets[i], m_neighOffsets[i + 1]) in nodeNeighbors and distances
+        std::vector<int64_t> m_neighOffsets, m_neigh2Offsets;
+        std::vector<float> distances, distances2;
+        std::vector<int32_t> nodeNeighbors, nodeNeighbors2;
+        std::vector<CrawlInfo> neighbors2PathInfo;//same layout as nodeNeighbors2
         std::vector<Vector3D> nodeCoords;//for line-following and A*
         int32_t numNodes;
         float m_avgNodeSpacing;//to use for balancing line following penalty
         float m_corrAreaSmallestFactor;//so that heuristics can be consistent despite corrected areas
+        float m_maxEdgeLength, m_maxEdge2Length;//for sizing the bucket queue
+        static void flattenLists(const std::vector<std::vector<int32_t> >& neighLists, const std::vector<std::vector<float> >& distLists, const std::vector<std::vector<CrawlInfo> >* infoLists,
+                                 std::vector<int64_t>& offsetsOut, std::vector<int32_t>& neighOut, std::vector<float>& distOut, std::vector<CrawlInfo>* infoOut, float& maxDistOut);
     public:
         explicit GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas = NULL);//NOTE: this is only an APPROXIMATE correction, use the real surface whenever possible
         friend class GeodesicHelper;//let it grab the private variables it needs
@@ -66,9 +72,12 @@ namespace caret {
         CaretPointer<const GeodesicHelperBase> m_myBase;//mostly just for automatic memory management
         CaretMutex inUse;//could add a function and a locker pointer to be able to lock to thread once, then call repeatedly without locking, if mutex overhead is actually a factor
         CaretMinHeap<int32_t, float> m_active;//save and reuse the allocated space
-        const std::vector<float>* distances, *distances2;
-        const std::vector<int32_t>* nodeNeighbors, *nodeNeighbors2;
-        const std::vector<GeodesicHelperBase::CrawlInfo>* neighbors2PathInfo;
+        const float* distances, *distances2;
+        const int32_t* nodeNeighbors, *nodeNeighbors2;
+        const int64_t* neighOffsets, *neigh2Offsets;
+        const GeodesicHelperBase::CrawlInfo* neighbors2PathInfo;
+        float m_bucketWidth, m_maxEdgeLength, m_maxEdge2Length;
+        std::vector<std::vector<std::pair<int32_t, float> > > m_buckets;//circular bucket queue for the batch methods, entries are node and the distance it was queued with
         const Vector3D* nodeCoords;
         float* output;
         int32_t* parent;
@@ -84,6 +93,7 @@ namespace caret {
         GeodesicHelper(const GeodesicHelper&);//can't use copy constructor
         void dijkstra(const int32_t root, const float maxdist, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth);//geodesic distance restricted
         void dijkstra(const int32_t root, bool smooth);//full surface
+        int32_t bucketSearch(const int32_t root, const float maxdist, bool smooth);//fills output for reached nodes, which are listed in changed, returns how many - caller must reset marked
         void dijkstra(const int32_t root, const std::vector<int32_t>& interested, bool smooth);//partial surface
         int32_t dijkstra(const std::vector<int32_t>& startList, const std::vector<int32_t>& endList, const float& maxDist, bool smooth);//one path that connects lists
         int32_t closest(const int32_t& root, const char* roi, const float& maxdist, float& distOut, bool smooth);//just closest node
@@ -113,6 +123,12 @@ namespace caret {
         /// Get distances from root node to entire surface, and their parents, vector method (root node has -1 as parent)
         void getGeoFromNode(const int32_t node, std::vector<float>& valuesOut, std::vector<int32_t>& parentsOut, const bool smoothflag = true);
 
+        /// Get distances from each of several root nodes up to a cutoff, using a bucket queue - output vectors have one entry per root (same order as roots), nodes are sorted by node index, NOT by distance
+        void getNodesToGeoDist(const std::vector<int32_t>& roots, const float maxdist, std::vector<std::vector<int32_t> >& nodesOut, std::vector<std::vector<float> >& distsOut, const bool smoothflag = true);
+        
+        /// Get distances from each of several root nodes to the entire surface, valuesOut must be allocated to roots.size() * number of nodes, one row per root, -1 where unreachable
+        void getGeoFromNodes(const std::vector<int32_t>& roots, float* valuesOut, const bool smoothflag = true);
+        
         /// Get distances to a restricted set of nodes - output vector is in the SAME ORDER and same size as the input vector ofInterest
         void getGeoToTheseNodes(const int32_t root, const std::vector<int32_t>& ofInterest, std::vector<float>& distsOut, bool smoothflag = true);
         
@@ -22,16 +22,31 @@
 
 #include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "SurfaceFile.h"
 #include "MetricFile.h"
 #include "GeodesicHelper.h"
 #include "TopologyHelper.h"
 #include "CaretOMP.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 using namespace std;
 using namespace caret;
 
+namespace
+{
+    const int32_t GEO_BLOCK_SIZE = 64;//roots per batched geodesic call, small enough that dynamic scheduling still balances threads
+}
+
 MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
 {
     CaretAssert(mySurf != NULL);
@@ -46,7 +61,7 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_matrix->m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +69,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != m_matrix->m_numNodes || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(m_matrix->m_numNodes, 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != m_matrix->m_numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -75,15 +90,15 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_matrix->m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != m_matrix->m_numNodes)
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != m_matrix->m_numNodes))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -113,29 +128,147 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_matrix->m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != m_matrix->m_numNodes || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(m_matrix->m_numNodes, numCols);
     }
-    vector<float> scratch(metricIn->getNumberOfNodes());
-    if (roi != NULL)
+    if (roi != NULL && roi->getNumberOfNodes() != m_matrix->m_numNodes)
+    {
+        throw CaretException("roi does not match surface number of nodes");
+    }
+    smoothColumns(metricIn, 0, numCols, metricOut, 0, roi, 0, fixZeros);
+}
+
+void MetricSmoothingObject::smoothColumns(const MetricFile* metricIn, const int& firstColumn, const int& numColumns, MetricFile* metricOut, const int& firstOutColumn,
+                                          const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const
+{
+    CaretAssert(metricIn != NULL);
+    CaretAssert(metricOut != NULL);
+    int32_t numNodes = m_matrix->m_numNodes;
+    if (metricIn->getNumberOfNodes() != numNodes)
+    {
+        throw CaretException("metric does not match surface number of nodes");
+    }
+    if (metricOut->getNumberOfNodes() != numNodes)
+    {
+        throw CaretException("output metric does not match surface number of nodes");
+    }
+    if (roi != NULL && roi->getNumberOfNodes() != numNodes)
+    {
+        throw CaretException("roi does not match surface number of nodes");
+    }
+    if (numColumns < 0 || firstColumn < 0 || firstColumn + numColumns > metricIn->getNumberOfColumns())
+    {
+        throw CaretException("invalid input column range");
+    }
+    if (firstOutColumn < 0 || firstOutColumn + numColumns > metricOut->getNumberOfColumns())
+    {
+        throw CaretException("invalid output column range");
+    }
+    if (roi != NULL && (whichRoiColumn < 0 || whichRoiColumn >= roi->getNumberOfColumns()))
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        throw CaretException("invalid roi column number");
+    }
+    const float* roiColumn = NULL;
+    if (roi != NULL) roiColumn = roi->getValuePointerForColumn(whichRoiColumn);
+    vector<float> tileIn(((int64_t)numNodes) * COLUMN_TILE), tileOut(((int64_t)numNodes) * COLUMN_TILE), scratch(numNodes);
+    for (int tileStart = 0; tileStart < numColumns; tileStart += COLUMN_TILE)
+    {
+        int tileWidth = min(COLUMN_TILE, numColumns - tileStart);
+        const float* inColumns[COLUMN_TILE];
+        for (int c = 0; c < tileWidth; ++c)
         {
-            throw CaretException("roi does not match surface number of nodes");
+            inColumns[c] = metricIn->getValuePointerForColumn(firstColumn + tileStart + c);
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int32_t i = 0; i < numNodes; ++i)
+        {//transpose into a row-major tile, so each neighbor's values for all columns are contiguous
+            float* rowIn = tileIn.data() + ((int64_t)i) * COLUMN_TILE;
+            for (int c = 0; c < tileWidth; ++c)
+            {
+                rowIn[c] = inColumns[c][i];
+            }
+            for (int c = tileWidth; c < COLUMN_TILE; ++c)
+            {
+                rowIn[c] = 0.0f;//the last tile is padded, cheaper than a second kernel for odd widths
+            }
         }
-        for (int32_t i = 0; i < numCols; ++i)
+        smoothTileInternal(tileIn.data(), tileOut.data(), roiColumn, fixZeros);
+        for (int c = 0; c < tileWidth; ++c)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, roi, 0, fixZeros);
+            for (int32_t i = 0; i < numNodes; ++i)
+            {
+                scratch[i] = tileOut[((int64_t)i) * COLUMN_TILE + c];
+            }
+            metricOut->setValuesForColumn(firstOutColumn + tileStart + c, scratch.data());
         }
-    } else {
-        for (int32_t i = 0; i < numCols; ++i)
+    }
+}
+
+void MetricSmoothingObject::smoothTileInternal(const float* tileIn, float* tileOut, const float* roiColumn, const bool& fixZeros) const
+{//sparse matrix times a row-major block of COLUMN_TILE columns, the fixed width lets the compiler vectorize the inner loops
+    const WeightMatrix& matrix = *m_matrix;
+    int32_t numNodes = matrix.m_numNodes;
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        float* rowOut = tileOut + ((int64_t)i) * COLUMN_TILE;
+        if ((roiColumn != NULL && !(roiColumn[i] > 0.0f)) || matrix.m_weightSums[i] == 0.0f)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, fixZeros);
+            for (int c = 0; c < COLUMN_TILE; ++c)
+            {
+                rowOut[c] = 0.0f;
+            }
+            continue;
+        }
+        float sum[COLUMN_TILE], weightsum[COLUMN_TILE];
+        for (int c = 0; c < COLUMN_TILE; ++c)
+        {
+            sum[c] = 0.0f;
+            weightsum[c] = 0.0f;
+        }
+        float roiWeightSum = 0.0f;
+        int64_t rowEnd = matrix.m_rowStarts[i + 1];
+        if (fixZeros)
+        {
+            for (int64_t j = matrix.m_rowStarts[i]; j < rowEnd; ++j)
+            {
+                int32_t neighbor = matrix.m_nodes[j];
+                if (roiColumn != NULL && !(roiColumn[neighbor] > 0.0f)) continue;
+                float weight = matrix.m_weights[j];
+                const float* rowIn = tileIn + ((int64_t)neighbor) * COLUMN_TILE;
+                for (int c = 0; c < COLUMN_TILE; ++c)
+                {//adding weight * 0 doesn't change the sum, so only the weight sum needs the zero test
+                    sum[c] += weight * rowIn[c];
+                    weightsum[c] += (rowIn[c] != 0.0f ? weight : 0.0f);
+                }
+            }
+            for (int c = 0; c < COLUMN_TILE; ++c)
+            {
+                rowOut[c] = (weightsum[c] != 0.0f ? sum[c] / weightsum[c] : 0.0f);
+            }
+        } else {
+            for (int64_t j = matrix.m_rowStarts[i]; j < rowEnd; ++j)
+            {
+                int32_t neighbor = matrix.m_nodes[j];
+                if (roiColumn != NULL && !(roiColumn[neighbor] > 0.0f)) continue;
+                float weight = matrix.m_weights[j];
+                const float* rowIn = tileIn + ((int64_t)neighbor) * COLUMN_TILE;
+                for (int c = 0; c < COLUMN_TILE; ++c)
+                {
+                    sum[c] += weight * rowIn[c];
+                }
+                roiWeightSum += weight;
+            }
+            float divisor = (roiColumn != NULL ? roiWeightSum : matrix.m_weightSums[i]);
+            for (int c = 0; c < COLUMN_TILE; ++c)
+            {
+                rowOut[c] = (divisor != 0.0f ? sum[c] / divisor : 0.0f);
+            }
         }
     }
 }
@@ -149,22 +282,22 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     CaretAssert(whichOutColumn >= 0 && whichOutColumn < metricOut->getNumberOfColumns());
     const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
     int32_t numNodes = metricIn->getNumberOfNodes();
+    const WeightMatrix& matrix = *m_matrix;
     if (fixZeros)//special case early to keep branching down
     {
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (matrix.m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = matrix.m_rowStarts[i + 1];
+                for (int64_t j = matrix.m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[matrix.m_nodes[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = matrix.m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,16 +316,15 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            if (matrix.m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = matrix.m_rowStarts[i + 1];
+                for (int64_t j = matrix.m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += matrix.m_weights[j] * myColumn[matrix.m_nodes[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / matrix.m_weightSums[i];
             } else {
                 scratch[i] = 0.0f;
             }
@@ -213,23 +345,23 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
     const float* roiColumn = roi->getValuePointerForColumn(whichRoiColumn);
     int32_t numNodes = metricIn->getNumberOfNodes();
+    const WeightMatrix& matrix = *m_matrix;
     if (fixZeros)//special case early to keep branching down
     {
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (roiColumn[i] > 0.0f && matrix.m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = matrix.m_rowStarts[i + 1];
+                for (int64_t j = matrix.m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = matrix.m_nodes[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = matrix.m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +380,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            if (roiColumn[i] > 0.0f && matrix.m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = matrix.m_rowStarts[i + 1];
+                for (int64_t j = matrix.m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = matrix.m_nodes[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = matrix.m_weights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -288,25 +419,38 @@ void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf,
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
         CaretPointer<GeodesicHelper> myGeoHelp(new GeodesicHelper(myGeoBase));
-        vector<float> distances;
+        vector<int32_t> roots;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
-        {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, m_weightLists[i].m_nodes, distances, true);
-            if (distances.size() < 7)
+        for (int32_t blockStart = 0; blockStart < numNodes; blockStart += GEO_BLOCK_SIZE)
+        {//batch the roots so the helper reuses its scratch and bucket queue across them
+            int32_t blockEnd = min(blockStart + GEO_BLOCK_SIZE, numNodes);
+            roots.clear();
+            for (int32_t i = blockStart; i < blockEnd; ++i)
             {
-                m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
-                m_weightLists[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
+                roots.push_back(i);
             }
-            int32_t numNeigh = (int32_t)distances.size();
-            m_weightLists[i].m_weights.resize(numNeigh);
-            m_weightLists[i].m_weightSum = 0.0f;
-            for (int32_t j = 0; j < numNeigh; ++j)
+            myGeoHelp->getNodesToGeoDist(roots, myGeoDist, blockNodes, blockDists, true);
+            for (int32_t i = blockStart; i < blockEnd; ++i)
             {
-                float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                m_weightLists[i].m_weights[j] = weight;
-                m_weightLists[i].m_weightSum += weight;
+                vector<float>& distances = blockDists[i - blockStart];
+                m_weightLists[i].m_nodes.swap(blockNodes[i - blockStart]);
+                if (distances.size() < 7)
+                {
+                    m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
+                    m_weightLists[i].m_nodes.push_back(i);
+                    myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
+                }
+                int32_t numNeigh = (int32_t)distances.size();
+                m_weightLists[i].m_weights.resize(numNeigh);
+                m_weightLists[i].m_weightSum = 0.0f;
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
+                    m_weightLists[i].m_weights[j] = weight;
+                    m_weightLists[i].m_weightSum += weight;
+                }
             }
         }
     }
@@ -369,33 +513,46 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
         CaretPointer<GeodesicHelper> myGeoHelp(new GeodesicHelper(myGeoBase));
-        vector<float> distances;
+        vector<int32_t> roots;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
-        {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
-            const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
-            if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
+        for (int32_t blockStart = 0; blockStart < numNodes; blockStart += GEO_BLOCK_SIZE)
+        {//batch the roots so the helper reuses its scratch and bucket queue across them
+            int32_t blockEnd = min(blockStart + GEO_BLOCK_SIZE, numNodes);
+            roots.clear();
+            for (int32_t i = blockStart; i < blockEnd; ++i)
             {
-                tempList[i].m_nodes = tempneighbors;
-                tempList[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
+                roots.push_back(i);
             }
-            int32_t numNeigh = (int32_t)distances.size();
-            tempList[i].m_weights.resize(numNeigh);
-            tempList[i].m_weightSum = 0.0f;
-            for (int32_t j = 0; j < numNeigh; ++j)
+            myGeoHelp->getNodesToGeoDist(roots, myGeoDist, blockNodes, blockDists, true);
+            for (int32_t i = blockStart; i < blockEnd; ++i)
             {
-                float weight = exp(distances[j] * distances[j] * gaussianDenom) * nodeAreas[tempList[i].m_nodes[j]];//exp(- dist ^ 2 / (2 * sigma ^ 2)) * area
-                tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
-                tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
-            }
-            float myFactor = nodeAreas[i] / tempList[i].m_weightSum;//make each scattering kernel sum to the area of the node it scatters from
-            for (int32_t j = 0; j < numNeigh; ++j)
-            {
-                tempList[i].m_weights[j] *= myFactor;
+                vector<float>& distances = blockDists[i - blockStart];
+                tempList[i].m_nodes.swap(blockNodes[i - blockStart]);
+                const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+                if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
+                {
+                    tempList[i].m_nodes = tempneighbors;
+                    tempList[i].m_nodes.push_back(i);
+                    myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
+                }
+                int32_t numNeigh = (int32_t)distances.size();
+                tempList[i].m_weights.resize(numNeigh);
+                tempList[i].m_weightSum = 0.0f;
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    float weight = exp(distances[j] * distances[j] * gaussianDenom) * nodeAreas[tempList[i].m_nodes[j]];//exp(- dist ^ 2 / (2 * sigma ^ 2)) * area
+                    tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
+                    tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
+                }
+                float myFactor = nodeAreas[i] / tempList[i].m_weightSum;//make each scattering kernel sum to the area of the node it scatters from
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    tempList[i].m_weights[j] *= myFactor;
+                }
+                tempList[i].m_weightSum = nodeAreas[i];
             }
-            tempList[i].m_weightSum = nodeAreas[i];
         }
     }
     m_weightLists.resize(numNodes);//now convert it to gathering kernels
@@ -504,33 +661,46 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
         CaretPointer<GeodesicHelper> myGeoHelp(new GeodesicHelper(myGeoBase));
-        vector<float> distances;
+        vector<int32_t> roots;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
-        {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
-            const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
-            if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
+        for (int32_t blockStart = 0; blockStart < numNodes; blockStart += GEO_BLOCK_SIZE)
+        {//batch the roots so the helper reuses its scratch and bucket queue across them
+            int32_t blockEnd = min(blockStart + GEO_BLOCK_SIZE, numNodes);
+            roots.clear();
+            for (int32_t i = blockStart; i < blockEnd; ++i)
             {
-                tempList[i].m_nodes = tempneighbors;
-                tempList[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
+                roots.push_back(i);
             }
-            int32_t numNeigh = (int32_t)distances.size();
-            tempList[i].m_weights.resize(numNeigh);
-            tempList[i].m_weightSum = 0.0f;
-            for (int32_t j = 0; j < numNeigh; ++j)
+            myGeoHelp->getNodesToGeoDist(roots, myGeoDist, blockNodes, blockDists, true);
+            for (int32_t i = blockStart; i < blockEnd; ++i)
             {
-                float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
-                tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
-            }
-            float myFactor = 1.0f / tempList[i].m_weightSum;//make each scattering kernel sum to 1
-            for (int32_t j = 0; j < numNeigh; ++j)
-            {
-                tempList[i].m_weights[j] *= myFactor;
+                vector<float>& distances = blockDists[i - blockStart];
+                tempList[i].m_nodes.swap(blockNodes[i - blockStart]);
+                const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+                if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
+                {
+                    tempList[i].m_nodes = tempneighbors;
+                    tempList[i].m_nodes.push_back(i);
+                    myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
+                }
+                int32_t numNeigh = (int32_t)distances.size();
+                tempList[i].m_weights.resize(numNeigh);
+                tempList[i].m_weightSum = 0.0f;
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
+                    tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
+                    tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
+                }
+                float myFactor = 1.0f / tempList[i].m_weightSum;//make each scattering kernel sum to 1
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    tempList[i].m_weights[j] *= myFactor;
+                }
+                tempList[i].m_weightSum = 1.0f;
             }
-            tempList[i].m_weightSum = 1.0f;
         }
     }
     m_weightLists.resize(numNodes);//now convert it to gathering kernels
@@ -636,6 +806,17 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
         mySurf->computeNodeAreas(areasTemp);
         passAreas = areasTemp.data();
     }
+    AString cacheFileName;
+    AString cacheDir = getWeightsCacheDirectory();
+    if (!cacheDir.isEmpty())
+    {
+        cacheFileName = cacheDir + "/" + computeCacheKey(mySurf, myKernel, theRoi, myMethod, passAreas) + ".wbsmoothweights";
+        if (loadCachedWeights(cacheFileName, mySurf->getNumberOfNodes()))
+        {
+            CaretLogFine("using cached smoothing weights from '" + cacheFileName + "'");
+            return;
+        }
+    }
     if (theRoi != NULL)
     {
         switch (myMethod)
@@ -668,4 +849,206 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
                 throw CaretException("unknown smoothing method specified");
         };
     }
+    flattenWeightLists();
+    if (!cacheFileName.isEmpty())
+    {
+        saveCachedWeights(cacheFileName);
+    }
+}
+
+MetricSmoothingObject::WeightMatrix::WeightMatrix()
+{
+    m_numNodes = 0;
+    m_rowStarts = NULL;
+    m_weightSums = NULL;
+    m_nodes = NULL;
+    m_weights = NULL;
+}
+
+MetricSmoothingObject::WeightMatrix::~WeightMatrix()
+{//QFile unmaps when it is closed or destroyed, nothing else to do
+}
+
+void MetricSmoothingObject::flattenWeightLists()
+{
+    m_matrix.grabNew(new WeightMatrix());
+    WeightMatrix& matrix = *m_matrix;
+    int32_t numNodes = (int32_t)m_weightLists.size();
+    matrix.m_numNodes = numNodes;
+    matrix.m_rowStartStore.resize(numNodes + 1);
+    matrix.m_weightSumStore.resize(numNodes);
+    matrix.m_rowStartStore[0] = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        matrix.m_rowStartStore[i + 1] = matrix.m_rowStartStore[i] + (int64_t)m_weightLists[i].m_nodes.size();
+        matrix.m_weightSumStore[i] = m_weightLists[i].m_weightSum;
+    }
+    matrix.m_nodeStore.resize(matrix.m_rowStartStore[numNodes]);
+    matrix.m_weightStore.resize(matrix.m_rowStartStore[numNodes]);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        int64_t base = matrix.m_rowStartStore[i];
+        int64_t numWeights = (int64_t)m_weightLists[i].m_nodes.size();
+        for (int64_t j = 0; j < numWeights; ++j)
+        {
+            matrix.m_nodeStore[base + j] = m_weightLists[i].m_nodes[j];
+            matrix.m_weightStore[base + j] = m_weightLists[i].m_weights[j];
+        }
+    }
+    vector<WeightList>().swap(m_weightLists);//release the memory
+    matrix.m_rowStarts = matrix.m_rowStartStore.data();
+    matrix.m_weightSums = matrix.m_weightSumStore.data();
+    matrix.m_nodes = matrix.m_nodeStore.data();
+    matrix.m_weights = matrix.m_weightStore.data();
+}
+
+namespace
+{
+    const char WEIGHTS_CACHE_MAGIC[8] = { 'W', 'B', 'S', 'M', 'W', 'T', '0', '1' };
+    const int32_t WEIGHTS_CACHE_ENDIAN_CHECK = 0x01020304;
+    
+    struct WeightsCacheHeader
+    {//followed by row starts (int64, numNodes + 1), weight sums (float, numNodes), nodes (int32, numEntries), weights (float, numEntries), all native endian
+        char m_magic[8];
+        int32_t m_endianCheck;
+        int32_t m_numNodes;
+        int64_t m_numEntries;
+    };
+    
+    int64_t weightsCacheSize(const int64_t& numNodes, const int64_t& numEntries)
+    {
+        return sizeof(WeightsCacheHeader) + (numNodes + 1) * sizeof(int64_t) + numNodes * sizeof(float) + numEntries * (sizeof(int32_t) + sizeof(float));
+    }
+}
+
+const int32_t MetricSmoothingObject::COLUMN_TILE;
+
+AString MetricSmoothingObject::s_cacheDirectory;
+bool MetricSmoothingObject::s_cacheDirectorySet = false;
+
+void MetricSmoothingObject::setWeightsCacheDirectory(const AString& directory)
+{
+    s_cacheDirectory = directory;
+    s_cacheDirectorySet = true;
+}
+
+AString MetricSmoothingObject::getWeightsCacheDirectory()
+{
+    if (s_cacheDirectorySet) return s_cacheDirectory;
+    return AString(qgetenv("WB_SMOOTHING_WEIGHTS_CACHE"));
+}
+
+AString MetricSmoothingObject::computeCacheKey(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas)
+{//hash everything the weights depend on, so a changed input can never pick up stale weights
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    int32_t numNodes = mySurf->getNumberOfNodes();
+    int32_t numTriangles = mySurf->getNumberOfTriangles();
+    int32_t methodInt = (int32_t)myMethod;
+    myHash.addData(WEIGHTS_CACHE_MAGIC, sizeof(WEIGHTS_CACHE_MAGIC));//so changes to the computation can bump the version and invalidate old files
+    myHash.addData((const char*)&numNodes, sizeof(int32_t));
+    myHash.addData((const char*)&numTriangles, sizeof(int32_t));
+    myHash.addData((const char*)&myKernel, sizeof(float));
+    myHash.addData((const char*)&methodInt, sizeof(int32_t));
+    myHash.addData((const char*)mySurf->getCoordinateData(), numNodes * 3 * sizeof(float));
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        myHash.addData((const char*)mySurf->getTriangle(i), 3 * sizeof(int32_t));
+    }
+    myHash.addData((const char*)nodeAreas, numNodes * sizeof(float));
+    char hasRoi = (theRoi != NULL ? 1 : 0);
+    myHash.addData(&hasRoi, 1);
+    if (theRoi != NULL)
+    {
+        myHash.addData((const char*)theRoi->getValuePointerForColumn(0), numNodes * sizeof(float));
+    }
+    return AString(myHash.result().toHex());
+}
+
+bool MetricSmoothingObject::loadCachedWeights(const AString& filename, const int32_t& numNodes)
+{//any problem just means we compute the weights instead
+    CaretPointer<QFile> myFile(new QFile(filename));
+    if (!myFile->open(QIODevice::ReadOnly)) return false;
+    int64_t fileSize = myFile->size();
+    if (fileSize < (int64_t)sizeof(WeightsCacheHeader)) return false;
+    const uchar* mapped = myFile->map(0, fileSize);
+    if (mapped == NULL)
+    {
+        CaretLogFine("unable to memory map smoothing weights cache file '" + filename + "'");
+        return false;
+    }
+    WeightsCacheHeader header;
+    memcpy(&header, mapped, sizeof(WeightsCacheHeader));
+    if (memcmp(header.m_magic, WEIGHTS_CACHE_MAGIC, sizeof(WEIGHTS_CACHE_MAGIC)) != 0 || header.m_endianCheck != WEIGHTS_CACHE_ENDIAN_CHECK ||
+        header.m_numNodes != numNodes || header.m_numEntries < 0 || fileSize != weightsCacheSize(numNodes, header.m_numEntries))
+    {
+        CaretLogWarning("ignoring invalid smoothing weights cache file '" + filename + "'");
+        return false;
+    }
+    CaretPointer<WeightMatrix> matrix(new WeightMatrix());
+    const uchar* position = mapped + sizeof(WeightsCacheHeader);
+    matrix->m_numNodes = numNodes;
+    matrix->m_rowStarts = (const int64_t*)position;
+    position += (numNodes + 1) * sizeof(int64_t);
+    matrix->m_weightSums = (const float*)position;
+    position += numNodes * sizeof(float);
+    matrix->m_nodes = (const int32_t*)position;
+    position += header.m_numEntries * sizeof(int32_t);
+    matrix->m_weights = (const float*)position;
+    bool valid = (matrix->m_rowStarts[0] == 0 && matrix->m_rowStarts[numNodes] == header.m_numEntries);
+    for (int32_t i = 0; valid && i < numNodes; ++i)
+    {
+        if (matrix->m_rowStarts[i + 1] < matrix->m_rowStarts[i]) valid = false;
+    }
+    for (int64_t j = 0; valid && j < header.m_numEntries; ++j)
+    {
+        if (matrix->m_nodes[j] < 0 || matrix->m_nodes[j] >= numNodes) valid = false;
+    }
+    if (!valid)
+    {
+        CaretLogWarning("ignoring corrupted smoothing weights cache file '" + filename + "'");
+        return false;
+    }
+    matrix->m_mappedFile = myFile;//keep the file open, the mapping lasts until it closes
+    m_matrix = matrix;
+    return true;
+}
+
+void MetricSmoothingObject::saveCachedWeights(const AString& filename) const
+{//failing to save is not an error, the next run will just compute them again
+    const WeightMatrix& matrix = *m_matrix;
+    QFileInfo myInfo(filename);
+    if (!QDir().mkpath(myInfo.absolutePath()))
+    {
+        CaretLogWarning("unable to create smoothing weights cache directory '" + myInfo.absolutePath() + "'");
+        return;
+    }
+    QTemporaryFile tempFile(filename + ".XXXXXX");//write elsewhere and rename, so concurrent jobs never see a partial file
+    tempFile.setAutoRemove(false);
+    if (!tempFile.open())
+    {
+        CaretLogWarning("unable to create smoothing weights cache file in '" + myInfo.absolutePath() + "'");
+        return;
+    }
+    AString tempName = tempFile.fileName();
+    WeightsCacheHeader header;
+    memcpy(header.m_magic, WEIGHTS_CACHE_MAGIC, sizeof(WEIGHTS_CACHE_MAGIC));
+    header.m_endianCheck = WEIGHTS_CACHE_ENDIAN_CHECK;
+    header.m_numNodes = matrix.m_numNodes;
+    header.m_numEntries = matrix.m_rowStarts[matrix.m_numNodes];
+    bool good = tempFile.write((const char*)&header, sizeof(WeightsCacheHeader)) == (qint64)sizeof(WeightsCacheHeader);
+    good = good && tempFile.write((const char*)matrix.m_rowStarts, (matrix.m_numNodes + 1) * sizeof(int64_t)) == (qint64)((matrix.m_numNodes + 1) * sizeof(int64_t));
+    good = good && tempFile.write((const char*)matrix.m_weightSums, matrix.m_numNodes * sizeof(float)) == (qint64)(matrix.m_numNodes * sizeof(float));
+    good = good && tempFile.write((const char*)matrix.m_nodes, header.m_numEntries * sizeof(int32_t)) == (qint64)(header.m_numEntries * sizeof(int32_t));
+    good = good && tempFile.write((const char*)matrix.m_weights, header.m_numEntries * sizeof(float)) == (qint64)(header.m_numEntries * sizeof(float));
+    tempFile.close();
+    if (!good || tempFile.error() != QFile::NoError)
+    {
+        CaretLogWarning("failed to write smoothing weights cache file '" + filename + "'");
+        QFile::remove(tempName);
+        return;
+    }
+    if (!QFile::rename(tempName, filename))
+    {//most likely another process finished the same weights first
+        QFile::remove(tempName);
+    }
 }
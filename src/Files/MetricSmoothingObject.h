@@ -30,10 +30,15 @@
 //NOTE: for a static ROI, it is (sometimes much) more efficient to use it in the constructor, and provide no ROI (NULL) to the functions, using both an ROI in constructor and in method
 //      will result in the effective ROI being the logical AND of the two (intersection).
 
+#include "AString.h"
+#include "CaretPointer.h"
+
 #include "stdint.h"
 #include "stddef.h"
 #include <vector>
 
+class QFile;
+
 namespace caret {
     
     class SurfaceFile;
@@ -52,6 +57,16 @@ namespace caret {
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///smooths several columns in one pass over the weights, the roi column applies to all of them
+        void smoothColumns(const MetricFile* metricIn, const int& firstColumn, const int& numColumns, MetricFile* metricOut, const int& firstOutColumn,
+                           const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
+        ///number of columns processed together by smoothColumns, callers reporting progress should use multiples of this
+        static const int32_t COLUMN_TILE = 16;
+        
+        ///directory to store computed weights in and reuse them from, keyed by a hash of everything that affects them, empty disables the cache
+        ///if never set, the WB_SMOOTHING_WEIGHTS_CACHE environment variable is used
+        static void setWeightsCacheDirectory(const AString& directory);
+        static AString getWeightsCacheDirectory();
     private:
         struct WeightList
         {
@@ -59,9 +74,31 @@ namespace caret {
             std::vector<float> m_weights;
             float m_weightSum;
         };
-        std::vector<WeightList> m_weightLists;
+        struct WeightMatrix
+        {//the gathering kernels as a CSR sparse matrix, either in the store vectors or memory mapped from a cache file
+            int32_t m_numNodes;
+            const int64_t* m_rowStarts;//m_numNodes + 1 elements
+            const float* m_weightSums;
+            const int32_t* m_nodes;
+            const float* m_weights;
+            std::vector<int64_t> m_rowStartStore;
+            std::vector<float> m_weightSumStore, m_weightStore;
+            std::vector<int32_t> m_nodeStore;
+            CaretPointer<QFile> m_mappedFile;
+            WeightMatrix();
+            ~WeightMatrix();//out of line, because QFile is incomplete here
+        };
+        std::vector<WeightList> m_weightLists;//only used while computing the weights
+        CaretPointer<WeightMatrix> m_matrix;
+        static AString s_cacheDirectory;
+        static bool s_cacheDirectorySet;
+        void flattenWeightLists();
+        static AString computeCacheKey(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
+        bool loadCachedWeights(const AString& filename, const int32_t& numNodes);
+        void saveCachedWeights(const AString& filename) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
+        void smoothTileInternal(const float* tileIn, float* tileOut, const float* roiColumn, const bool& fixZeros) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
         void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas);
         void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas);
@@ -47,13 +47,16 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 #include "RibbonMappingHelper.h"
 
+#include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretOMP.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "VolumeSpace.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -469,3 +472,93 @@ void RibbonMappingHelper::computeWeightsRibbon(vector<vector<VoxelWeight> >& myW
         }
     }
 }
+
+namespace
+{
+    const int FRAME_BLOCK = 16;//frames per pass of VoxelWeightMatrix::apply, enough for the compiler to vectorize the inner loop
+}
+
+VoxelWeightMatrix::VoxelWeightMatrix(const vector<vector<VoxelWeight> >& weights, const VolumeSpace& volSpace)
+{
+    const int64_t* dims = volSpace.getDims();
+    m_dims[0] = dims[0]; m_dims[1] = dims[1]; m_dims[2] = dims[2];
+    int64_t numVertices = (int64_t)weights.size();
+    m_rowStarts.resize(numVertices + 1);
+    m_weightSums.resize(numVertices);
+    vector<int64_t> entryVoxels;
+    m_rowStarts[0] = 0;
+    for (int64_t i = 0; i < numVertices; ++i)
+    {
+        float totalWeight = 0.0f;//summed in the same order as the per-frame loops used to
+        for (int j = 0; j < (int)weights[i].size(); ++j)
+        {
+            entryVoxels.push_back(volSpace.getIndex(weights[i][j].ijk));
+            m_weights.push_back(weights[i][j].weight);
+            totalWeight += weights[i][j].weight;
+        }
+        m_weightSums[i] = totalWeight;
+        m_rowStarts[i + 1] = (int64_t)entryVoxels.size();
+    }
+    m_voxels = entryVoxels;
+    sort(m_voxels.begin(), m_voxels.end());
+    m_voxels.erase(unique(m_voxels.begin(), m_voxels.end()), m_voxels.end());
+    m_columns.resize(entryVoxels.size());
+    for (int64_t e = 0; e < (int64_t)entryVoxels.size(); ++e)
+    {
+        m_columns[e] = lower_bound(m_voxels.begin(), m_voxels.end(), entryVoxels[e]) - m_voxels.begin();
+    }
+}
+
+vector<VoxelWeight> VoxelWeightMatrix::getVertexWeights(const int64_t& vertex) const
+{
+    CaretAssert(vertex >= 0 && vertex < getNumberOfVertices());
+    vector<VoxelWeight> ret;
+    for (int64_t e = m_rowStarts[vertex]; e < m_rowStarts[vertex + 1]; ++e)
+    {
+        int64_t index = m_voxels[m_columns[e]], ijk[3];
+        ijk[0] = index % m_dims[0];
+        index /= m_dims[0];
+        ijk[1] = index % m_dims[1];
+        ijk[2] = index / m_dims[1];
+        ret.push_back(VoxelWeight(m_weights[e], ijk));
+    }
+    return ret;
+}
+
+void VoxelWeightMatrix::apply(const vector<const float*>& frames, const vector<float*>& columnsOut) const
+{
+    CaretAssert(frames.size() == columnsOut.size());
+    const int64_t numFrames = (int64_t)frames.size(), numVoxels = (int64_t)m_voxels.size(), numVertices = getNumberOfVertices();
+    vector<float> gathered(numVoxels * FRAME_BLOCK, 0.0f);
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += FRAME_BLOCK)
+    {
+        const int blockSize = (int)min((int64_t)FRAME_BLOCK, numFrames - blockStart);
+#pragma omp CARET_PARFOR
+        for (int64_t v = 0; v < numVoxels; ++v)
+        {
+            float* dest = gathered.data() + v * FRAME_BLOCK;
+            for (int f = 0; f < blockSize; ++f)
+            {
+                dest[f] = frames[blockStart + f][m_voxels[v]];
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+        for (int64_t vert = 0; vert < numVertices; ++vert)
+        {
+            float accum[FRAME_BLOCK] = { 0.0f };
+            for (int64_t e = m_rowStarts[vert]; e < m_rowStarts[vert + 1]; ++e)
+            {
+                const float weight = m_weights[e];
+                const float* values = gathered.data() + m_columns[e] * FRAME_BLOCK;
+                for (int f = 0; f < FRAME_BLOCK; ++f)//whole block even when the last one is partial, the extra lanes are ignored
+                {
+                    accum[f] += weight * values[f];
+                }
+            }
+            for (int f = 0; f < blockSize; ++f)
+            {
+                columnsOut[blockStart + f][vert] = (m_weightSums[vert] != 0.0f) ? accum[f] / m_weightSums[vert] : 0.0f;
+            }
+        }
+    }
+}
@@ -55,6 +55,27 @@ namespace caret
         PointWeight(const int weightIn, const Vector3D coordIn) { weight = weightIn; coord = coordIn; }
     };
     
+    ///per-vertex voxel weights in compressed form, for applying the same ribbon weights to many frames or volumes
+    class VoxelWeightMatrix
+    {
+        int64_t m_dims[3];
+        std::vector<int64_t> m_rowStarts;//per vertex, into m_columns and m_weights
+        std::vector<int64_t> m_columns;//index into m_voxels
+        std::vector<float> m_weights, m_weightSums;
+        std::vector<int64_t> m_voxels;//frame indices of all voxels used by any vertex, sorted
+    public:
+        VoxelWeightMatrix(const std::vector<std::vector<VoxelWeight> >& weights, const VolumeSpace& volSpace);
+        int64_t getNumberOfVertices() const { return (int64_t)m_weightSums.size(); }
+        const int64_t* getDims() const { return m_dims; }
+        ///true if the vertex has no weight in any voxel, its output will be zero
+        bool isVertexEmpty(const int64_t& vertex) const { return m_weightSums[vertex] == 0.0f; }
+        ///the entries for one vertex, in their original order
+        std::vector<VoxelWeight> getVertexWeights(const int64_t& vertex) const;
+        ///weighted average of each frame at every vertex, columnsOut has one array of getNumberOfVertices() values per frame
+        ///frames are done in blocks: each used voxel is gathered once per block, so the inner loop is contiguous over frames
+        void apply(const std::vector<const float*>& frames, const std::vector<float*>& columnsOut) const;
+    };
+    
     class RibbonMappingHelper
     {
     public:
@@ -48,6 +48,7 @@
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
+#include "SurfaceTriangleBVH.h"
 #include "TopologyHelper.h"
 
 using namespace caret;
@@ -596,6 +597,7 @@ SurfaceFile::computeNormals()
         return;
     }
     m_normalsComputed = true;
+    invalidateGraphicsPrimitives();//primitives contain the normals
     int32_t numCoords = this->getNumberOfNodes();
     if (numCoords > 0) {
         this->normalVectors.resize(numCoords * 3);
@@ -911,6 +913,12 @@ void SurfaceFile::invalidateHelpers()
         CaretMutexLocker myLock3(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    if (m_triangleBVH != NULL)
+    {
+        CaretMutexLocker myLock5(&m_triangleBVHMutex);
+        m_triangleBVH.grabNew(NULL);
+    }
+    invalidateGraphicsPrimitives();
 }
 
 /**
@@ -1406,6 +1414,19 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
     return m_locator;
 }
 
+CaretPointer<const SurfaceTriangleBVH> SurfaceFile::getTriangleBVH() const
+{
+    if (m_triangleBVH == NULL)//same pattern as the point locator
+    {
+        CaretMutexLocker myLock(&m_triangleBVHMutex);
+        if (m_triangleBVH == NULL)
+        {
+            m_triangleBVH.grabNew(new SurfaceTriangleBVH(this));
+        }
+    }
+    return m_triangleBVH;
+}
+
 void SurfaceFile::clearCachedHelpers() const
 {
     {
@@ -1430,6 +1451,10 @@ void SurfaceFile::clearCachedHelpers() const
         CaretMutexLocker locked(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    {
+        CaretMutexLocker locked(&m_triangleBVHMutex);
+        m_triangleBVH.grabNew(NULL);
+    }
 }
 
 /**
@@ -1570,6 +1595,20 @@ SurfaceFile::invalidateNodeColoringForBrowserTabs()
         this->wholeBrainNodeColoringForBrowserTabs[i].clear();
     }
     
+    /*
+     * Graphics primitives are kept so that their coordinate, normal, and
+     * triangle buffers are not reloaded.  Only the colors of a primitive
+     * are replaced when its coloring is set.
+     */
+}
+
+/**
+ * Invalidate the graphics primitives after the coordinates,
+ * normal vectors, or triangles change.
+ */
+void
+SurfaceFile::invalidateGraphicsPrimitives()
+{
     m_surfaceGraphicsPrimitives.clear();
     m_surfaceMontageGraphicsPrimitives.clear();
     m_wholeBrainGraphicsPrimitives.clear();
@@ -1702,10 +1741,9 @@ SurfaceFile::setSurfaceNodeColoringRgbaForBrowserTab(const int32_t browserTabInd
         rgba[i] = rgbaNodeColorComponents[i];
     }
     
-    if ((browserTabIndex >= 0)
-        && (browserTabIndex < static_cast<int32_t>(m_surfaceGraphicsPrimitives.size()))) {
-        m_surfaceGraphicsPrimitives[browserTabIndex].reset();
-    }
+    updateGraphicsPrimitiveColoring(m_surfaceGraphicsPrimitives,
+                                    browserTabIndex,
+                                    &rgba[0]);
 }
 
 /**
@@ -1754,10 +1792,9 @@ SurfaceFile::setSurfaceMontageNodeColoringRgbaForBrowserTab(const int32_t browse
         rgba[i] = rgbaNodeColorComponents[i];
     }
     
-    if ((browserTabIndex >= 0)
-        && (browserTabIndex < static_cast<int32_t>(m_surfaceMontageGraphicsPrimitives.size()))) {
-        m_surfaceMontageGraphicsPrimitives[browserTabIndex].reset();
-    }
+    updateGraphicsPrimitiveColoring(m_surfaceMontageGraphicsPrimitives,
+                                    browserTabIndex,
+                                    &rgba[0]);
 }
 
 
@@ -1806,10 +1843,9 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
         rgba[i] = rgbaNodeColorComponents[i];
     }
     
-    if ((browserTabIndex >= 0)
-        && (browserTabIndex < static_cast<int32_t>(m_wholeBrainGraphicsPrimitives.size()))) {
-        m_wholeBrainGraphicsPrimitives[browserTabIndex].reset();
-    }
+    updateGraphicsPrimitiveColoring(m_wholeBrainGraphicsPrimitives,
+                                    browserTabIndex,
+                                    &rgba[0]);
 }
 
 /**
@@ -1865,6 +1901,36 @@ SurfaceFile::getGraphicsPrimitive(std::vector<std::unique_ptr<GraphicsPrimitiveV
 
 }
 
+/**
+ * Replace the coloring in the graphics primitive for the given tab, if the
+ * primitive has been created.  Only the color buffer is reloaded by
+ * the graphics engine and only when the coloring has changed.
+ * @param primitives
+ *    Primitives for each tab index
+ * @param browserTabIndex
+ *    Index of the tab
+ * @param rgba
+ *    The RGBA coloring for the surface
+ */
+void
+SurfaceFile::updateGraphicsPrimitiveColoring(std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>>& primitives,
+                                             const int32_t browserTabIndex,
+                                             const float* rgba)
+{
+    if ((browserTabIndex >= 0)
+        && (browserTabIndex < static_cast<int32_t>(primitives.size()))) {
+        GraphicsPrimitiveV3fN3fC4f* primitive(primitives[browserTabIndex].get());
+        if (primitive != NULL) {
+            if (primitive->getNumberOfVertices() == getNumberOfNodes()) {
+                primitive->replaceAllVertexFloatRGBA(rgba);
+            }
+            else {
+                primitives[browserTabIndex].reset();
+            }
+        }
+    }
+}
+
 /*
  * @return Graphics primitive for drawing this surface in the given RGBA colors
  * @param rgba
@@ -1877,17 +1943,41 @@ SurfaceFile::createSurfaceGraphicsPrimitive(const float* rgba)
 {
     GraphicsPrimitiveV3fN3fC4f* primitiveOut(GraphicsPrimitive::newPrimitiveV3fN3fC4f(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES));
     
+    /*
+     * Coordinates, normals, and triangles are loaded once, colors
+     * are replaced each time the surface coloring changes
+     */
+    primitiveOut->setUsageTypeCoordinates(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+    primitiveOut->setUsageTypeNormals(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+    primitiveOut->setUsageTypeColors(GraphicsPrimitive::UsageType::MODIFIED_MANY_DRAWN_MANY_TIMES);
+    
+    /*
+     * One primitive vertex for each surface vertex, the
+     * triangles are drawn using the element indices
+     */
+    const int32_t numberOfVertices(getNumberOfNodes());
+    primitiveOut->reserveForNumberOfVertices(numberOfVertices);
+    for (int32_t i = 0; i < numberOfVertices; i++) {
+        primitiveOut->addVertex(getCoordinate(i),
+                                getNormalVector(i),
+                                &rgba[i * 4]);
+    }
+    
     const int32_t numberOfTriangles(getNumberOfTriangles());
+    std::vector<uint32_t> elementIndices;
+    elementIndices.reserve(numberOfTriangles * 3);
     for (int32_t i = 0; i < numberOfTriangles; i++) {
         const int32_t* triangleIndices(getTriangle(i));
-        for (int32_t j = 0; j < 3; j++) {
-            const int32_t vertexIndex(triangleIndices[j]);
-            const float* xyz(getCoordinate(vertexIndex));
-            const float* normalXYZ(getNormalVector(vertexIndex));
-            const float* vertexRgba(&rgba[vertexIndex * 4]);
-            primitiveOut->addVertex(xyz, normalXYZ, vertexRgba);
+        if ((triangleIndices[0] >= 0)
+            && (triangleIndices[1] >= 0)
+            && (triangleIndices[2] >= 0)) {
+            elementIndices.push_back(triangleIndices[0]);
+            elementIndices.push_back(triangleIndices[1]);
+            elementIndices.push_back(triangleIndices[2]);
         }
     }
+    primitiveOut->setElementIndices(elementIndices);
+    
     return primitiveOut;
 }
 /**
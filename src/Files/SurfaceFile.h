@@ -47,6 +47,7 @@ namespace caret {
     class PlainTextStringBuilder;
     class SignedDistanceHelper;
     class SignedDistanceHelperBase;
+    class SurfaceTriangleBVH;
     class TopologyHelper;
     class TopologyHelperBase;
     
@@ -142,6 +143,8 @@ namespace caret {
         
         CaretPointer<const CaretPointLocator> getPointLocator() const;
         
+        CaretPointer<const SurfaceTriangleBVH> getTriangleBVH() const;
+        
         void clearCachedHelpers() const;
         
         const BoundingBox* getBoundingBox() const;
@@ -228,6 +231,8 @@ namespace caret {
     private:
         void invalidateNodeColoringForBrowserTabs();
         
+        void invalidateGraphicsPrimitives();
+        
         void allocateSurfaceNodeColoringForBrowserTab(const int32_t browserTabIndex,
                                                       const bool zeroizeColorsFlag);
         
@@ -242,6 +247,10 @@ namespace caret {
         GraphicsPrimitiveV3fN3fC4f* getGraphicsPrimitive(std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>>& primitives,
                                                          const int32_t browserTabIndex,
                                                          const float* rgba);
+        
+        void updateGraphicsPrimitiveColoring(std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>>& primitives,
+                                             const int32_t browserTabIndex,
+                                             const float* rgba);
 
         /** Data array containing the coordinates. */
         GiftiDataArray* coordinateDataArray;
@@ -333,12 +342,15 @@ namespace caret {
         ///used to search for the closest point in the surface
         mutable CaretPointer<CaretPointLocator> m_locator;
         
+        ///used to find the triangle hit by a ray, for picking
+        mutable CaretPointer<SurfaceTriangleBVH> m_triangleBVH;
+        
         ///used to track when the surface file gets changed
         void invalidateHelpers();
         
         mutable BoundingBox* boundingBox;
         
-        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
+        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex, m_triangleBVHMutex;
     };
 
 } // namespace
@@ -36,8 +36,14 @@
 #include "TopologyHelper.h"
 #include "Vector3D.h"
 
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+
 #include <algorithm>
-#include <set>
+#include <cstring>
 #include <map>
 
 using namespace std;
@@ -47,6 +53,23 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
                                                  const float* currentAreas, const float* newAreas, const float* currentRoi, const bool allowNonSphere)
 {
     m_nonsphereAllowed = allowNonSphere;
+    m_distortionWarning = false;
+    if (myMethod == SurfaceResamplingMethodEnum::ADAP_BARY_AREA)
+    {
+        CaretAssert(currentAreas != NULL && newAreas != NULL);
+        if (currentAreas == NULL || newAreas == NULL) throw CaretException("ADAP_BARY_AREA method requires providing vertex areas using anatomical surfaces or vertex area metrics");
+    }
+    AString cacheFileName;
+    AString cacheDir = getWeightsCacheDirectory();
+    if (!cacheDir.isEmpty())
+    {
+        cacheFileName = cacheDir + "/" + computeCacheKey(myMethod, currentSphere, newSphere, currentAreas, newAreas, currentRoi, allowNonSphere) + ".wbresampleweights";
+        if (loadCachedWeights(cacheFileName, currentSphere->getNumberOfNodes(), newSphere->getNumberOfNodes()))
+        {
+            CaretLogFine("using cached resampling weights from '" + cacheFileName + "'");
+            return;
+        }
+    }
     SurfaceFile currentSphereMod, newSphereMod;
     const SurfaceFile* useCurrent = currentSphere, *useNew = newSphere;
     if (!allowNonSphere)
@@ -62,14 +85,16 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
     switch (myMethod)
     {
         case SurfaceResamplingMethodEnum::ADAP_BARY_AREA:
-            CaretAssert(currentAreas != NULL && newAreas != NULL);
-            if (currentAreas == NULL || newAreas == NULL) throw CaretException("ADAP_BARY_AREA method requires providing vertex areas using anatomical surfaces or vertex area metrics");
             computeWeightsAdapBaryArea(useCurrent, useNew, currentAreas, newAreas, currentRoi);
             break;
         case SurfaceResamplingMethodEnum::BARYCENTRIC:
             computeWeightsBarycentric(useCurrent, useNew, currentRoi);
             break;
     }
+    if (!cacheFileName.isEmpty())
+    {
+        saveCachedWeights(cacheFileName, currentSphere->getNumberOfNodes());
+    }
 }
 
 void SurfaceResamplingHelper::resampleNormal(const float* input, float* output, const float& invalidVal) const
@@ -216,6 +241,16 @@ void SurfaceResamplingHelper::getResampleValidROI(float* output) const
     }
 }
 
+void SurfaceResamplingHelper::getNodeWeights(const int& newNode, vector<pair<int, float> >& weightsOut) const
+{
+    CaretAssert(newNode >= 0 && newNode < (int)m_weights.size() - 1);
+    weightsOut.clear();
+    for (WeightElem* elem = m_weights[newNode]; elem != m_weights[newNode + 1]; ++elem)
+    {
+        weightsOut.push_back(pair<int, float>(elem->node, elem->weight));
+    }
+}
+
 void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn, const SurfaceFile* currentSphere, const SurfaceFile* newSphere, SurfaceFile* surfaceOut)
 {
     if (cutSurfaceIn->getNumberOfNodes() != currentSphere->getNumberOfNodes()) throw CaretException("input surface has different number of nodes than input sphere");
@@ -413,91 +448,125 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
 void SurfaceResamplingHelper::computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                                          const float* currentAreas, const float* newAreas, const float* currentRoi)
 {
-    vector<map<int, float> > forward, reverse, reverse_gather;
-    makeBarycentricWeights(currentSphere, newSphere, forward, NULL);//don't use an roi until after we have done area correction, because area correction MUST ignore ROI
-    makeBarycentricWeights(newSphere, currentSphere, reverse, NULL);
-    int numNewNodes = (int)forward.size(), numOldNodes = currentSphere->getNumberOfNodes();
-    reverse_gather.resize(numNewNodes);
-    for (int oldNode = 0; oldNode < numOldNodes; ++oldNode)//this loop can't be parallelized
-    {
-        for (map<int, float>::iterator iter = reverse[oldNode].begin(); iter != reverse[oldNode].end(); ++iter)//convert scattering weights to gathering weights
+    vector<WeightElem> forward, reverse;
+    vector<int> forwardCounts, reverseCounts;
+    makeBarycentricWeights(currentSphere, newSphere, forward, forwardCounts, NULL);//don't use an roi until after we have done area correction, because area correction MUST ignore ROI
+    makeBarycentricWeights(newSphere, currentSphere, reverse, reverseCounts, NULL);
+    int numNewNodes = (int)forwardCounts.size(), numOldNodes = currentSphere->getNumberOfNodes();
+    vector<int64_t> gatherStarts(numNewNodes + 1, 0);//convert scattering weights to gathering weights with a counting sort
+    for (int oldNode = 0; oldNode < numOldNodes; ++oldNode)
+    {
+        for (int k = 0; k < reverseCounts[oldNode]; ++k)
         {
-            reverse_gather[iter->first][oldNode] = iter->second;
+            ++gatherStarts[reverse[oldNode * 3 + k].node + 1];
         }
     }
-    vector<map<int, float> > adap_gather(numNewNodes);
-#pragma omp CARET_PARFOR schedule(dynamic)
     for (int newNode = 0; newNode < numNewNodes; ++newNode)
     {
-        set<int> forwardused;//build set of all nodes used by forward weights (really only 3, but this is a bit cleaner and more generic)
-        for (map<int, float>::iterator iter = forward[newNode].begin(); iter != forward[newNode].end(); ++iter)
+        gatherStarts[newNode + 1] += gatherStarts[newNode];
+    }
+    vector<WeightElem> reverseGather(gatherStarts[numNewNodes]);
+    vector<int64_t> gatherPos(gatherStarts.begin(), gatherStarts.end() - 1);
+    for (int oldNode = 0; oldNode < numOldNodes; ++oldNode)//this loop can't be parallelized, and visiting old nodes in order leaves each gather list sorted by node
+    {
+        for (int k = 0; k < reverseCounts[oldNode]; ++k)
         {
-            forwardused.insert(iter->first);
+            const WeightElem& elem = reverse[oldNode * 3 + k];
+            reverseGather[gatherPos[elem.node]] = WeightElem(oldNode, elem.weight);
+            ++gatherPos[elem.node];
         }
+    }
+    vector<char> useForward(numNewNodes);//avoid bitpacking so it can be modified in parallel
+    vector<int> adapCounts(numNewNodes);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        const WeightElem* forwardList = forward.data() + newNode * 3;
         bool useforward = true;
-        for (map<int, float>::iterator iter = reverse_gather[newNode].begin(); iter != reverse_gather[newNode].end(); ++iter)
+        for (int64_t j = gatherStarts[newNode]; j < gatherStarts[newNode + 1]; ++j)
         {
-            if (forwardused.find(iter->first) == forwardused.end())
+            bool found = false;
+            for (int k = 0; k < forwardCounts[newNode]; ++k)
+            {
+                if (forwardList[k].node == reverseGather[j].node)
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
             {
                 useforward = false;//if the reverse scatter weights include something the forward gather weights don't, use reverse scatter
                 break;
             }
         }
-        if (useforward)
-        {
-            adap_gather[newNode] = forward[newNode];
-        } else {
-            adap_gather[newNode] = reverse_gather[newNode];
-        }
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)//begin area correction by multiplying by target node area
+        useForward[newNode] = (useforward ? 1 : 0);
+        adapCounts[newNode] = (useforward ? forwardCounts[newNode] : (int)(gatherStarts[newNode + 1] - gatherStarts[newNode]));
+    }
+    vector<int64_t> adapStarts(numNewNodes + 1, 0);
+    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        adapStarts[newNode + 1] = adapStarts[newNode] + adapCounts[newNode];
+    }
+    vector<WeightElem> adapGather(adapStarts[numNewNodes]);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        const WeightElem* source = (useForward[newNode] ? forward.data() + newNode * 3 : reverseGather.data() + gatherStarts[newNode]);
+        WeightElem* dest = adapGather.data() + adapStarts[newNode];
+        for (int k = 0; k < adapCounts[newNode]; ++k)
         {
-            iter->second *= newAreas[newNode];//begin the process of area correction by multiplying by gathering node areas
+            dest[k] = WeightElem(source[k].node, source[k].weight * newAreas[newNode]);//begin the process of area correction by multiplying by gathering node areas
         }
     }
     vector<float> correctionSum(numOldNodes, 0.0f);
     for (int newNode = 0; newNode < numNewNodes; ++newNode)//this loop is separate because it can't be parallelized
     {
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
+        for (int64_t j = adapStarts[newNode]; j < adapStarts[newNode + 1]; ++j)
         {
-            correctionSum[iter->first] += iter->second;//now, sum the scattering weights to prepare for first normalization
+            correctionSum[adapGather[j].node] += adapGather[j].weight;//now, sum the scattering weights to prepare for first normalization
         }
     }
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int newNode = 0; newNode < numNewNodes; ++newNode)
     {
         double weightsum = 0.0f;
-        vector<map<int, float>::iterator> toRemove;
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
+        WeightElem* list = adapGather.data() + adapStarts[newNode];
+        int kept = 0;//remove nodes outside the roi by shifting the rest down
+        for (int k = 0; k < adapCounts[newNode]; ++k)
         {
-            if (currentRoi == NULL || currentRoi[iter->first] > 0.0f)
+            const int node = list[k].node;
+            if (currentRoi == NULL || currentRoi[node] > 0.0f)
             {
-                iter->second *= currentAreas[iter->first] / correctionSum[iter->first];//divide the weights by their scatter sum, then multiply by current areas
-                weightsum += iter->second;//and compute the sum
-            } else {
-                toRemove.push_back(iter);
+                list[kept] = WeightElem(node, list[k].weight * (currentAreas[node] / correctionSum[node]));//divide the weights by their scatter sum, then multiply by current areas
+                weightsum += list[kept].weight;//and compute the sum
+                ++kept;
             }
         }
-        int numToRemove = (int)toRemove.size();
-        for (int i = 0; i < numToRemove; ++i)
-        {
-            adap_gather[newNode].erase(toRemove[i]);
-        }
+        adapCounts[newNode] = kept;
         if (weightsum != 0.0f)//this shouldn't happen unless no nodes remain due to roi, or node areas can be zero
         {
-            for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
+            for (int k = 0; k < kept; ++k)
             {
-                iter->second /= weightsum;//and normalize to a sum of 1
+                list[k].weight /= weightsum;//and normalize to a sum of 1
             }
         }
     }
-    compactWeights(adap_gather);//and compact them into the internal weight storage
+    compactWeights(adapGather, adapStarts, adapCounts);//and compact them into the internal weight storage
 }
 
 void SurfaceResamplingHelper::computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi)
 {
-    vector<map<int, float> > forward;
-    makeBarycentricWeights(currentSphere, newSphere, forward, currentRoi);//this should ensure they sum to 1, so we are done
-    compactWeights(forward);
+    vector<WeightElem> forward;
+    vector<int> forwardCounts;
+    makeBarycentricWeights(currentSphere, newSphere, forward, forwardCounts, currentRoi);//this should ensure they sum to 1, so we are done
+    int numNewNodes = (int)forwardCounts.size();
+    vector<int64_t> forwardStarts(numNewNodes);
+    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        forwardStarts[newNode] = newNode * 3;
+    }
+    compactWeights(forward, forwardStarts, forwardCounts);
 }
 
 bool SurfaceResamplingHelper::checkSphere(const SurfaceFile* surface)
@@ -545,23 +614,23 @@ void SurfaceResamplingHelper::changeRadius(const float& radius, const SurfaceFil
     output->setCoordinates(newCoordData.data());
 }
 
-void SurfaceResamplingHelper::compactWeights(const vector<map<int, float> >& weights)
+void SurfaceResamplingHelper::compactWeights(const vector<WeightElem>& weights, const vector<int64_t>& starts, const vector<int>& counts)
 {
-    int compactsize = 0;
-    int numNodes = (int)weights.size();
+    int64_t compactsize = 0;
+    int numNodes = (int)counts.size();
     m_weights = CaretArray<WeightElem*>(numNodes + 1);//include a "one-after" pointer
     for (int i = 0; i < numNodes; ++i)
     {
-        compactsize += (int)weights[i].size();
+        compactsize += counts[i];
     }
     m_storagechunk = CaretArray<WeightElem>(compactsize);
-    int curpos = 0;
+    int64_t curpos = 0;
     for (int i = 0; i < numNodes; ++i)
     {
         m_weights[i] = m_storagechunk + curpos;
-        for (map<int, float>::const_iterator iter = weights[i].begin(); iter != weights[i].end(); ++iter)
+        for (int k = 0; k < counts[i]; ++k)
         {
-            m_storagechunk[curpos] = WeightElem(iter->first, iter->second);
+            m_storagechunk[curpos] = weights[starts[i] + k];
             ++curpos;
         }
     }
@@ -569,10 +638,33 @@ void SurfaceResamplingHelper::compactWeights(const vector<map<int, float> >& wei
     m_weights[numNodes] = m_storagechunk + compactsize;
 }
 
-void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, vector<map<int, float> >& weights, const float* currentRoi)
+namespace
+{
+    //set the weight of a node in a short list sorted by node, replacing any weight it already has
+    template <typename T>
+    void setSortedWeight(T* list, int& count, const int& node, const float& weight)
+    {
+        int pos = 0;
+        while (pos < count && list[pos].node < node) ++pos;
+        if (pos < count && list[pos].node == node)
+        {
+            list[pos].weight = weight;
+            return;
+        }
+        for (int k = count; k > pos; --k)
+        {
+            list[k] = list[k - 1];
+        }
+        list[pos] = T(node, weight);
+        ++count;
+    }
+}
+
+void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, vector<WeightElem>& weights, vector<int>& counts, const float* currentRoi)
 {
     int numToNodes = to->getNumberOfNodes();
-    weights.resize(numToNodes);
+    weights.resize(numToNodes * 3);
+    counts.assign(numToNodes, 0);
     const float* toCoordData = to->getCoordinateData();
     FastStatistics fromEdgeStatistics, toEdgeStatistics;
     from->getNodesSpacingStatistics(fromEdgeStatistics);
@@ -588,10 +680,12 @@ void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, co
             for (int i = 0; i < numToNodes; ++i)
             {
                 BarycentricInfo myInfo;
+                WeightElem* list = weights.data() + i * 3;
                 mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
-                if (myInfo.baryWeights[0] != 0.0f) weights[i][myInfo.nodes[0]] = myInfo.baryWeights[0];
-                if (myInfo.baryWeights[1] != 0.0f) weights[i][myInfo.nodes[1]] = myInfo.baryWeights[1];
-                if (myInfo.baryWeights[2] != 0.0f) weights[i][myInfo.nodes[2]] = myInfo.baryWeights[2];
+                for (int j = 0; j < 3; ++j)
+                {
+                    if (myInfo.baryWeights[j] != 0.0f) setSortedWeight(list, counts[i], myInfo.nodes[j], myInfo.baryWeights[j]);
+                }
                 if (myInfo.absDistance > warningDistance) doWarn = true; //shouldn't matter if threads collide writing the same value
             }
         }
@@ -603,28 +697,22 @@ void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, co
             for (int i = 0; i < numToNodes; ++i)
             {
                 BarycentricInfo myInfo;
+                WeightElem* list = weights.data() + i * 3;
                 float weightsum = 0.0f;//there are only 3 weights, so don't bother with double precision
                 mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
-                if (myInfo.baryWeights[0] != 0.0f && currentRoi[myInfo.nodes[0]] > 0.0f)
+                for (int j = 0; j < 3; ++j)
                 {
-                    weights[i][myInfo.nodes[0]] = myInfo.baryWeights[0];
-                    weightsum += myInfo.baryWeights[0];
-                }
-                if (myInfo.baryWeights[1] != 0.0f && currentRoi[myInfo.nodes[1]] > 0.0f)
-                {
-                    weights[i][myInfo.nodes[1]] = myInfo.baryWeights[1];
-                    weightsum += myInfo.baryWeights[1];
-                }
-                if (myInfo.baryWeights[2] != 0.0f && currentRoi[myInfo.nodes[2]] > 0.0f)
-                {
-                    weights[i][myInfo.nodes[2]] = myInfo.baryWeights[2];
-                    weightsum += myInfo.baryWeights[2];
+                    if (myInfo.baryWeights[j] != 0.0f && currentRoi[myInfo.nodes[j]] > 0.0f)
+                    {
+                        setSortedWeight(list, counts[i], myInfo.nodes[j], myInfo.baryWeights[j]);
+                        weightsum += myInfo.baryWeights[j];
+                    }
                 }
                 if (weightsum != 0.0f)
                 {
-                    for (map<int, float>::iterator iter = weights[i].begin(); iter != weights[i].end(); ++iter)
+                    for (int k = 0; k < counts[i]; ++k)
                     {
-                        iter->second /= weightsum;
+                        list[k].weight /= weightsum;
                     }
                     if (myInfo.absDistance > warningDistance) doWarn = true;
                 }
@@ -633,11 +721,174 @@ void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, co
     }
     if (doWarn)
     {
-        if (m_nonsphereAllowed)
+        m_distortionWarning = true;
+        logDistortionWarning();
+    }
+}
+
+void SurfaceResamplingHelper::logDistortionWarning() const
+{
+    if (m_nonsphereAllowed)
+    {
+        CaretLogWarning("current and new resampling surfaces do not follow the same contour very closely everywhere (or have extreme distortion somewhere), resampling output may have artifacts.  please check whether you used the appropriate current and new surfaces");
+    } else {
+        CaretLogWarning("current or new resampling spheres seem to have extremely large distortions, please check them manually");
+    }
+}
+
+namespace
+{
+    const char WEIGHTS_CACHE_MAGIC[8] = { 'W', 'B', 'R', 'S', 'W', 'T', '0', '1' };
+    const int32_t WEIGHTS_CACHE_ENDIAN_CHECK = 0x01020304;
+    
+    struct WeightsCacheHeader
+    {//followed by row starts (int64, numNewNodes + 1), then (node int32, weight float) pairs (numEntries), all native endian
+        char m_magic[8];
+        int32_t m_endianCheck;
+        int32_t m_numCurrentNodes;
+        int32_t m_numNewNodes;
+        int32_t m_distortionWarning;//so a reused file gives the same warning as computing the weights
+        int64_t m_numEntries;
+    };
+    
+    void hashSurface(QCryptographicHash& myHash, const SurfaceFile* surface)
+    {
+        int32_t numNodes = surface->getNumberOfNodes();
+        int32_t numTriangles = surface->getNumberOfTriangles();
+        myHash.addData((const char*)&numNodes, sizeof(int32_t));
+        myHash.addData((const char*)&numTriangles, sizeof(int32_t));
+        myHash.addData((const char*)surface->getCoordinateData(), numNodes * 3 * sizeof(float));
+        for (int32_t i = 0; i < numTriangles; ++i)
         {
-            CaretLogWarning("current and new resampling surfaces do not follow the same contour very closely everywhere (or have extreme distortion somewhere), resampling output may have artifacts.  please check whether you used the appropriate current and new surfaces");
-        } else {
-            CaretLogWarning("current or new resampling spheres seem to have extremely large distortions, please check them manually");
+            myHash.addData((const char*)surface->getTriangle(i), 3 * sizeof(int32_t));
         }
     }
 }
+
+AString SurfaceResamplingHelper::s_cacheDirectory;
+bool SurfaceResamplingHelper::s_cacheDirectorySet = false;
+
+void SurfaceResamplingHelper::setWeightsCacheDirectory(const AString& directory)
+{
+    s_cacheDirectory = directory;
+    s_cacheDirectorySet = true;
+}
+
+AString SurfaceResamplingHelper::getWeightsCacheDirectory()
+{
+    if (s_cacheDirectorySet) return s_cacheDirectory;
+    return AString(qgetenv("WB_RESAMPLING_WEIGHTS_CACHE"));
+}
+
+AString SurfaceResamplingHelper::computeCacheKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                                 const float* currentAreas, const float* newAreas, const float* currentRoi, const bool allowNonSphere)
+{//hash everything the weights depend on, so a changed input can never pick up stale weights
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    int32_t methodInt = (int32_t)myMethod;
+    char nonSphere = (allowNonSphere ? 1 : 0);
+    myHash.addData(WEIGHTS_CACHE_MAGIC, sizeof(WEIGHTS_CACHE_MAGIC));//so changes to the computation can bump the version and invalidate old files
+    myHash.addData((const char*)&methodInt, sizeof(int32_t));
+    myHash.addData(&nonSphere, 1);
+    hashSurface(myHash, currentSphere);
+    hashSurface(myHash, newSphere);
+    if (myMethod == SurfaceResamplingMethodEnum::ADAP_BARY_AREA)
+    {//other methods ignore the areas
+        myHash.addData((const char*)currentAreas, currentSphere->getNumberOfNodes() * sizeof(float));
+        myHash.addData((const char*)newAreas, newSphere->getNumberOfNodes() * sizeof(float));
+    }
+    char hasRoi = (currentRoi != NULL ? 1 : 0);
+    myHash.addData(&hasRoi, 1);
+    if (currentRoi != NULL)
+    {
+        myHash.addData((const char*)currentRoi, currentSphere->getNumberOfNodes() * sizeof(float));
+    }
+    return AString(myHash.result().toHex());
+}
+
+bool SurfaceResamplingHelper::loadCachedWeights(const AString& filename, const int32_t& numCurrentNodes, const int32_t& numNewNodes)
+{//any problem just means we compute the weights instead
+    QFile myFile(filename);
+    if (!myFile.open(QIODevice::ReadOnly)) return false;
+    int64_t fileSize = myFile.size();
+    WeightsCacheHeader header;
+    if (fileSize < (int64_t)sizeof(WeightsCacheHeader) || myFile.read((char*)&header, sizeof(WeightsCacheHeader)) != (qint64)sizeof(WeightsCacheHeader)) return false;
+    if (memcmp(header.m_magic, WEIGHTS_CACHE_MAGIC, sizeof(WEIGHTS_CACHE_MAGIC)) != 0 || header.m_endianCheck != WEIGHTS_CACHE_ENDIAN_CHECK ||
+        header.m_numCurrentNodes != numCurrentNodes || header.m_numNewNodes != numNewNodes || header.m_numEntries < 0 ||
+        fileSize != (int64_t)(sizeof(WeightsCacheHeader) + (numNewNodes + 1) * sizeof(int64_t) + header.m_numEntries * sizeof(WeightElem)))
+    {
+        CaretLogWarning("ignoring invalid resampling weights cache file '" + filename + "'");
+        return false;
+    }
+    vector<int64_t> rowStarts(numNewNodes + 1);
+    CaretArray<WeightElem> storage(header.m_numEntries);
+    bool valid = myFile.read((char*)rowStarts.data(), (numNewNodes + 1) * sizeof(int64_t)) == (qint64)((numNewNodes + 1) * sizeof(int64_t));
+    valid = valid && myFile.read((char*)storage.getArray(), header.m_numEntries * sizeof(WeightElem)) == (qint64)(header.m_numEntries * sizeof(WeightElem));
+    valid = valid && rowStarts[0] == 0 && rowStarts[numNewNodes] == header.m_numEntries;
+    for (int32_t i = 0; valid && i < numNewNodes; ++i)
+    {
+        if (rowStarts[i + 1] < rowStarts[i]) valid = false;
+    }
+    for (int64_t j = 0; valid && j < header.m_numEntries; ++j)
+    {
+        if (storage[j].node < 0 || storage[j].node >= numCurrentNodes) valid = false;
+    }
+    if (!valid)
+    {
+        CaretLogWarning("ignoring corrupted resampling weights cache file '" + filename + "'");
+        return false;
+    }
+    m_storagechunk = storage;
+    m_weights = CaretArray<WeightElem*>(numNewNodes + 1);
+    for (int32_t i = 0; i <= numNewNodes; ++i)
+    {
+        m_weights[i] = m_storagechunk + rowStarts[i];
+    }
+    m_distortionWarning = (header.m_distortionWarning != 0);
+    if (m_distortionWarning) logDistortionWarning();
+    return true;
+}
+
+void SurfaceResamplingHelper::saveCachedWeights(const AString& filename, const int32_t& numCurrentNodes) const
+{//failing to save is not an error, the next run will just compute them again
+    QFileInfo myInfo(filename);
+    if (!QDir().mkpath(myInfo.absolutePath()))
+    {
+        CaretLogWarning("unable to create resampling weights cache directory '" + myInfo.absolutePath() + "'");
+        return;
+    }
+    QTemporaryFile tempFile(filename + ".XXXXXX");//write elsewhere and rename, so concurrent jobs never see a partial file
+    tempFile.setAutoRemove(false);
+    if (!tempFile.open())
+    {
+        CaretLogWarning("unable to create resampling weights cache file in '" + myInfo.absolutePath() + "'");
+        return;
+    }
+    AString tempName = tempFile.fileName();
+    int32_t numNewNodes = (int32_t)m_weights.size() - 1;
+    WeightsCacheHeader header;
+    memcpy(header.m_magic, WEIGHTS_CACHE_MAGIC, sizeof(WEIGHTS_CACHE_MAGIC));
+    header.m_endianCheck = WEIGHTS_CACHE_ENDIAN_CHECK;
+    header.m_numCurrentNodes = numCurrentNodes;
+    header.m_numNewNodes = numNewNodes;
+    header.m_distortionWarning = (m_distortionWarning ? 1 : 0);
+    header.m_numEntries = m_weights[numNewNodes] - m_weights[0];
+    vector<int64_t> rowStarts(numNewNodes + 1);
+    for (int32_t i = 0; i <= numNewNodes; ++i)
+    {
+        rowStarts[i] = m_weights[i] - m_weights[0];
+    }
+    bool good = tempFile.write((const char*)&header, sizeof(WeightsCacheHeader)) == (qint64)sizeof(WeightsCacheHeader);
+    good = good && tempFile.write((const char*)rowStarts.data(), (numNewNodes + 1) * sizeof(int64_t)) == (qint64)((numNewNodes + 1) * sizeof(int64_t));
+    good = good && tempFile.write((const char*)m_weights[0], header.m_numEntries * sizeof(WeightElem)) == (qint64)(header.m_numEntries * sizeof(WeightElem));
+    tempFile.close();
+    if (!good || tempFile.error() != QFile::NoError)
+    {
+        CaretLogWarning("failed to write resampling weights cache file '" + filename + "'");
+        QFile::remove(tempName);
+        return;
+    }
+    if (!QFile::rename(tempName, filename))
+    {//most likely another process finished the same weights first
+        QFile::remove(tempName);
+    }
+}
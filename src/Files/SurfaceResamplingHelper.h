@@ -21,10 +21,11 @@
  */
 /*LICENSE_END*/
 
+#include "AString.h"
 #include "CaretPointer.h"
 #include "SurfaceResamplingMethodEnum.h"
 
-#include <map>
+#include <stdint.h>
 #include <vector>
 
 namespace caret {
@@ -42,15 +43,24 @@ namespace caret {
         };
         CaretArray<WeightElem> m_storagechunk;
         CaretArray<WeightElem*> m_weights;
-        bool m_nonsphereAllowed;
+        bool m_nonsphereAllowed, m_distortionWarning;
+        static AString s_cacheDirectory;
+        static bool s_cacheDirectorySet;
         static bool checkSphere(const SurfaceFile* surface);
         static void changeRadius(const float& radius, const SurfaceFile* input, SurfaceFile* output);
         void computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentAreas, const float* newAreas, const float* currentRoi);
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
-        void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
-        void compactWeights(const std::vector<std::map<int, float> >& weights);
+        ///weights of up to 3 nodes of from for each node of to, at stride 3 and sorted by node, counts gets how many each node has
+        void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<WeightElem>& weights, std::vector<int>& counts, const float* currentRoi);
+        ///weights for node i are counts[i] elements of weights starting at starts[i]
+        void compactWeights(const std::vector<WeightElem>& weights, const std::vector<int64_t>& starts, const std::vector<int>& counts);
+        void logDistortionWarning() const;
+        static AString computeCacheKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                       const float* currentAreas, const float* newAreas, const float* currentRoi, const bool allowNonSphere);
+        bool loadCachedWeights(const AString& filename, const int32_t& numCurrentNodes, const int32_t& numNewNodes);
+        void saveCachedWeights(const AString& filename, const int32_t& numCurrentNodes) const;
     public:
-        SurfaceResamplingHelper() { }
+        SurfaceResamplingHelper() : m_nonsphereAllowed(false), m_distortionWarning(false) { }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                 const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL, const bool allowNonSphere = false);
         ///resample real-valued data by means of weights
@@ -65,6 +75,13 @@ namespace caret {
         void resampleLargest(const int32_t* input, int32_t* output, const int32_t& invalidVal = 0) const;
         ///get the ROI of nodes that have data within the input ROI
         void getResampleValidROI(float* output) const;
+        ///get the input nodes and weights used for a node of the new surface, empty if the node gets no data
+        void getNodeWeights(const int& newNode, std::vector<std::pair<int, float> >& weightsOut) const;
+        
+        ///directory to store computed weights in and reuse them from, keyed by a hash of everything that affects them, empty disables the cache
+        ///if never set, the WB_RESAMPLING_WEIGHTS_CACHE environment variable is used
+        static void setWeightsCacheDirectory(const AString& directory);
+        static AString getWeightsCacheDirectory();
         
         ///resample a cut surface - not something you will apply multiple times, so static method
         static void resampleCutSurface(const SurfaceFile* cutSurfaceIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere, SurfaceFile* surfaceOut);
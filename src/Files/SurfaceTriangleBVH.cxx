@@ -0,0 +1,258 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceTriangleBVH.h"
+
+#include "CaretAssert.h"
+#include "SurfaceFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //entry distance of a ray into a box, false if it misses the box within [tMin, tMax]
+    bool rayHitsBox(const float boxMin[3], const float boxMax[3], const double origin[3], const double inverseDirection[3],
+                    const double tMin, const double tMax, double& tEntryOut)
+    {
+        double entry = tMin, exit = tMax;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (std::isinf(inverseDirection[axis]))
+            {//ray parallel to these slabs, must start between them
+                if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis]) return false;
+                continue;
+            }
+            double t1 = (boxMin[axis] - origin[axis]) * inverseDirection[axis];
+            double t2 = (boxMax[axis] - origin[axis]) * inverseDirection[axis];
+            if (t1 > t2) swap(t1, t2);
+            entry = max(entry, t1);
+            exit = min(exit, t2);
+            if (entry > exit) return false;
+        }
+        tEntryOut = entry;
+        return true;
+    }
+}
+
+SurfaceTriangleBVH::SurfaceTriangleBVH(const SurfaceFile* surfaceFile)
+{
+    CaretAssert(surfaceFile != NULL);
+    const int32_t numNodes = surfaceFile->getNumberOfNodes();
+    const int32_t numTris = surfaceFile->getNumberOfTriangles();
+    if (numNodes > 0)
+    {
+        const float* coords = surfaceFile->getCoordinateData();
+        m_coords = vector<float>(coords, coords + numNodes * 3);
+    }
+    if (numTris > 0)
+    {
+        const int32_t* tris = surfaceFile->getTriangle(0);
+        m_topology = vector<int32_t>(tris, tris + numTris * 3);
+    }
+    build();
+}
+
+void SurfaceTriangleBVH::build()
+{
+    const int32_t numTris = (int32_t)(m_topology.size() / 3);
+    m_nodes.clear();
+    m_triangles.resize(numTris);
+    if (numTris == 0) return;
+    vector<float> centroids(numTris * 3);
+    for (int32_t i = 0; i < numTris; ++i)
+    {
+        m_triangles[i] = i;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            centroids[i * 3 + axis] = (m_coords[m_topology[i * 3] * 3 + axis] +
+                                       m_coords[m_topology[i * 3 + 1] * 3 + axis] +
+                                       m_coords[m_topology[i * 3 + 2] * 3 + axis]) / 3.0f;
+        }
+    }
+    m_nodes.reserve(2 * (numTris / MAX_LEAF_TRIANGLES + 1));
+    struct BuildTask
+    {
+        int32_t m_parent;//node whose second child this is, -1 for the root or a first child
+        int32_t m_start, m_end;
+    };
+    vector<BuildTask> tasks;//depth first, so that a node's first child is always the next node
+    BuildTask rootTask = { -1, 0, numTris };
+    tasks.push_back(rootTask);
+    while (!tasks.empty())
+    {
+        const BuildTask task = tasks.back();
+        tasks.pop_back();
+        const int32_t nodeIndex = (int32_t)m_nodes.size();
+        if (task.m_parent >= 0) m_nodes[task.m_parent].m_start = nodeIndex;
+        Node node;
+        float centroidMin[3], centroidMax[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            node.m_min[axis] = centroidMin[axis] = numeric_limits<float>::max();
+            node.m_max[axis] = centroidMax[axis] = -numeric_limits<float>::max();
+        }
+        for (int32_t i = task.m_start; i < task.m_end; ++i)
+        {
+            const int32_t tri = m_triangles[i];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    const float value = m_coords[m_topology[tri * 3 + j] * 3 + axis];
+                    node.m_min[axis] = min(node.m_min[axis], value);
+                    node.m_max[axis] = max(node.m_max[axis], value);
+                }
+                centroidMin[axis] = min(centroidMin[axis], centroids[tri * 3 + axis]);
+                centroidMax[axis] = max(centroidMax[axis], centroids[tri * 3 + axis]);
+            }
+        }
+        int splitAxis = 0;
+        for (int axis = 1; axis < 3; ++axis)
+        {
+            if (centroidMax[axis] - centroidMin[axis] > centroidMax[splitAxis] - centroidMin[splitAxis]) splitAxis = axis;
+        }
+        const int32_t count = task.m_end - task.m_start;
+        if (count <= MAX_LEAF_TRIANGLES || centroidMax[splitAxis] <= centroidMin[splitAxis])
+        {//small enough, or all centroids are the same point and can't be split
+            node.m_start = task.m_start;
+            node.m_count = count;
+            m_nodes.push_back(node);
+            continue;
+        }
+        node.m_start = -1;//set when the second child is built
+        node.m_count = 0;
+        m_nodes.push_back(node);
+        const int32_t middle = task.m_start + count / 2;
+        nth_element(m_triangles.begin() + task.m_start, m_triangles.begin() + middle, m_triangles.begin() + task.m_end,
+                    [&centroids, splitAxis](const int32_t a, const int32_t b) { return centroids[a * 3 + splitAxis] < centroids[b * 3 + splitAxis]; });
+        BuildTask secondTask = { nodeIndex, middle, task.m_end };
+        BuildTask firstTask = { -1, task.m_start, middle };
+        tasks.push_back(secondTask);
+        tasks.push_back(firstTask);//popped first, so it becomes the next node
+    }
+}
+
+bool SurfaceTriangleBVH::intersectTriangle(const int32_t triangle, const double origin[3], const double direction[3],
+                                           double& tOut, double& uOut, double& vOut) const
+{//Moller-Trumbore, without culling either side
+    const float* c0 = m_coords.data() + m_topology[triangle * 3] * 3;
+    const float* c1 = m_coords.data() + m_topology[triangle * 3 + 1] * 3;
+    const float* c2 = m_coords.data() + m_topology[triangle * 3 + 2] * 3;
+    const double edge1[3] = { (double)c1[0] - c0[0], (double)c1[1] - c0[1], (double)c1[2] - c0[2] };
+    const double edge2[3] = { (double)c2[0] - c0[0], (double)c2[1] - c0[1], (double)c2[2] - c0[2] };
+    const double p[3] = { direction[1] * edge2[2] - direction[2] * edge2[1],
+                          direction[2] * edge2[0] - direction[0] * edge2[2],
+                          direction[0] * edge2[1] - direction[1] * edge2[0] };
+    const double det = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+    if (det == 0.0) return false;//ray is in the plane of the triangle, or the triangle is degenerate
+    const double invDet = 1.0 / det;
+    const double s[3] = { origin[0] - c0[0], origin[1] - c0[1], origin[2] - c0[2] };
+    const double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+    if (u < 0.0 || u > 1.0) return false;
+    const double q[3] = { s[1] * edge1[2] - s[2] * edge1[1],
+                          s[2] * edge1[0] - s[0] * edge1[2],
+                          s[0] * edge1[1] - s[1] * edge1[0] };
+    const double v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * invDet;
+    if (v < 0.0 || u + v > 1.0) return false;
+    tOut = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * invDet;
+    uOut = u;
+    vOut = v;
+    return true;
+}
+
+bool SurfaceTriangleBVH::intersectRay(const float origin[3], const float direction[3], const float minT, const float maxT,
+                                      int32_t& triangleOut, float& tOut, float barycentricOut[3],
+                                      const HitFilter& hitFilter) const
+{
+    triangleOut = -1;
+    if (m_nodes.empty()) return false;
+    const double dOrigin[3] = { origin[0], origin[1], origin[2] };
+    const double dDirection[3] = { direction[0], direction[1], direction[2] };
+    double inverseDirection[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        inverseDirection[axis] = (dDirection[axis] == 0.0) ? numeric_limits<double>::infinity() : 1.0 / dDirection[axis];
+    }
+    double bestT = maxT, bestU = 0.0, bestV = 0.0;
+    vector<int32_t> stack;
+    stack.reserve(64);
+    double entry;
+    if (!rayHitsBox(m_nodes[0].m_min, m_nodes[0].m_max, dOrigin, inverseDirection, minT, bestT, entry)) return false;
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back()];
+        const int32_t nodeIndex = stack.back();
+        stack.pop_back();
+        if (!rayHitsBox(node.m_min, node.m_max, dOrigin, inverseDirection, minT, bestT, entry)) continue;//a closer hit was found since it was pushed
+        if (node.m_count > 0)
+        {
+            for (int32_t i = node.m_start; i < node.m_start + node.m_count; ++i)
+            {
+                const int32_t tri = m_triangles[i];
+                double t, u, v;
+                if (!intersectTriangle(tri, dOrigin, dDirection, t, u, v)) continue;
+                if (t < minT || t > bestT) continue;
+                if (hitFilter)
+                {
+                    const float hitXYZ[3] = { (float)(dOrigin[0] + t * dDirection[0]),
+                                              (float)(dOrigin[1] + t * dDirection[1]),
+                                              (float)(dOrigin[2] + t * dDirection[2]) };
+                    if (!hitFilter(hitXYZ)) continue;
+                }
+                bestT = t;
+                bestU = u;
+                bestV = v;
+                triangleOut = tri;
+            }
+        } else {
+            const int32_t first = nodeIndex + 1, second = node.m_start;
+            double firstEntry, secondEntry;
+            const bool firstHit = rayHitsBox(m_nodes[first].m_min, m_nodes[first].m_max, dOrigin, inverseDirection, minT, bestT, firstEntry);
+            const bool secondHit = rayHitsBox(m_nodes[second].m_min, m_nodes[second].m_max, dOrigin, inverseDirection, minT, bestT, secondEntry);
+            if (firstHit && secondHit)
+            {//visit the nearer child first, so the farther one is usually skipped
+                if (firstEntry < secondEntry)
+                {
+                    stack.push_back(second);
+                    stack.push_back(first);
+                } else {
+                    stack.push_back(first);
+                    stack.push_back(second);
+                }
+            } else if (firstHit) {
+                stack.push_back(first);
+            } else if (secondHit) {
+                stack.push_back(second);
+            }
+        }
+    }
+    if (triangleOut < 0) return false;
+    tOut = (float)bestT;
+    barycentricOut[0] = (float)(1.0 - bestU - bestV);
+    barycentricOut[1] = (float)bestU;
+    barycentricOut[2] = (float)bestV;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef __SURFACE_TRIANGLE_BVH_H__
+#define __SURFACE_TRIANGLE_BVH_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    class SurfaceFile;
+
+    ///bounding volume hierarchy of a surface's triangles, for finding the triangle under the mouse without a render pass
+    ///copies the coordinates and topology, so it must be rebuilt if the surface changes (SurfaceFile does this for its cached one)
+    class SurfaceTriangleBVH
+    {
+        struct Node
+        {
+            float m_min[3], m_max[3];
+            int32_t m_start;//leaf: first entry in m_triangles, inner: index of second child (first child is the next node)
+            int32_t m_count;//leaf: number of triangles, inner: 0
+        };
+        static const int MAX_LEAF_TRIANGLES = 4;
+        std::vector<Node> m_nodes;
+        std::vector<int32_t> m_triangles;//triangle indices, each leaf refers to a range of them
+        std::vector<float> m_coords;
+        std::vector<int32_t> m_topology;
+        void build();
+        bool intersectTriangle(const int32_t triangle, const double origin[3], const double direction[3],
+                               double& tOut, double& uOut, double& vOut) const;
+        SurfaceTriangleBVH();
+    public:
+        typedef std::function<bool(const float xyz[3])> HitFilter;
+
+        explicit SurfaceTriangleBVH(const SurfaceFile* surfaceFile);
+
+        ///find the first triangle hit by the ray origin + t * direction, for t in [minT, maxT], returns false if there is none
+        ///triangles are hit from either side, hitFilter (if set) can reject hits, such as ones that are clipped out
+        ///barycentricOut gets the weights of the triangle's three vertices at the hit point
+        bool intersectRay(const float origin[3], const float direction[3], const float minT, const float maxT,
+                          int32_t& triangleOut, float& tOut, float barycentricOut[3],
+                          const HitFilter& hitFilter = HitFilter()) const;
+    };
+
+}
+
+#endif //__SURFACE_TRIANGLE_BVH_H__
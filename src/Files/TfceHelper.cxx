@@ -0,0 +1,282 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TfceHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "TopologyHelper.h"
+#include "Vector3D.h"
+#include "VolumeSpace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using namespace caret;
+using namespace std;
+
+TfceHelper::Cluster::Cluster()
+{
+    accumVal = 0.0;
+    totalWeight = 0.0;
+    offset = 0.0;
+    parent = -1;
+    numMembers = 0;
+    lastVal = 0.0f;
+    first = true;
+}
+
+void TfceHelper::Cluster::update(const float& bottomVal, const float& param_e, const float& param_h)
+{
+    if (first)
+    {
+        lastVal = bottomVal;
+        first = false;
+    } else {
+        if (bottomVal != lastVal)//skip computing if there is no difference
+        {
+            CaretAssert(bottomVal < lastVal);
+            double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+            double newSlice = pow(totalWeight, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
+            accumVal += newSlice;
+            lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
+        }
+    }
+}
+
+TfceHelper::TfceHelper(const TopologyHelper* topology, const float* areas, const float* roiData, const float& param_e, const float& param_h)
+{
+    CaretAssert(topology != NULL && areas != NULL);
+    m_isVolume = false;
+    m_param_e = param_e;
+    m_param_h = param_h;
+    m_voxelVolume = 0.0f;
+    m_dims[0] = 0; m_dims[1] = 0; m_dims[2] = 0;
+    m_numElements = topology->getNumberOfNodes();
+    m_areas.assign(areas, areas + m_numElements);
+    m_neighOffsets.resize(m_numElements + 1);
+    m_neighOffsets[0] = 0;
+    for (int32_t i = 0; i < (int32_t)m_numElements; ++i)
+    {
+        const vector<int32_t>& neighbors = topology->getNodeNeighbors(i);
+        m_neighbors.insert(m_neighbors.end(), neighbors.begin(), neighbors.end());
+        m_neighOffsets[i + 1] = (int64_t)m_neighbors.size();
+    }
+    if (roiData != NULL)
+    {
+        m_roi.resize(m_numElements);
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            m_roi[i] = (roiData[i] > 0.0f) ? 1 : 0;
+        }
+    }
+}
+
+TfceHelper::TfceHelper(const VolumeSpace& volSpace, const float* roiFrame, const float& param_e, const float& param_h)
+{
+    m_isVolume = true;
+    m_param_e = param_e;
+    m_param_h = param_h;
+    const int64_t* dims = volSpace.getDims();
+    m_dims[0] = dims[0]; m_dims[1] = dims[1]; m_dims[2] = dims[2];
+    m_numElements = dims[0] * dims[1] * dims[2];
+    Vector3D ivec, jvec, kvec, origin;//compute the volume of a voxel so different resolutions have comparable values
+    volSpace.getSpacingVectors(ivec, jvec, kvec, origin);
+    m_voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
+    if (roiFrame != NULL)
+    {
+        m_roi.resize(m_numElements);
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            m_roi[i] = (roiFrame[i] > 0.0f) ? 1 : 0;
+        }
+    }
+}
+
+int TfceHelper::getRecommendedBatchSize()
+{
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    return 2 * numThreads;//some slack, so a thread with a slow map doesn't leave the others idle for long
+}
+
+void TfceHelper::getNeighbors(const int64_t& index, vector<int64_t>& neighborsOut) const
+{
+    neighborsOut.clear();
+    if (m_isVolume)
+    {//face neighbors, i index fastest, same as VolumeSpace::getIndex
+        int64_t i = index % m_dims[0], rest = index / m_dims[0];
+        int64_t j = rest % m_dims[1], k = rest / m_dims[1];
+        const int64_t jStride = m_dims[0], kStride = m_dims[0] * m_dims[1];
+        if (k > 0) neighborsOut.push_back(index - kStride);
+        if (j > 0) neighborsOut.push_back(index - jStride);
+        if (i > 0) neighborsOut.push_back(index - 1);
+        if (i + 1 < m_dims[0]) neighborsOut.push_back(index + 1);
+        if (j + 1 < m_dims[1]) neighborsOut.push_back(index + jStride);
+        if (k + 1 < m_dims[2]) neighborsOut.push_back(index + kStride);
+    } else {
+        neighborsOut.insert(neighborsOut.end(), m_neighbors.begin() + m_neighOffsets[index], m_neighbors.begin() + m_neighOffsets[index + 1]);
+    }
+}
+
+int64_t TfceHelper::findRoot(vector<Cluster>& clusters, const int64_t& which)
+{//path compression, with offsets summed along the path - union by size keeps the recursion depth logarithmic
+    int64_t parent = clusters[which].parent;
+    if (parent == which) return which;
+    int64_t root = findRoot(clusters, parent);
+    clusters[which].offset += clusters[parent].offset;//parent's offset is now relative to root
+    clusters[which].parent = root;
+    return root;
+}
+
+void TfceHelper::compute(const float* data, float* dataOut) const
+{
+    Workspace scratch;
+    computeInternal(data, dataOut, scratch);
+}
+
+void TfceHelper::computeBatch(const vector<const float*>& dataIn, const vector<float*>& dataOut) const
+{
+    CaretAssert(dataIn.size() == dataOut.size());
+    int64_t numMaps = (int64_t)dataIn.size();
+#pragma omp CARET_PAR
+    {
+        Workspace scratch;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t m = 0; m < numMaps; ++m)
+        {
+            computeInternal(dataIn[m], dataOut[m], scratch);
+        }
+    }
+}
+
+void TfceHelper::computeInternal(const float* data, float* dataOut, Workspace& scratch) const
+{
+    scratch.accum.assign(m_numElements, 0.0);
+    scratch.membership.resize(m_numElements, -1);//reset after each use by tfceOneSign
+    tfceOneSign(data, false, scratch);
+    tfceOneSign(data, true, scratch);//negatives and positives don't overlap, so reuse the accum array - NOTE: output is still positive
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (inRoi(i))
+        {
+            if (data[i] < 0.0f)
+            {
+                dataOut[i] = (float)-scratch.accum[i];
+            } else {
+                dataOut[i] = (float)scratch.accum[i];
+            }
+        } else {
+            dataOut[i] = 0.0f;
+        }
+    }
+}
+
+void TfceHelper::tfceOneSign(const float* data, const bool& negate, Workspace& scratch) const
+{
+    vector<pair<float, int64_t> >& sorted = scratch.sorted;
+    vector<int64_t>& membership = scratch.membership;
+    vector<Cluster>& clusters = scratch.clusters;
+    vector<int64_t>& touching = scratch.touching;
+    double* accumData = scratch.accum.data();
+    sorted.clear();
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (inRoi(i))
+        {
+            float value = negate ? -data[i] : data[i];
+            if (value > 0.0f) sorted.push_back(make_pair(value, i));
+        }
+    }
+    sort(sorted.begin(), sorted.end(), greater<pair<float, int64_t> >());//sort once, instead of a heap
+    clusters.clear();
+    int64_t numSorted = (int64_t)sorted.size();
+    for (int64_t s = 0; s < numSorted; ++s)
+    {
+        const float value = sorted[s].first;
+        const int64_t index = sorted[s].second;
+        getNeighbors(index, scratch.neighbors);
+        touching.clear();
+        for (int n = 0; n < (int)scratch.neighbors.size(); ++n)
+        {
+            int64_t neighCluster = membership[scratch.neighbors[n]];
+            if (neighCluster != -1)
+            {
+                int64_t root = findRoot(clusters, neighCluster);
+                if (find(touching.begin(), touching.end(), root) == touching.end()) touching.push_back(root);
+            }
+        }
+        int64_t joined;
+        switch (touching.size())
+        {
+            case 0://make new cluster
+                joined = (int64_t)clusters.size();
+                clusters.push_back(Cluster());
+                clusters[joined].parent = joined;
+                break;
+            case 1://add to cluster
+                joined = touching[0];
+                break;
+            default://merge all touching clusters into the biggest one (in number of members), union by size
+            {
+                joined = touching[0];
+                for (int t = 1; t < (int)touching.size(); ++t)
+                {
+                    if (clusters[touching[t]].numMembers > clusters[joined].numMembers) joined = touching[t];
+                }
+                Cluster& mergedCluster = clusters[joined];
+                mergedCluster.update(value, m_param_e, m_param_h);//recalculate to align cluster bottoms
+                for (int t = 0; t < (int)touching.size(); ++t)
+                {
+                    if (touching[t] == joined) continue;
+                    Cluster& thisCluster = clusters[touching[t]];
+                    thisCluster.update(value, m_param_e, m_param_h);
+                    thisCluster.offset = thisCluster.accumVal - mergedCluster.accumVal;//members use the merged cluster's accum from now on, remember how far they were from it
+                    thisCluster.parent = joined;
+                    mergedCluster.numMembers += thisCluster.numMembers;
+                    mergedCluster.totalWeight += thisCluster.totalWeight;
+                }
+                break;
+            }
+        }
+        Cluster& joinedCluster = clusters[joined];
+        joinedCluster.update(value, m_param_e, m_param_h);//will not trigger recomputation when merging, we already recomputed at this value
+        ++joinedCluster.numMembers;
+        joinedCluster.totalWeight += getWeight(index);
+        accumData[index] -= joinedCluster.accumVal;//the accum value is the current amount less than the peak value that the edge of the cluster has (this element is on the edge)
+        membership[index] = joined;
+    }
+    int64_t numClusters = (int64_t)clusters.size();
+    for (int64_t c = 0; c < numClusters; ++c)
+    {
+        if (clusters[c].parent == c) clusters[c].update(0.0f, m_param_e, m_param_h);//update to include the to-zero slice
+    }
+    for (int64_t s = 0; s < numSorted; ++s)
+    {//each element gets the final accum of its root, plus the corrections from the merges along the way
+        const int64_t index = sorted[s].second;
+        int64_t cluster = membership[index];
+        int64_t root = findRoot(clusters, cluster);
+        accumData[index] += clusters[cluster].offset + clusters[root].accumVal;//root offset is always zero
+        membership[index] = -1;//ready for the next use of the workspace
+    }
+}
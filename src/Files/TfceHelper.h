@@ -0,0 +1,86 @@
+#ifndef __TFCE_HELPER_H__
+#define __TFCE_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstddef>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace caret {
+
+    class TopologyHelper;
+    class VolumeSpace;
+    
+    ///threshold-free cluster enhancement on a fixed surface topology or volume grid, reusable for many maps (such as permutations)
+    ///clusters are merged with a union-find where each merged cluster only records its offset from the cluster it joined, so merges never walk the members
+    class TfceHelper
+    {
+        struct Cluster
+        {
+            double accumVal, totalWeight;
+            double offset;//correction to add to members to use the parent's accumVal instead, zero for roots
+            int64_t parent, numMembers;
+            float lastVal;
+            bool first;
+            Cluster();
+            void update(const float& bottomVal, const float& param_e, const float& param_h);
+        };
+        struct Workspace
+        {
+            std::vector<std::pair<float, int64_t> > sorted;
+            std::vector<int64_t> membership;
+            std::vector<double> accum;
+            std::vector<Cluster> clusters;
+            std::vector<int64_t> neighbors, touching;
+        };
+        int64_t m_numElements;
+        float m_param_e, m_param_h;
+        bool m_isVolume;
+        int64_t m_dims[3];
+        float m_voxelVolume;
+        std::vector<int64_t> m_neighOffsets;//surface neighbors in CSR form
+        std::vector<int32_t> m_neighbors;
+        std::vector<float> m_areas;
+        std::vector<char> m_roi;//empty means everything is included
+        bool inRoi(const int64_t& index) const { return m_roi.empty() || m_roi[index] != 0; }
+        void getNeighbors(const int64_t& index, std::vector<int64_t>& neighborsOut) const;
+        float getWeight(const int64_t& index) const { return m_isVolume ? m_voxelVolume : m_areas[index]; }
+        void computeInternal(const float* data, float* dataOut, Workspace& scratch) const;
+        void tfceOneSign(const float* data, const bool& negate, Workspace& scratch) const;
+        static int64_t findRoot(std::vector<Cluster>& clusters, const int64_t& which);
+    public:
+        ///surface topology, areas is per-vertex (possibly corrected) area, vertices where roiData is not positive are excluded
+        TfceHelper(const TopologyHelper* topology, const float* areas, const float* roiData = NULL, const float& param_e = 1.0f, const float& param_h = 2.0f);
+        ///volume grid with face neighbors, voxels where roiFrame is not positive are excluded
+        TfceHelper(const VolumeSpace& volSpace, const float* roiFrame = NULL, const float& param_e = 0.5f, const float& param_h = 2.0f);
+        ///positive and negative values are enhanced separately, negative inputs give negative outputs, excluded elements get zero
+        void compute(const float* data, float* dataOut) const;
+        ///computes many maps in parallel, each thread reuses its scratch memory across maps
+        void computeBatch(const std::vector<const float*>& dataIn, const std::vector<float*>& dataOut) const;
+        ///number of maps per computeBatch call that keeps all threads busy without much buffered output
+        static int getRecommendedBatchSize();
+    };
+
+}
+
+#endif //__TFCE_HELPER_H__
@@ -363,30 +363,19 @@ VolumeDynamicConnectivityFile::loadMapAverageDataForVoxelIndices(const int64_t v
      */
     clearVoxels();
     
-    std::vector<double> dataSum(m_numberOfVoxels);
-    std::fill(dataSum.begin(),
-              dataSum.end(),
-              0.0);
     std::vector<int64_t> brainordinateIndices;
     for (auto voxel : voxelIndices) {
         const int64_t offset(m_parentVolumeFile->getIndex(voxel.m_ijk));
         brainordinateIndices.push_back(offset);
-        
-        std::vector<float> data;
-        connCorrelationTwo->computeForDataSetIndex(offset, data);
-        
-        for (int64_t j = 0; j < m_numberOfVoxels; j++) {
-            CaretAssertVectorIndex(dataSum, j);
-            CaretAssertVectorIndex(data, j);
-            dataSum[j] += data[j];
-        }
     }
     
     if (m_numberOfVoxels > 0) {
-        const double numVoxels(m_numberOfVoxels);
+        std::vector<float> dataAverage(m_numberOfVoxels);
+        connCorrelationTwo->computeAverageForDataSetIndices(brainordinateIndices,
+                                                            dataAverage);
         for (int64_t j = 0; j < m_numberOfVoxels; j++) {
-            CaretAssertVectorIndex(dataSum, j);
-            m_voxelData[j] = (dataSum[j] / numVoxels);
+            CaretAssertVectorIndex(dataAverage, j);
+            m_voxelData[j] = dataAverage[j];
         }
         
         const int32_t mapIndex(0);
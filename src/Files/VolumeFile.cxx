@@ -38,6 +38,7 @@
 #include "ChartDataSource.h"
 #include "ClusterContainer.h"
 #include "DataFileContentInformation.h"
+#include "DataFileStatisticsSidecar.h"
 #include "ElapsedTimer.h"
 #include "EventManager.h"
 #include "GiftiLabel.h"
@@ -245,6 +246,7 @@ VolumeFile::clear()
     m_fileFastStatistics.grabNew(NULL);
     m_fileHistogram.grabNew(NULL);
     m_fileHistorgramLimitedValues.grabNew(NULL);
+    m_fileStatisticsSidecarChecked = false;
     
     m_caretVolExt.clear();
     m_brickAttributes.clear();
@@ -909,6 +911,7 @@ VolumeFile::setModified()
     m_fileFastStatistics.grabNew(NULL);
     m_fileHistogram.grabNew(NULL);
     m_fileHistorgramLimitedValues.grabNew(NULL);
+    m_fileStatisticsSidecarChecked = false;
 }
 
 /**
@@ -1059,6 +1062,7 @@ void VolumeFile::checkStatisticsValid()
             m_brickAttributes[i].m_fastStatistics.grabNew(NULL);
             m_brickAttributes[i].m_histogram.grabNew(NULL);
             m_brickAttributes[i].m_histogramLimitedValues.grabNew(NULL);
+            m_brickAttributes[i].m_summaryValid = false;
         }
         m_brickStatisticsValid = true;
     }
@@ -1216,13 +1220,7 @@ const FastStatistics*
 VolumeFile::getFileFastStatistics()
 {
     if (m_fileFastStatistics == NULL) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
-            m_fileFastStatistics.grabNew(new FastStatistics());
-            m_fileFastStatistics->update(&fileData[0],
-                                         fileData.size());
-        }
+        updateFileStatisticsAndHistogram();
     }
     
     return m_fileFastStatistics;
@@ -1241,32 +1239,165 @@ const Histogram*
 VolumeFile::getFileHistogram()
 {
     const int32_t numBuckets = getFileHistogramNumberOfBuckets();
-    bool updateHistogramFlag = false;
-    if (m_fileHistogram != NULL) {
-        if (numBuckets != m_fileHistogramNumberOfBuckets) {
-            updateHistogramFlag = true;
-        }
+    if ((m_fileHistogram == NULL)
+        || (numBuckets != m_fileHistogramNumberOfBuckets)) {
+        updateFileStatisticsAndHistogram();
     }
-    else {
-        updateHistogramFlag = true;
+    
+    return m_fileHistogram;
+}
+
+namespace {
+    /**
+     * Provides the maps of a volume file for the statistics of all
+     * data in the file.
+     */
+    class VolumeMapPartReader : public PartitionedStatistics::PartReader {
+    public:
+        VolumeMapPartReader(const VolumeFile* volumeFile)
+        : m_volumeFile(volumeFile) { }
         
-    }
+        int64_t getNumberOfParts() const {
+            return m_volumeFile->getNumberOfMaps();
+        }
+        
+        bool supportsConcurrentRead() const {
+            return true;
+        }
+        
+        const float* readPart(const int64_t& index,
+                              std::vector<float>& storage,
+                              int64_t& countOut) const {
+            int64_t dimI, dimJ, dimK, dimTime, dimComp;
+            m_volumeFile->getDimensions(dimI, dimJ, dimK, dimTime, dimComp);
+            const int64_t frameSize = dimI * dimJ * dimK;
+            countOut = frameSize * dimComp;
+            if (dimComp == 1) {
+                return m_volumeFile->getFrame(index);
+            }
+            
+            /*
+             * Components of a map are not contiguous
+             */
+            storage.resize(countOut);
+            for (int64_t iComp = 0; iComp < dimComp; iComp++) {
+                const float* frame = m_volumeFile->getFrame(index,
+                                                            iComp);
+                std::copy(frame,
+                          frame + frameSize,
+                          storage.begin() + iComp * frameSize);
+            }
+            return (storage.empty() ? NULL : &storage[0]);
+        }
+        
+    private:
+        const VolumeFile* m_volumeFile;
+    };
+}
+
+/**
+ * Update the statistics and histogram of all data in the file that are
+ * missing or out of date.  They are read from the statistics sidecar
+ * when it matches the file on disk, otherwise both are computed from
+ * the file's maps in parallel and the sidecar is written.  The range
+ * and mean of each map are kept for getDataRangeFromAllMaps().
+ */
+void
+VolumeFile::updateFileStatisticsAndHistogram()
+{
+    const int32_t numBuckets = getFileHistogramNumberOfBuckets();
     
-    if (updateHistogramFlag) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
-            if (m_fileHistogram == NULL) {
-                m_fileHistogram.grabNew(new Histogram(numBuckets));
+    /*
+     * Sidecar describes the data on disk, not data changed in memory
+     */
+    const bool useSidecarFlag = ( ! isModifiedExcludingPaletteColorMapping());
+    if (useSidecarFlag
+        && ( ! m_fileStatisticsSidecarChecked)) {
+        m_fileStatisticsSidecarChecked = true;
+        CaretPointer<FastStatistics> sidecarStatistics;
+        CaretPointer<Histogram> sidecarHistogram;
+        std::vector<PartitionedStatistics::PartSummary> sidecarBrickSummaries;
+        if (DataFileStatisticsSidecar::read(getFileName(),
+                                            sidecarStatistics,
+                                            sidecarHistogram,
+                                            sidecarBrickSummaries)) {
+            setBrickSummaries(sidecarBrickSummaries);
+            if ((m_fileFastStatistics == NULL)
+                && (sidecarStatistics != NULL)) {
+                m_fileFastStatistics = sidecarStatistics;
+            }
+            if ((sidecarHistogram != NULL)
+                && (sidecarHistogram->getNumberOfBuckets() == numBuckets)) {
+                m_fileHistogram = sidecarHistogram;
+                m_fileHistogramNumberOfBuckets = numBuckets;
             }
-            m_fileHistogram->update(numBuckets,
-                                    &fileData[0],
-                                    fileData.size());
-            m_fileHistogramNumberOfBuckets = numBuckets;
         }
     }
     
-    return m_fileHistogram;
+    const bool updateStatisticsFlag = (m_fileFastStatistics == NULL);
+    const bool updateHistogramFlag  = ((m_fileHistogram == NULL)
+                                       || (numBuckets != m_fileHistogramNumberOfBuckets));
+    if (( ! updateStatisticsFlag)
+        && ( ! updateHistogramFlag)) {
+        return;
+    }
+    
+    CaretPointer<FastStatistics> fastStatistics;
+    if (updateStatisticsFlag) {
+        fastStatistics.grabNew(new FastStatistics());
+    }
+    CaretPointer<Histogram> histogram;
+    if (updateHistogramFlag) {
+        histogram.grabNew(new Histogram(numBuckets));
+    }
+    const VolumeMapPartReader mapReader(this);
+    std::vector<PartitionedStatistics::PartSummary> brickSummaries;
+    if ( ! PartitionedStatistics::compute(mapReader,
+                                          numBuckets,
+                                          fastStatistics,
+                                          histogram,
+                                          &brickSummaries)) {
+        return;
+    }
+    setBrickSummaries(brickSummaries);
+    
+    if (updateStatisticsFlag) {
+        m_fileFastStatistics = fastStatistics;
+    }
+    if (updateHistogramFlag) {
+        m_fileHistogram = histogram;
+        m_fileHistogramNumberOfBuckets = numBuckets;
+    }
+    
+    if (useSidecarFlag) {
+        DataFileStatisticsSidecar::write(getFileName(),
+                                         m_fileFastStatistics,
+                                         m_fileHistogram,
+                                         brickSummaries);
+    }
+}
+
+/**
+ * Set the range and mean of each map, computed with or read along
+ * with the statistics of all data in the file.
+ *
+ * @param brickSummaries
+ *    Range and mean of each map, ignored if the number of maps differs.
+ */
+void
+VolumeFile::setBrickSummaries(const std::vector<PartitionedStatistics::PartSummary>& brickSummaries)
+{
+    const int32_t numMaps = getNumberOfMaps();
+    if (static_cast<int32_t>(brickSummaries.size()) != numMaps) {
+        return;
+    }
+    
+    checkStatisticsValid();
+    for (int32_t i = 0; i < numMaps; i++) {
+        CaretAssertVectorIndex(m_brickAttributes, i);
+        m_brickAttributes[i].m_summary = brickSummaries[i];
+        m_brickAttributes[i].m_summaryValid = true;
+    }
 }
 
 /**
@@ -2266,6 +2397,36 @@ VolumeFile::getDataRangeFromAllMaps(float& dataRangeMinimumOut,
     m_dataRangeMaximum = -std::numeric_limits<float>::max();
     m_dataRangeMinimum = std::numeric_limits<float>::max();
     
+    /*
+     * Use the range of each map from the file's statistics when
+     * they are available, so the data is not read again.
+     */
+    bool brickSummariesValidFlag = (m_brickStatisticsValid
+                                    && ( ! m_brickAttributes.empty()));
+    for (const BrickAttributes& brick : m_brickAttributes) {
+        if ( ! brick.m_summaryValid) {
+            brickSummariesValidFlag = false;
+            break;
+        }
+    }
+    if (brickSummariesValidFlag) {
+        for (const BrickAttributes& brick : m_brickAttributes) {
+            if (brick.m_summary.m_max > m_dataRangeMaximum) {
+                m_dataRangeMaximum = brick.m_summary.m_max;
+            }
+            if (brick.m_summary.m_min < m_dataRangeMinimum) {
+                m_dataRangeMinimum = brick.m_summary.m_min;
+            }
+        }
+        
+        dataRangeMinimumOut = m_dataRangeMinimum;
+        dataRangeMaximumOut = m_dataRangeMaximum;
+        
+        m_dataRangeValid = true;
+        
+        return true;
+    }
+    
     const int64_t* dimensions = getDimensionsPtr();
     int64_t m_dataSize = dimensions[0] * dimensions[1] * dimensions[2] * dimensions[3] * dimensions[4];
     const float* data = getFrame();//HACK: use first frame knowing all data is contiguous after it
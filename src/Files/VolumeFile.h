@@ -32,6 +32,7 @@
 #include "CaretVolumeExtension.h"
 #include "ChartableLineSeriesBrainordinateInterface.h"
 #include "GroupAndNameHierarchyUserInterface.h"
+#include "PartitionedStatistics.h"
 #include "StructureEnum.h"
 #include "GiftiMetaData.h"
 #include "BoundingBox.h"
@@ -64,6 +65,10 @@ namespace caret {
         
         void checkStatisticsValid();
         
+        void updateFileStatisticsAndHistogram();//reads the statistics sidecar, or computes both from the maps in parallel
+        
+        void setBrickSummaries(const std::vector<PartitionedStatistics::PartSummary>& brickSummaries);
+        
         struct BrickAttributes//for storing ONLY stuff that doesn't get saved to the caret extension
         {//TODO: prune this once statistics gets straightened out
             CaretPointer<FastStatistics> m_fastStatistics;
@@ -76,6 +81,8 @@ namespace caret {
             float m_histogramLimitedValuesLeastNegativeValueInclusive;
             float m_histogramLimitedValuesMostNegativeValueInclusive;
             bool m_histogramLimitedValuesIncludeZeroValues;
+            PartitionedStatistics::PartSummary m_summary;//range and mean, from the statistics of all data in the file
+            bool m_summaryValid = false;
         };
         
         mutable std::vector<BrickAttributes> m_brickAttributes;//because statistics and metadata construct lazily
@@ -90,6 +97,9 @@ namespace caret {
         
         int32_t m_fileHistogramNumberOfBuckets = 100;
         
+        /** Statistics sidecar has been checked since the file was read */
+        bool m_fileStatisticsSidecarChecked = false;
+        
         /** Histogram with limited values used when statistics computed on all data in file */
         CaretPointer<Histogram> m_fileHistorgramLimitedValues;
         
@@ -19,12 +19,14 @@
 /*LICENSE_END*/
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <ostream>
 #include <limits>
 #include <sstream>
 
 #include "Base64.h"
+#include "Base64Decoder.h"
 #include "ByteOrderEnum.h"
 #include "ByteSwapping.h"
 #include "CaretAssert.h"
@@ -42,6 +44,7 @@
 #include "PaletteColorMapping.h"
 #include "SystemUtilities.h"
 #include "XmlWriter.h"
+#include "zlib.h"
 
 using namespace caret;
 
@@ -590,14 +593,11 @@ GiftiDataArray::readFromText(const AString text,
                              const bool isReadOnlyMetaData)
 {
    const NiftiDataTypeEnum::Enum requiredDataType = dataType;
-   dataType = dataTypeForReading;
-   encoding = encodingForReading;
-   endian   = dataEndianForReading;
-   arraySubscriptingOrder = arraySubscriptingOrderForReading;
-   setDimensions(dimensionsForReading);
-   if (dimensionsForReading.size() == 0) {
-      throw GiftiException("Data array has no dimensions.");
-   }
+   setAttributesForReading(dataEndianForReading,
+                           arraySubscriptingOrderForReading,
+                           dataTypeForReading,
+                           dimensionsForReading,
+                           encodingForReading);
    //setExternalFileInformation(externalFileNameForReading,
    //                           externalFileOffsetForReading);//TSC: don't set the external filename on the array, because that is what it uses when writing the array
                               
@@ -654,75 +654,14 @@ GiftiDataArray::readFromText(const AString text,
             }
             break;
           case GiftiEncodingEnum::BASE64_BINARY:
-            {
-               //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               const uint64_t numDecoded =
-                     Base64::decode((const unsigned char*)(text.toStdString().c_str()),
-                                                data.size(),
-                                                &data[0],
-                                                text.size());
-               if (numDecoded != data.size()) {
-                  std::ostringstream str;
-                  str << "Decoding of Base64 Binary data failed.\n"
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
-                      << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               //
-               // Is byte swapping needed ?
-               //
-               if (endian != getSystemEndian()) {
-                  byteSwapData(getSystemEndian());
-               }
-            }
-            break;
           case GiftiEncodingEnum::GZIP_BASE64_BINARY:
             {
                //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               std::vector<unsigned char> dataBuffer(text.size() - text.size() / 4 + 10);//generous constant to make up for integer rounding
-               //const char* textChars = text.toLatin1().constData();
-               const uint64_t numDecoded =
-                     Base64::decode((unsigned char*)text.toStdString().c_str(),
-                                                dataBuffer.size(),
-                                                dataBuffer.data(),
-                                                text.size());
-               if (numDecoded == 0) {
-                   std::ostringstream str;
-                   str << "Decoding of GZip Base64 Binary data failed."
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
-                   << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                   throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               
-               //
-               // Uncompress the data using VTK's algorithm
-               // 
-                DataCompressZLib compressor;
-                const uint64_t uncompressedDataLength = 
-                                   compressor.uncompressData(dataBuffer.data(),
-                                                          numDecoded,
-                                                          (unsigned char*)&data[0],
-                                                          data.size());
-               if (uncompressedDataLength != data.size()) {
-                  std::ostringstream str;
-                  str << "Decompression of Binary data failed.\n"
-                   << "Uncompressed " << AString::number(uncompressedDataLength).toStdString() << " bytes but should be "
-                   << AString::number(static_cast<uint64_t>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               //
-               // Is byte swapping needed ? 
+               // Base64 text is ASCII, a single conversion to bytes is sufficient
                //
-               if (endian != getSystemEndian()) {
-                  byteSwapData(getSystemEndian());
-               }
+               const QByteArray textBytes = text.toLatin1();
+               decodeEncodedData(textBytes.constData(),
+                                 textBytes.size());
             }
             break;
           case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
@@ -797,6 +736,90 @@ GiftiDataArray::readFromText(const AString text,
             break;
       }
    
+      finishReadingData(requiredDataType);
+   } // If NOT metadata only
+   
+   setModified();
+}
+
+/**
+ * Read a GIFTI data array from base64 or gzip base64 encoded text.
+ * Unlike readFromText(), this may be called from multiple threads
+ * as long as each thread reads a different data array.
+ *
+ * @param text
+ *    The encoded text, it does not need to be null terminated.
+ * @param textLength
+ *    Number of characters in the text.
+ * @param dataEndianForReading
+ *    Endian of the encoded data.
+ * @param arraySubscriptingOrderForReading
+ *    Indexing order of the encoded data.
+ * @param dataTypeForReading
+ *    Data type of the encoded data.
+ * @param dimensionsForReading
+ *    Dimensions of the data array.
+ * @param encodingForReading
+ *    Must be BASE64_BINARY or GZIP_BASE64_BINARY.
+ * @throws GiftiException
+ *    If the text is not valid or does not contain the expected amount of data.
+ */
+void
+GiftiDataArray::readFromEncodedText(const char* text,
+                                    const int64_t textLength,
+                                    const GiftiEndianEnum::Enum dataEndianForReading,
+                                    const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                    const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                    const std::vector<int64_t>& dimensionsForReading,
+                                    const GiftiEncodingEnum::Enum encodingForReading)
+{
+    CaretAssert((encodingForReading == GiftiEncodingEnum::BASE64_BINARY)
+                || (encodingForReading == GiftiEncodingEnum::GZIP_BASE64_BINARY));
+    
+    const NiftiDataTypeEnum::Enum requiredDataType = dataType;
+    setAttributesForReading(dataEndianForReading,
+                            arraySubscriptingOrderForReading,
+                            dataTypeForReading,
+                            dimensionsForReading,
+                            encodingForReading);
+    decodeEncodedData(text,
+                      textLength);
+    finishReadingData(requiredDataType);
+    
+    setModified();
+}
+
+/**
+ * Set the attributes of the data that is about to be read and
+ * allocate the data.
+ */
+void
+GiftiDataArray::setAttributesForReading(const GiftiEndianEnum::Enum dataEndianForReading,
+                                        const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                        const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                        const std::vector<int64_t>& dimensionsForReading,
+                                        const GiftiEncodingEnum::Enum encodingForReading)
+{
+   dataType = dataTypeForReading;
+   encoding = encodingForReading;
+   endian   = dataEndianForReading;
+   arraySubscriptingOrder = arraySubscriptingOrderForReading;
+   setDimensions(dimensionsForReading);
+   if (dimensionsForReading.size() == 0) {
+      throw GiftiException("Data array has no dimensions.");
+   }
+}
+
+/**
+ * Convert data that was just read to the required data type and to
+ * row major order.
+ *
+ * @param requiredDataType
+ *    Data type the array had before reading.
+ */
+void
+GiftiDataArray::finishReadingData(const NiftiDataTypeEnum::Enum requiredDataType)
+{
       //
       // Check if data type needs to be converted
       //
@@ -809,12 +832,159 @@ GiftiDataArray::readFromText(const AString text,
        //
        // Are array indices in opposite order
        //
-       if (arraySubscriptingOrderForReading == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
+       if (arraySubscriptingOrder == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
            convertArrayIndexingOrder();
        }
-   } // If NOT metadata only
-   
-   setModified();
+}
+
+/**
+ * Decode base64 or gzip base64 text into the allocated data and byte swap
+ * it if needed.  The text is decoded in blocks that are passed directly to
+ * zlib's inflate, which writes into the data, so there is no intermediate
+ * copy of the whole compressed data.
+ *
+ * @param text
+ *    The encoded text.
+ * @param textLength
+ *    Number of characters in the text.
+ * @throws GiftiException
+ *    If the text is not valid or does not contain the expected amount of data.
+ */
+void
+GiftiDataArray::decodeEncodedData(const char* text,
+                                  const int64_t textLength)
+{
+    const bool gzipFlag = (encoding == GiftiEncodingEnum::GZIP_BASE64_BINARY);
+    const int64_t dataSize = data.size();
+    unsigned char dummyOutput = 0;
+    unsigned char* dataBytes = (dataSize > 0) ? &data[0] : &dummyOutput;//zlib does not accept a NULL output
+    
+    const int64_t TEXT_BLOCK_SIZE = 65536;
+    std::vector<unsigned char> decodedBlock(Base64Decoder::getMaximumDecodedSize(TEXT_BLOCK_SIZE));
+    Base64Decoder decoder;
+    
+    z_stream zStream;
+    memset(&zStream, 0, sizeof(zStream));
+    if (gzipFlag) {
+        if (inflateInit(&zStream) != Z_OK) {
+            throw GiftiException("Unable to initialize decompression of Binary data.");
+        }
+    }
+    
+    int64_t numDecoded = 0;
+    int64_t numOutput  = 0;
+    bool streamEndFlag = false;
+    AString errorMessage;
+    for (int64_t textOffset = 0; textOffset <= textLength; textOffset += TEXT_BLOCK_SIZE) {
+        int64_t blockDecoded = 0;
+        if (textOffset < textLength) {
+            blockDecoded = decoder.decode(text + textOffset,
+                                          std::min(TEXT_BLOCK_SIZE, textLength - textOffset),
+                                          decodedBlock.data());
+        }
+        else {
+            blockDecoded = decoder.finish(decodedBlock.data());
+        }
+        if (blockDecoded < 0) {
+            errorMessage = ("Decoding of Base64 Binary data failed.\n"
+                            "Text contains a character that is not valid in Base64.");
+            break;
+        }
+        numDecoded += blockDecoded;
+        
+        if (gzipFlag) {
+            zStream.next_in  = decodedBlock.data();
+            zStream.avail_in = blockDecoded;
+            while ((zStream.avail_in > 0)
+                   && ( ! streamEndFlag)) {
+                const int64_t outputRemaining = dataSize - numOutput;
+                zStream.next_out  = dataBytes + numOutput;
+                zStream.avail_out = std::min(outputRemaining, (int64_t)(1 << 30));
+                const int result = inflate(&zStream, Z_NO_FLUSH);
+                numOutput = zStream.next_out - dataBytes;
+                if (result == Z_STREAM_END) {
+                    streamEndFlag = true;
+                }
+                else if (result != Z_OK) {
+                    if ((result == Z_BUF_ERROR)
+                        && (numOutput >= dataSize)) {
+                        errorMessage = ("Decompression of Binary data failed.\n"
+                                        "Uncompressed data is larger than "
+                                        + AString::number(dataSize)
+                                        + " bytes.");
+                    }
+                    else {
+                        errorMessage = ("Decompression of Binary data failed.\n"
+                                        "zlib error code "
+                                        + AString::number(result)
+                                        + ".");
+                    }
+                    break;
+                }
+            }
+        }
+        else {
+            if ((numOutput + blockDecoded) > dataSize) {
+                errorMessage = ("Decoding of Base64 Binary data failed.\n"
+                                "Decoded more than "
+                                + AString::number(dataSize)
+                                + " bytes.");
+                break;
+            }
+            if (blockDecoded > 0) {
+                memcpy(dataBytes + numOutput,
+                       decodedBlock.data(),
+                       blockDecoded);
+                numOutput += blockDecoded;
+            }
+        }
+        
+        if ( ! errorMessage.isEmpty()) {
+            break;
+        }
+    }
+    
+    if (gzipFlag) {
+        inflateEnd(&zStream);
+    }
+    
+    if (errorMessage.isEmpty()) {
+        if (gzipFlag) {
+            if (numDecoded == 0) {
+                errorMessage = ("Decoding of GZip Base64 Binary data failed."
+                                "Decoded 0 bytes but should be "
+                                + AString::number(dataSize)
+                                + " bytes.");
+            }
+            else if (( ! streamEndFlag)
+                     || (numOutput != dataSize)) {
+                errorMessage = ("Decompression of Binary data failed.\n"
+                                "Uncompressed "
+                                + AString::number(numOutput)
+                                + " bytes but should be "
+                                + AString::number(dataSize)
+                                + " bytes.");
+            }
+        }
+        else if (numOutput != dataSize) {
+            errorMessage = ("Decoding of Base64 Binary data failed.\n"
+                            "Decoded "
+                            + AString::number(numOutput)
+                            + " bytes but should be "
+                            + AString::number(dataSize)
+                            + " bytes.");
+        }
+    }
+    if ( ! errorMessage.isEmpty()) {
+        throw GiftiException(errorMessage);
+    }
+    
+    //
+    // Is byte swapping needed ?
+    //
+    if (endian != getSystemEndian()) {
+        byteSwapData(getSystemEndian());
+    }
 }
 
 /**
@@ -1012,7 +1182,8 @@ GiftiDataArray::convertArrayIndexingOrder()
 void 
 GiftiDataArray::writeAsXML(std::ostream& stream, 
                            std::ostream* externalBinaryOutputStream,
-                           GiftiEncodingEnum::Enum encodingForWriting) 
+                           GiftiEncodingEnum::Enum encodingForWriting,
+                           const std::vector<char>* encodedData)
                                                
 {
     this->encoding = encodingForWriting;
@@ -1169,66 +1340,24 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
          }
          break;
        case GiftiEncodingEnum::BASE64_BINARY:
+       case GiftiEncodingEnum::GZIP_BASE64_BINARY:
          {
             //
-            // Encode the data with VTK's Base64 algorithm
+            // Encode here if the data was not encoded by the caller
             //
-            const uint64_t bufferLength = static_cast<uint64_t>(data.size() * 1.5);
-            char* buffer = new char[bufferLength];
-            const uint64_t compressedLength =
-               Base64::encode(&data[0],
-                                          data.size(),
-                                          (unsigned char*)buffer);
-            if (compressedLength >= bufferLength) {
-               throw GiftiException(
-                     "Base64 encoding buffer length ("
-                     + AString::number(bufferLength)
-                     + ") is too small but needs to be "
-                                    + AString::number(compressedLength));
+            std::vector<char> encodedDataBuffer;
+            if (encodedData == NULL) {
+                encodeDataForWriting(encoding,
+                                     encodedDataBuffer);
+                encodedData = &encodedDataBuffer;
             }
-            buffer[compressedLength] = '\0';
             
             //
             // Write the data  MUST BE NO space around data
             //
-            xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA, buffer);
-            
-            //
-            // Free memory
-            //
-            delete[] buffer;
-         }
-         break;
-       case GiftiEncodingEnum::GZIP_BASE64_BINARY:
-         {
-            //
-            // Compress the data with VTK's ZLIB algorithm
-            //
-             DataCompressZLib compressor;
-             uint64_t compressedDataBufferLength =
-                              compressor.getMaximumCompressionSpace(data.size());
-            std::vector<unsigned char> compressedDataBuffer(compressedDataBufferLength);
-            uint64_t compressedDataLength =
-                          compressor.compressData(&data[0], 
-                                               data.size(),
-                                               compressedDataBuffer.data(),
-                                               compressedDataBufferLength);
-            
-            //
-            // Encode the data with VTK's Base64 algorithm
-            //
-            std::vector<unsigned char> buffer(compressedDataLength + compressedDataLength / 3 + 10);//generous constant for partial bytes, integer rounding, and possible "=" formatting
-            const uint64_t compressedLength =
-               Base64::encode(compressedDataBuffer.data(),
-                                          compressedDataLength,
-                                          buffer.data());
-            buffer[compressedLength] = '\0';
-            
-             //
-             // Write the data  MUST BE NO space around data
-             //
-             xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA, (char*)buffer.data());
-             
+            xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA,
+                                          (encodedData->empty() ? "" : &(*encodedData)[0]),
+                                          encodedData->size());
          }
          break;
        case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
@@ -1253,6 +1382,75 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
    xmlWriter.writeEndElement();
 }                      
 
+/**
+ * Encode the data as base64 or gzip base64 text for writing.  This does not
+ * modify the data array, so it may be called from multiple threads
+ * for different data arrays, for instance by a writer that encodes
+ * several arrays at once.
+ *
+ * @param encodingForWriting
+ *    The encoding, only BASE64_BINARY and GZIP_BASE64_BINARY produce text.
+ * @param encodedDataOut
+ *    Output with the encoded text (not null terminated).
+ * @throws GiftiException
+ *    If compression fails.
+ */
+void
+GiftiDataArray::encodeDataForWriting(const GiftiEncodingEnum::Enum encodingForWriting,
+                                     std::vector<char>& encodedDataOut) const
+{
+    encodedDataOut.clear();
+    if (data.empty()) {
+        return;
+    }
+    
+    switch (encodingForWriting) {
+        case GiftiEncodingEnum::ASCII:
+        case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
+            break;
+        case GiftiEncodingEnum::BASE64_BINARY:
+        {
+            //
+            // Encode the data with VTK's Base64 algorithm
+            //
+            encodedDataOut.resize((data.size() / 3 + 1) * 4);
+            const uint64_t encodedLength = Base64::encode(&data[0],
+                                                          data.size(),
+                                                          (unsigned char*)&encodedDataOut[0]);
+            CaretAssert(encodedLength <= encodedDataOut.size());
+            encodedDataOut.resize(encodedLength);
+        }
+            break;
+        case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+        {
+            //
+            // Compress the data with VTK's ZLIB algorithm
+            //
+            DataCompressZLib compressor;
+            const uint64_t compressedDataBufferLength = compressor.getMaximumCompressionSpace(data.size());
+            std::vector<unsigned char> compressedDataBuffer(compressedDataBufferLength);
+            const uint64_t compressedDataLength = compressor.compressData(&data[0],
+                                                                          data.size(),
+                                                                          compressedDataBuffer.data(),
+                                                                          compressedDataBufferLength);
+            if (compressedDataLength == 0) {
+                throw GiftiException("Compression of Binary data failed.");
+            }
+            
+            //
+            // Encode the data with VTK's Base64 algorithm
+            //
+            encodedDataOut.resize((compressedDataLength / 3 + 1) * 4);
+            const uint64_t encodedLength = Base64::encode(compressedDataBuffer.data(),
+                                                          compressedDataLength,
+                                                          (unsigned char*)&encodedDataOut[0]);
+            CaretAssert(encodedLength <= encodedDataOut.size());
+            encodedDataOut.resize(encodedLength);
+        }
+            break;
+    }
+}
+
 /**
  * convert to data type.
  */
@@ -123,10 +123,24 @@ namespace caret {
                           const int64_t externalFileOffsetForReading,
                           const bool isReadOnlyMetaData);
         
+        // read a data array from base64 or gzip base64 text, safe to use concurrently on different arrays
+        void readFromEncodedText(const char* text,
+                                 const int64_t textLength,
+                                 const GiftiEndianEnum::Enum dataEndianForReading,
+                                 const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                 const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                 const std::vector<int64_t>& dimensionsForReading,
+                                 const GiftiEncodingEnum::Enum encodingForReading);
+        
         // write the data as XML
         void writeAsXML(std::ostream& stream, 
                         std::ostream* externalBinaryOutputStream,
-                        GiftiEncodingEnum::Enum encodingForWriting);
+                        GiftiEncodingEnum::Enum encodingForWriting,
+                        const std::vector<char>* encodedData = NULL);
+        
+        // encode the data as base64 or gzip base64 text, safe to use concurrently on different arrays
+        void encodeDataForWriting(const GiftiEncodingEnum::Enum encodingForWriting,
+                                  std::vector<char>& encodedDataOut) const;
         
         /// get endian
         GiftiEndianEnum::Enum getEndian() const { return endian; }
@@ -311,6 +325,20 @@ namespace caret {
         //validate the array
         void validateArrayAfterReading();
         
+        // set the attributes of the data being read and allocate it
+        void setAttributesForReading(const GiftiEndianEnum::Enum dataEndianForReading,
+                                     const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                     const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                     const std::vector<int64_t>& dimensionsForReading,
+                                     const GiftiEncodingEnum::Enum encodingForReading);
+        
+        // convert the data just read to the required type and order
+        void finishReadingData(const NiftiDataTypeEnum::Enum requiredDataType);
+        
+        // decode base64 or gzip base64 text into the data
+        void decodeEncodedData(const char* text,
+                               const int64_t textLength);
+        
         // allocate data for this column
         virtual void allocateData();
         
@@ -942,9 +942,7 @@ GiftiFile::writeFile(const AString& filename)
         //
         // Write the data arrays
         //
-        for (int i = 0; i < numberOfDataArrays; i++) {
-            giftiFileWriter.writeDataArray(this->getDataArray(i));
-        }
+        giftiFileWriter.writeDataArrays(this->dataArrays);
         
         //
         // Finish writing the file
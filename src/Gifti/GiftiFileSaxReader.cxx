@@ -20,7 +20,9 @@
 
 #include <sstream>
 
+#include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "FileInformation.h"
 #include "GiftiEndianEnum.h"
 #include "GiftiLabel.h"
@@ -50,6 +52,7 @@ GiftiFileSaxReader::GiftiFileSaxReader(GiftiFile* giftiFileIn)
     this->labelTableSaxReader = NULL;
     this->metaDataSaxReader = NULL;
     this->dataArrayDataHasBeenRead = false;
+    this->pendingArrayDataBytes = 0;
 }
 
 /**
@@ -214,6 +217,7 @@ GiftiFileSaxReader::startElement(const AString& namespaceURI,
    stateStack.push(previousState);
    
    elementText = "";
+   elementBinaryText.clear();
 }
 
 /**
@@ -228,6 +232,13 @@ GiftiFileSaxReader::endElement(const AString& namespaceURI,
       case STATE_NONE:
          break;
       case STATE_GIFTI:
+         if (qName == GiftiXmlElements::TAG_GIFTI) {
+             /*
+              * The parser may not call endDocument() when parsing
+              * from a string, so decode when the root element ends.
+              */
+             this->decodePendingArrayData();
+         }
          break;
       case STATE_METADATA:
            this->metaDataSaxReader->endElement(namespaceURI, localName, qName);
@@ -295,6 +306,7 @@ GiftiFileSaxReader::endElement(const AString& namespaceURI,
    // Clear out for new elements
    //
    this->elementText = "";
+   this->elementBinaryText.clear();
    
    //
    // Go to previous state
@@ -515,6 +527,34 @@ GiftiFileSaxReader::processArrayData()
     this->dataArrayDataHasBeenRead = true;
 
     CaretAssert(dataArray);
+    
+    /*
+     * Base64 text is decoded later so that the data arrays
+     * can be decoded in parallel.  The text is kept as bytes
+     * so that it is not converted to and from a QString.
+     */
+    if (isArrayDataDecodedLater()) {
+        this->pendingArrayData.push_back(PendingArrayData());
+        PendingArrayData& pending = this->pendingArrayData.back();
+        pending.m_dataArray = dataArray.getPointer();
+        pending.m_text.swap(this->elementBinaryText);
+        pending.m_endian = this->endianForReadingArrayData;
+        pending.m_arraySubscriptingOrder = arraySubscriptingOrderForReadingArrayData;
+        pending.m_dataType = dataTypeForReadingArrayData;
+        pending.m_dimensions = dimensionsForReadingArrayData;
+        pending.m_encoding = encodingForReadingArrayData;
+        this->pendingArrayDataBytes += pending.m_text.size();
+        
+        /*
+         * Limit memory used by the text
+         */
+        const int64_t maximumPendingBytes = ((int64_t)512) << 20;
+        if (this->pendingArrayDataBytes > maximumPendingBytes) {
+            decodePendingArrayData();
+        }
+        return;
+    }
+    
     try {
         dataArray->readFromText(elementText,
                                 this->endianForReadingArrayData,
@@ -543,11 +583,77 @@ GiftiFileSaxReader::characters(const char* ch)
     else if (this->labelTableSaxReader != NULL) {
         this->labelTableSaxReader->characters(ch);
     }
+    else if ((this->state == STATE_DATA_ARRAY_DATA)
+             && isArrayDataDecodedLater()) {
+        elementBinaryText += ch;
+    }
     else {
         elementText += ch;
     }
 }
 
+/**
+ * @return True if the current data array's text is base64 that is
+ * decoded by decodePendingArrayData().
+ */
+bool
+GiftiFileSaxReader::isArrayDataDecodedLater() const
+{
+    if (this->giftiFile->getReadMetaDataOnlyFlag()) {
+        return false;
+    }
+    switch (this->encodingForReadingArrayData) {
+        case GiftiEncodingEnum::ASCII:
+        case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
+            break;
+        case GiftiEncodingEnum::BASE64_BINARY:
+        case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Decode the data arrays that are waiting for decoding, in parallel.
+ */
+void
+GiftiFileSaxReader::decodePendingArrayData()
+{
+    const int64_t numPending = static_cast<int64_t>(this->pendingArrayData.size());
+    std::vector<AString> errorMessages(numPending);
+    
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numPending; i++) {
+        PendingArrayData& pending = this->pendingArrayData[i];
+        try {
+            pending.m_dataArray->readFromEncodedText(pending.m_text.data(),
+                                                     pending.m_text.size(),
+                                                     pending.m_endian,
+                                                     pending.m_arraySubscriptingOrder,
+                                                     pending.m_dataType,
+                                                     pending.m_dimensions,
+                                                     pending.m_encoding);
+        }
+        catch (const GiftiException& e) {
+            errorMessages[i] = e.whatString();
+        }
+        catch (const std::exception& e) {
+            errorMessages[i] = ("Error decoding data array: "
+                                + AString(e.what()));
+        }
+        std::string().swap(pending.m_text);
+    }
+    
+    this->pendingArrayData.clear();
+    this->pendingArrayDataBytes = 0;
+    
+    for (int64_t i = 0; i < numPending; i++) {
+        if ( ! errorMessages[i].isEmpty()) {
+            throw XmlSaxParserException(errorMessages[i]);
+        }
+    }
+}
+
 /**
  * a fatal error occurs.
  */
@@ -594,5 +700,6 @@ GiftiFileSaxReader::startDocument()
 void 
 GiftiFileSaxReader::endDocument()
 {
+    this->decodePendingArrayData();
 }
 
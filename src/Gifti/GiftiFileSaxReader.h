@@ -23,6 +23,8 @@
 /*LICENSE_END*/
 
 #include <stack>
+#include <string>
+#include <vector>
 #include <AString.h>
 #include <stdint.h>
 
@@ -106,6 +108,23 @@ namespace caret {
         // create a data array
         void createDataArray(const XmlAttributes& attributes);
         
+        // decode the data arrays that are waiting for decoding
+        void decodePendingArrayData();
+        
+        // is the data array's text base64 that is decoded later
+        bool isArrayDataDecodedLater() const;
+        
+        /// base64 data array text with the information needed to decode it
+        struct PendingArrayData {
+            GiftiDataArray* m_dataArray;
+            std::string m_text;
+            GiftiEndianEnum::Enum m_endian;
+            GiftiArrayIndexingOrderEnum::Enum m_arraySubscriptingOrder;
+            NiftiDataTypeEnum::Enum m_dataType;
+            std::vector<int64_t> m_dimensions;
+            GiftiEncodingEnum::Enum m_encoding;
+        };
+        
         /// file reading state
         STATE state;
         
@@ -121,6 +140,15 @@ namespace caret {
         /// element text
         AString elementText;
         
+        /// text of a base64 DATA element, kept as bytes to avoid conversions
+        std::string elementBinaryText;
+        
+        /// data arrays whose text has been read but not decoded
+        std::vector<PendingArrayData> pendingArrayData;
+        
+        /// size of the text in pendingArrayData
+        int64_t pendingArrayDataBytes;
+        
         /// GIFTI data array being read
         CaretPointer<GiftiDataArray> dataArray;
         
@@ -27,6 +27,7 @@
 #undef __GIFTI_FILE_WRITER_DECLARE__
 
 #include "CaretHierarchy.h"
+#include "CaretOMP.h"
 #include "FileInformation.h"
 #include "GiftiDataArray.h"
 #include "GiftiXmlElements.h"
@@ -200,6 +201,101 @@ GiftiFileWriter::start(const int numberOfDataArrays,
  */
 void 
 GiftiFileWriter::writeDataArray(GiftiDataArray* gda)
+{
+    this->writeDataArray(gda,
+                         NULL);
+}
+
+/**
+ * Write data arrays.  When the encoding is base64, several data arrays
+ * are encoded (and compressed) in parallel and then written in order.
+ *
+ * @param dataArrays - The data arrays.
+ * @throws GiftiException - If an error occurs.
+ */
+void
+GiftiFileWriter::writeDataArrays(const std::vector<GiftiDataArray*>& dataArrays)
+{
+    const int64_t numDataArrays = static_cast<int64_t>(dataArrays.size());
+    
+    bool encodeInParallelFlag = false;
+    switch (this->encoding) {
+        case GiftiEncodingEnum::ASCII:
+        case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
+            break;
+        case GiftiEncodingEnum::BASE64_BINARY:
+        case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+            encodeInParallelFlag = true;
+            break;
+    }
+    if ( ! encodeInParallelFlag) {
+        for (int64_t i = 0; i < numDataArrays; i++) {
+            this->writeDataArray(dataArrays[i]);
+        }
+        return;
+    }
+    
+    /*
+     * Limit the size of the data encoded at one time since
+     * the encoded text is held in memory until it is written
+     */
+    const int64_t maximumBatchBytes = ((int64_t)256) << 20;
+    int64_t batchStart = 0;
+    while (batchStart < numDataArrays) {
+        int64_t batchEnd = batchStart;
+        int64_t batchBytes = 0;
+        while ((batchEnd < numDataArrays)
+               && ((batchEnd == batchStart)
+                   || ((batchBytes + dataArrays[batchEnd]->getDataSizeInBytes()) <= maximumBatchBytes))) {
+            batchBytes += dataArrays[batchEnd]->getDataSizeInBytes();
+            batchEnd++;
+        }
+        
+        const int64_t batchCount = batchEnd - batchStart;
+        std::vector<std::vector<char> > encodedData(batchCount);
+        std::vector<AString> errorMessages(batchCount);
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t i = 0; i < batchCount; i++) {
+            try {
+                dataArrays[batchStart + i]->encodeDataForWriting(this->encoding,
+                                                                 encodedData[i]);
+            }
+            catch (const GiftiException& e) {
+                errorMessages[i] = e.whatString();
+            }
+            catch (const std::exception& e) {
+                errorMessages[i] = ("Error encoding data array: "
+                                    + AString(e.what()));
+            }
+        }
+        for (int64_t i = 0; i < batchCount; i++) {
+            if ( ! errorMessages[i].isEmpty()) {
+                this->closeFiles();
+                throw GiftiException(errorMessages[i]);
+            }
+        }
+        
+        for (int64_t i = 0; i < batchCount; i++) {
+            this->writeDataArray(dataArrays[batchStart + i],
+                                 &encodedData[i]);
+            std::vector<char>().swap(encodedData[i]);
+        }
+        
+        batchStart = batchEnd;
+    }
+}
+
+/**
+ * Write a data array.
+ *
+ * @param gda - The data array.
+ * @param encodedData - The data array's data already encoded with this
+ *    writer's encoding, or NULL to encode it here.
+ * @throws GiftiException - If an error occurs.
+ */
+void
+GiftiFileWriter::writeDataArray(GiftiDataArray* gda,
+                                const std::vector<char>* encodedData)
 {
     this->verifyOpened();
     
@@ -242,7 +338,8 @@ GiftiFileWriter::writeDataArray(GiftiDataArray* gda)
         //
         gda->writeAsXML(*this->xmlFileOutputStream, 
                         this->externalFileOutputStream,
-                        this->encoding);
+                        this->encoding,
+                        encodedData);
         
         //
         // Increment counter of data arrays written
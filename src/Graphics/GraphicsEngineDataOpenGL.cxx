@@ -253,11 +253,6 @@ GraphicsEngineDataOpenGL::loadColorBuffer(GraphicsPrimitive* primitive)
             break;
         case GraphicsPrimitive::ColorDataType::FLOAT_RGBA:
         {
-            EventGraphicsOpenGLCreateBufferObject createEvent;
-            EventManager::get()->sendEvent(createEvent.getPointer());
-            m_colorBufferObject.reset(createEvent.getOpenGLBufferObject());
-            CaretAssert(m_colorBufferObject->getBufferObjectName());
-            
             m_componentsPerColor = 4;
             m_colorDataType = GL_FLOAT;
             
@@ -265,12 +260,34 @@ GraphicsEngineDataOpenGL::loadColorBuffer(GraphicsPrimitive* primitive)
             CaretAssert(colorSizeBytes > 0);
             const GLvoid* colorDataPointer = (const GLvoid*)&primitive->m_floatRGBA[0];
             
-            glBindBuffer(GL_ARRAY_BUFFER,
-                         m_colorBufferObject->getBufferObjectName());
-            glBufferData(GL_ARRAY_BUFFER,
-                         colorSizeBytes,
-                         colorDataPointer,
-                         usageHint);
+            /*
+             * When the colors are replaced, the number of colors does not
+             * change so the existing buffer is updated instead of allocating
+             * a new buffer.
+             */
+            if ((m_colorBufferObject != NULL)
+                && (m_colorBufferSizeBytes == static_cast<GLsizeiptr>(colorSizeBytes))) {
+                glBindBuffer(GL_ARRAY_BUFFER,
+                             m_colorBufferObject->getBufferObjectName());
+                glBufferSubData(GL_ARRAY_BUFFER,
+                                0,
+                                colorSizeBytes,
+                                colorDataPointer);
+            }
+            else {
+                EventGraphicsOpenGLCreateBufferObject createEvent;
+                EventManager::get()->sendEvent(createEvent.getPointer());
+                m_colorBufferObject.reset(createEvent.getOpenGLBufferObject());
+                CaretAssert(m_colorBufferObject->getBufferObjectName());
+                
+                glBindBuffer(GL_ARRAY_BUFFER,
+                             m_colorBufferObject->getBufferObjectName());
+                glBufferData(GL_ARRAY_BUFFER,
+                             colorSizeBytes,
+                             colorDataPointer,
+                             usageHint);
+                m_colorBufferSizeBytes = colorSizeBytes;
+            }
         }
             break;
         case GraphicsPrimitive::ColorDataType::UNSIGNED_BYTE_RGBA:
@@ -293,6 +310,7 @@ GraphicsEngineDataOpenGL::loadColorBuffer(GraphicsPrimitive* primitive)
                          colorSizeBytes,
                          colorDataPointer,
                          usageHint);
+            m_colorBufferSizeBytes = colorSizeBytes;
         }
             break;
     }
@@ -300,6 +318,44 @@ GraphicsEngineDataOpenGL::loadColorBuffer(GraphicsPrimitive* primitive)
     m_reloadColorsFlag = false;
 }
 
+/**
+ * Load the element indices buffer.  The element indices
+ * do not change after the primitive is first drawn.
+ *
+ * @param primitive
+ *     The graphics primitive that will be drawn.
+ */
+void
+GraphicsEngineDataOpenGL::loadElementIndicesBuffer(GraphicsPrimitive* primitive)
+{
+    CaretAssert(primitive);
+    
+    m_elementIndicesCount = primitive->m_elementIndices.size();
+    if (m_elementIndicesCount <= 0) {
+        m_elementIndicesBufferObject.reset();
+        return;
+    }
+    
+    GLenum usageHint = getOpenGLBufferUsageHint(primitive->getUsageTypeCoordinates());
+    
+    const GLuint indicesSizeBytes = m_elementIndicesCount * sizeof(uint32_t);
+    const GLvoid* indicesDataPointer = (const GLvoid*)&primitive->m_elementIndices[0];
+    
+    EventGraphicsOpenGLCreateBufferObject createEvent;
+    EventManager::get()->sendEvent(createEvent.getPointer());
+    m_elementIndicesBufferObject.reset(createEvent.getOpenGLBufferObject());
+    CaretAssert(m_elementIndicesBufferObject->getBufferObjectName());
+    
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 m_elementIndicesBufferObject->getBufferObjectName());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 indicesSizeBytes,
+                 indicesDataPointer,
+                 usageHint);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+}
+
 /**
  * Load the texture coordinate buffer.
  * @param primitive
@@ -362,6 +418,7 @@ GraphicsEngineDataOpenGL::loadAllBuffers(GraphicsPrimitive* primitive)
     loadNormalVectorBuffer(primitive);
     loadColorBuffer(primitive);
     loadTextureCoordinateBuffer(primitive);    
+    loadElementIndicesBuffer(primitive);
 }
 
 /**
@@ -1563,6 +1620,14 @@ GraphicsEngineDataOpenGL::drawWithSelection(GraphicsPrimitive* primitive,
 {
     CaretAssert(primitive);
     
+    if ( ! primitive->m_elementIndices.empty()) {
+        CaretAssertMessage(0, "Selection is not supported for primitives with element indices");
+        CaretLogWarning("Selection is not supported for primitives with element indices");
+        selectedPrimitiveIndexOut = -1;
+        selectedPrimitiveDepthOut = 0.0;
+        return;
+    }
+    
     bool modelSpaceLineFlag = false;
     bool windowSpaceLineFlag = false;
     switch (primitive->m_primitiveType) {
@@ -2147,8 +2212,21 @@ GraphicsEngineDataOpenGL::drawPrivate(const PrivateDrawMode drawMode,
     
     int32_t subsetFirstVertexIndex(-1);
     int32_t subsetVertexCount(-1);
-    if (primitive->getDrawArrayIndicesSubset(subsetFirstVertexIndex,
-                                             subsetVertexCount)) {
+    if (openglData->m_elementIndicesBufferObject != NULL) {
+        /*
+         * Vertices are shared and drawn in the order of the element indices
+         */
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                     openglData->m_elementIndicesBufferObject->getBufferObjectName());
+        glDrawElements(openGLPrimitiveType,
+                       openglData->m_elementIndicesCount,
+                       GL_UNSIGNED_INT,
+                       (GLvoid*)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                     0);
+    }
+    else if (primitive->getDrawArrayIndicesSubset(subsetFirstVertexIndex,
+                                                  subsetVertexCount)) {
         glDrawArrays(openGLPrimitiveType,
                      subsetFirstVertexIndex,
                      subsetVertexCount);
@@ -93,6 +93,8 @@ namespace caret {
         
         void loadColorBuffer(GraphicsPrimitive* primitive);
         
+        void loadElementIndicesBuffer(GraphicsPrimitive* primitive);
+        
         void loadTextureCoordinateBuffer(GraphicsPrimitive* primitive);
         
         void loadTextureImageDataBuffer(GraphicsPrimitive* primitive);
@@ -160,6 +162,12 @@ namespace caret {
         
         GLint m_componentsPerColor = 0;
         
+        GLsizeiptr m_colorBufferSizeBytes = 0;
+        
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_elementIndicesBufferObject;
+        
+        GLsizei m_elementIndicesCount = 0;
+        
         std::unique_ptr<GraphicsOpenGLBufferObject> m_textureCoordinatesBufferObject;
         
         GLenum m_textureCoordinatesDataType = GL_FLOAT;
@@ -158,6 +158,7 @@ GraphicsPrimitive::copyHelperGraphicsPrimitive(const GraphicsPrimitive& obj)
     m_floatRGBA                   = obj.m_floatRGBA;
     m_unsignedByteRGBA            = obj.m_unsignedByteRGBA;
     m_floatTextureSTR             = obj.m_floatTextureSTR;
+    m_elementIndices              = obj.m_elementIndices;
     m_lineWidthType               = obj.m_lineWidthType;
     m_lineWidthValue              = obj.m_lineWidthValue;
     m_pointSizeType               = obj.m_pointSizeType;
@@ -1494,6 +1495,87 @@ GraphicsPrimitive::replaceAllVertexSolidFloatRGBA(const float rgba[4])
 
 
 
+/**
+ * Replace the float RGBA coloring for all vertices.  The colors are
+ * only invalidated, so that the graphics engine reloads them, if
+ * the new coloring differs from the current coloring.
+ *
+ * @param rgba
+ *     RGBA for all vertices, four components for each vertex.
+ * @return
+ *     True if the coloring changed, else false.
+ */
+bool
+GraphicsPrimitive::replaceAllVertexFloatRGBA(const float* rgba)
+{
+    CaretAssert(rgba);
+    
+    switch (m_releaseInstanceDataMode) {
+        case ReleaseInstanceDataMode::COMPLETED:
+        {
+            const QString msg("All RGBA Data in primitive cannot be replaced.  "
+                              "Instance data was removed to save memory.  "
+                              "setReleaseInstanceDataMode() should not be called for this primitive.");
+            CaretAssertMessage(0, msg);
+            CaretLogSevere(msg);
+            return false;
+        }
+            break;
+        case ReleaseInstanceDataMode::DISABLED:
+            break;
+        case ReleaseInstanceDataMode::ENABLED:
+            break;
+    }
+    
+    bool changedFlag(false);
+    switch (m_colorDataType) {
+        case ColorDataType::NONE:
+            CaretAssert(0);
+            break;
+        case ColorDataType::FLOAT_RGBA:
+            if ( ! std::equal(m_floatRGBA.begin(),
+                              m_floatRGBA.end(),
+                              rgba)) {
+                std::copy(rgba,
+                          rgba + m_floatRGBA.size(),
+                          m_floatRGBA.begin());
+                changedFlag = true;
+            }
+            break;
+        case ColorDataType::UNSIGNED_BYTE_RGBA:
+            CaretAssertMessage(0, "Replacing Float RGBA in primitive but coloring type is Byte");
+            CaretLogWarning("Replacing Float RGBA in primitive but coloring type is Byte");
+            break;
+    }
+    
+    if (changedFlag) {
+        if (m_graphicsEngineDataForOpenGL != NULL) {
+            m_graphicsEngineDataForOpenGL->invalidateColors();
+        }
+    }
+    
+    return changedFlag;
+}
+
+/**
+ * Set the indices of the vertices that are drawn.  When there are
+ * element indices, vertices may be shared (as in a surface where a 
+ * vertex is in several triangles) and the vertices are drawn in
+ * the order of the element indices.  Must be set before the primitive
+ * is first drawn.  Selection is not supported with element indices
+ * since the selection colors are per-vertex.
+ *
+ * @param elementIndices
+ *     Indices of the vertices.
+ */
+void
+GraphicsPrimitive::setElementIndices(const std::vector<uint32_t>& elementIndices)
+{
+    CaretAssertMessage(m_graphicsEngineDataForOpenGL == NULL,
+                       "Element indices must be set before the primitive is drawn");
+    m_elementIndices = elementIndices;
+}
+
 /**
  * Get a bounds box for the vertex coordinates.
  *
@@ -2597,6 +2679,7 @@ GraphicsPrimitive::setOpenGLBuffersHaveBeenLoadedByGraphicsEngine()
             std::vector<float>().swap(m_floatNormalVectorXYZ);
             std::vector<uint8_t>().swap(m_unsignedByteRGBA);
             std::vector<float>().swap(m_floatTextureSTR);
+            std::vector<uint32_t>().swap(m_elementIndices);
             
             m_releaseInstanceDataMode = ReleaseInstanceDataMode::COMPLETED;
         }
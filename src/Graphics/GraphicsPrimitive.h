@@ -458,6 +458,15 @@ namespace caret {
         
         void replaceAllVertexSolidFloatRGBA(const float rgba[4]);
         
+        bool replaceAllVertexFloatRGBA(const float* rgba);
+        
+        /**
+         * @return Indices of vertices that are drawn, empty if all vertices are drawn in order.
+         */
+        const std::vector<uint32_t>& getElementIndices() const { return m_elementIndices; }
+        
+        void setElementIndices(const std::vector<uint32_t>& elementIndices);
+        
         void replaceVertexTextureSTR(const int32_t vertexIndex,
                                      const float str[3]);
         
@@ -616,6 +625,8 @@ namespace caret {
         
         std::vector<float> m_floatTextureSTR;
         
+        std::vector<uint32_t> m_elementIndices;
+        
         mutable float m_yMean = 0.0;
         
         mutable float m_yStandardDeviation = -1.0;
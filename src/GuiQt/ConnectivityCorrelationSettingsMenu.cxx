@@ -84,6 +84,13 @@ m_settings(settings)
     m_optionNoDemeanCheckBox->setChecked(settings->isCorrelationNoDemeanEnabled());
     QObject::connect(m_optionNoDemeanCheckBox, &QCheckBox::clicked,
                      this, &ConnectivityCorrelationSettingsMenu::optionNoDemeanCheckBoxClicked);
+    
+    m_optionReducedMemoryCheckBox = new QCheckBox("Reduced Memory (8-bit)");
+    m_optionReducedMemoryCheckBox->setToolTip("When averaging many rows of very large data, use\n"
+                                              "8-bit values to reduce memory at a loss of accuracy");
+    m_optionReducedMemoryCheckBox->setChecked(settings->isReducedMemoryAveragingEnabled());
+    QObject::connect(m_optionReducedMemoryCheckBox, &QCheckBox::clicked,
+                     this, &ConnectivityCorrelationSettingsMenu::optionReducedMemoryCheckBoxClicked);
 
     QGroupBox* modeGroupBox(new QGroupBox("Mode"));
     QVBoxLayout* modeGroupBoxLayout(new QVBoxLayout(modeGroupBox));
@@ -95,10 +102,15 @@ m_settings(settings)
     optionsGroupBoxLayout->addWidget(m_optionFisherZCheckBox);
     optionsGroupBoxLayout->addWidget(m_optionNoDemeanCheckBox);
     
+    QGroupBox* averagingGroupBox(new QGroupBox("Averaging Options"));
+    QVBoxLayout* averagingGroupBoxLayout(new QVBoxLayout(averagingGroupBox));
+    averagingGroupBoxLayout->addWidget(m_optionReducedMemoryCheckBox);
+    
     QWidget* optionsWidget(new QWidget());
     QVBoxLayout* optionsLayout(new QVBoxLayout(optionsWidget));
     optionsLayout->addWidget(modeGroupBox);
     optionsLayout->addWidget(optionsGroupBox);
+    optionsLayout->addWidget(averagingGroupBox);
     
     QWidgetAction* widgetAction(new QWidgetAction(this));
     widgetAction->setDefaultWidget(optionsWidget);
@@ -156,6 +168,17 @@ ConnectivityCorrelationSettingsMenu::optionNoDemeanCheckBoxClicked(bool checked)
     m_settings->setCorrelationNoDemeanEnabled(checked);
 }
 
+/**
+ * Called when reduced memory checkbox is clicked
+ * @param checked
+ *    Checked status
+ */
+void
+ConnectivityCorrelationSettingsMenu::optionReducedMemoryCheckBoxClicked(bool checked)
+{
+    m_settings->setReducedMemoryAveragingEnabled(checked);
+}
+
 /**
  * Update the menu
  */
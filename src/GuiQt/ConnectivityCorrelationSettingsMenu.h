@@ -58,6 +58,8 @@ namespace caret {
         
         void optionNoDemeanCheckBoxClicked(bool checked);
         
+        void optionReducedMemoryCheckBoxClicked(bool checked);
+        
     private:
         void updateMenu();
         
@@ -71,6 +73,8 @@ namespace caret {
         
         QCheckBox* m_optionNoDemeanCheckBox;
         
+        QCheckBox* m_optionReducedMemoryCheckBox;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
@@ -63,6 +63,7 @@
 #include "CursorDisplayScoped.h"
 #include "CursorManager.h"
 #include "CustomViewDialog.h"
+#include "CziImageTileCache.h"
 #include "DataFileException.h"
 #include "DataToolTipsManager.h"
 #include "ElapsedTimer.h"
@@ -385,6 +386,13 @@ GuiManager::initializeGuiManager()
     
     QObject::connect(WuQHyperlinkToolTip::instance(), &WuQHyperlinkToolTip::hyperlinkClicked,
                      this, &GuiManager::toolTipHyperlinkClicked);
+    
+    /*
+     * Tiles are loaded in a background thread so the connection must be queued
+     */
+    QObject::connect(CziImageTileCache::get(), &CziImageTileCache::tilesLoaded,
+                     this, &GuiManager::cziImageTilesLoaded,
+                     Qt::QueuedConnection);
 }
 
 /**
@@ -4205,3 +4213,13 @@ GuiManager::toolTipHyperlinkClicked(const QString& hyperlink)
                        + hyperlink);
     }
 }
+
+/**
+ * Called when CZI image tiles have been loaded in the background.
+ * Graphics are updated so that images waiting for the tiles are created again.
+ */
+void
+GuiManager::cziImageTilesLoaded()
+{
+    EventManager::get()->sendEvent(EventGraphicsPaintSoonAllWindows().getPointer());
+}
@@ -44,7 +44,10 @@ namespace caret
         std::vector<int64_t> m_dims;
         std::vector<char> m_scratch;//scratch memory for byteswapping, type conversion, etc
         CaretMutex m_mutex;//protect multithreaded calls from each other
+        static const int64_t MAX_THREAD_SCRATCH_BYTES = 1<<26;//64MiB, larger concurrent reads use temporary scratch memory
         int numBytesPerElem();//for resizing scratch
+        template<typename T>
+        void convertReadScratch(T* dataOut, char* scratch, const int64_t& numElems);//dispatch on the file datatype
         template<typename TO, typename FROM>
         void convertRead(TO* out, FROM* in, const int64_t& count);//for reading from file
         template<typename TO, typename FROM>
@@ -61,19 +64,32 @@ namespace caret
         void dropExtensions() { m_header.m_extensions.clear(); }
         const std::vector<int64_t>& getDimensions() const { return m_dims; }
         int getNumComponents() const;
+        ///readData doesn't serialize on a mutex when this is true (uncompressed, opened read-only)
+        bool supportsConcurrentRead() const { return m_file.supportsConcurrentRead(); }
         //to read/write 1 frame of a standard volume file, call with fullDims = 3, indexSelect containing indexes for any of dims 4-7 that exist
         //NOTE: you need to provide storage for all components within the range, if getNumComponents() == 3 and fullDims == 0, you need 3 elements allocated
         template<typename T>
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
+        //reads numBlocks consecutive fullDims-sized blocks in one call, starting at indexSelect, indexSelect[0] + numBlocks must not exceed that dimension
+        //for instance, fullDims = 5 on cifti reads a range of rows with one sequential read
+        template<typename T>
+        void readDataBlocks(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numBlocks, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
     };
     
     template<typename T>
     void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead)
+    {
+        readDataBlocks(dataOut, fullDims, indexSelect, 1, tolerateShortRead);
+    }
+    
+    template<typename T>
+    void NiftiIO::readDataBlocks(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numBlocks, const bool& tolerateShortRead)
     {
         CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
         CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
+        CaretAssert(numBlocks == 1 || (numBlocks > 1 && !indexSelect.empty() && indexSelect[0] + numBlocks <= m_dims[fullDims]));
         int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
         int curDim;
         for (curDim = 0; curDim < fullDims; ++curDim)
@@ -87,55 +103,84 @@ namespace caret
             numSkip += indexSelect[curDim - fullDims] * numDimSkip;
             numDimSkip *= m_dims[curDim];
         }
+        numElems *= numBlocks;//blocks are contiguous because they vary along the first non-full dimension
+        const int64_t numBytes = numElems * numBytesPerElem(), fileOffset = numSkip * numBytesPerElem() + m_header.getDataOffset();
+        int64_t numRead = 0;
+        if (m_file.supportsConcurrentRead())
+        {//uncompressed and read-only: positional reads don't share a file position, so the only shared state left is scratch memory, use one per thread instead
+            static thread_local std::vector<char> threadScratch;
+            std::vector<char> bigScratch;
+            char* scratch;
+            if (numBytes <= MAX_THREAD_SCRATCH_BYTES)
+            {
+                if ((int64_t)threadScratch.size() < numBytes) threadScratch.resize(numBytes);
+                scratch = threadScratch.data();
+            } else {//don't let a whole-file read pin that much memory to every thread that ever did one
+                bigScratch.resize(numBytes);
+                scratch = bigScratch.data();
+            }
+            m_file.readAt(fileOffset, scratch, numBytes, &numRead);
+            if ((numRead != numBytes && !tolerateShortRead) || numRead < 0)
+            {
+                throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
+            }
+            convertReadScratch(dataOut, scratch, numElems);
+            return;
+        }
         CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done converting, because we use an internal variable for scratch space
         //we can't guarantee that the output memory is enough to use as scratch space, as we might be doing a narrowing conversion
         //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
-        m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
-        int64_t numRead = 0;
+        m_scratch.resize(numBytes);
+        m_file.seek(fileOffset);
         m_file.read(m_scratch.data(), m_scratch.size(), &numRead);
         if ((numRead != (int64_t)m_scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
         {
             throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
         }
+        convertReadScratch(dataOut, m_scratch.data(), numElems);
+    }
+    
+    template<typename T>
+    void NiftiIO::convertReadScratch(T* dataOut, char* scratch, const int64_t& numElems)
+    {
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
             case NIFTI_TYPE_RGB24://handled by components
-                convertRead(dataOut, (uint8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint8_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_INT8:
-                convertRead(dataOut, (int8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int8_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_UINT16:
-                convertRead(dataOut, (uint16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint16_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_INT16:
-                convertRead(dataOut, (int16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int16_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_UINT32:
-                convertRead(dataOut, (uint32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint32_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_INT32:
-                convertRead(dataOut, (int32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int32_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_UINT64:
-                convertRead(dataOut, (uint64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint64_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_INT64:
-                convertRead(dataOut, (int64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int64_t*)scratch, numElems);
                 break;
             case NIFTI_TYPE_FLOAT32:
             case NIFTI_TYPE_COMPLEX64://components
-                convertRead(dataOut, (float*)m_scratch.data(), numElems);
+                convertRead(dataOut, (float*)scratch, numElems);
                 break;
             case NIFTI_TYPE_FLOAT64:
             case NIFTI_TYPE_COMPLEX128:
-                convertRead(dataOut, (double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (double*)scratch, numElems);
                 break;
             case NIFTI_TYPE_FLOAT128:
             case NIFTI_TYPE_COMPLEX256:
-                convertRead(dataOut, (long double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (long double*)scratch, numElems);
                 break;
             default:
                 CaretAssert(0);
@@ -0,0 +1,152 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationCiftiCorrelationSparse.h"
+#include "OperationException.h"
+
+#include "AlgorithmCiftiCorrelation.h"
+#include "AlgorithmCiftiCrossCorrelation.h"
+#include "CaretSparseFile.h"
+#include "CiftiFile.h"
+#include "FileInformation.h"
+
+#include <fstream>
+
+using namespace caret;
+using namespace std;
+
+AString OperationCiftiCorrelationSparse::getCommandSwitch()
+{
+    return "-cifti-correlation-sparse";
+}
+
+AString OperationCiftiCorrelationSparse::getShortDescription()
+{
+    return "CORRELATE CIFTI ROWS, KEEPING ONLY THE STRONGEST CORRELATIONS";
+}
+
+OperationParameters* OperationCiftiCorrelationSparse::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addCiftiParameter(1, "cifti", "input cifti file");
+    
+    ret->addStringParameter(2, "wbsparse-out", "output - the output wbsparse file, should end in .corr.wbsparse");//HACK: fake the output format since we don't have a wbsparse parameter type (or file type, really)
+    
+    OptionalParameter* topKOpt = ret->createOptionalParameter(3, "-top-k", "keep only the largest values in each row");
+    topKOpt->addIntegerParameter(1, "count", "number of values to keep per row");
+    
+    OptionalParameter* thresholdOpt = ret->createOptionalParameter(4, "-threshold", "keep only values at or above a threshold");
+    thresholdOpt->addDoubleParameter(1, "value", "the threshold, applied after -fisher-z if specified");
+    
+    OptionalParameter* crossOpt = ret->createOptionalParameter(5, "-cross", "correlate with the rows of another file instead, like -cifti-cross-correlation");
+    crossOpt->addCiftiParameter(1, "cifti-b", "the cifti file whose rows become the output columns");
+    
+    OptionalParameter* weightsOpt = ret->createOptionalParameter(6, "-weights", "specify column weights");
+    weightsOpt->addStringParameter(1, "weight-file", "text file containing one weight per column");
+    
+    ret->createOptionalParameter(7, "-fisher-z", "apply fisher small z transform (ie, artanh) to correlation");
+    
+    ret->createOptionalParameter(8, "-no-demean", "instead of correlation, do dot product of rows, then normalize by diagonal");
+    
+    ret->createOptionalParameter(9, "-covariance", "compute covariance instead of correlation");
+    
+    OptionalParameter* memLimitOpt = ret->createOptionalParameter(10, "-mem-limit", "restrict memory usage");
+    memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
+    
+    ret->setHelpText(
+        AString("Computes the same values as -cifti-correlation (or -cifti-cross-correlation when -cross is specified), but writes only the selected values of each row to a wbsparse file, ") +
+        "without ever holding the full dense matrix in memory or on disk.  " +
+        "At least one of -top-k and -threshold must be specified, if both are, the top values are chosen from those that pass the threshold.  " +
+        "Values that are not kept are simply absent from the output.\n\n" +
+        "The output mappings are the same as the dense commands would produce, and each stored value is the bit pattern of a 32-bit float.  " +
+        "The file is marked as containing float values, so commands that read fiber trajectory wbsparse files will reject it, its name should end in " + AString(CaretSparseFile::FLOAT_CORRELATION_EXTENSION) + ".\n\n" +
+        "-mem-limit restricts memory the same way as in the dense commands, and also bounds how much of the dense result exists at once.\n\n" +
+        "-no-demean and -covariance are not available with -cross.  " +
+        "When using the -fisher-z option, the output is NOT a Z-score, it is artanh(r)."
+    );
+    return ret;
+}
+
+void OperationCiftiCorrelationSparse::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    CiftiFile* myCifti = myParams->getCifti(1);
+    AString outputName = myParams->getString(2);
+    AlgorithmCiftiCorrelation::SparseSettings mySettings;
+    OptionalParameter* topKOpt = myParams->getOptionalParameter(3);
+    if (topKOpt->m_present)
+    {
+        mySettings.m_topK = topKOpt->getInteger(1);
+        if (mySettings.m_topK < 1) throw OperationException("top-k count must be positive");
+    }
+    OptionalParameter* thresholdOpt = myParams->getOptionalParameter(4);
+    if (thresholdOpt->m_present)
+    {
+        mySettings.m_useThreshold = true;
+        mySettings.m_threshold = (float)thresholdOpt->getDouble(1);
+    }
+    if (!topKOpt->m_present && !thresholdOpt->m_present) throw OperationException("you must specify -top-k, -threshold, or both");
+    OptionalParameter* weightsOpt = myParams->getOptionalParameter(6);
+    vector<float>* weights = NULL, realweights;//NOTE: realweights is NOT a pointer
+    if (weightsOpt->m_present)
+    {
+        weights = &realweights;//point it to the actual vector to signify the option is present
+        AString weightFileName = weightsOpt->getString(1);
+        FileInformation textFileInfo(weightFileName);
+        if (!textFileInfo.exists())
+        {
+            throw OperationException("weight list file doesn't exist");
+        }
+        fstream weightListFile(weightFileName.toLocal8Bit().constData(), fstream::in);
+        if (!weightListFile.good())
+        {
+            throw OperationException("error reading weight list file");
+        }
+        while (weightListFile.good())
+        {
+            float weight;
+            if (!(weightListFile >> weight))
+            {
+                break;
+            }
+            realweights.push_back(weight);
+        }
+    }
+    bool fisherZ = myParams->getOptionalParameter(7)->m_present;
+    bool noDemean = myParams->getOptionalParameter(8)->m_present;
+    bool covariance = myParams->getOptionalParameter(9)->m_present;
+    float memLimitGB = -1.0f;
+    OptionalParameter* memLimitOpt = myParams->getOptionalParameter(10);
+    if (memLimitOpt->m_present)
+    {
+        memLimitGB = (float)memLimitOpt->getDouble(1);
+        if (memLimitGB < 0.0f)
+        {
+            throw OperationException("memory limit cannot be negative");
+        }
+    }
+    OptionalParameter* crossOpt = myParams->getOptionalParameter(5);
+    if (crossOpt->m_present)
+    {
+        if (noDemean || covariance) throw OperationException("-no-demean and -covariance are not supported with -cross");
+        AlgorithmCiftiCrossCorrelation(myProgObj, myCifti, crossOpt->getCifti(1), outputName, mySettings, weights, fisherZ, memLimitGB);
+    } else {
+        AlgorithmCiftiCorrelation(myProgObj, myCifti, outputName, mySettings, weights, fisherZ, memLimitGB, noDemean, covariance);
+    }
+}
@@ -25,8 +25,8 @@
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
 #include "CiftiFile.h"
+#include "CiftiRowPipeline.h"
 #include "CiftiXML.h"
-#include "MultiDimIterator.h"
 
 #include <iostream>
 
@@ -267,57 +267,36 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
     }
     if (outXML.getNumberOfDimensions() < 1) throw OperationException("output must have at least 1 dimension");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> values(numVars), scratchRow(outDims[0]);
-    vector<vector<float> > inputRows(numVars);
-    vector<vector<int64_t> > loadedRow(numVars);//to detect and prevent rereading the same row
+    CiftiRowPipeline myPipeline(myCiftiOut);//reads ahead and evaluates rows on multiple threads
     for (int v = 0; v < numVars; ++v)
-    {
-        inputRows[v].resize(varCiftiFiles[v]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW));
-        loadedRow[v].resize(varCiftiFiles[v]->getCiftiXML().getNumberOfDimensions() - 1, -1);//we always load a full row, so ignore first dim
+    {//select info includes the row dimension, and can have extra entries for nonexistent dimensions
+        int thisNumDims = varCiftiFiles[v]->getCiftiXML().getNumberOfDimensions();
+        myPipeline.addInput(varCiftiFiles[v], vector<int64_t>(selectInfo[v].begin() + 1, selectInfo[v].begin() + thisNumDims));
     }
-    for (MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end())); !iter.atEnd(); ++iter)
+    int numThreads = CiftiRowPipeline::getNumThreads();
+    vector<vector<const float*> > threadPointers(numThreads, vector<const float*>(numVars));
+    vector<vector<vector<float> > > threadBroadcast(numThreads, vector<vector<float> >(numVars));//for select along row, the selected value repeated
+    myPipeline.run([&](const vector<int64_t>&, const vector<const float*>& inputRows, float* scratchRow, const int& thread)
     {
-        for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
+        vector<const float*>& rowPointers = threadPointers[thread];
+        for (int v = 0; v < numVars; ++v)//now we check for select along row
         {
-            bool needToLoad = false;
-            for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
-            {
-                int64_t indexNeeded = -1;
-                if (selectInfo[v][dim + 1] == -1)
-                {
-                    CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
-                    indexNeeded = (*iter)[dim];//NOTE: iter also doesn't include the first dim
-                } else {
-                    indexNeeded = selectInfo[v][dim + 1];
-                }
-                if (indexNeeded != loadedRow[v][dim])
-                {
-                    needToLoad = true;
-                    loadedRow[v][dim] = indexNeeded;
-                }
-            }
-            if (needToLoad)
+            if (selectInfo[v][0] == -1)
             {
-                varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
+                rowPointers[v] = inputRows[v];
+            } else {
+                vector<float>& broadcast = threadBroadcast[thread][v];
+                broadcast.assign(outDims[0], inputRows[v][selectInfo[v][0]]);
+                rowPointers[v] = broadcast.data();
             }
         }
-        for (int j = 0; j < outDims[0]; ++j)
+        myExpr.evaluateBatch(rowPointers, outDims[0], scratchRow);
+        if (nanfix)
         {
-            for (int v = 0; v < numVars; ++v)//now we check for select along row
+            for (int j = 0; j < outDims[0]; ++j)
             {
-                if (selectInfo[v][0] == -1)
-                {
-                    values[v] = inputRows[v][j];
-                } else {
-                    values[v] = inputRows[v][selectInfo[v][0]];
-                }
-            }
-            scratchRow[j] = (float)myExpr.evaluate(values);
-            if (nanfix && scratchRow[j] != scratchRow[j])
-            {
-                scratchRow[j] = nanfixval;
+                if (scratchRow[j] != scratchRow[j]) scratchRow[j] = nanfixval;
             }
         }
-        myCiftiOut->setRow(scratchRow.data(), *iter);
-    }
+    });
 }
@@ -23,14 +23,142 @@
 
 #include "AffineFile.h"
 #include "AlgorithmCiftiResample.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "WarpfieldFile.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    typedef vector<vector<AlgorithmCiftiResample::ResampleWeight> > SparseWeights;
+    
+    //output = colWeights * input * rowWeights^T, without an intermediate dconn: each needed input row is resampled along the row, and then
+    //each output row is the weighted sum of the resampled rows its column weights use, so output rows are done in blocks such that the
+    //resampled rows a block needs, plus the block itself, fit in the memory limit, and resampled rows are kept for the next block if it uses them
+    void resampleDconnBlocked(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const SparseWeights& colWeights, const SparseWeights& rowWeights, const int64_t& memLimitBytes)
+    {
+        const int64_t inRows = ciftiIn->getNumberOfRows(), inCols = ciftiIn->getNumberOfColumns();
+        const int64_t outRows = (int64_t)colWeights.size(), outCols = (int64_t)rowWeights.size();
+        const int64_t inRowBytes = inCols * sizeof(float), outRowBytes = outCols * sizeof(float);
+        const int64_t readBatch = max((int64_t)1, min((int64_t)64, memLimitBytes / 8 / inRowBytes));//input rows are read serially, and resampled in parallel
+        const int64_t maxBlockRows = (memLimitBytes - readBatch * inRowBytes) / outRowBytes;//counts both resampled rows and output rows
+        vector<vector<float> > readRows(readBatch, vector<float>(inCols));
+        vector<vector<float> > resampledRows(inRows);//empty when not in memory
+        vector<int64_t> cachedRows;
+        vector<char> needed(inRows, 0);
+        vector<float> outBlock;
+        int64_t blockStart = 0;
+        while (blockStart < outRows)
+        {
+            vector<int64_t> neededRows;
+            int64_t blockEnd = blockStart;
+            while (blockEnd < outRows)
+            {
+                const vector<AlgorithmCiftiResample::ResampleWeight>& weights = colWeights[blockEnd];
+                int64_t newNeeded = 0;
+                for (int64_t k = 0; k < (int64_t)weights.size(); ++k)
+                {
+                    if (!needed[weights[k].m_index]) ++newNeeded;
+                }
+                if ((int64_t)neededRows.size() + newNeeded + (blockEnd - blockStart + 1) > maxBlockRows)
+                {
+                    if (blockEnd == blockStart)
+                    {
+                        throw OperationException("memory limit is too small to compute output row " + AString::number(blockEnd) + ", it needs at least " +
+                                                 AString::number((readBatch * inRowBytes + (newNeeded + 1) * outRowBytes) / 1024.0 / 1024.0 / 1024.0) + " GB");
+                    }
+                    break;
+                }
+                for (int64_t k = 0; k < (int64_t)weights.size(); ++k)
+                {
+                    if (!needed[weights[k].m_index])
+                    {
+                        needed[weights[k].m_index] = 1;
+                        neededRows.push_back(weights[k].m_index);
+                    }
+                }
+                ++blockEnd;
+            }
+            vector<int64_t> keptRows;//free the resampled rows this block doesn't use before computing new ones
+            for (int64_t k = 0; k < (int64_t)cachedRows.size(); ++k)
+            {
+                if (needed[cachedRows[k]])
+                {
+                    keptRows.push_back(cachedRows[k]);
+                } else {
+                    vector<float>().swap(resampledRows[cachedRows[k]]);
+                }
+            }
+            cachedRows = keptRows;
+            vector<int64_t> toCompute;
+            for (int64_t k = 0; k < (int64_t)neededRows.size(); ++k)
+            {
+                if (resampledRows[neededRows[k]].empty()) toCompute.push_back(neededRows[k]);
+            }
+            sort(toCompute.begin(), toCompute.end());//read in file order
+            for (int64_t batchStart = 0; batchStart < (int64_t)toCompute.size(); batchStart += readBatch)
+            {
+                const int64_t batchEnd = min(batchStart + readBatch, (int64_t)toCompute.size());
+                for (int64_t b = batchStart; b < batchEnd; ++b)
+                {
+                    ciftiIn->getRow(readRows[b - batchStart].data(), toCompute[b]);
+                }
+#pragma omp CARET_PARFOR schedule(dynamic)
+                for (int64_t b = batchStart; b < batchEnd; ++b)
+                {
+                    const float* inData = readRows[b - batchStart].data();
+                    vector<float>& resampled = resampledRows[toCompute[b]];
+                    resampled.resize(outCols);
+                    for (int64_t j = 0; j < outCols; ++j)
+                    {
+                        const vector<AlgorithmCiftiResample::ResampleWeight>& weights = rowWeights[j];
+                        double accum = 0.0;
+                        for (int64_t k = 0; k < (int64_t)weights.size(); ++k)
+                        {
+                            accum += inData[weights[k].m_index] * weights[k].m_weight;
+                        }
+                        resampled[j] = accum;
+                    }
+                }
+                cachedRows.insert(cachedRows.end(), toCompute.begin() + batchStart, toCompute.begin() + batchEnd);
+            }
+            const int64_t blockRows = blockEnd - blockStart;
+            outBlock.resize(blockRows * outCols);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t i = 0; i < blockRows; ++i)
+            {
+                float* outData = outBlock.data() + i * outCols;
+                const vector<AlgorithmCiftiResample::ResampleWeight>& weights = colWeights[blockStart + i];
+                for (int64_t j = 0; j < outCols; ++j) outData[j] = 0.0f;
+                for (int64_t k = 0; k < (int64_t)weights.size(); ++k)
+                {
+                    const float* resampled = resampledRows[weights[k].m_index].data();
+                    const float weight = weights[k].m_weight;
+                    for (int64_t j = 0; j < outCols; ++j)
+                    {
+                        outData[j] += weight * resampled[j];
+                    }
+                }
+            }
+            for (int64_t i = 0; i < blockRows; ++i)
+            {
+                ciftiOut->setRow(outBlock.data() + i * outCols, blockStart + i);
+            }
+            for (int64_t k = 0; k < (int64_t)neededRows.size(); ++k)
+            {
+                needed[neededRows[k]] = 0;
+            }
+            blockStart = blockEnd;
+        }
+    }
+}
+
 AString OperationCiftiResampleDconnMemory::getCommandSwitch()
 {
     return "-cifti-resample-dconn-memory";
@@ -116,6 +244,9 @@ OperationParameters* OperationCiftiResampleDconnMemory::getParameters()
     cerebAreaMetricsOpt->addMetricParameter(1, "current-area", "a metric file with vertex areas for the current mesh");
     cerebAreaMetricsOpt->addMetricParameter(2, "new-area", "a metric file with vertex areas for the new mesh");
     
+    OptionalParameter* memLimitOpt = ret->createOptionalParameter(16, "-mem-limit", "resample without the intermediate dconn, using limited memory");
+    memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
+    
     AString myHelpText =
         AString("This command does the same thing as running -cifti-resample twice, but uses memory up to approximately 2x the size that the intermediate file would be.  ") +
         "This is because the intermediate dconn is kept in memory, rather than written to disk, " +
@@ -125,6 +256,11 @@ OperationParameters* OperationCiftiResampleDconnMemory::getParameters()
         "Dilation is done with the 'nearest' method, and is done on <new-sphere> for surface data.  " +
         "Volume components are padded before dilation so that dilation doesn't run into the edge of the component bounding box.\n\n" +
         "To get the v1.3.2 and earlier behavior of weighted dilation, specify exponent of 2 for surface and volume, and -legacy-cutoff for both surface and volume.\n\n" +
+        "When -mem-limit is specified, the resampling is instead done as sparse weights applied on both sides of the input dconn, a block of output rows at a time, " +
+        "so that the input rows needed by a block, resampled along the row, fit within the limit along with the block.  " +
+        "The memory used by the weights and by the surfaces and volumes used to find them is not counted.  " +
+        "Volume weights are found by resampling one voxel at a time, which can be slow for large volume components.  " +
+        "It cannot be used with -surface-postdilate, or with label data.\n\n" +
         "The <volume-method> argument must be one of the following:\n\n" +
         "CUBIC\nENCLOSING_VOXEL\nTRILINEAR\n\n" +
         "The <surface-method> argument must be one of the following:\n\n";
@@ -402,6 +538,49 @@ void OperationCiftiResampleDconnMemory::useParameters(OperationParameters* myPar
     {
         throw OperationException(message);
     }
+    OptionalParameter* memLimitOpt = myParams->getOptionalParameter(16);
+    if (memLimitOpt->m_present)
+    {
+        float memLimitGB = (float)memLimitOpt->getDouble(1);
+        if (memLimitGB <= 0.0f) throw OperationException("memory limit must be positive");
+        if (surfDilateOpt->m_present) throw OperationException("-surface-postdilate cannot be used with -mem-limit");
+        if (isLabelData) throw OperationException("-mem-limit cannot be used with label data");
+        const VolumeFile* warpPtr = NULL;
+        const FloatMatrix* affinePtr = NULL;
+        if (warpfieldOpt->m_present)
+        {
+            warpPtr = myWarpfield.getWarpfield();
+        } else {
+            affinePtr = &(myAffine.getMatrix());
+        }
+        SparseWeights rowWeights, colWeights;
+        AlgorithmCiftiResample::getRowResampleWeights(myCiftiIn, myTemplate, templateDir, mySurfMethod, myVolMethod, surfLargest, voldilatemm, warpPtr, affinePtr,
+                                                      curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
+                                                      curRightSphere, newRightSphere, curRightAreas, newRightAreas,
+                                                      curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas,
+                                                      volDilateMethod, volDilateExponent, volLegacyCutoff, rowWeights);
+        const SparseWeights* colWeightsUse = &rowWeights;
+        if (*(inputXML.getMap(CiftiXML::ALONG_COLUMN)) != *(inputXML.getMap(CiftiXML::ALONG_ROW)))
+        {//the weights only depend on the mapping, so get the column weights from a file header with the column mapping along the row
+            CiftiXML columnXML = inputXML;
+            columnXML.setMap(CiftiXML::ALONG_ROW, *(inputXML.getMap(CiftiXML::ALONG_COLUMN)));
+            CiftiFile columnFile;
+            columnFile.setCiftiXML(columnXML);
+            AlgorithmCiftiResample::getRowResampleWeights(&columnFile, myTemplate, templateDir, mySurfMethod, myVolMethod, surfLargest, voldilatemm, warpPtr, affinePtr,
+                                                          curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
+                                                          curRightSphere, newRightSphere, curRightAreas, newRightAreas,
+                                                          curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas,
+                                                          volDilateMethod, volDilateExponent, volLegacyCutoff, colWeights);
+            colWeightsUse = &colWeights;
+        }
+        CiftiXML outXML = inputXML;
+        const CiftiMappingType* templateMap = myTemplate->getCiftiXML().getMap(templateDir);
+        outXML.setMap(CiftiXML::ALONG_ROW, *templateMap);
+        outXML.setMap(CiftiXML::ALONG_COLUMN, *templateMap);
+        myCiftiOut->setCiftiXML(outXML);
+        resampleDconnBlocked(myCiftiIn, myCiftiOut, *colWeightsUse, rowWeights, (int64_t)(memLimitGB * 1024.0 * 1024.0 * 1024.0));
+        return;
+    }
     CiftiFile tempCifti;
     //TSC: resampling along column first causes it to hit peak memory usage earlier
     if (warpfieldOpt->m_present)
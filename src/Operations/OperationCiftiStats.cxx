@@ -21,11 +21,13 @@
 #include "OperationCiftiStats.h"
 #include "OperationException.h"
 
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "ReductionOperation.h"
 
 #include <algorithm>
 #include <cmath>
+#include <exception>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -188,7 +190,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     }
     bool showMapName = myParams->getOptionalParameter(6)->m_present;
     const CiftiMappingType* rowMap = myXML.getMap(CiftiXML::ALONG_ROW);
-    vector<float> colScratch(colLength);
     int64_t columnStart, columnEnd;
     if (useColumn == -1)
     {
@@ -201,45 +202,56 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         columnStart = useColumn;
         columnEnd = useColumn + 1;
     }
-    for (int i = columnStart; i < columnEnd; ++i)
+    int64_t numResults = (matchColumnMode ? 1 : numRois);
+    vector<vector<float> > results(columnEnd - columnStart, vector<float>(numResults));
+    exception_ptr firstError;
+#pragma omp CARET_PAR
+    {//when there is more than one column, everything has been read into memory, so columns can be computed in parallel
+        vector<float> colScratch(colLength), myRoiData(roiData.size());
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = columnStart; i < columnEnd; ++i)
+        {
+            try
+            {
+                myInput->getColumn(colScratch.data(), i);
+                for (int64_t j = 0; j < numResults; ++j)
+                {
+                    if (matchColumnMode)
+                    {//trick: matchColumn is only true when we have an roi
+                        roiCifti->getColumn(myRoiData.data(), i);
+                    } else {
+                        if (roiCifti != NULL) roiCifti->getColumn(myRoiData.data(), j);
+                    }
+                    if (reduceOpt->m_present)
+                    {
+                        results[i - columnStart][j] = reduce(colScratch, myop, myRoiData);
+                    } else {
+                        CaretAssert(percentileOpt->m_present);
+                        results[i - columnStart][j] = percentile(colScratch, percent, myRoiData);
+                    }
+                }
+            } catch (...) {
+#pragma omp critical
+                {
+                    if (!firstError) firstError = current_exception();
+                }
+            }
+        }
+    }
+    if (firstError) rethrow_exception(firstError);
+    for (int64_t i = columnStart; i < columnEnd; ++i)
     {
-        myInput->getColumn(colScratch.data(), i);
         if (showMapName)
         {
             cout << AString::number(i + 1) << ":\t" << rowMap->getIndexName(i) << ":\t";
         }
-        if (matchColumnMode)
-        {//trick: matchColumn is only true when we have an roi
-            roiCifti->getColumn(roiData.data(), i);
-            float result;
-            if (reduceOpt->m_present)
-            {
-                result = reduce(colScratch, myop, roiData);
-            } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(colScratch, percent, roiData);
-            }
+        for (int64_t j = 0; j < numResults; ++j)
+        {
             stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str() << endl;
-        } else {
-            for (int64_t j = 0; j < numRois; ++j)
-            {
-                if (roiCifti != NULL) roiCifti->getColumn(roiData.data(), j);
-                float result;
-                if (reduceOpt->m_present)
-                {
-                    result = reduce(colScratch, myop, roiData);
-                } else {
-                    CaretAssert(percentileOpt->m_present);
-                    result = percentile(colScratch, percent, roiData);
-                }
-                stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
-                if (j != 0) cout << "\t";
-                cout << resultsstr.str();
-            }
-            cout << endl;
+            resultsstr << setprecision(7) << results[i - columnStart][j];
+            if (j != 0) cout << "\t";
+            cout << resultsstr.str();
         }
+        cout << endl;
     }
 }
@@ -24,8 +24,10 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "MetricFile.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace caret;
@@ -181,7 +183,7 @@ void OperationMetricMath::useParameters(OperationParameters* myParams, ProgressO
     {
         throw OperationException("all -var options used -repeat, there is no file to get number of desired output columns from");
     }
-    vector<float> values(numVars), colScratch(numNodes);
+    vector<float> colScratch(numNodes);
     vector<const float*> columnPointers(numVars);
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numColumns);
     myMetricOut->setStructure(myStructure);
@@ -197,16 +199,25 @@ void OperationMetricMath::useParameters(OperationParameters* myParams, ProgressO
                 columnPointers[v] = varMetrics[v]->getValuePointerForColumn(metricColumns[v]);
             }
         }
-        for (int i = 0; i < numNodes; ++i)
+        const int64_t BLOCK_SIZE = 4096;
+        int64_t numBlocks = (numNodes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t b = 0; b < numBlocks; ++b)
         {
+            int64_t start = b * BLOCK_SIZE, count = min(BLOCK_SIZE, numNodes - start);
+            vector<const float*> blockPointers(numVars);
             for (int v = 0; v < numVars; ++v)
             {
-                values[v] = columnPointers[v][i];
+                blockPointers[v] = columnPointers[v] + start;
             }
-            colScratch[i] = (float)myExpr.evaluate(values);
-            if (nanfix && colScratch[i] != colScratch[i])
+            float* blockOut = colScratch.data() + start;
+            myExpr.evaluateBatch(blockPointers, count, blockOut);
+            if (nanfix)
             {
-                colScratch[i] = nanfixval;
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    if (blockOut[i] != blockOut[i]) blockOut[i] = nanfixval;
+                }
             }
         }
         myMetricOut->setValuesForColumn(j, colScratch.data());
@@ -24,8 +24,10 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace caret;
@@ -200,7 +202,7 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
         throw OperationException("all -var options used -repeat, there is no file to get number of desired output subvolumes from");
     }
     int64_t frameSize = outDims[0] * outDims[1] * outDims[2];
-    vector<float> values(numVars), outFrame(frameSize);
+    vector<float> outFrame(frameSize);
     vector<const float*> inputFrames(numVars);
     if (toClone != NULL)
     {//don't take volume type from the selected volume, because we don't check for or copy label tables, nor do we want to (might be changing all the label keys, splitting label by roi...)
@@ -220,18 +222,26 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
                 inputFrames[v] = varVolumes[v]->getFrame(varSubvolumes[v]);
             }
         }
-        for (int64_t i = 0; i < frameSize; ++i)
+        const int64_t BLOCK_SIZE = 4096;
+        int64_t numBlocks = (frameSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t b = 0; b < numBlocks; ++b)
         {
+            int64_t start = b * BLOCK_SIZE, count = min(BLOCK_SIZE, frameSize - start);
+            vector<const float*> blockPointers(numVars);
             for (int v = 0; v < numVars; ++v)
             {
-                values[v] = inputFrames[v][i];
+                blockPointers[v] = inputFrames[v] + start;
             }
-            float tempf = (float)myExpr.evaluate(values);
-            if (nanfix && tempf != tempf)
+            float* blockOut = outFrame.data() + start;
+            myExpr.evaluateBatch(blockPointers, count, blockOut);
+            if (nanfix)
             {
-                tempf = nanfixval;
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    if (blockOut[i] != blockOut[i]) blockOut[i] = nanfixval;
+                }
             }
-            outFrame[i] = tempf;
         }
         myVolOut->setFrame(outFrame.data(), s);
     }
@@ -72,6 +72,10 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
     for (int i = 0; i < numCifti; ++i)
     {
         wbsparseList.push_back(CaretPointer<CaretSparseFile>(new CaretSparseFile(myInstances[i]->getString(1))));
+        if (wbsparseList.back()->getValueType() != CaretSparseFile::INTEGER_VALUES)
+        {
+            throw OperationException("file '" + myInstances[i]->getString(1) + "' contains float values, only fiber trajectory wbsparse files can be merged");
+        }
     }
     if (wbsparseList.size() == 0) throw OperationException("no files specified");
     if (myDir != CiftiXML::ALONG_ROW && myDir != CiftiXML::ALONG_COLUMN) throw OperationException("direction not supported by wbsparse merge dense");
@@ -0,0 +1,153 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "Base64DecoderTest.h"
+
+#include "Base64Decoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+Base64DecoderTest::Base64DecoderTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    ///reference encoder, with a line break every 76 characters like MIME, and optionally without '=' padding
+    string encode(const vector<unsigned char>& data, const bool& padded)
+    {
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        string encoded;
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            uint32_t bits = ((uint32_t)data[i]) << 16;
+            size_t numBytes = min((size_t)3, data.size() - i);
+            if (numBytes > 1) bits |= ((uint32_t)data[i + 1]) << 8;
+            if (numBytes > 2) bits |= data[i + 2];
+            for (size_t k = 0; k < 4; ++k)
+            {
+                if (k <= numBytes)
+                {
+                    encoded += alphabet[(bits >> (18 - 6 * k)) & 63];
+                } else if (padded) {
+                    encoded += '=';
+                }
+                if (encoded.size() % 77 == 76) encoded += '\n';
+            }
+        }
+        return encoded;
+    }
+    
+    ///decodes the text split into pieces at the given positions, returns false if the decoder reports an error
+    bool decodeInChunks(const string& text, const vector<size_t>& splits, vector<unsigned char>& decodedOut)
+    {
+        Base64Decoder decoder;
+        decodedOut.clear();
+        size_t start = 0;
+        for (size_t s = 0; s <= splits.size(); ++s)
+        {
+            size_t end = (s < splits.size()) ? splits[s] : text.size();
+            vector<unsigned char> buffer(Base64Decoder::getMaximumDecodedSize(end - start));
+            int64_t numBytes = decoder.decode(text.data() + start, end - start, buffer.data());
+            if (numBytes < 0) return false;
+            decodedOut.insert(decodedOut.end(), buffer.begin(), buffer.begin() + numBytes);
+            start = end;
+        }
+        unsigned char last[2];
+        int64_t numBytes = decoder.finish(last);
+        if (numBytes < 0) return false;
+        decodedOut.insert(decodedOut.end(), last, last + numBytes);
+        return true;
+    }
+}
+
+void Base64DecoderTest::execute()
+{
+    vector<unsigned char> decoded;
+    for (int length = 0; !failed() && length < 40; ++length)
+    {//every split point of short inputs, padded or not, so groups are split at every position between calls
+        vector<unsigned char> data(length);
+        for (int i = 0; i < length; ++i)
+        {
+            data[i] = (unsigned char)(rand() % 256);
+        }
+        for (int padded = 0; !failed() && padded < 2; ++padded)
+        {
+            const string text = encode(data, padded != 0);
+            for (size_t split = 0; split <= text.size(); ++split)
+            {
+                vector<size_t> splits(1, split);
+                if (!decodeInChunks(text, splits, decoded) || decoded != data)
+                {
+                    setFailed("wrong result decoding " + AString::number(length) + " bytes split at character " + AString::number((int64_t)split) + (padded ? "" : " without padding"));
+                    break;
+                }
+            }
+        }
+    }
+    vector<unsigned char> data(100000);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = (unsigned char)(rand() % 256);
+    }
+    const string text = encode(data, true);
+    vector<size_t> splits;
+    for (size_t position = rand() % 50; position < text.size(); position += 1 + rand() % 5000)
+    {//uneven pieces, like an XML parser gives
+        splits.push_back(position);
+    }
+    if (!decodeInChunks(text, splits, decoded) || decoded != data)
+    {
+        setFailed("wrong result decoding " + AString::number((int64_t)data.size()) + " bytes in " + AString::number((int64_t)splits.size() + 1) + " pieces");
+    }
+    splits.clear();
+    if (!decodeInChunks("  QUJD\r\n\tREVG\n====\n", splits, decoded) || string(decoded.begin(), decoded.end()) != "ABCDEF")
+    {
+        setFailed("wrong result decoding whitespace and an end marker after complete groups");
+    }
+    
+    const char* invalidInputs[] = { "QUJD*REVG", "QU-JDREVG", "QUJDREVG.", "QUJ=REVG", "Q===", "QUJDR", "QUI=A" };
+    const int numInvalid = sizeof(invalidInputs) / sizeof(invalidInputs[0]);
+    for (int i = 0; i < numInvalid; ++i)
+    {
+        if (decodeInChunks(invalidInputs[i], splits, decoded))
+        {
+            setFailed(AString("invalid input was accepted: ") + invalidInputs[i]);
+        }
+    }
+    string withNull("QUJD");
+    withNull += '\0';
+    withNull += "REVG";
+    if (decodeInChunks(withNull, splits, decoded))
+    {
+        setFailed("input with a null character was accepted");
+    }
+    Base64Decoder decoder;
+    unsigned char buffer[16];
+    if (decoder.decode("QU#J", 4, buffer) >= 0 || decoder.decode("REVG", 4, buffer) >= 0 || decoder.finish(buffer) >= 0)
+    {
+        setFailed("decoder did not keep reporting the error after invalid input");
+    }
+}
@@ -0,0 +1,129 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CorrelationTest.h"
+
+#include "AlgorithmCiftiCorrelation.h"
+#include "CiftiFile.h"
+#include "DotProductKernel.h"
+#include "dot_wrapper.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CorrelationTest::CorrelationTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    void randomRow(float* rowOut, const int& length)
+    {
+        for (int i = 0; i < length; ++i)
+        {
+            rowOut[i] = (rand() * 2.0f / RAND_MAX) - 1.0f;
+        }
+    }
+}
+
+void CorrelationTest::execute()
+{
+    srand(1234);
+    dot_set_impl(DOT_NAIVE);//the blocked kernel sums in the same order as the naive dot product, the SIMD versions reorder the sum
+    testDotBlock();
+    testTiles();
+    dot_set_impl(DOT_AUTO);
+    DotProductKernel::setAVX2Enabled(true);
+}
+
+void CorrelationTest::testDotBlock()
+{
+    const int LENGTH = 37, NUM_IN = 5;//partial block, to check the zero fill
+    const int BLOCK_ROWS = DotProductKernel::BLOCK_ROWS, BLOCK_COLS = DotProductKernel::BLOCK_COLS;
+    vector<float> rowData(BLOCK_ROWS * LENGTH), inData(NUM_IN * LENGTH), packed(BLOCK_COLS * LENGTH);
+    randomRow(rowData.data(), BLOCK_ROWS * LENGTH);
+    randomRow(inData.data(), NUM_IN * LENGTH);
+    const float* rows[BLOCK_ROWS];
+    const float* inRows[NUM_IN];
+    for (int i = 0; i < BLOCK_ROWS; ++i) rows[i] = rowData.data() + i * LENGTH;
+    for (int j = 0; j < NUM_IN; ++j) inRows[j] = inData.data() + j * LENGTH;
+    DotProductKernel::packRows(inRows, NUM_IN, LENGTH, packed.data());
+    for (int useAVX2 = 0; useAVX2 < 2; ++useAVX2)
+    {
+        if (DotProductKernel::setAVX2Enabled(useAVX2 != 0) != (useAVX2 != 0)) continue;//build or cpu lacks AVX2
+        double dots[BLOCK_ROWS * BLOCK_COLS];
+        DotProductKernel::dotBlock(rows, packed.data(), LENGTH, dots);
+        for (int i = 0; i < BLOCK_ROWS; ++i)
+        {
+            for (int j = 0; j < BLOCK_COLS; ++j)
+            {
+                double expected = (j < NUM_IN ? dsdot(rows[i], inRows[j], LENGTH) : 0.0);
+                if (dots[i * BLOCK_COLS + j] != expected)
+                {
+                    setFailed("dotBlock" + AString(useAVX2 ? " (AVX2)" : "") + " differs from dsdot at row " + AString::number(i) + ", column " + AString::number(j) +
+                              ": " + AString::number(dots[i * BLOCK_COLS + j], 'g', 17) + " vs " + AString::number(expected, 'g', 17));
+                }
+            }
+        }
+    }
+}
+
+void CorrelationTest::testTiles()
+{
+    const int NUM_ROWS = 23, NUM_COLS = 41;//not multiples of the block size
+    CiftiXMLOld myXML;
+    myXML.resetRowsToTimepoints(1.0f, NUM_COLS);
+    myXML.resetColumnsToScalars(NUM_ROWS);
+    CiftiFile input;
+    input.setCiftiXML(myXML);
+    vector<float> row(NUM_COLS);
+    for (int i = 0; i < NUM_ROWS; ++i)
+    {
+        randomRow(row.data(), NUM_COLS);
+        input.setRow(row.data(), i);
+    }
+    vector<float> tiledRow(NUM_ROWS), pairRow(NUM_ROWS);
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        const bool fisherZ = (mode == 1), covariance = (mode == 2);
+        for (int useAVX2 = 0; useAVX2 < 2; ++useAVX2)
+        {
+            if (DotProductKernel::setAVX2Enabled(useAVX2 != 0) != (useAVX2 != 0)) continue;
+            CiftiFile tiled, pairwise;
+            AlgorithmCiftiCorrelation(NULL, &input, &tiled, NULL, fisherZ, -1.0f, false, covariance);//whole input in memory, correlated in tiles
+            AlgorithmCiftiCorrelation(NULL, &input, &pairwise, NULL, fisherZ, 0.0f, false, covariance);//no memory to spare, rows are streamed and correlated one pair at a time
+            for (int i = 0; i < NUM_ROWS; ++i)
+            {
+                tiled.getRow(tiledRow.data(), i);
+                pairwise.getRow(pairRow.data(), i);
+                for (int j = 0; j < NUM_ROWS; ++j)
+                {
+                    if (tiledRow[j] != pairRow[j])
+                    {
+                        setFailed("tiled correlation" + AString(useAVX2 ? " (AVX2)" : "") + " differs from pairwise in mode " + AString::number(mode) +
+                                  " at " + AString::number(i) + ", " + AString::number(j) + ": " + AString::number(tiledRow[j], 'g', 9) + " vs " + AString::number(pairRow[j], 'g', 9));
+                    }
+                }
+            }
+        }
+    }
+}
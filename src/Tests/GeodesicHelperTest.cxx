@@ -22,6 +22,7 @@
 #include "GeodesicHelper.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 using namespace caret;
@@ -96,4 +97,50 @@ void GeodesicHelperTest::execute()
         checkNodeLists(this, "Comparing normal to quarter areas, getPathFollowingData", nodesNorm, nodesQuarter);
         checkNodeLists(this, "Comparing normal to quad areas, getPathFollowingData", nodesNorm, nodesQuad);
     }
+    vector<int32_t> roots;
+    for (int i = 0; i < TEST_SAMPLES; ++i)
+    {
+        roots.push_back(rand() % numNodes);
+    }
+    vector<float> batchDists(roots.size() * numNodes), singleDists;
+    normalHelp->getGeoFromNodes(roots, batchDists.data());
+    for (int i = 0; !failed() && i < TEST_SAMPLES; ++i)
+    {
+        normalHelp->getGeoFromNode(roots[i], singleDists);
+        for (int j = 0; j < numNodes; ++j)
+        {
+            if (batchDists[((int64_t)i) * numNodes + j] != singleDists[j])
+            {
+                setFailed("Comparing getGeoFromNodes to getGeoFromNode, found different distance at node " + AString::number(j) + " from root " + AString::number(roots[i]));
+                break;
+            }
+        }
+    }
+    vector<vector<int32_t> > batchNodes;
+    vector<vector<float> > batchNodeDists;
+    const float BATCH_GEO_DIST = 20.0f;
+    normalHelp->getNodesToGeoDist(roots, BATCH_GEO_DIST, batchNodes, batchNodeDists);
+    for (int i = 0; !failed() && i < TEST_SAMPLES; ++i)
+    {//batch output is by node index, so sort the single root output the same way, everything else must match exactly
+        normalHelp->getNodesToGeoDist(roots[i], BATCH_GEO_DIST, nodesNorm, distsNorm);
+        vector<pair<int32_t, float> > sorted(nodesNorm.size());
+        for (size_t j = 0; j < nodesNorm.size(); ++j)
+        {
+            sorted[j] = pair<int32_t, float>(nodesNorm[j], distsNorm[j]);
+        }
+        sort(sorted.begin(), sorted.end());
+        for (size_t j = 0; j < sorted.size(); ++j)
+        {
+            nodesNorm[j] = sorted[j].first;
+            distsNorm[j] = sorted[j].second;
+        }
+        checkNodeLists(this, "Comparing batched to single root getNodesToGeoDist", batchNodes[i], nodesNorm);
+        for (size_t j = 0; !failed() && j < distsNorm.size(); ++j)
+        {
+            if (batchNodeDists[i][j] != distsNorm[j])
+            {
+                setFailed("Comparing batched to single root getNodesToGeoDist, found different distance at node " + AString::number(nodesNorm[j]) + " from root " + AString::number(roots[i]));
+            }
+        }
+    }
 }
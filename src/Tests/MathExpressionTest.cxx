@@ -55,4 +55,29 @@ void MathExpressionTest::execute()
     {
         setFailed("output value incorrect, expected " + AString::number(correctresult) + ", got " + AString::number(testresult));
     }
+    const int BATCH_LENGTH = 1000;//more than one chunk of the batch evaluator
+    vector<float> batchVars[2], batchOut(BATCH_LENGTH);
+    for (int v = 0; v < 2; ++v)
+    {
+        batchVars[v].resize(BATCH_LENGTH);
+        for (int i = 0; i < BATCH_LENGTH; ++i)
+        {
+            batchVars[v][i] = vars[v] + (i - BATCH_LENGTH / 2) * 0.01f * (v + 1);
+        }
+    }
+    vector<const float*> batchPointers(2);
+    batchPointers[0] = batchVars[0].data();
+    batchPointers[1] = batchVars[1].data();
+    myExpr.evaluateBatch(batchPointers, BATCH_LENGTH, batchOut.data());
+    for (int i = 0; i < BATCH_LENGTH; ++i)
+    {
+        vars[0] = batchVars[0][i];
+        vars[1] = batchVars[1][i];
+        float expected = (float)myExpr.evaluate(vars);
+        if (batchOut[i] != expected)
+        {
+            setFailed("batch output value incorrect at index " + AString::number(i) + ", expected " + AString::number(expected) + ", got " + AString::number(batchOut[i]));
+            break;
+        }
+    }
 }
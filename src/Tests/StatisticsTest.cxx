@@ -20,9 +20,20 @@
 #include "StatisticsTest.h"
 #include <cstdlib>
 #include <cmath>
+#include <limits>
 
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "CaretPointer.h"
+#include "DataFileStatisticsSidecar.h"
 #include "FastStatistics.h"
 #include "DescriptiveStatistics.h"
+#include "Histogram.h"
+#include "PartitionedStatistics.h"
+#include "StatisticsKernel.h"
 
 using namespace caret;
 using namespace std;
@@ -42,6 +53,7 @@ void StatisticsTest::execute()
     DescriptiveStatistics myFullStats;
     myFullStats.update(myData.data(), NUM_ELEMENTS);
     FastStatistics myFastStats(myData.data(), NUM_ELEMENTS);
+    Histogram myHist(myData.data(), NUM_ELEMENTS);
     float exacttolerance = myFullStats.getPopulationStandardDeviation() * 0.000001f;
     float approxtolerance = myFullStats.getPopulationStandardDeviation() * 0.01f;
     if (abs(myFullStats.getMinimumValue() - myFastStats.getMin()) > exacttolerance)
@@ -76,4 +88,300 @@ void StatisticsTest::execute()
     {
         setFailed(AString("mismatch in 90% negative percentile, full: ") + AString::number(myFullStats.getNegativePercentile(90.0f)) + ", fast: " + AString::number(myFastStats.getApproxNegativePercentile(90.0f)));
     }
+    //the AVX2 and scalar kernels must classify and bucket identically, including special values and a partial vector at the end
+    for (int i = 0; i < NUM_ELEMENTS; i += 97)
+    {
+        switch ((i / 97) % 5)
+        {
+            case 0: myData[i] = 0.0f; break;
+            case 1: myData[i] = -0.0f; break;
+            case 2: myData[i] = numeric_limits<float>::quiet_NaN(); break;
+            case 3: myData[i] = numeric_limits<float>::infinity(); break;
+            case 4: myData[i] = -numeric_limits<float>::infinity(); break;
+        }
+    }
+    const int64_t oddCount = NUM_ELEMENTS - 3;
+    StatisticsKernel::setAVX2Enabled(false);
+    FastStatistics scalarStats(myData.data(), oddCount);
+    Histogram scalarHist(myData.data(), oddCount);
+    if (StatisticsKernel::setAVX2Enabled(true))//also restores the default
+    {
+        FastStatistics avx2Stats(myData.data(), oddCount);
+        Histogram avx2Hist(myData.data(), oddCount);
+        int64_t scalarCounts[6], avx2Counts[6];
+        scalarStats.getCounts(scalarCounts[0], scalarCounts[1], scalarCounts[2], scalarCounts[3], scalarCounts[4], scalarCounts[5]);
+        avx2Stats.getCounts(avx2Counts[0], avx2Counts[1], avx2Counts[2], avx2Counts[3], avx2Counts[4], avx2Counts[5]);
+        for (int i = 0; i < 6; ++i)
+        {
+            if (scalarCounts[i] != avx2Counts[i])
+            {
+                setFailed("mismatch in value class count " + AString::number(i) + ", scalar: " + AString::number(scalarCounts[i]) + ", AVX2: " + AString::number(avx2Counts[i]));
+            }
+        }
+        if (scalarStats.getMin() != avx2Stats.getMin() || scalarStats.getMax() != avx2Stats.getMax())
+        {
+            setFailed("mismatch in range between scalar and AVX2 statistics");
+        }
+        if (abs(scalarStats.getMean() - avx2Stats.getMean()) > exacttolerance)
+        {
+            setFailed(AString("mismatch in mean, scalar: ") + AString::number(scalarStats.getMean()) + ", AVX2: " + AString::number(avx2Stats.getMean()));
+        }
+        if (scalarStats.getApproxPositivePercentile(90.0f) != avx2Stats.getApproxPositivePercentile(90.0f) ||
+            scalarStats.getApproxNegativePercentile(90.0f) != avx2Stats.getApproxNegativePercentile(90.0f) ||
+            scalarStats.getApproxAbsolutePercentile(90.0f) != avx2Stats.getApproxAbsolutePercentile(90.0f))
+        {
+            setFailed("mismatch in percentiles between scalar and AVX2 statistics");
+        }
+        if (scalarHist.getHistogramCounts() != avx2Hist.getHistogramCounts())
+        {
+            setFailed("mismatch in histogram buckets between scalar and AVX2");
+        }
+    }
+    testPartitioned(myData.data(), oddCount, exacttolerance);
+    testBinaryRoundTrip(myFastStats, myHist);
+    testSidecar(myFastStats, myHist);
+}
+
+namespace
+{
+    class ArrayPartReader : public PartitionedStatistics::PartReader
+    {//uneven parts, including an empty one
+        const float* m_data;
+        vector<int64_t> m_starts;
+    public:
+        ArrayPartReader(const float* data, const int64_t& count) : m_data(data)
+        {
+            m_starts.push_back(0);
+            m_starts.push_back(0);
+            for (int64_t start = 1000; start < count; start = start * 3 / 2 + 7)
+            {
+                m_starts.push_back(start);
+            }
+            m_starts.push_back(count);
+        }
+        int64_t getNumberOfParts() const { return m_starts.size() - 1; }
+        bool supportsConcurrentRead() const { return true; }
+        const float* readPart(const int64_t& index, vector<float>&, int64_t& countOut) const
+        {
+            countOut = m_starts[index + 1] - m_starts[index];
+            return m_data + m_starts[index];
+        }
+        int64_t getStart(const int64_t& index) const { return m_starts[index]; }
+    };
+}
+
+void StatisticsTest::testPartitioned(const float* data, const int64_t& count, const float& tolerance)
+{
+    FastStatistics wholeStats(data, count);
+    Histogram wholeHist(data, count);
+    ArrayPartReader reader(data, count);
+    FastStatistics partStats;
+    Histogram partHist;
+    vector<PartitionedStatistics::PartSummary> partSummaries;
+    if (!PartitionedStatistics::compute(reader, wholeHist.getNumberOfBuckets(), &partStats, &partHist, &partSummaries))
+    {
+        setFailed("partitioned statistics found no data");
+        return;
+    }
+    int64_t wholeCounts[6], partCounts[6];
+    wholeStats.getCounts(wholeCounts[0], wholeCounts[1], wholeCounts[2], wholeCounts[3], wholeCounts[4], wholeCounts[5]);
+    partStats.getCounts(partCounts[0], partCounts[1], partCounts[2], partCounts[3], partCounts[4], partCounts[5]);
+    for (int i = 0; i < 6; ++i)
+    {
+        if (wholeCounts[i] != partCounts[i])
+        {
+            setFailed("mismatch in partitioned value class count " + AString::number(i));
+        }
+    }
+    if (wholeStats.getMin() != partStats.getMin() || wholeStats.getMax() != partStats.getMax())
+    {
+        setFailed("mismatch in range of partitioned statistics");
+    }
+    if (abs(wholeStats.getMean() - partStats.getMean()) > tolerance ||
+        abs(wholeStats.getSampleStdDev() - partStats.getSampleStdDev()) > tolerance)
+    {
+        setFailed(AString("mismatch in partitioned mean or stddev, whole: ") + AString::number(wholeStats.getMean()) + ", partitioned: " + AString::number(partStats.getMean()));
+    }
+    if (wholeStats.getApproxPositivePercentile(90.0f) != partStats.getApproxPositivePercentile(90.0f) ||
+        wholeStats.getApproxNegativePercentile(90.0f) != partStats.getApproxNegativePercentile(90.0f) ||
+        wholeStats.getApproxAbsolutePercentile(90.0f) != partStats.getApproxAbsolutePercentile(90.0f))
+    {
+        setFailed("mismatch in percentiles of partitioned statistics");
+    }
+    if (!sameHistogram(wholeHist, partHist))
+    {
+        setFailed("mismatch in partitioned histogram");
+    }
+    if ((int64_t)partSummaries.size() != reader.getNumberOfParts())
+    {
+        setFailed("wrong number of part summaries");
+        return;
+    }
+    for (int64_t part = 0; part < reader.getNumberOfParts(); ++part)
+    {//range includes infinities, mean doesn't
+        float partMin = numeric_limits<float>::infinity(), partMax = -numeric_limits<float>::infinity();
+        double sum = 0.0;
+        int64_t finiteCount = 0;
+        for (int64_t i = reader.getStart(part); i < reader.getStart(part + 1); ++i)
+        {
+            if (data[i] != data[i]) continue;
+            partMin = min(partMin, data[i]);
+            partMax = max(partMax, data[i]);
+            if (abs(data[i]) == numeric_limits<float>::infinity()) continue;
+            sum += data[i];
+            ++finiteCount;
+        }
+        const float partMean = (finiteCount > 0 ? sum / finiteCount : 0.0f);
+        if (partSummaries[part].m_min != partMin || partSummaries[part].m_max != partMax ||
+            abs(partSummaries[part].m_mean - partMean) > tolerance)
+        {
+            setFailed("mismatch in summary of part " + AString::number(part));
+        }
+    }
+}
+
+void StatisticsTest::testBinaryRoundTrip(const FastStatistics& stats, const Histogram& hist)
+{
+    vector<char> buffer;
+    stats.appendBinary(buffer);
+    hist.appendBinary(buffer);
+    const char* position = buffer.data();
+    const char* end = buffer.data() + buffer.size();
+    FastStatistics readStats;
+    Histogram readHist;
+    if (!readStats.readBinary(position, end) || !readHist.readBinary(position, end))
+    {
+        setFailed("failed to read back statistics written by appendBinary");
+        return;
+    }
+    if (position != end)
+    {
+        setFailed("readBinary did not consume exactly what appendBinary wrote");
+    }
+    if (!sameStatistics(stats, readStats) || !sameHistogram(hist, readHist))
+    {
+        setFailed("mismatch in statistics or histogram after appendBinary/readBinary");
+    }
+    position = buffer.data();
+    FastStatistics truncatedStats;
+    if (truncatedStats.readBinary(position, buffer.data() + buffer.size() / 4))
+    {
+        setFailed("readBinary accepted truncated statistics");
+    }
+    if (position != buffer.data())
+    {
+        setFailed("readBinary advanced position on truncated statistics");
+    }
+}
+
+void StatisticsTest::testSidecar(const FastStatistics& stats, const Histogram& hist)
+{
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid())
+    {
+        setFailed("unable to create temporary directory for sidecar test");
+        return;
+    }
+    const AString dataFileName = AString(tempDir.path()) + "/sidecarTest.dscalar.nii";
+    QFile dataFile(dataFileName);
+    if (!dataFile.open(QIODevice::WriteOnly) || dataFile.write("sidecar test data") < 0)
+    {
+        setFailed("unable to write data file for sidecar test");
+        return;
+    }
+    dataFile.close();
+    const bool wasEnabled = DataFileStatisticsSidecar::isEnabled();
+    DataFileStatisticsSidecar::setEnabled(true);
+    vector<PartitionedStatistics::PartSummary> mapSummaries(3);
+    mapSummaries[0].m_min = -2.0f;
+    mapSummaries[0].m_max = 5.0f;
+    mapSummaries[0].m_mean = 1.5f;
+    mapSummaries[1].m_min = -numeric_limits<float>::infinity();
+    mapSummaries[1].m_max = numeric_limits<float>::infinity();
+    mapSummaries[1].m_mean = -0.25f;//third is left as a map with no values
+    DataFileStatisticsSidecar::write(dataFileName, &stats, &hist, mapSummaries);
+    CaretPointer<FastStatistics> readStats;
+    CaretPointer<Histogram> readHist;
+    vector<PartitionedStatistics::PartSummary> readSummaries;
+    if (!DataFileStatisticsSidecar::read(dataFileName, readStats, readHist, readSummaries) || readStats == NULL || readHist == NULL)
+    {
+        setFailed("sidecar for an unchanged data file was not read");
+    } else if (!sameStatistics(stats, *readStats) || !sameHistogram(hist, *readHist)) {
+        setFailed("mismatch in statistics or histogram read from sidecar");
+    } else if (readSummaries.size() != mapSummaries.size()) {
+        setFailed("wrong number of map summaries read from sidecar");
+    } else {
+        for (size_t i = 0; i < mapSummaries.size(); ++i)
+        {
+            if (readSummaries[i].m_min != mapSummaries[i].m_min || readSummaries[i].m_max != mapSummaries[i].m_max ||
+                readSummaries[i].m_mean != mapSummaries[i].m_mean)
+            {
+                setFailed("mismatch in map summary " + AString::number(i) + " read from sidecar");
+            }
+        }
+    }
+    
+    //same size, different modification time
+    QDateTime modified = QFileInfo(dataFileName).lastModified();
+    if (!dataFile.open(QIODevice::ReadWrite) || !dataFile.setFileTime(modified.addSecs(-3600), QFileDevice::FileModificationTime))
+    {
+        setFailed("unable to change modification time for sidecar test");
+    } else {
+        dataFile.close();
+        if (DataFileStatisticsSidecar::read(dataFileName, readStats, readHist, readSummaries))
+        {
+            setFailed("sidecar was used after the data file modification time changed");
+        }
+    }
+    
+    //same modification time, different size
+    DataFileStatisticsSidecar::write(dataFileName, &stats, &hist, mapSummaries);
+    modified = QFileInfo(dataFileName).lastModified();
+    if (!dataFile.open(QIODevice::Append) || dataFile.write("more") < 0)
+    {
+        setFailed("unable to append to data file for sidecar test");
+    } else {
+        dataFile.flush();
+        dataFile.setFileTime(modified, QFileDevice::FileModificationTime);
+        dataFile.close();
+        if (DataFileStatisticsSidecar::read(dataFileName, readStats, readHist, readSummaries))
+        {
+            setFailed("sidecar was used after the data file size changed");
+        }
+    }
+    DataFileStatisticsSidecar::setEnabled(wasEnabled);
+}
+
+bool StatisticsTest::sameStatistics(const FastStatistics& first, const FastStatistics& second)
+{
+    int64_t firstCounts[6], secondCounts[6];
+    first.getCounts(firstCounts[0], firstCounts[1], firstCounts[2], firstCounts[3], firstCounts[4], firstCounts[5]);
+    second.getCounts(secondCounts[0], secondCounts[1], secondCounts[2], secondCounts[3], secondCounts[4], secondCounts[5]);
+    for (int i = 0; i < 6; ++i)
+    {
+        if (firstCounts[i] != secondCounts[i]) return false;
+    }
+    float firstRanges[4], secondRanges[4];
+    first.getNonzeroRanges(firstRanges[0], firstRanges[1], firstRanges[2], firstRanges[3]);
+    second.getNonzeroRanges(secondRanges[0], secondRanges[1], secondRanges[2], secondRanges[3]);
+    for (int i = 0; i < 4; ++i)
+    {
+        if (firstRanges[i] != secondRanges[i]) return false;
+    }
+    return first.getMin() == second.getMin() && first.getMax() == second.getMax() &&
+           first.getMean() == second.getMean() &&
+           first.getSampleStdDev() == second.getSampleStdDev() &&
+           first.getPopulationStdDev() == second.getPopulationStdDev() &&
+           first.getApproxPositivePercentile(90.0f) == second.getApproxPositivePercentile(90.0f) &&
+           first.getApproxNegativePercentile(90.0f) == second.getApproxNegativePercentile(90.0f) &&
+           first.getApproxAbsolutePercentile(90.0f) == second.getApproxAbsolutePercentile(90.0f);
+}
+
+bool StatisticsTest::sameHistogram(const Histogram& first, const Histogram& second)
+{
+    float firstMin, firstMax, secondMin, secondMax;
+    first.getRange(firstMin, firstMax);
+    second.getRange(secondMin, secondMax);
+    return firstMin == secondMin && firstMax == secondMax &&
+           first.getHistogramCounts() == second.getHistogramCounts();
 }
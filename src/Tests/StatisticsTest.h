@@ -24,11 +24,20 @@
 
 namespace caret {
 
+   class FastStatistics;
+   class Histogram;
+
    class StatisticsTest : public TestInterface
    {
    public:
       StatisticsTest(const AString& identifier);
       virtual void execute();
+   private:
+      void testPartitioned(const float* data, const int64_t& count, const float& tolerance);
+      void testBinaryRoundTrip(const FastStatistics& stats, const Histogram& hist);
+      void testSidecar(const FastStatistics& stats, const Histogram& hist);
+      static bool sameStatistics(const FastStatistics& first, const FastStatistics& second);
+      static bool sameHistogram(const Histogram& first, const Histogram& second);
    };
 
 }
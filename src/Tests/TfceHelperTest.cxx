@@ -0,0 +1,162 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TfceHelperTest.h"
+
+#include "TfceHelper.h"
+#include "VolumeSpace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TfceHelperTest::TfceHelperTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t DIMS[3] = { 9, 7, 5 };
+    const int64_t NUM_VOXELS = DIMS[0] * DIMS[1] * DIMS[2];
+    
+    ///straightforward TFCE: for each distinct value, find the clusters at that threshold by flood fill, and add the slice down to the next lower value
+    void bruteForceTfce(const vector<float>& data, const vector<float>& roi, const float& voxelVolume, const float& param_e, const float& param_h, vector<double>& accumOut)
+    {
+        accumOut.assign(NUM_VOXELS, 0.0);
+        for (int sign = 0; sign < 2; ++sign)
+        {
+            vector<float> values(NUM_VOXELS, 0.0f);
+            vector<float> levels;
+            for (int64_t i = 0; i < NUM_VOXELS; ++i)
+            {
+                if (roi[i] > 0.0f)
+                {
+                    values[i] = (sign == 0) ? data[i] : -data[i];
+                    if (values[i] > 0.0f) levels.push_back(values[i]);
+                }
+            }
+            sort(levels.begin(), levels.end());
+            levels.erase(unique(levels.begin(), levels.end()), levels.end());
+            for (int l = (int)levels.size() - 1; l >= 0; --l)
+            {
+                double top = levels[l], bottom = (l > 0) ? levels[l - 1] : 0.0;
+                double integrated_h = param_h + 1.0;
+                double slice = (pow(top, integrated_h) - pow(bottom, integrated_h)) / integrated_h;
+                vector<int64_t> cluster(NUM_VOXELS, -1), members;
+                for (int64_t seed = 0; seed < NUM_VOXELS; ++seed)
+                {
+                    if (!(values[seed] >= top) || cluster[seed] != -1) continue;
+                    members.clear();
+                    members.push_back(seed);
+                    cluster[seed] = seed;
+                    for (size_t m = 0; m < members.size(); ++m)
+                    {
+                        int64_t index = members[m];
+                        int64_t ijk[3] = { index % DIMS[0], (index / DIMS[0]) % DIMS[1], index / (DIMS[0] * DIMS[1]) };
+                        int64_t stride = 1;
+                        for (int axis = 0; axis < 3; ++axis)
+                        {
+                            if (ijk[axis] > 0 && values[index - stride] >= top && cluster[index - stride] == -1)
+                            {
+                                cluster[index - stride] = seed;
+                                members.push_back(index - stride);
+                            }
+                            if (ijk[axis] + 1 < DIMS[axis] && values[index + stride] >= top && cluster[index + stride] == -1)
+                            {
+                                cluster[index + stride] = seed;
+                                members.push_back(index + stride);
+                            }
+                            stride *= DIMS[axis];
+                        }
+                    }
+                    double contribution = pow(members.size() * (double)voxelVolume, (double)param_e) * slice;
+                    for (size_t m = 0; m < members.size(); ++m)
+                    {
+                        accumOut[members[m]] += contribution;
+                    }
+                }
+            }
+        }
+        for (int64_t i = 0; i < NUM_VOXELS; ++i)
+        {
+            if (data[i] < 0.0f) accumOut[i] = -accumOut[i];
+        }
+    }
+}
+
+void TfceHelperTest::execute()
+{
+    const float sform[12] = { 2.0f, 0.0f, 0.0f, -10.0f,
+                              0.0f, 2.0f, 0.0f, -10.0f,
+                              0.0f, 0.0f, 2.0f, -10.0f };
+    VolumeSpace mySpace(DIMS, sform);
+    const float voxelVolume = 8.0f, param_e = 0.5f, param_h = 2.0f;
+    const int NUM_MAPS = 6;
+    vector<vector<float> > inputs(NUM_MAPS, vector<float>(NUM_VOXELS)), outputs(NUM_MAPS, vector<float>(NUM_VOXELS));
+    for (int m = 0; m < NUM_MAPS; ++m)
+    {
+        for (int64_t i = 0; i < NUM_VOXELS; ++i)
+        {//quarter steps, so there are ties and plateaus that merge several clusters at the same value
+            inputs[m][i] = (rand() % 33 - 16) * 0.25f;
+        }
+    }
+    vector<float> fullRoi(NUM_VOXELS, 1.0f), partialRoi(NUM_VOXELS);
+    for (int64_t i = 0; i < NUM_VOXELS; ++i)
+    {
+        partialRoi[i] = (rand() % 4 == 0) ? 0.0f : 1.0f;
+    }
+    vector<double> expected;
+    for (int useRoi = 0; !failed() && useRoi < 2; ++useRoi)
+    {
+        const vector<float>& roi = useRoi ? partialRoi : fullRoi;
+        TfceHelper myHelper(mySpace, useRoi ? roi.data() : NULL, param_e, param_h);
+        vector<const float*> batchIn;
+        vector<float*> batchOut;
+        for (int m = 0; m < NUM_MAPS; ++m)
+        {
+            batchIn.push_back(inputs[m].data());
+            batchOut.push_back(outputs[m].data());
+        }
+        myHelper.computeBatch(batchIn, batchOut);
+        vector<float> single(NUM_VOXELS);
+        for (int m = 0; !failed() && m < NUM_MAPS; ++m)
+        {
+            bruteForceTfce(inputs[m], roi, voxelVolume, param_e, param_h, expected);
+            myHelper.compute(inputs[m].data(), single.data());
+            for (int64_t i = 0; i < NUM_VOXELS; ++i)
+            {
+                if (single[i] != outputs[m][i])
+                {
+                    setFailed("computeBatch and compute differ at voxel " + AString::number(i) + " of map " + AString::number(m) + (useRoi ? " with roi" : ""));
+                    break;
+                }
+                if (abs(single[i] - expected[i]) > 0.0001 * abs(expected[i]) + 0.00001)
+                {
+                    setFailed("mismatch at voxel " + AString::number(i) + " of map " + AString::number(m) + (useRoi ? " with roi" : "") +
+                              ", expected " + AString::number(expected[i]) + ", got " + AString::number(single[i]));
+                    break;
+                }
+            }
+        }
+    }
+}
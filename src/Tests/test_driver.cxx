@@ -33,7 +33,9 @@
 #include "CaretException.h"
 
 //tests
+#include "Base64DecoderTest.h"
 #include "CiftiFileTest.h"
+#include "CorrelationTest.h"
 #include "DotTest.h"
 #include "GeodesicHelperTest.h"
 #include "HttpTest.h"
@@ -45,6 +47,7 @@
 #include "ProgressTest.h"
 #include "QuatTest.h"
 #include "StatisticsTest.h"
+#include "TfceHelperTest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
 #include "VolumeFileTest.h"
@@ -69,7 +72,9 @@ int main(int argc, char** argv)
         caret_global_commandLine_init(argc, argv);
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
+        mytests.push_back(new Base64DecoderTest("base64decoder"));
         mytests.push_back(new CiftiFileTest("ciftifile"));
+        mytests.push_back(new CorrelationTest("correlation"));
         mytests.push_back(new DotTest("dotsimd"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
         mytests.push_back(new HeapTest("heap"));
@@ -82,6 +87,7 @@ int main(int argc, char** argv)
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
         mytests.push_back(new StatisticsTest("statistics"));
+        mytests.push_back(new TfceHelperTest("tfcehelper"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
         mytests.push_back(new VolumeFileTest("volumefile"));
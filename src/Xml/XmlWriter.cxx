@@ -296,6 +296,31 @@ XmlWriter::writeElementNoSpace(const AString& localName, const AString& text) {
    this->writeTextToOutputStream("</" + localName + ">\n");
 }
 
+/**
+ * Write an element with no spacing between start and end tags.  The text
+ * is written without conversion, so it must be ASCII (such as base64)
+ * and must not contain characters that need escaping.
+ *
+ * @param localName - local name of tag to write.
+ * @param text - text to write, does not need to be null terminated.
+ * @param textLength - number of characters in the text.
+ * @throws XmlException if an I/O error occurs.
+ */
+void
+XmlWriter::writeElementNoSpace(const AString& localName, const char* text, const int64_t textLength) {
+   this->writeIndentation();
+   this->writeTextToOutputStream("<" + localName + ">");
+   switch (this->outputStreamType) {
+       case OUTPUT_STREAM_Q_TEXT_STREAM:
+           *qTextStreamWriter << QLatin1String(text, textLength);
+           break;
+       case OUTPUT_STREAM_STD_OUTPUT_STREAM:
+           stdOutputStreamWriter->write(text, textLength);
+           break;
+   }
+   this->writeTextToOutputStream("</" + localName + ">\n");
+}
+
 /**
  * Writes a start tag to the output.
  *